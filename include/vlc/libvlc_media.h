@@ -811,6 +811,9 @@ typedef enum libvlc_thumbnailer_seek_speed_t
 {
     libvlc_media_thumbnail_seek_precise,
     libvlc_media_thumbnail_seek_fast,
+    /** Decode only keyframes, from the one found by a fast seek
+     * \version libvlc 4.0 or later */
+    libvlc_media_thumbnail_seek_keyframe,
 } libvlc_thumbnailer_seek_speed_t;
 
 /**
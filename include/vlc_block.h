@@ -91,6 +91,8 @@
 #define BLOCK_FLAG_BOTTOM_FIELD_FIRST 0x1000
 /** This block contains a single field from interlaced picture. */
 #define BLOCK_FLAG_SINGLE_FIELD  0x2000
+/** This block is not used as a reference to decode any other block */
+#define BLOCK_FLAG_DISPOSABLE    0x4000
 
 /** This block contains an interlaced picture */
 #define BLOCK_FLAG_INTERLACED_MASK \
@@ -230,6 +232,37 @@ static inline block_t *block_Duplicate( const block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Makes a block shareable.
+ *
+ * Wraps a block so that parts of its data can be referenced by other blocks
+ * without copying, see block_Slice(). The data is released with the last
+ * block referencing it.
+ *
+ * @note The data of a shared block and of its slices must not be modified,
+ * as other blocks may reference it. Slices have no spare room, so that
+ * block_Realloc() copies them whenever they grow.
+ *
+ * @return the shared block (or the same block if it is already shared),
+ * or the unmodified block on memory error, which then cannot be sliced.
+ */
+VLC_API block_t *block_Share(block_t *) VLC_USED;
+
+/**
+ * References a part of a shared block.
+ *
+ * Creates a block referencing a part of the data of a block returned by
+ * block_Share() or by this function, without copying it. The properties
+ * of the block are copied.
+ *
+ * @param offset offset of the part from the block payload start
+ * @param length byte length of the part
+ *
+ * @return the new block, or NULL if the block is not shared, the part is
+ * not within its payload, or on memory error.
+ */
+VLC_API block_t *block_Slice(block_t *, size_t offset, size_t length) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -430,6 +463,15 @@ static inline block_t *block_ChainGather( block_t *p_list )
     return g;
 }
 
+/**
+ * Gathers a chain into a single block.
+ *
+ * Same as block_ChainGather(), except that a chain of contiguous slices of
+ * the same shared block is gathered into a single slice, without copying.
+ * Otherwise the chain is copied as block_ChainGather() does.
+ */
+VLC_API block_t *block_ChainGatherShared(block_t *) VLC_USED;
+
 /**
  * @}
  * \defgroup fifo Block FIFO
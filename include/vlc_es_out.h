@@ -24,6 +24,8 @@
 #ifndef VLC_ES_OUT_H
 #define VLC_ES_OUT_H 1
 
+#include <vlc_block.h>
+
 /**
  * \defgroup es_out ES output
  * \ingroup input
@@ -130,6 +132,9 @@ struct es_out_callbacks
     void         (*del)(es_out_t *, es_out_id_t *);
     int          (*control)(es_out_t *, int query, va_list);
     void         (*destroy)(es_out_t *);
+    /* Optional: sends a chain of blocks belonging to the same ES at once.
+     * When NULL, es_out_SendChain() falls back to one send() per block. */
+    int          (*send_chain)(es_out_t *, es_out_id_t *, block_t *);
 };
 
 struct es_out_t
@@ -154,6 +159,32 @@ static inline int es_out_Send( es_out_t *out, es_out_id_t *id,
     return out->cbs->send( out, id, p_block );
 }
 
+/**
+ * Sends a chain of blocks to an ES.
+ *
+ * All blocks of the chain (linked through p_next) must belong to the same
+ * ES and be in decoding order. The es_out takes ownership of the whole chain.
+ * This is equivalent to calling es_out_Send() for each block, but allows the
+ * es_out to hand the chain to the decoder in a single operation.
+ */
+static inline int es_out_SendChain( es_out_t *out, es_out_id_t *id,
+                                    block_t *p_chain )
+{
+    if( out->cbs->send_chain != NULL )
+        return out->cbs->send_chain( out, id, p_chain );
+
+    int i_ret = VLC_SUCCESS;
+    while( p_chain != NULL )
+    {
+        block_t *p_next = p_chain->p_next;
+        p_chain->p_next = NULL;
+        if( out->cbs->send( out, id, p_chain ) != VLC_SUCCESS )
+            i_ret = VLC_EGENERIC;
+        p_chain = p_next;
+    }
+    return i_ret;
+}
+
 static inline int es_out_vaControl( es_out_t *out, int i_query, va_list args )
 {
     return out->cbs->control( out, i_query, args );
@@ -413,6 +413,25 @@ VLC_API void libvlc_MetadataCancel( libvlc_int_t *, void * );
 /******************
  * Input stats
  ******************/
+
+/**
+ * Number of bins of the input statistics histograms.
+ *
+ * The histograms are indexed by the binary logarithm of a duration in
+ * milliseconds: bin 0 counts durations below 1 ms, bin 1 from 1 to 2 ms,
+ * bin 2 from 2 to 4 ms and so on. The last bin counts all the durations
+ * above its lower bound.
+ *
+ * Signed histograms use the upper half of the bins for positive values,
+ * and mirror it in the lower half for negative values: the bin at
+ * INPUT_STATS_HISTOGRAM_SIZE / 2 counts values from 0 to 1 ms, the one
+ * below it values from -1 to 0 ms.
+ *
+ * Queue depth histograms use the same scale for numbers of elements: bin 0
+ * counts empty queues, bin 1 a single element, bin 2 two or three, and so on.
+ */
+#define INPUT_STATS_HISTOGRAM_SIZE 16
+
 struct input_stats_t
 {
     /* Input */
@@ -430,6 +449,22 @@ struct input_stats_t
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
+    /** Time spent in the packetizers of the decoders */
+    vlc_tick_t i_packetizer_time;
+    /** Time spent in the decoder modules, output queuing included */
+    vlc_tick_t i_decoder_time;
+    /** Time spent in the video and audio decoder modules per block */
+    int64_t i_video_decode_time[INPUT_STATS_HISTOGRAM_SIZE];
+    int64_t i_audio_decode_time[INPUT_STATS_HISTOGRAM_SIZE];
+    /** Number of blocks left in the video and audio decoder FIFOs when a
+     * block is dequeued */
+    int64_t i_video_fifo_depth[INPUT_STATS_HISTOGRAM_SIZE];
+    int64_t i_audio_fifo_depth[INPUT_STATS_HISTOGRAM_SIZE];
+    /** Time spent by the video decoders waiting for a free picture */
+    int64_t i_picture_wait[INPUT_STATS_HISTOGRAM_SIZE];
+    /** Delay until the pictures queued to the video output are due
+     * (signed: negative if late) */
+    int64_t i_vout_latency[INPUT_STATS_HISTOGRAM_SIZE];
 
     /* Vout */
     int64_t i_displayed_pictures;
@@ -438,6 +473,28 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Aout synchronization */
+    /** Drift between the actual and the intended playback time of the
+     * audio buffers (signed: negative if early, positive if late) */
+    int64_t i_aout_drift[INPUT_STATS_HISTOGRAM_SIZE];
+    /** Audio output latency, i.e. delay until the buffers are played */
+    int64_t i_aout_latency[INPUT_STATS_HISTOGRAM_SIZE];
+    /** Audio buffers played while resampling to correct the drift */
+    int64_t i_aout_resampled_abuffers;
+    /** Silence insertions to correct early playback */
+    int64_t i_aout_silences;
+    /** Output flushes to correct late playback */
+    int64_t i_aout_flushes;
+    /** Current drift correction resampling ratio (1 if not resampling) */
+    float f_aout_resampling;
+    /** Momentary, short-term and integrated loudness (LUFS), and true peak
+     * level of the last 100ms (dBTP), as measured by the loudness audio
+     * filter (NaN if not measured) */
+    float f_loudness_momentary;
+    float f_loudness_shortterm;
+    float f_loudness_integrated;
+    float f_loudness_true_peak;
 };
 
 /**
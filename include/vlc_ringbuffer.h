@@ -0,0 +1,150 @@
+/*****************************************************************************
+ * vlc_ringbuffer.h: lock-free single producer single consumer ring buffer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_RINGBUFFER_H
+#define VLC_RINGBUFFER_H 1
+
+/**
+ * \defgroup ringbuffer Ring buffer
+ * \ingroup misc
+ * Lock-free single producer, single consumer byte ring
+ *
+ * The ring buffer is meant to hand samples over from a thread that may block
+ * (typically the audio output play callback) to a real-time thread that must
+ * not (typically the callback of a pull-model audio API).
+ *
+ * There must be at most one producer thread and one consumer thread at any
+ * given time. Functions documented as "consumer side" never lock, allocate
+ * nor free memory, and are safe to call from a real-time context.
+ * @{
+ * \file
+ */
+
+typedef struct vlc_ringbuffer vlc_ringbuffer_t;
+
+/**
+ * Creates a ring buffer.
+ *
+ * \param size minimum capacity in bytes (rounded up to a power of two)
+ * \return the ring buffer or NULL on allocation error
+ */
+VLC_API vlc_ringbuffer_t *vlc_ringbuffer_New(size_t size) VLC_USED;
+
+/**
+ * Destroys a ring buffer.
+ *
+ * Neither the producer nor the consumer may use the buffer anymore.
+ */
+VLC_API void vlc_ringbuffer_Delete(vlc_ringbuffer_t *);
+
+/**
+ * Locks the ring buffer in physical memory.
+ *
+ * This prevents the real-time thread from page faulting when it accesses
+ * the buffer. The memory is unlocked when the buffer is destroyed.
+ *
+ * \return VLC_SUCCESS, or an error if the memory could not be locked (e.g.
+ * insufficient privileges); the buffer is usable anyway
+ */
+VLC_API int vlc_ringbuffer_Lock(vlc_ringbuffer_t *);
+
+/**
+ * Returns the capacity of the ring buffer in bytes.
+ */
+VLC_API size_t vlc_ringbuffer_GetSize(const vlc_ringbuffer_t *) VLC_USED;
+
+/**
+ * Writes data into the ring buffer (producer side).
+ *
+ * \return the number of bytes written, lower than len if the buffer is full
+ */
+VLC_API size_t vlc_ringbuffer_Write(vlc_ringbuffer_t *, const void *buf,
+                                    size_t len);
+
+/**
+ * Returns the number of bytes that can be written (producer side).
+ */
+VLC_API size_t vlc_ringbuffer_WriteSpace(vlc_ringbuffer_t *) VLC_USED;
+
+/**
+ * Discards all the buffered data (producer side).
+ *
+ * The consumer drops the data on its next read. Until then, the data is
+ * no longer accounted by vlc_ringbuffer_ReadSpace() and
+ * vlc_ringbuffer_GetDelay(), but it still occupies the buffer.
+ */
+VLC_API void vlc_ringbuffer_Flush(vlc_ringbuffer_t *);
+
+/**
+ * Reads data from the ring buffer (consumer side).
+ *
+ * \param buf destination buffer, or NULL to skip data
+ * \return the number of bytes read, lower than len on underflow
+ */
+VLC_API size_t vlc_ringbuffer_Read(vlc_ringbuffer_t *, void *buf, size_t len);
+
+/**
+ * Reads interleaved single precision samples into planar buffers
+ * (consumer side).
+ *
+ * Only whole frames are read.
+ *
+ * \param planes table of channels destination buffers
+ * \param channels number of channels
+ * \param frames maximum number of frames to read
+ * \return the number of frames read
+ */
+VLC_API size_t vlc_ringbuffer_ReadDeinterleave(vlc_ringbuffer_t *,
+                                               float *const *planes,
+                                               unsigned channels,
+                                               size_t frames);
+
+/**
+ * Returns the number of bytes that can be read.
+ *
+ * This can be called from either side.
+ */
+VLC_API size_t vlc_ringbuffer_ReadSpace(vlc_ringbuffer_t *) VLC_USED;
+
+/**
+ * Records when the data read last will be done playing (consumer side).
+ *
+ * \param date system time when the last read sample leaves the speakers,
+ * or VLC_TICK_INVALID if unknown
+ */
+VLC_API void vlc_ringbuffer_SetPlayedDate(vlc_ringbuffer_t *,
+                                          vlc_tick_t date);
+
+/**
+ * Computes the playback delay of the buffered data (producer side).
+ *
+ * The delay is the duration of the buffered data, plus the time remaining
+ * until the date set by vlc_ringbuffer_SetPlayedDate(), if any.
+ *
+ * \param bytes_per_frame size of an audio frame in bytes
+ * \param rate sample rate in Hz
+ */
+VLC_API vlc_tick_t vlc_ringbuffer_GetDelay(vlc_ringbuffer_t *,
+                                           size_t bytes_per_frame,
+                                           unsigned rate) VLC_USED;
+
+/** @} */
+
+#endif /* VLC_RINGBUFFER_H */
@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * vlc_seekindex.h: persistent demuxer seek index cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SEEKINDEX_H
+#define VLC_SEEKINDEX_H 1
+
+/**
+ * \defgroup seekindex Seek index cache
+ * \ingroup input
+ * Persistent cache of demuxer seek indexes
+ *
+ * Demuxers that have to scan a file to seek accurately can save the result
+ * in the user cache directory, and reuse it the next time the same file is
+ * opened. A cached index is identified by the demuxer name and the URL of
+ * the stream, and is only valid for the size and modification time that
+ * the file had when the index was stored.
+ *
+ * Only local files are cached, as the modification time of other sources
+ * cannot be known.
+ * @{
+ * \file
+ */
+
+/**
+ * Seek index entry
+ *
+ * Except for vlc_seekindex_Find(), the meaning of the fields is defined by
+ * each demuxer.
+ */
+typedef struct vlc_seekindex_entry
+{
+    vlc_tick_t time; /**< Timestamp */
+    uint64_t offset; /**< Byte offset in the stream */
+    uint32_t size; /**< Data size */
+    uint32_t track; /**< Track identifier */
+    uint32_t flags; /**< Flags */
+} vlc_seekindex_entry_t;
+
+typedef struct vlc_seekindex vlc_seekindex_t;
+
+/**
+ * Creates an (empty) seek index for a stream.
+ *
+ * \param obj object used for logging and configuration
+ * \param s source stream
+ * \param name name of the demuxer owning the index
+ * \param version version of the demuxer index layout: an index stored with
+ * another version is ignored
+ * \return the seek index, or NULL if the stream cannot be cached (not a
+ * local file, unknown size, cache disabled or allocation error)
+ */
+VLC_API vlc_seekindex_t *vlc_seekindex_New(vlc_object_t *obj, stream_t *s,
+                                           const char *name,
+                                           uint32_t version) VLC_USED;
+#define vlc_seekindex_New(o, s, n, v) \
+        vlc_seekindex_New(VLC_OBJECT(o), s, n, v)
+
+/**
+ * Destroys a seek index (without storing it).
+ */
+VLC_API void vlc_seekindex_Delete(vlc_seekindex_t *);
+
+/**
+ * Loads the index from the cache.
+ *
+ * Any previous entry is discarded.
+ *
+ * \return VLC_SUCCESS if a matching valid index was found in the cache
+ */
+VLC_API int vlc_seekindex_Load(vlc_seekindex_t *);
+
+/**
+ * Stores the index into the cache, replacing any previous one.
+ */
+VLC_API int vlc_seekindex_Store(vlc_seekindex_t *);
+
+/**
+ * Appends an entry to the index.
+ */
+VLC_API int vlc_seekindex_Append(vlc_seekindex_t *,
+                                 const vlc_seekindex_entry_t *);
+
+/**
+ * Discards all the entries of the index.
+ */
+VLC_API void vlc_seekindex_Reset(vlc_seekindex_t *);
+
+/**
+ * Returns the entries of the index.
+ *
+ * The entries are in the order they were appended or stored. The table is
+ * valid until the index is modified.
+ */
+VLC_API const vlc_seekindex_entry_t *
+vlc_seekindex_GetEntries(const vlc_seekindex_t *, size_t *count) VLC_USED;
+
+/**
+ * Finds the last entry of a track at or before a given time.
+ *
+ * The entries of the index must have been appended in increasing time
+ * order.
+ *
+ * \param track track identifier of the entry to find
+ * \param time timestamp to seek to
+ * \return the entry, or NULL if there is none
+ */
+VLC_API const vlc_seekindex_entry_t *
+vlc_seekindex_Find(const vlc_seekindex_t *, uint32_t track,
+                   vlc_tick_t time) VLC_USED;
+
+/** @} */
+
+#endif /* VLC_SEEKINDEX_H */
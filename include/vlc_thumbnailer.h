@@ -59,6 +59,9 @@ enum vlc_thumbnailer_seek_speed
     VLC_THUMBNAILER_SEEK_PRECISE,
     /** Fast, but potentially imprecise */
     VLC_THUMBNAILER_SEEK_FAST,
+    /** Fastest: only the keyframe found by a fast seek, or a later one, is
+     * decoded */
+    VLC_THUMBNAILER_SEEK_KEYFRAME,
 };
 
 /**
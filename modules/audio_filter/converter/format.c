@@ -39,18 +39,28 @@
 #include <vlc_aout.h>
 #include <vlc_block.h>
 #include <vlc_filter.h>
+#include <vlc_rand.h>
+
+#include "format.h"
 
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open(vlc_object_t *);
+static void Close(vlc_object_t *);
+
+#define DITHER_TEXT N_("Dither when reducing to 16-bits")
+#define DITHER_LONGTEXT N_( \
+    "Add triangular dither noise when converting floating point samples " \
+    "to 16-bits integers, to decorrelate the quantization error.")
 
 vlc_module_begin()
     set_description(N_("Audio filter for PCM format conversion"))
     set_category(CAT_AUDIO)
     set_subcategory(SUBCAT_AUDIO_MISC)
     set_capability("audio converter", 1)
-    set_callbacks(Open, NULL)
+    add_bool("audio-format-dither", false, DITHER_TEXT, DITHER_LONGTEXT, true)
+    set_callbacks(Open, Close)
 vlc_module_end()
 
 /*****************************************************************************
@@ -59,6 +69,12 @@ vlc_module_end()
 
 typedef block_t *(*cvt_t)(filter_t *, block_t *);
 static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst);
+static block_t *Fl32toS16Dither(filter_t *, block_t *);
+
+typedef struct
+{
+    uint32_t dither[PCM_DITHER_LANES];
+} filter_sys_t;
 
 static int Open(vlc_object_t *object)
 {
@@ -76,12 +92,33 @@ static int Open(vlc_object_t *object)
     if (filter->pf_audio_filter == NULL)
         return VLC_EGENERIC;
 
+    filter->p_sys = NULL;
+    if (src->i_codec == VLC_CODEC_FL32 && dst->i_codec == VLC_CODEC_S16N
+     && var_InheritBool(filter, "audio-format-dither"))
+    {
+        filter_sys_t *sys = malloc(sizeof (*sys));
+        if (unlikely(sys == NULL))
+            return VLC_ENOMEM;
+        /* The generators must never be seeded with zero */
+        for (unsigned i = 0; i < PCM_DITHER_LANES; i++)
+            sys->dither[i] = vlc_mrand48() | 1;
+        filter->p_sys = sys;
+        filter->pf_audio_filter = Fl32toS16Dither;
+    }
+
     msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
             (char *)&src->i_codec, (char *)&dst->i_codec,
             src->audio.i_bitspersample, dst->audio.i_bitspersample);
     return VLC_SUCCESS;
 }
 
+static void Close(vlc_object_t *object)
+{
+    filter_t *filter = (filter_t *)object;
+
+    free(filter->p_sys);
+}
+
 
 /*** from U8 ***/
 static block_t *U8toS16(filter_t *filter, block_t *bsrc)
@@ -173,21 +210,9 @@ static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
         goto out;
 
     block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
-#else
-    {   /* This is Walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
-    }
-#endif
+    pcm_s16_to_fl32_Select()((float *)bdst->p_buffer,
+                             (const int16_t *)bsrc->p_buffer,
+                             bsrc->i_buffer / 2);
 out:
     block_Release(bsrc);
     VLC_UNUSED(filter);
@@ -253,46 +278,28 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
 static block_t *Fl32toS16(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
-    float   *src = (float *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
+    /* In place: each vector is loaded before its narrower result is stored */
+    pcm_fl32_to_s16_Select()((int16_t *)b->p_buffer,
+                             (const float *)b->p_buffer, b->i_buffer / 4);
+    b->i_buffer /= 2;
+    return b;
+}
+
+static block_t *Fl32toS16Dither(filter_t *filter, block_t *b)
+{
+    filter_sys_t *sys = filter->p_sys;
+
+    pcm_fl32_to_s16_dither_Select()((int16_t *)b->p_buffer,
+                                    (const float *)b->p_buffer,
+                                    b->i_buffer / 4, sys->dither);
     b->i_buffer /= 2;
     return b;
 }
 
 static block_t *Fl32toS32(filter_t *filter, block_t *b)
 {
-    float   *src = (float *)b->p_buffer;
-    int32_t *dst = (int32_t *)src;
-    for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * 2147483648.f;
-        if (s >= 2147483647.f)
-            *(dst++) = 2147483647;
-        else
-        if (s <= -2147483648.f)
-            *(dst++) = -2147483648;
-        else
-            *(dst++) = lroundf(s);
-    }
+    pcm_fl32_to_s32_Select()((int32_t *)b->p_buffer,
+                             (const float *)b->p_buffer, b->i_buffer / 4);
     VLC_UNUSED(filter);
     return b;
 }
@@ -343,10 +350,8 @@ static block_t *S32toS16(filter_t *filter, block_t *b)
 static block_t *S32toFl32(filter_t *filter, block_t *b)
 {
     VLC_UNUSED(filter);
-    int32_t *src = (int32_t*)b->p_buffer;
-    float   *dst = (float *)src;
-    for (int i = b->i_buffer / 4; i--;)
-        *dst++ = (float)(*src++) / 2147483648.f;
+    pcm_s32_to_fl32_Select()((float *)b->p_buffer,
+                             (const int32_t *)b->p_buffer, b->i_buffer / 4);
     return b;
 }
 
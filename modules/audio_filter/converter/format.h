@@ -0,0 +1,504 @@
+/*****************************************************************************
+ * format.h : PCM format conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_AUDIO_FORMAT_CONVERTER_H_
+#define VLC_AUDIO_FORMAT_CONVERTER_H_
+
+#include <math.h>
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <emmintrin.h>
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+# include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+# define PCM_CONVERT_NEON 1
+#endif
+
+/* All the kernels of a given conversion produce bit-exact results: the
+ * vector versions round to nearest even like the scalar ones and saturate
+ * to the same limits. NaN inputs are not defined.
+ *
+ * The float to integer conversions may run in place (dst == src). */
+
+typedef void (*pcm_s16_fl32_t)(float *, const int16_t *, size_t);
+typedef void (*pcm_fl32_s16_t)(int16_t *, const float *, size_t);
+typedef void (*pcm_fl32_s16_dither_t)(int16_t *, const float *, size_t,
+                                      uint32_t *);
+typedef void (*pcm_s32_fl32_t)(float *, const int32_t *, size_t);
+typedef void (*pcm_fl32_s32_t)(int32_t *, const float *, size_t);
+
+/* Number of independent dither generators, one per vector lane */
+#define PCM_DITHER_LANES 8
+
+/* Triangular (TPDF) dither, in units of one S16 LSB */
+static inline uint32_t pcm_dither_next(uint32_t *state)
+{
+    uint32_t s = *state;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    *state = s;
+    return s;
+}
+
+static inline float pcm_dither_tpdf(uint32_t s)
+{
+    return (float)((int32_t)(s >> 16) - (int32_t)(s & 0xffff))
+           * (1.f / 65536.f);
+}
+
+/*** Scalar ***/
+static inline void pcm_s16_to_fl32_c(float *dst, const int16_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {   /* This is Walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        u.i = src[i] + 0x43c00000;
+        dst[i] = u.f - 384.f;
+    }
+}
+
+static inline void pcm_fl32_to_s16_c(int16_t *dst, const float *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {   /* This is Walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        u.f = src[i] + 384.f;
+        if (u.i > 0x43c07fff)
+            dst[i] = 32767;
+        else if (u.i < 0x43bf8000)
+            dst[i] = -32768;
+        else
+            dst[i] = u.i - 0x43c00000;
+    }
+}
+
+static inline void pcm_fl32_to_s16_dither_c(int16_t *dst, const float *src,
+                                            size_t n, uint32_t *state)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t r = pcm_dither_next(&state[i % PCM_DITHER_LANES]);
+        float s = src[i] * 32768.f + pcm_dither_tpdf(r);
+
+        if (s >= 32767.f)
+            dst[i] = 32767;
+        else if (s <= -32768.f)
+            dst[i] = -32768;
+        else
+            dst[i] = lrintf(s);
+    }
+}
+
+static inline void pcm_s32_to_fl32_c(float *dst, const int32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (float)src[i] / 2147483648.f;
+}
+
+static inline void pcm_fl32_to_s32_c(int32_t *dst, const float *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        float s = src[i] * 2147483648.f;
+        if (s >= 2147483647.f)
+            dst[i] = 2147483647;
+        else if (s <= -2147483648.f)
+            dst[i] = -2147483648;
+        else
+            dst[i] = lrintf(s);
+    }
+}
+
+/*** SSE2 ***/
+#if defined(HAVE_SSE2_INTRINSICS)
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_s16_to_fl32_sse2(float *dst, const int16_t *src,
+                                        size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    pcm_s16_to_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i pcm_fl32_to_s32x4_sse2(__m128 s, __m128 min, __m128 max)
+{
+    return _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(s, max), min));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_fl32_to_s16_sse2(int16_t *dst, const float *src,
+                                        size_t n)
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+        __m128i v = _mm_packs_epi32(pcm_fl32_to_s32x4_sse2(a, min, max),
+                                    pcm_fl32_to_s32x4_sse2(b, min, max));
+        _mm_storeu_si128((__m128i *)dst, v);
+    }
+    pcm_fl32_to_s16_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline __m128 pcm_dither_tpdf_sse2(__m128i *state)
+{
+    __m128i s = *state;
+    s = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+    s = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+    s = _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+    *state = s;
+
+    __m128i d = _mm_sub_epi32(_mm_srli_epi32(s, 16),
+                              _mm_and_si128(s, _mm_set1_epi32(0xffff)));
+    return _mm_mul_ps(_mm_cvtepi32_ps(d), _mm_set1_ps(1.f / 65536.f));
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_fl32_to_s16_dither_sse2(int16_t *dst, const float *src,
+                                               size_t n, uint32_t *state)
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    __m128i s0 = _mm_loadu_si128((const __m128i *)state);
+    __m128i s1 = _mm_loadu_si128((const __m128i *)(state + 4));
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src), scale),
+                              pcm_dither_tpdf_sse2(&s0));
+        __m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + 4), scale),
+                              pcm_dither_tpdf_sse2(&s1));
+        __m128i v = _mm_packs_epi32(pcm_fl32_to_s32x4_sse2(a, min, max),
+                                    pcm_fl32_to_s32x4_sse2(b, min, max));
+        _mm_storeu_si128((__m128i *)dst, v);
+    }
+    _mm_storeu_si128((__m128i *)state, s0);
+    _mm_storeu_si128((__m128i *)(state + 4), s1);
+    pcm_fl32_to_s16_dither_c(dst, src, n, state);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_s32_to_fl32_sse2(float *dst, const int32_t *src,
+                                        size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    pcm_s32_to_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_fl32_to_s32_sse2(int32_t *dst, const float *src,
+                                        size_t n)
+{
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        /* Out of range values convert to INT32_MIN, flip positive ones */
+        __m128i v = _mm_xor_si128(_mm_cvtps_epi32(s),
+                        _mm_castps_si128(_mm_cmpge_ps(s, scale)));
+        _mm_storeu_si128((__m128i *)dst, v);
+    }
+    pcm_fl32_to_s32_c(dst, src, n);
+}
+#endif
+
+/*** AVX2 ***/
+#if defined(HAVE_AVX2_INTRINSICS)
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_s16_to_fl32_avx2(float *dst, const int16_t *src,
+                                        size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+
+    for (; n >= 16; n -= 16, src += 16, dst += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(
+                        _mm_loadu_si128((const __m128i *)src));
+        __m256i hi = _mm256_cvtepi16_epi32(
+                        _mm_loadu_si128((const __m128i *)(src + 8)));
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + 8,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    pcm_s16_to_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i pcm_fl32_to_s32x8_avx2(__m256 s, __m256 min, __m256 max)
+{
+    return _mm256_cvtps_epi32(_mm256_max_ps(_mm256_min_ps(s, max), min));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_fl32_to_s16_avx2(int16_t *dst, const float *src,
+                                        size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+
+    for (; n >= 16; n -= 16, src += 16, dst += 16)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + 8), scale);
+        __m256i v = _mm256_packs_epi32(pcm_fl32_to_s32x8_avx2(a, min, max),
+                                       pcm_fl32_to_s32x8_avx2(b, min, max));
+        /* packs works within 128-bits lanes */
+        v = _mm256_permute4x64_epi64(v, 0xD8);
+        _mm256_storeu_si256((__m256i *)dst, v);
+    }
+    pcm_fl32_to_s16_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_fl32_to_s16_dither_avx2(int16_t *dst, const float *src,
+                                               size_t n, uint32_t *state)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    const __m256i mask = _mm256_set1_epi32(0xffff);
+    const __m256 lsb = _mm256_set1_ps(1.f / 65536.f);
+    __m256i s = _mm256_loadu_si256((const __m256i *)state);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 13));
+        s = _mm256_xor_si256(s, _mm256_srli_epi32(s, 17));
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 5));
+
+        __m256i d = _mm256_sub_epi32(_mm256_srli_epi32(s, 16),
+                                     _mm256_and_si256(s, mask));
+        __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src), scale),
+                                 _mm256_mul_ps(_mm256_cvtepi32_ps(d), lsb));
+        __m256i i = pcm_fl32_to_s32x8_avx2(v, min, max);
+        __m128i p = _mm_packs_epi32(_mm256_castsi256_si128(i),
+                                    _mm256_extracti128_si256(i, 1));
+        _mm_storeu_si128((__m128i *)dst, p);
+    }
+    _mm256_storeu_si256((__m256i *)state, s);
+    pcm_fl32_to_s16_dither_c(dst, src, n, state);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_s32_to_fl32_avx2(float *dst, const int32_t *src,
+                                        size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)src);
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    pcm_s32_to_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_fl32_to_s32_avx2(int32_t *dst, const float *src,
+                                        size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256i v = _mm256_xor_si256(_mm256_cvtps_epi32(s),
+                        _mm256_castps_si256(_mm256_cmp_ps(s, scale,
+                                                          _CMP_GE_OQ)));
+        _mm256_storeu_si256((__m256i *)dst, v);
+    }
+    pcm_fl32_to_s32_c(dst, src, n);
+}
+#endif
+
+/*** NEON (AArch64) ***/
+#ifdef PCM_CONVERT_NEON
+static inline void pcm_s16_to_fl32_neon(float *dst, const int16_t *src,
+                                        size_t n)
+{
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        int16x8_t v = vld1q_s16(src);
+        /* Fixed point conversion with 15 fractional bits */
+        vst1q_f32(dst, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v)), 15));
+        vst1q_f32(dst + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(v)), 15));
+    }
+    pcm_s16_to_fl32_c(dst, src, n);
+}
+
+static inline void pcm_fl32_to_s16_neon(int16_t *dst, const float *src,
+                                        size_t n)
+{
+    const float32x4_t min = vdupq_n_f32(-32768.f);
+    const float32x4_t max = vdupq_n_f32(32767.f);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(src), 32768.f);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(src + 4), 32768.f);
+        a = vmaxq_f32(vminq_f32(a, max), min);
+        b = vmaxq_f32(vminq_f32(b, max), min);
+        vst1q_s16(dst, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+                                    vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    pcm_fl32_to_s16_c(dst, src, n);
+}
+
+static inline float32x4_t pcm_dither_tpdf_neon(uint32x4_t *state)
+{
+    uint32x4_t s = *state;
+    s = veorq_u32(s, vshlq_n_u32(s, 13));
+    s = veorq_u32(s, vshrq_n_u32(s, 17));
+    s = veorq_u32(s, vshlq_n_u32(s, 5));
+    *state = s;
+
+    int32x4_t d = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(s, 16)),
+                    vreinterpretq_s32_u32(vandq_u32(s, vdupq_n_u32(0xffff))));
+    return vmulq_n_f32(vcvtq_f32_s32(d), 1.f / 65536.f);
+}
+
+static inline void pcm_fl32_to_s16_dither_neon(int16_t *dst, const float *src,
+                                               size_t n, uint32_t *state)
+{
+    const float32x4_t min = vdupq_n_f32(-32768.f);
+    const float32x4_t max = vdupq_n_f32(32767.f);
+    uint32x4_t s0 = vld1q_u32(state);
+    uint32x4_t s1 = vld1q_u32(state + 4);
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        float32x4_t a = vaddq_f32(vmulq_n_f32(vld1q_f32(src), 32768.f),
+                                  pcm_dither_tpdf_neon(&s0));
+        float32x4_t b = vaddq_f32(vmulq_n_f32(vld1q_f32(src + 4), 32768.f),
+                                  pcm_dither_tpdf_neon(&s1));
+        a = vmaxq_f32(vminq_f32(a, max), min);
+        b = vmaxq_f32(vminq_f32(b, max), min);
+        vst1q_s16(dst, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+                                    vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    vst1q_u32(state, s0);
+    vst1q_u32(state + 4, s1);
+    pcm_fl32_to_s16_dither_c(dst, src, n, state);
+}
+
+static inline void pcm_s32_to_fl32_neon(float *dst, const int32_t *src,
+                                        size_t n)
+{
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        vst1q_f32(dst, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src)),
+                                   1.f / 2147483648.f));
+    pcm_s32_to_fl32_c(dst, src, n);
+}
+
+static inline void pcm_fl32_to_s32_neon(int32_t *dst, const float *src,
+                                        size_t n)
+{
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        /* The conversion saturates on its own */
+        vst1q_s32(dst, vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src),
+                                                  2147483648.f)));
+    pcm_fl32_to_s32_c(dst, src, n);
+}
+#endif
+
+/*** Runtime selection ***/
+#if defined(HAVE_AVX2_INTRINSICS)
+# define PCM_SELECT_AVX2(name) \
+    if (vlc_CPU_AVX2()) return name##_avx2;
+#else
+# define PCM_SELECT_AVX2(name)
+#endif
+#if defined(HAVE_SSE2_INTRINSICS)
+# define PCM_SELECT_SSE2(name) \
+    if (vlc_CPU_SSE2()) return name##_sse2;
+#else
+# define PCM_SELECT_SSE2(name)
+#endif
+#ifdef PCM_CONVERT_NEON
+# define PCM_SELECT_NEON(name) \
+    if (vlc_CPU_ARM_NEON()) return name##_neon;
+#else
+# define PCM_SELECT_NEON(name)
+#endif
+
+#define PCM_SELECT(name) \
+    PCM_SELECT_AVX2(name) \
+    PCM_SELECT_SSE2(name) \
+    PCM_SELECT_NEON(name) \
+    return name##_c;
+
+static inline pcm_s16_fl32_t pcm_s16_to_fl32_Select(void)
+{
+    PCM_SELECT(pcm_s16_to_fl32)
+}
+
+static inline pcm_fl32_s16_t pcm_fl32_to_s16_Select(void)
+{
+    PCM_SELECT(pcm_fl32_to_s16)
+}
+
+static inline pcm_fl32_s16_dither_t pcm_fl32_to_s16_dither_Select(void)
+{
+    PCM_SELECT(pcm_fl32_to_s16_dither)
+}
+
+static inline pcm_s32_fl32_t pcm_s32_to_fl32_Select(void)
+{
+    PCM_SELECT(pcm_s32_to_fl32)
+}
+
+static inline pcm_fl32_s32_t pcm_fl32_to_s32_Select(void)
+{
+    PCM_SELECT(pcm_fl32_to_s32)
+}
+
+#undef PCM_SELECT
+#undef PCM_SELECT_NEON
+#undef PCM_SELECT_SSE2
+#undef PCM_SELECT_AVX2
+
+#endif
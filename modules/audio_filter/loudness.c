@@ -0,0 +1,539 @@
+/*****************************************************************************
+ * loudness.c : EBU R128 / ITU BS.1770 loudness meter
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+
+static int  Open     ( vlc_object_t * );
+static void Close    ( vlc_object_t * );
+static block_t *DoWork( filter_t *, block_t * );
+
+/* Gating blocks are 400ms long with 75% overlap: the measurement advances
+ * by steps of 100ms */
+#define STEP_MS         100
+#define MOMENTARY_STEPS 4
+#define SHORTTERM_STEPS 30
+
+/* Histogram of the gating block loudnesses, 0.1 LU wide bins */
+#define HIST_MIN    (-70.)
+#define HIST_MAX    (+30.)
+#define HIST_BINS   1000
+
+/* True peak interpolation: 4x oversampling */
+#define TP_PHASES   4
+#define TP_TAPS     12
+
+#define CHANNELS_MAX AOUT_CHAN_MAX
+
+typedef struct
+{
+    /* K-weighting, two biquads (pre-filter and RLB high-pass) */
+    double b[2][3], a[2][3];
+    double z[CHANNELS_MAX][2][2];
+    float  weight[CHANNELS_MAX];
+
+    /* Current step */
+    unsigned i_step_length;
+    unsigned i_step_count;
+    double   f_step_energy;
+
+    /* Weighted energy of the last steps */
+    double   steps[SHORTTERM_STEPS];
+    unsigned i_steps;
+    unsigned i_step_pos;
+
+    /* Integrated loudness gating */
+    uint64_t hist[HIST_BINS];
+    double   hist_energy[HIST_BINS];
+
+    /* True peak */
+    bool     b_true_peak;
+    float    tp_coefs[TP_TAPS][TP_PHASES];
+    /* Mirrored ring, the last TP_TAPS samples are always contiguous */
+    float    tp_history[CHANNELS_MAX][2 * TP_TAPS];
+    unsigned i_tp_pos;
+    float    f_peak;
+    float    f_peak_max;
+
+    /* Results, in LUFS and dBTP */
+    float    f_momentary;
+    float    f_shortterm;
+    float    f_integrated;
+
+    /* Normalization */
+    bool     b_normalize;
+    float    f_target;
+    float    f_max_gain;
+    float    f_gain_db;
+} filter_sys_t;
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define TRUEPEAK_TEXT N_("Measure true peak")
+#define TRUEPEAK_LONGTEXT N_("Measure the inter-sample peak level with 4x " \
+                "oversampling instead of the sample peak level.")
+
+#define NORMALIZE_TEXT N_("Normalize loudness")
+#define NORMALIZE_LONGTEXT N_("Adjust the gain so that the short-term " \
+                "loudness follows the target loudness.")
+
+#define TARGET_TEXT N_("Target loudness (LUFS)")
+#define TARGET_LONGTEXT N_("Loudness the normalizer aims for. " \
+                "EBU R128 recommends -23 LUFS.")
+
+#define MAXGAIN_TEXT N_("Maximum gain (dB)")
+#define MAXGAIN_LONGTEXT N_("Maximum amplification applied by the " \
+                "normalizer.")
+
+vlc_module_begin ()
+    set_description( N_("EBU R128 loudness meter") )
+    set_shortname( N_("Loudness meter") )
+    set_help( N_("Measures the momentary, short-term and integrated "
+                 "loudness and the true peak level. The results are "
+                 "published in the loudness-* variables of the audio "
+                 "output, or of the transcode stream output when used "
+                 "with afilter=loudness.") )
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_AFILTER )
+    add_shortcut( "r128" )
+    add_bool( "loudness-true-peak", true, TRUEPEAK_TEXT, TRUEPEAK_LONGTEXT,
+              true )
+    add_bool( "loudness-normalize", false, NORMALIZE_TEXT,
+              NORMALIZE_LONGTEXT, false )
+    add_float( "loudness-target", -23.f, TARGET_TEXT, TARGET_LONGTEXT,
+               false )
+    add_float_with_range( "loudness-max-gain", 12.f, 0.f, 40.f,
+                          MAXGAIN_TEXT, MAXGAIN_LONGTEXT, true )
+    set_capability( "audio filter", 0 )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+static const char *const ppsz_results[] = {
+    "loudness-momentary",
+    "loudness-short-term",
+    "loudness-integrated",
+    "loudness-true-peak-level",
+};
+
+static double EnergyToLoudness( double f_energy )
+{
+    return -0.691 + 10. * log10( f_energy );
+}
+
+/* ITU BS.1770-4 K-weighting filter, for any sample rate */
+static void SetupKWeighting( filter_sys_t *p_sys, unsigned i_rate )
+{
+    double f0 = 1681.974450955533;
+    double G  = 3.999843853973347;
+    double Q  = 0.7071752369554196;
+
+    double K  = tan( M_PI * f0 / i_rate );
+    double Vh = pow( 10., G / 20. );
+    double Vb = pow( Vh, 0.4996667741545416 );
+    double a0 = 1. + K / Q + K * K;
+
+    p_sys->b[0][0] = ( Vh + Vb * K / Q + K * K ) / a0;
+    p_sys->b[0][1] = 2. * ( K * K - Vh ) / a0;
+    p_sys->b[0][2] = ( Vh - Vb * K / Q + K * K ) / a0;
+    p_sys->a[0][0] = 1.;
+    p_sys->a[0][1] = 2. * ( K * K - 1. ) / a0;
+    p_sys->a[0][2] = ( 1. - K / Q + K * K ) / a0;
+
+    f0 = 38.13547087602444;
+    Q  = 0.5003270373238773;
+    K  = tan( M_PI * f0 / i_rate );
+    a0 = 1. + K / Q + K * K;
+
+    p_sys->b[1][0] = 1.;
+    p_sys->b[1][1] = -2.;
+    p_sys->b[1][2] = 1.;
+    p_sys->a[1][0] = 1.;
+    p_sys->a[1][1] = 2. * ( K * K - 1. ) / a0;
+    p_sys->a[1][2] = ( 1. - K / Q + K * K ) / a0;
+}
+
+/* Windowed sinc interpolator, one set of coefficients per phase.
+ * Phase 0 is the original sample, delayed by half the filter length. */
+static void SetupTruePeak( filter_sys_t *p_sys )
+{
+    for( unsigned p = 0; p < TP_PHASES; p++ )
+    {
+        for( unsigned t = 0; t < TP_TAPS; t++ )
+        {
+            /* Distance of the tap to the interpolated point, in samples */
+            double x = (double)t - ( TP_TAPS / 2 - 1 ) - (double)p / TP_PHASES;
+            double sinc = p == 0 ? ( x == 0. ? 1. : 0. )
+                                 : sin( M_PI * x ) / ( M_PI * x );
+            double w = 0.5 + 0.5 * cos( M_PI * x / ( TP_TAPS / 2 ) );
+            p_sys->tp_coefs[t][p] = sinc * w;
+        }
+    }
+}
+
+/*****************************************************************************
+ * Open: initialize and create stuff
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    vlc_object_t *p_aout = p_filter->obj.parent;
+    filter_sys_t *p_sys;
+
+    unsigned i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    if( i_channels == 0 || i_channels > CHANNELS_MAX )
+        return VLC_EGENERIC;
+
+    p_sys = p_filter->p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    aout_FormatPrepare( &p_filter->fmt_in.audio );
+    p_filter->fmt_out.audio = p_filter->fmt_in.audio;
+
+    const unsigned i_rate = p_filter->fmt_in.audio.i_rate;
+    SetupKWeighting( p_sys, i_rate );
+
+    /* Channel weights: LFE is ignored, surround channels count more */
+    const uint16_t i_physical = p_filter->fmt_in.audio.i_physical_channels;
+    unsigned i_chan = 0;
+    for( unsigned i = 0; pi_vlc_chan_order_wg4[i]; i++ )
+    {
+        uint32_t i_mask = pi_vlc_chan_order_wg4[i];
+        if( !( i_physical & i_mask ) )
+            continue;
+        if( i_mask == AOUT_CHAN_LFE )
+            p_sys->weight[i_chan] = 0.f;
+        else if( i_mask & ( AOUT_CHANS_REAR | AOUT_CHANS_MIDDLE ) )
+            p_sys->weight[i_chan] = 1.41f;
+        else
+            p_sys->weight[i_chan] = 1.f;
+        i_chan++;
+    }
+    for( ; i_chan < i_channels; i_chan++ )
+        p_sys->weight[i_chan] = 1.f;
+
+    p_sys->i_step_length = i_rate * STEP_MS / 1000;
+
+    /* Oversampling is pointless at high sample rates */
+    p_sys->b_true_peak = var_InheritBool( p_filter, "loudness-true-peak" )
+                      && i_rate < 96000;
+    if( p_sys->b_true_peak )
+        SetupTruePeak( p_sys );
+
+    p_sys->b_normalize = var_InheritBool( p_filter, "loudness-normalize" );
+    p_sys->f_target = var_InheritFloat( p_filter, "loudness-target" );
+    p_sys->f_max_gain = var_InheritFloat( p_filter, "loudness-max-gain" );
+
+    p_sys->f_momentary = p_sys->f_shortterm = p_sys->f_integrated = -INFINITY;
+    p_sys->f_peak_max = -INFINITY;
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_results); i++ )
+    {
+        var_Create( p_aout, ppsz_results[i], VLC_VAR_FLOAT );
+        var_SetFloat( p_aout, ppsz_results[i], -INFINITY );
+    }
+
+    p_filter->pf_audio_filter = DoWork;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Measurements
+ *****************************************************************************/
+static void GateBlock( filter_sys_t *p_sys, double f_energy )
+{
+    double f_loudness = EnergyToLoudness( f_energy );
+
+    /* Absolute gate */
+    if( !( f_loudness >= HIST_MIN ) )
+        return;
+
+    int i_bin = ( f_loudness - HIST_MIN ) * HIST_BINS / ( HIST_MAX - HIST_MIN );
+    if( i_bin >= HIST_BINS )
+        i_bin = HIST_BINS - 1;
+    p_sys->hist[i_bin]++;
+    p_sys->hist_energy[i_bin] += f_energy;
+}
+
+static float Integrate( const filter_sys_t *p_sys )
+{
+    uint64_t i_count = 0;
+    double f_sum = 0.;
+
+    for( unsigned i = 0; i < HIST_BINS; i++ )
+    {
+        i_count += p_sys->hist[i];
+        f_sum += p_sys->hist_energy[i];
+    }
+    if( i_count == 0 )
+        return -INFINITY;
+
+    /* Relative gate, 10 LU below the absolute-gated loudness */
+    double f_gate = EnergyToLoudness( f_sum / i_count ) - 10.;
+    int i_start = ceil( ( f_gate - HIST_MIN ) * HIST_BINS
+                        / ( HIST_MAX - HIST_MIN ) );
+    if( i_start < 0 )
+        i_start = 0;
+
+    i_count = 0;
+    f_sum = 0.;
+    for( unsigned i = i_start; i < HIST_BINS; i++ )
+    {
+        i_count += p_sys->hist[i];
+        f_sum += p_sys->hist_energy[i];
+    }
+    if( i_count == 0 )
+        return -INFINITY;
+    return EnergyToLoudness( f_sum / i_count );
+}
+
+static double SumSteps( const filter_sys_t *p_sys, unsigned i_count )
+{
+    double f_sum = 0.;
+    unsigned i_pos = p_sys->i_step_pos;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        i_pos = ( i_pos + SHORTTERM_STEPS - 1 ) % SHORTTERM_STEPS;
+        f_sum += p_sys->steps[i_pos];
+    }
+    return f_sum / ( i_count * p_sys->i_step_length );
+}
+
+static void EndStep( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    p_sys->steps[p_sys->i_step_pos] = p_sys->f_step_energy;
+    p_sys->i_step_pos = ( p_sys->i_step_pos + 1 ) % SHORTTERM_STEPS;
+    if( p_sys->i_steps < SHORTTERM_STEPS )
+        p_sys->i_steps++;
+    p_sys->f_step_energy = 0.;
+    p_sys->i_step_count = 0;
+
+    if( p_sys->i_steps >= MOMENTARY_STEPS )
+    {
+        double f_energy = SumSteps( p_sys, MOMENTARY_STEPS );
+        p_sys->f_momentary = EnergyToLoudness( f_energy );
+        GateBlock( p_sys, f_energy );
+        p_sys->f_integrated = Integrate( p_sys );
+    }
+    if( p_sys->i_steps >= SHORTTERM_STEPS )
+        p_sys->f_shortterm =
+            EnergyToLoudness( SumSteps( p_sys, SHORTTERM_STEPS ) );
+
+    float f_peak = p_sys->f_peak > 0.f ? 20.f * log10f( p_sys->f_peak )
+                                       : -INFINITY;
+    p_sys->f_peak = 0.f;
+    if( f_peak > p_sys->f_peak_max )
+        p_sys->f_peak_max = f_peak;
+
+    vlc_object_t *p_aout = p_filter->obj.parent;
+    var_SetFloat( p_aout, "loudness-momentary", p_sys->f_momentary );
+    var_SetFloat( p_aout, "loudness-short-term", p_sys->f_shortterm );
+    var_SetFloat( p_aout, "loudness-integrated", p_sys->f_integrated );
+    var_SetFloat( p_aout, "loudness-true-peak-level", f_peak );
+}
+
+/* Runs both K-weighting stages on one channel, returns the filtered energy.
+ * The recursion is sequential in time, so the state stays in registers for
+ * the whole run rather than being reloaded on every interleaved sample. */
+static double KWeighting( filter_sys_t *p_sys, unsigned i_chan,
+                          const float *p_in, unsigned i_count,
+                          unsigned i_stride )
+{
+    const double b00 = p_sys->b[0][0], b01 = p_sys->b[0][1];
+    const double b02 = p_sys->b[0][2];
+    const double a01 = p_sys->a[0][1], a02 = p_sys->a[0][2];
+    const double b10 = p_sys->b[1][0], b11 = p_sys->b[1][1];
+    const double b12 = p_sys->b[1][2];
+    const double a11 = p_sys->a[1][1], a12 = p_sys->a[1][2];
+    double (*z)[2] = p_sys->z[i_chan];
+    double z00 = z[0][0], z01 = z[0][1], z10 = z[1][0], z11 = z[1][1];
+    double f_energy = 0.;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        /* Direct form II transposed, both stages */
+        double x = p_in[i * i_stride];
+        double y = b00 * x + z00;
+        z00 = b01 * x - a01 * y + z01;
+        z01 = b02 * x - a02 * y;
+
+        x = y;
+        y = b10 * x + z10;
+        z10 = b11 * x - a11 * y + z11;
+        z11 = b12 * x - a12 * y;
+
+        f_energy += y * y;
+    }
+
+    z[0][0] = z00; z[0][1] = z01; z[1][0] = z10; z[1][1] = z11;
+    return f_energy;
+}
+
+/* Returns the peak of one channel, interpolated at all the phases. The taps
+ * are stored phase-minor so that the phases are computed side by side. */
+static float TruePeak( filter_sys_t *p_sys, unsigned i_chan,
+                       const float *p_in, unsigned i_count, unsigned i_stride )
+{
+    float *p_hist = p_sys->tp_history[i_chan];
+    unsigned i_pos = p_sys->i_tp_pos;
+    float peak[TP_PHASES] = { 0.f };
+    /* Not written through the history */
+    const float (*restrict coefs)[TP_PHASES] = p_sys->tp_coefs;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        float f_sample = p_in[i * i_stride];
+        p_hist[i_pos] = p_hist[i_pos + TP_TAPS] = f_sample;
+        if( ++i_pos == TP_TAPS )
+            i_pos = 0;
+
+        /* Last TP_TAPS samples, oldest first */
+        const float *p_win = p_hist + i_pos;
+        for( unsigned p = 0; p < TP_PHASES; p++ )
+        {
+            float f_sum = 0.f;
+            for( unsigned t = 0; t < TP_TAPS; t++ )
+                f_sum += coefs[t][p] * p_win[t];
+            peak[p] = __MAX( peak[p], fabsf( f_sum ) );
+        }
+    }
+
+    float f_peak = peak[0];
+    for( unsigned p = 1; p < TP_PHASES; p++ )
+        f_peak = __MAX( f_peak, peak[p] );
+    return f_peak;
+}
+
+static float SamplePeak( const float *p_in, unsigned i_count,
+                         unsigned i_stride )
+{
+    float f_peak = 0.f;
+
+    for( unsigned i = 0; i < i_count; i++ )
+        f_peak = __MAX( f_peak, fabsf( p_in[i * i_stride] ) );
+    return f_peak;
+}
+
+/*****************************************************************************
+ * DoWork : measures and optionally normalizes a buffer
+ *****************************************************************************/
+static block_t *DoWork( filter_t *p_filter, block_t *p_block )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    float *p_samples = (float *)p_block->p_buffer;
+
+    /* Process the channels one after the other, up to the end of each step */
+    for( unsigned i = 0; i < p_block->i_nb_samples; )
+    {
+        unsigned i_count = __MIN( p_block->i_nb_samples - i,
+                                  p_sys->i_step_length - p_sys->i_step_count );
+        double f_energy = 0.;
+
+        for( unsigned c = 0; c < i_channels; c++ )
+        {
+            if( p_sys->weight[c] != 0.f )
+                f_energy += p_sys->weight[c]
+                          * KWeighting( p_sys, c, p_samples + c, i_count,
+                                        i_channels );
+
+            float f_peak = p_sys->b_true_peak
+                ? TruePeak( p_sys, c, p_samples + c, i_count, i_channels )
+                : SamplePeak( p_samples + c, i_count, i_channels );
+            if( f_peak > p_sys->f_peak )
+                p_sys->f_peak = f_peak;
+        }
+        p_sys->f_step_energy += f_energy;
+        p_sys->i_tp_pos = ( p_sys->i_tp_pos + i_count ) % TP_TAPS;
+        p_samples += i_count * i_channels;
+        i += i_count;
+
+        p_sys->i_step_count += i_count;
+        if( p_sys->i_step_count == p_sys->i_step_length )
+            EndStep( p_filter );
+    }
+
+    if( p_sys->b_normalize && isfinite( p_sys->f_shortterm ) )
+    {
+        /* Move slowly towards the target, never above 0 dBTP */
+        float f_wanted = p_sys->f_target - p_sys->f_shortterm;
+        f_wanted = __MIN( f_wanted, p_sys->f_max_gain );
+        if( isfinite( p_sys->f_peak_max ) )
+            f_wanted = __MIN( f_wanted, -p_sys->f_peak_max );
+
+        float f_step = 0.05f * p_block->i_nb_samples * 1000.f
+                     / ( STEP_MS * p_filter->fmt_in.audio.i_rate );
+        if( f_wanted > p_sys->f_gain_db + f_step )
+            p_sys->f_gain_db += f_step;
+        else if( f_wanted < p_sys->f_gain_db - f_step )
+            p_sys->f_gain_db -= f_step;
+        else
+            p_sys->f_gain_db = f_wanted;
+
+        if( p_sys->f_gain_db != 0.f )
+        {
+            float f_gain = powf( 10.f, p_sys->f_gain_db / 20.f );
+            float *p = (float *)p_block->p_buffer;
+            for( size_t i = p_block->i_nb_samples * i_channels; i > 0; i-- )
+                *(p++) *= f_gain;
+        }
+    }
+
+    return p_block;
+}
+
+/**********************************************************************
+ * Close
+ **********************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t*)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+    vlc_object_t *p_aout = p_filter->obj.parent;
+
+    msg_Dbg( p_filter, "integrated loudness: %.1f LUFS, max peak: %.1f dBTP",
+             p_sys->f_integrated, p_sys->f_peak_max );
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_results); i++ )
+        var_Destroy( p_aout, ppsz_results[i] );
+    free( p_sys );
+}
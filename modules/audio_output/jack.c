@@ -36,9 +36,9 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
+#include <vlc_ringbuffer.h>
 
 #include <jack/jack.h>
-#include <jack/ringbuffer.h>
 
 #include <stdio.h>
 #include <unistd.h>                                      /* write(), close() */
@@ -53,7 +53,7 @@ typedef jack_default_audio_sample_t jack_sample_t;
  *****************************************************************************/
 typedef struct
 {
-    jack_ringbuffer_t *p_jack_ringbuffer;
+    vlc_ringbuffer_t *p_ringbuffer;
     jack_client_t  *p_jack_client;
     jack_port_t   **p_jack_ports;
     jack_sample_t **p_jack_buffers;
@@ -126,6 +126,7 @@ static int Start( audio_output_t *p_aout, audio_sample_format_t *restrict fmt )
 
     p_sys->latency = 0;
     p_sys->paused = VLC_TICK_INVALID;
+    p_sys->p_ringbuffer = NULL;
 
     /* Connect to the JACK server */
     psz_name = var_InheritString( p_aout, "jack-name" );
@@ -182,17 +183,17 @@ static int Start( audio_output_t *p_aout, audio_sample_format_t *restrict fmt )
 
     const size_t buf_sz =
         samples_from_vlc_tick(AOUT_MAX_ADVANCE_TIME, fmt->i_rate * fmt->i_bytes_per_frame);
-    p_sys->p_jack_ringbuffer = jack_ringbuffer_create( buf_sz );
+    p_sys->p_ringbuffer = vlc_ringbuffer_New( buf_sz );
 
-    if( p_sys->p_jack_ringbuffer == NULL )
+    if( p_sys->p_ringbuffer == NULL )
     {
         status = VLC_ENOMEM;
         goto error_out;
     }
 
-    if( jack_ringbuffer_mlock( p_sys->p_jack_ringbuffer ))
+    if( vlc_ringbuffer_Lock( p_sys->p_ringbuffer ) )
     {
-        msg_Warn( p_aout, "failed to lock JACK ringbuffer in memory" );
+        msg_Warn( p_aout, "failed to lock ringbuffer in memory" );
     }
 
     /* Create the output ports */
@@ -273,8 +274,8 @@ error_out:
             jack_deactivate( p_sys->p_jack_client );
             jack_client_close( p_sys->p_jack_client );
         }
-        if( p_sys->p_jack_ringbuffer )
-            jack_ringbuffer_free( p_sys->p_jack_ringbuffer );
+        if( p_sys->p_ringbuffer )
+            vlc_ringbuffer_Delete( p_sys->p_ringbuffer );
 
         free( p_sys->p_jack_ports );
         free( p_sys->p_jack_buffers );
@@ -286,13 +287,14 @@ error_out:
 static void Play(audio_output_t * p_aout, block_t * p_block, vlc_tick_t date)
 {
     aout_sys_t *p_sys = p_aout->sys;
-    jack_ringbuffer_t *rb = p_sys->p_jack_ringbuffer;
+    vlc_ringbuffer_t *rb = p_sys->p_ringbuffer;
     const size_t bytes_per_frame = p_sys->i_channels * sizeof(jack_sample_t);
 
     while (p_block->i_buffer > 0) {
 
-        /* move data to buffer */
-        const size_t write_space = jack_ringbuffer_write_space(rb);
+        /* move whole frames to buffer */
+        const size_t write_space = vlc_ringbuffer_WriteSpace(rb)
+                                 / bytes_per_frame * bytes_per_frame;
         const size_t bytes = p_block->i_buffer < write_space ?
             p_block->i_buffer : write_space;
 
@@ -303,7 +305,7 @@ static void Play(audio_output_t * p_aout, block_t * p_block, vlc_tick_t date)
             break;
         }
 
-        jack_ringbuffer_write( rb, (const char *) p_block->p_buffer, bytes );
+        vlc_ringbuffer_Write( rb, p_block->p_buffer, bytes );
 
         p_block->p_buffer += bytes;
         p_block->i_buffer -= bytes;
@@ -332,7 +334,6 @@ static void Pause(audio_output_t *aout, bool paused, vlc_tick_t date)
 static void Flush(audio_output_t *p_aout, bool wait)
 {
     aout_sys_t * p_sys = p_aout->sys;
-    jack_ringbuffer_t *rb = p_sys->p_jack_ringbuffer;
 
     /* Sleep if wait was requested */
     if( wait )
@@ -342,19 +343,18 @@ static void Flush(audio_output_t *p_aout, bool wait)
             vlc_tick_sleep(delay);
     }
 
-    /* reset ringbuffer read and write pointers */
-    jack_ringbuffer_reset(rb);
+    /* the process callback drops the buffered data on its next cycle */
+    vlc_ringbuffer_Flush(p_sys->p_ringbuffer);
 }
 
 static int TimeGet(audio_output_t *p_aout, vlc_tick_t *delay)
 {
     aout_sys_t * p_sys = p_aout->sys;
-    jack_ringbuffer_t *rb = p_sys->p_jack_ringbuffer;
     const size_t bytes_per_frame = p_sys->i_channels * sizeof(jack_sample_t);
 
-    *delay = p_sys->latency +
-            vlc_tick_from_samples(jack_ringbuffer_read_space(rb) / bytes_per_frame,
-                                  p_sys->i_rate);
+    *delay = vlc_tick_from_samples(p_sys->latency, p_sys->i_rate) +
+             vlc_ringbuffer_GetDelay(p_sys->p_ringbuffer, bytes_per_frame,
+                                     p_sys->i_rate);
 
     return 0;
 }
@@ -364,8 +364,7 @@ static int TimeGet(audio_output_t *p_aout, vlc_tick_t *delay)
  *****************************************************************************/
 int Process( jack_nframes_t i_frames, void *p_arg )
 {
-    unsigned int i, j, frames_from_rb = 0;
-    size_t bytes_read = 0;
+    unsigned int i, frames_from_rb = 0;
     size_t frames_read;
     audio_output_t *p_aout = (audio_output_t*) p_arg;
     aout_sys_t *p_sys = p_aout->sys;
@@ -382,19 +381,16 @@ int Process( jack_nframes_t i_frames, void *p_arg )
                                                          i_frames );
     }
 
-    /* Copy in the audio data */
-    for( j = 0; j < frames_from_rb; j++ )
-    {
-        for( i = 0; i < p_sys->i_channels; i++ )
-        {
-            jack_sample_t *p_dst = p_sys->p_jack_buffers[i] + j;
-            bytes_read += jack_ringbuffer_read( p_sys->p_jack_ringbuffer,
-                    (char *) p_dst, sizeof(jack_sample_t) );
-        }
-    }
+    /* Copy in the audio data (this also applies any pending flush) */
+    frames_read = vlc_ringbuffer_ReadDeinterleave( p_sys->p_ringbuffer,
+                                                   p_sys->p_jack_buffers,
+                                                   p_sys->i_channels,
+                                                   frames_from_rb );
+    /* The last frame read plays out at the end of this cycle */
+    vlc_ringbuffer_SetPlayedDate( p_sys->p_ringbuffer, vlc_tick_now() +
+                        vlc_tick_from_samples( i_frames, p_sys->i_rate ) );
 
     /* Fill any remaining buffer with silence */
-    frames_read = (bytes_read / sizeof(jack_sample_t)) / p_sys->i_channels;
     if( frames_read < i_frames )
     {
         for( i = 0; i < p_sys->i_channels; i++ )
@@ -455,7 +451,7 @@ static void Stop( audio_output_t *p_aout )
     }
     free( p_sys->p_jack_ports );
     free( p_sys->p_jack_buffers );
-    jack_ringbuffer_free( p_sys->p_jack_ringbuffer );
+    vlc_ringbuffer_Delete( p_sys->p_ringbuffer );
 }
 
 static int Open(vlc_object_t *obj)
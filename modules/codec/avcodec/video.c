@@ -1025,16 +1025,13 @@ static int DecodeBlock( decoder_t *p_dec, block_t **pp_block )
     else
         b_need_output_picture = false;
 
-    /* Change skip_frame config only if hurry_up is enabled */
-    if( p_sys->b_hurry_up )
-    {
-        p_context->skip_frame = p_sys->i_skip_frame;
+    /* Restore the configured skip_frame, that a preroll may have raised */
+    p_context->skip_frame = p_sys->i_skip_frame;
 
-        /* Check also if we should/can drop the block and move to next block
-            as trying to catchup the speed*/
-        if( p_dec->b_frame_drop_allowed )
-            p_block = filter_earlydropped_blocks( p_dec, p_block );
-    }
+    /* Check also if we should/can drop the block and move to next block
+        as trying to catchup the speed*/
+    if( p_sys->b_hurry_up && p_dec->b_frame_drop_allowed )
+        p_block = filter_earlydropped_blocks( p_dec, p_block );
 
     if( !b_need_output_picture || p_sys->framedrop == FRAMEDROP_NONREF )
     {
@@ -36,6 +36,7 @@
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
 #include "logic/PredictiveAdaptationLogic.hpp"
 #include "logic/NearOptimalAdaptationLogic.hpp"
+#include "logic/BufferBasedAdaptationLogic.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
@@ -77,6 +78,13 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
     cached.i_length = 0;
     cached.f_position = 0.0;
     cached.i_time = VLC_TICK_INVALID;
+
+    var_Create(p_demux, "adaptive-buffered-bytes", VLC_VAR_INTEGER);
+    var_Create(p_demux, "adaptive-buffered-peak", VLC_VAR_INTEGER);
+
+    /* Live edge targeting */
+    playlist->setLowLatency(var_InheritBool(p_demux, "adaptive-lowlatency"));
+    playlist->setLiveDelay(VLC_TICK_FROM_MS(var_InheritInteger(p_demux, "adaptive-livedelay")));
 }
 
 PlaylistManager::~PlaylistManager   ()
@@ -92,6 +100,8 @@ PlaylistManager::~PlaylistManager   ()
     vlc_mutex_destroy(&demux.lock);
     vlc_cond_destroy(&demux.cond);
     vlc_mutex_destroy(&cached.lock);
+    var_Destroy(p_demux, "adaptive-buffered-bytes");
+    var_Destroy(p_demux, "adaptive-buffered-peak");
 }
 
 void PlaylistManager::unsetPeriod()
@@ -160,6 +170,10 @@ bool PlaylistManager::start()
       )
         return false;
 
+    const int64_t i_maxmem = var_InheritInteger(p_demux, "adaptive-maxbuffermem");
+    if(i_maxmem > 0)
+        conManager->getMemoryBudget()->setLimit((size_t) i_maxmem * 1024 * 1024);
+
     if(!setupPeriod())
         return false;
 
@@ -187,6 +201,13 @@ void PlaylistManager::stop()
         vlc_join(thread, NULL);
         b_thread = false;
     }
+
+    if(conManager)
+    {
+        const MemoryBudget *budget = conManager->getMemoryBudget();
+        msg_Dbg(p_demux, "buffers memory peak %zu KiB, limit %zu KiB",
+                budget->getPeak() / 1024, budget->getLimit() / 1024);
+    }
 }
 
 struct PrioritizedAbstractStream
@@ -235,7 +256,10 @@ AbstractStream::buffering_status PlaylistManager::bufferize(vlc_tick_t i_nzdeadl
             (!st->isSelected() || !st->canActivate() || !reactivateStream(st)))
                 continue;
 
-        AbstractStream::buffering_status i_ret = st->bufferize(i_nzdeadline, i_min_buffering, i_extra_buffering);
+        /* Over the memory budget, streams only refill their minimum */
+        const bool b_overbudget = conManager->getMemoryBudget()->isExceeded();
+        AbstractStream::buffering_status i_ret = st->bufferize(i_nzdeadline, i_min_buffering,
+                                                               i_extra_buffering, b_overbudget);
         if(i_return != AbstractStream::buffering_ongoing) /* Buffering streams need to keep going */
         {
             if(i_ret > i_return)
@@ -643,6 +667,7 @@ void PlaylistManager::Run()
 
         int canc = vlc_savecancel();
         AbstractStream::buffering_status i_return = bufferize(i_nzpcr, i_min_buffering, i_extra_buffering);
+        updateBufferingStats();
         vlc_restorecancel( canc );
 
         if(i_return != AbstractStream::buffering_lessthanmin)
@@ -654,6 +679,8 @@ void PlaylistManager::Run()
                 i_deadline += VLC_TICK_FROM_MS(100);
             else if(i_return == AbstractStream::buffering_end)
                 i_deadline += VLC_TICK_FROM_SEC(1);
+            else if(playlist->isLowLatency()) /* waiting for the next part */
+                i_deadline += VLC_TICK_FROM_MS(50);
             else /*if(i_return == AbstractStream::buffering_suspended)*/
                 i_deadline += VLC_TICK_FROM_MS(250);
 
@@ -671,6 +698,15 @@ void PlaylistManager::Run()
     vlc_mutex_unlock(&lock);
 }
 
+void PlaylistManager::updateBufferingStats()
+{
+    /* For sizing devices: the bytes held by all the streams buffers,
+     * downloaded and demuxed, and the highest amount so far */
+    const MemoryBudget *budget = conManager->getMemoryBudget();
+    var_SetInteger(p_demux, "adaptive-buffered-bytes", budget->getUsed());
+    var_SetInteger(p_demux, "adaptive-buffered-peak", budget->getPeak());
+}
+
 void * PlaylistManager::managerThread(void *opaque)
 {
     static_cast<PlaylistManager *>(opaque)->Run();
@@ -755,6 +791,18 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
             if(predictivelogic)
                 conn->setDownloadRateObserver(predictivelogic);
             logic = predictivelogic;
+            break;
+        }
+        case AbstractAdaptationLogic::BufferBased:
+        case AbstractAdaptationLogic::Hybrid:
+        {
+            AbstractAdaptationLogic *bufferlogic =
+                    new (std::nothrow) BufferBasedAdaptationLogic(VLC_OBJECT(p_demux),
+                                            type == AbstractAdaptationLogic::Hybrid);
+            if(bufferlogic)
+                conn->setDownloadRateObserver(bufferlogic);
+            logic = bufferlogic;
+            break;
         }
 
         default:
@@ -129,6 +129,7 @@ namespace adaptive
 
         private:
             void setBufferingRunState(bool);
+            void updateBufferingStats();
             void Run();
             static void * managerThread(void *);
             vlc_mutex_t  lock;
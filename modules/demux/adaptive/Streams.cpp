@@ -71,7 +71,7 @@ bool AbstractStream::init(const StreamFormat &format_, SegmentTracker *tracker,
         CommandsFactory *factory = new (std::nothrow) CommandsFactory();
         if(factory)
         {
-            commandsqueue = new (std::nothrow) CommandsQueue(factory);
+            commandsqueue = new (std::nothrow) CommandsQueue(factory, conn->getMemoryBudget());
             if(commandsqueue)
             {
                 fakeesout = new (std::nothrow) FakeESOut(p_realdemux->out, commandsqueue);
@@ -296,14 +296,16 @@ vlc_tick_t AbstractStream::getDemuxedAmount() const
 }
 
 AbstractStream::buffering_status AbstractStream::bufferize(vlc_tick_t nz_deadline,
-                                                           vlc_tick_t i_min_buffering, vlc_tick_t i_extra_buffering)
+                                                           vlc_tick_t i_min_buffering, vlc_tick_t i_extra_buffering,
+                                                           bool b_overbudget)
 {
-    last_buffer_status = doBufferize(nz_deadline, i_min_buffering, i_extra_buffering);
+    last_buffer_status = doBufferize(nz_deadline, i_min_buffering, i_extra_buffering, b_overbudget);
     return last_buffer_status;
 }
 
 AbstractStream::buffering_status AbstractStream::doBufferize(vlc_tick_t nz_deadline,
-                                                             vlc_tick_t i_min_buffering, vlc_tick_t i_extra_buffering)
+                                                             vlc_tick_t i_min_buffering, vlc_tick_t i_extra_buffering,
+                                                             bool b_overbudget)
 {
     vlc_mutex_lock(&lock);
 
@@ -355,10 +357,12 @@ AbstractStream::buffering_status AbstractStream::doBufferize(vlc_tick_t nz_deadl
     }
 
     const vlc_tick_t i_total_buffering = i_min_buffering + i_extra_buffering;
+    /* Over the memory budget, only the minimum is refilled */
+    const vlc_tick_t i_fill_buffering = b_overbudget ? i_min_buffering : i_total_buffering;
 
     vlc_tick_t i_demuxed = commandsqueue->getDemuxedAmount();
     segmentTracker->notifyBufferingLevel(i_min_buffering, i_demuxed, i_total_buffering);
-    if(i_demuxed < i_total_buffering) /* not already demuxed */
+    if(i_demuxed < i_fill_buffering) /* not already demuxed */
     {
         if(!segmentTracker->segmentsListReady()) /* Live Streams */
         {
@@ -367,7 +371,7 @@ AbstractStream::buffering_status AbstractStream::doBufferize(vlc_tick_t nz_deadl
         }
 
         vlc_tick_t nz_extdeadline = commandsqueue->getBufferingLevel() +
-                                (i_total_buffering - commandsqueue->getDemuxedAmount()) / 4;
+                                (i_fill_buffering - commandsqueue->getDemuxedAmount()) / 4;
         nz_deadline = std::max(nz_deadline, nz_extdeadline);
 
         /* need to read, demuxer still buffering, ... */
@@ -399,7 +403,7 @@ AbstractStream::buffering_status AbstractStream::doBufferize(vlc_tick_t nz_deadl
     }
     vlc_mutex_unlock(&lock);
 
-    if(i_demuxed < i_total_buffering) /* need to read more */
+    if(i_demuxed < i_fill_buffering) /* need to read more */
     {
         if(i_demuxed < i_min_buffering)
             return AbstractStream::buffering_lessthanmin; /* high prio */
@@ -650,6 +654,13 @@ void AbstractStream::trackerEvent(const SegmentTrackerEvent &event)
             }
             break;
 
+        case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+            /* lets the downloader serve the starving streams first */
+            if(connManager)
+                connManager->updateBufferingLevel(*event.u.buffering_level.id,
+                                                  event.u.buffering_level.current);
+            break;
+
         default:
             break;
     }
@@ -83,7 +83,7 @@ namespace adaptive
             buffering_ongoing,
             buffering_lessthanmin,
         } buffering_status;
-        buffering_status bufferize(vlc_tick_t, vlc_tick_t, vlc_tick_t);
+        buffering_status bufferize(vlc_tick_t, vlc_tick_t, vlc_tick_t, bool);
         buffering_status getLastBufferStatus() const;
         vlc_tick_t getDemuxedAmount() const;
         status dequeue(vlc_tick_t, vlc_tick_t *);
@@ -134,7 +134,7 @@ namespace adaptive
         vlc_mutex_t lock; /* lock for everything accessed by dequeuing */
 
     private:
-        buffering_status doBufferize(vlc_tick_t, vlc_tick_t, vlc_tick_t);
+        buffering_status doBufferize(vlc_tick_t, vlc_tick_t, vlc_tick_t, bool);
         buffering_status last_buffer_status;
         bool dead;
         bool disabled;
@@ -76,10 +76,31 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_LOWLATENCY_TEXT N_("Low latency live playback")
+#define ADAPT_LOWLATENCY_LONGTEXT N_("Play live streams close to the live edge, " \
+                                     "using the partial segments (LL-HLS parts, " \
+                                     "chunked CMAF) as they are produced")
+
+#define ADAPT_LIVEDELAY_TEXT N_("Live delay (ms)")
+#define ADAPT_LIVEDELAY_LONGTEXT N_("Distance to the live edge in low latency mode. " \
+                                    "0 uses the one advertised by the stream.")
+
+#define ADAPT_DOWNLOADERS_TEXT N_("Parallel downloads")
+#define ADAPT_DOWNLOADERS_LONGTEXT N_("Maximum number of segments downloaded at the " \
+                                      "same time, from the least buffered streams first")
+
+#define ADAPT_MAXBUFFERMEM_TEXT N_("Maximum buffers memory (MiB)")
+#define ADAPT_MAXBUFFERMEM_LONGTEXT N_("Memory shared by the downloaded and demuxed data " \
+                                       "of all the streams. Once exceeded, the streams " \
+                                       "are only refilled up to the minimum buffering. " \
+                                       "0 for no limit.")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
                                 AbstractAdaptationLogic::NearOptimal,
+                                AbstractAdaptationLogic::BufferBased,
+                                AbstractAdaptationLogic::Hybrid,
                                 AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
@@ -89,6 +110,8 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "bola",
+                                "hybrid",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -97,6 +120,8 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Buffer Based (BOLA)"),
+                                           N_("Hybrid Throughput/Buffer Based"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -122,6 +147,13 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-downloaders", 3, 1, 8,
+                                ADAPT_DOWNLOADERS_TEXT, ADAPT_DOWNLOADERS_LONGTEXT, true );
+        add_bool   ( "adaptive-lowlatency", false, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT, false );
+        add_integer_with_range( "adaptive-livedelay", 0, 0, 60000,
+                                ADAPT_LIVEDELAY_TEXT, ADAPT_LIVEDELAY_LONGTEXT, true );
+        add_integer( "adaptive-maxbuffermem", 0,
+                     ADAPT_MAXBUFFERMEM_TEXT, ADAPT_MAXBUFFERMEM_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -211,9 +211,14 @@ block_t * HTTPChunkSource::read(size_t readsize)
     }
 
     vlc_tick_t time = vlc_tick_now();
-    ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    /* reads can be short on chunked transfers */
+    size_t total = 0;
+    ssize_t ret = 0;
+    while(total < readsize &&
+          (ret = connection->read(&p_block->p_buffer[total], readsize - total)) > 0)
+        total += ret;
     time = vlc_tick_now() - time;
-    if(ret < 0)
+    if(ret < 0 && total == 0)
     {
         block_Release(p_block);
         p_block = NULL;
@@ -221,11 +226,11 @@ block_t * HTTPChunkSource::read(size_t readsize)
     }
     else
     {
-        p_block->i_buffer = (size_t) ret;
+        p_block->i_buffer = total;
         consumed += p_block->i_buffer;
-        if((size_t)ret < readsize)
+        if(total < readsize)
             eof = true;
-        if(ret && time)
+        if(total && time)
             connManager->updateDownloadRate(sourceid, p_block->i_buffer, time);
     }
 
@@ -303,7 +308,6 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
-    downloadstart = 0;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -322,6 +326,7 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         p_head = NULL;
         pp_tail = &p_head;
     }
+    connManager->getMemoryBudget()->remove(buffered);
     buffered = 0;
     vlc_mutex_unlock(&lock);
 
@@ -334,6 +339,12 @@ bool HTTPChunkBufferedSource::isDone() const
     return done;
 }
 
+size_t HTTPChunkBufferedSource::getBufferedSize() const
+{
+    vlc_mutex_locker locker( &lock );
+    return buffered;
+}
+
 void HTTPChunkBufferedSource::hold()
 {
     vlc_mutex_locker locker( &lock );
@@ -347,7 +358,7 @@ void HTTPChunkBufferedSource::release()
     vlc_cond_signal(&avail);
 }
 
-void HTTPChunkBufferedSource::bufferize(size_t readsize)
+size_t HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     vlc_mutex_lock(&lock);
     if(!prepare())
@@ -356,7 +367,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         eof = true;
         vlc_cond_signal(&avail);
         vlc_mutex_unlock(&lock);
-        return;
+        return 0;
     }
 
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
@@ -371,57 +382,31 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(!p_block)
     {
         eof = true;
-        return;
+        return 0;
     }
 
-    struct
-    {
-        size_t size;
-        vlc_tick_t time;
-    } rate = {0,0};
-
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
         block_Release(p_block);
         p_block = NULL;
+        ret = 0;
         vlc_mutex_locker locker( &lock );
         done = true;
-        rate.size = buffered + consumed;
-        rate.time = vlc_tick_now() - downloadstart;
-        downloadstart = 0;
     }
     else
     {
+        /* Short reads are partial chunked transfers, delivered as soon as
+         * received. The end is only known on the next empty read. */
         p_block->i_buffer = (size_t) ret;
         vlc_mutex_locker locker( &lock );
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
-        if((size_t) ret < readsize)
-        {
-            done = true;
-            rate.size = buffered + consumed;
-            rate.time = vlc_tick_now() - downloadstart;
-            downloadstart = 0;
-        }
-    }
-
-    if(rate.size && rate.time)
-    {
-        connManager->updateDownloadRate(sourceid, rate.size, rate.time);
+        connManager->getMemoryBudget()->add(p_block->i_buffer);
     }
 
     vlc_cond_signal(&avail);
-}
-
-bool HTTPChunkBufferedSource::prepare()
-{
-    if(!prepared)
-    {
-        downloadstart = vlc_tick_now();
-        return HTTPChunkSource::prepare();
-    }
-    return true;
+    return ret;
 }
 
 bool HTTPChunkBufferedSource::hasMoreData() const
@@ -460,6 +445,7 @@ block_t * HTTPChunkBufferedSource::readBlock()
 
     consumed += p_block->i_buffer;
     buffered -= p_block->i_buffer;
+    connManager->getMemoryBudget()->remove(p_block->i_buffer);
 
     return p_block;
 }
@@ -500,6 +486,7 @@ block_t * HTTPChunkBufferedSource::read(size_t readsize)
     }
 
     consumed += copied;
+    connManager->getMemoryBudget()->remove(copied);
     p_block->i_buffer = copied;
 
     if(copied < readsize)
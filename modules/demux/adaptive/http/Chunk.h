@@ -130,9 +130,9 @@ namespace adaptive
                 void               release();
 
             protected:
-                virtual bool       prepare(); /* reimpl */
-                void               bufferize(size_t);
+                size_t             bufferize(size_t);
                 bool               isDone() const;
+                size_t             getBufferedSize() const;
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -140,7 +140,6 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
-                vlc_tick_t          downloadstart;
                 vlc_cond_t          avail;
                 bool                held;
         };
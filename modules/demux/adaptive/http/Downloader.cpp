@@ -22,50 +22,71 @@
 #endif
 
 #include "Downloader.hpp"
+#include "../tools/MemoryBudget.hpp"
 
 #include <vlc_threads.h>
 
-#include <atomic>
+#include <algorithm>
 
 using namespace adaptive::http;
+using namespace adaptive;
 
-Downloader::Downloader()
+Downloader::StreamQueue::StreamQueue()
+{
+    /* unknown level, served after the streams known to be starving */
+    bufferinglevel = INT64_MAX;
+    busy = false;
+}
+
+Downloader::Downloader(const MemoryBudget *budget_, IDownloadRateObserver *observer)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    budget = budget_;
+    rateObserver = observer;
+    transfers = 0;
+    transferSize = 0;
+    transferTime = 0;
+    transferDate = 0;
 }
 
-bool Downloader::start()
+bool Downloader::start(unsigned count)
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    if(count == 0)
+        count = 1;
+
+    while(threads.size() < count)
     {
-        return false;
+        vlc_thread_t thread;
+        if(vlc_clone(&thread, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     source->hold();
-    chunks.push_back(source);
+    queues[source->sourceid].chunks.push_back(source);
     vlc_cond_signal(&waitcond);
     vlc_mutex_unlock(&lock);
 }
@@ -73,11 +94,71 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the worker reading it, if any */
+    while(isDownloading(source))
+        vlc_cond_wait(&updatedcond, &lock);
     source->release();
-    chunks.remove(source);
+    std::map<ID, StreamQueue>::iterator it = queues.find(source->sourceid);
+    if(it != queues.end())
+        (*it).second.chunks.remove(source);
+    releaseQueue(source->sourceid);
+    vlc_mutex_unlock(&lock);
+}
+
+void Downloader::updateBufferingLevel(const ID &id, vlc_tick_t level)
+{
+    vlc_mutex_lock(&lock);
+    queues[id].bufferinglevel = level;
     vlc_mutex_unlock(&lock);
 }
 
+/* Queues are created by the first segment or level of a stream, and
+ * removed once idle, so that ended streams do not accumulate */
+void Downloader::releaseQueue(const ID &id)
+{
+    std::map<ID, StreamQueue>::iterator it = queues.find(id);
+    if(it != queues.end() && !(*it).second.busy && (*it).second.chunks.empty())
+        queues.erase(it);
+}
+
+void Downloader::updateTransferTime(vlc_tick_t now)
+{
+    if(transfers > 0)
+        transferTime += now - transferDate;
+    transferDate = now;
+}
+
+bool Downloader::isDownloading(const HTTPChunkBufferedSource *source) const
+{
+    return std::find(downloading.begin(), downloading.end(), source) != downloading.end();
+}
+
+Downloader::StreamQueue * Downloader::getNextQueue(bool *pb_throttled)
+{
+    /* Over the memory budget, a source is only read when its reader
+     * has consumed everything, so that it can't block playback */
+    const bool b_overbudget = budget && budget->isExceeded();
+    *pb_throttled = false;
+
+    /* The stream closest to underflow first */
+    StreamQueue *next = NULL;
+    std::map<ID, StreamQueue>::iterator it;
+    for(it = queues.begin(); it != queues.end(); ++it)
+    {
+        StreamQueue *queue = &(*it).second;
+        if(queue->busy || queue->chunks.empty())
+            continue;
+        if(b_overbudget && queue->chunks.front()->getBufferedSize())
+        {
+            *pb_throttled = true;
+            continue;
+        }
+        if(next == NULL || queue->bufferinglevel < next->bufferinglevel)
+            next = queue;
+    }
+    return next;
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
     Downloader *instance = static_cast<Downloader *>(opaque);
@@ -87,10 +168,11 @@ void * Downloader::downloaderThread(void *opaque)
     return NULL;
 }
 
-void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
+size_t Downloader::DownloadSource(HTTPChunkBufferedSource *source)
 {
-    if(!source->isDone())
-        source->bufferize(HTTPChunkSource::CHUNK_SIZE);
+    if(source->isDone())
+        return 0;
+    return source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
 void Downloader::Run()
@@ -98,22 +180,49 @@ void Downloader::Run()
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
-            vlc_cond_wait(&waitcond, &lock);
+        StreamQueue *queue;
+        bool b_throttled;
+        while(!killed && !(queue = getNextQueue(&b_throttled)))
+        {
+            if(b_throttled) /* reads are not signaled, poll them */
+                vlc_cond_timedwait(&waitcond, &lock, vlc_tick_now() + VLC_TICK_FROM_MS(10));
+            else
+                vlc_cond_wait(&waitcond, &lock);
+        }
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        /* Read one block, then pick the next stream again, so that a
+         * starving stream does not wait for a whole segment */
+        HTTPChunkBufferedSource *source = queue->chunks.front();
+        queue->busy = true;
+        downloading.push_back(source);
+        updateTransferTime(vlc_tick_now());
+        transfers++;
+        vlc_mutex_unlock(&lock);
+
+        size_t size = DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        updateTransferTime(vlc_tick_now());
+        transfers--;
+        transferSize += size;
+        downloading.remove(source);
+        queue->busy = false;
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            if(rateObserver && transferSize && transferTime)
+                rateObserver->updateDownloadRate(source->sourceid,
+                                                 transferSize, transferTime);
+            transferSize = 0;
+            transferTime = 0;
+            queue->chunks.remove(source);
+            source->release();
+            releaseQueue(source->sourceid);
         }
+        vlc_cond_broadcast(&updatedcond);
+        vlc_cond_signal(&waitcond);
     }
     vlc_mutex_unlock(&lock);
 }
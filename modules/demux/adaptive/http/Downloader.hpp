@@ -21,12 +21,17 @@
 #define DOWNLOADER_HPP
 
 #include "Chunk.h"
+#include "../ID.hpp"
+#include "../logic/IDownloadRateObserver.h"
 
 #include <vlc_common.h>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace adaptive
 {
+    class MemoryBudget;
 
     namespace http
     {
@@ -34,22 +39,49 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(const MemoryBudget *, IDownloadRateObserver *);
                 ~Downloader();
-                bool start();
+                bool start(unsigned = 1);
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
+                void updateBufferingLevel(const ID &, vlc_tick_t);
 
             private:
+                /* Sources of a stream are downloaded in order, by a single
+                 * worker at a time */
+                class StreamQueue
+                {
+                    public:
+                        StreamQueue();
+                        std::list<HTTPChunkBufferedSource *> chunks;
+                        vlc_tick_t bufferinglevel;
+                        bool       busy;
+                };
+
                 static void * downloaderThread(void *);
                 void Run();
-                void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                size_t DownloadSource(HTTPChunkBufferedSource *);
+                StreamQueue * getNextQueue(bool *);
+                void releaseQueue(const ID &);
+                void updateTransferTime(vlc_tick_t);
+                bool isDownloading(const HTTPChunkBufferedSource *) const;
+                std::vector<vlc_thread_t> threads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
                 bool         killed;
-                std::list<HTTPChunkBufferedSource *> chunks;
+                const MemoryBudget *budget;
+                std::map<ID, StreamQueue> queues;
+                std::list<const HTTPChunkBufferedSource *> downloading;
+
+                /* The transfers share the bandwidth: the rate is measured
+                 * over all of them, on the wall clock time at least one
+                 * is active, and reported when a source completes */
+                IDownloadRateObserver *rateObserver;
+                unsigned     transfers;
+                size_t       transferSize;
+                vlc_tick_t   transferTime;
+                vlc_tick_t   transferDate;
         };
 
     }
@@ -225,7 +225,9 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(ret >= 0)
         bytesRead += ret;
 
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
+    /* chunked reads stop at chunk boundaries */
+    const bool eof = (chunked) ? chunked_eof : (ret >= 0 && (size_t)ret < len);
+    if(ret < 0 || eof || /* set EOF */
        (contentLength == bytesRead && connectionClose))
     {
         transport->disconnect();
@@ -342,6 +344,11 @@ ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
             ssize_t in = transport->read(&crlf, 2);
             if(in < 2 || memcmp(crlf, "\r\n", 2))
                 return (copied == 0) ? -1 : copied;
+
+            /* Don't wait for the next chunk, which can be a CMAF chunk
+             * or a part still being produced */
+            if(copied > 0)
+                break;
         }
     }
 
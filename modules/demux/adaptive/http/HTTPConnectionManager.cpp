@@ -53,17 +53,27 @@ void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid,
         rateObserver->updateDownloadRate(sourceid, size, time);
 }
 
+void AbstractConnectionManager::updateBufferingLevel(const adaptive::ID &, vlc_tick_t)
+{
+
+}
+
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
 {
     rateObserver = obs;
 }
 
+adaptive::MemoryBudget * AbstractConnectionManager::getMemoryBudget()
+{
+    return &memoryBudget;
+}
+
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AbstractConnectionFactory *factory_)
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    downloader = new (std::nothrow) Downloader(&memoryBudget, this);
+    downloader->start(var_InheritInteger(p_object, "adaptive-downloaders"));
     factory = factory_;
 }
 
@@ -71,8 +81,8 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthSt
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    downloader = new (std::nothrow) Downloader(&memoryBudget, this);
+    downloader->start(var_InheritInteger(p_object, "adaptive-downloaders"));
     factory = new ConnectionFactory(storage);
 }
 
@@ -154,3 +164,8 @@ void HTTPConnectionManager::cancel(AbstractChunkSource *source)
     if(src)
         downloader->cancel(src);
 }
+
+void HTTPConnectionManager::updateBufferingLevel(const adaptive::ID &id, vlc_tick_t level)
+{
+    downloader->updateBufferingLevel(id, level);
+}
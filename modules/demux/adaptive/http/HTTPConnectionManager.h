@@ -26,6 +26,7 @@
 #define HTTPCONNECTIONMANAGER_H_
 
 #include "../logic/IDownloadRateObserver.h"
+#include "../tools/MemoryBudget.hpp"
 
 #include <vlc_common.h>
 
@@ -52,12 +53,15 @@ namespace adaptive
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
+                virtual void updateBufferingLevel(const ID &, vlc_tick_t);
 
                 virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t); /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                MemoryBudget * getMemoryBudget();
 
             protected:
                 vlc_object_t                                       *p_object;
+                MemoryBudget                                        memoryBudget;
 
             private:
                 IDownloadRateObserver                              *rateObserver;
@@ -75,6 +79,7 @@ namespace adaptive
 
                 virtual void start(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
+                virtual void updateBufferingLevel(const ID &, vlc_tick_t) /* reimpl */;
 
             private:
                 void    releaseAllConnections ();
@@ -61,6 +61,8 @@ namespace adaptive
                     FixedRate,
                     Predictive,
                     NearOptimal,
+                    BufferBased,
+                    Hybrid,
                 };
 
             protected:
@@ -0,0 +1,252 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../tools/Debug.hpp"
+
+#include <cmath>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * BOLA-BASIC: buffer occupancy based Lyapunov algorithm
+ * http://arxiv.org/abs/1601.06748
+ *
+ * Unlike NearOptimal, quality only depends on the buffer level once started,
+ * the throughput only limiting up switches (BOLA-O).
+ * The hybrid mode uses the throughput rule while the buffer is low and hands
+ * over to BOLA once it has grown (dash.js DYNAMIC strategy).
+ */
+
+#define bolaMinimumBufferS  VLC_TICK_FROM_SEC(6)  /* Qmin */
+#define bolaBufferTargetS   VLC_TICK_FROM_SEC(60)
+#define bolaBufferPerLevelS VLC_TICK_FROM_SEC(2)
+#define bolaThroughputSafety 0.9
+
+BufferBasedContext::BufferBasedContext()
+    : buffering_min( bolaMinimumBufferS )
+    , buffering_level( 0 )
+    , buffering_target( bolaBufferTargetS )
+    , last_download_rate( 0 )
+    , b_buffer_based( false )
+{ }
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic(vlc_object_t *p_obj_, bool b_hybrid_)
+    : AbstractAdaptationLogic()
+{
+    b_hybrid = b_hybrid_;
+    p_obj = p_obj_;
+    vlc_mutex_init(&lock);
+}
+
+BufferBasedAdaptationLogic::~BufferBasedAdaptationLogic()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+/* Highest quality is reached halfway to the buffering target,
+ * the upper half being kept as a safety margin */
+static vlc_tick_t getBolaBufferTime(vlc_tick_t target, vlc_tick_t min, size_t levels)
+{
+    vlc_tick_t buffertime = std::max(target / 2, min + bolaBufferPerLevelS * (vlc_tick_t) levels);
+    return std::min(buffertime, target);
+}
+
+BaseRepresentation *
+BufferBasedAdaptationLogic::getBufferBasedRepresentation(BaseAdaptationSet *adaptSet,
+                                                         RepresentationSelector &selector,
+                                                         const BufferBasedContext &ctx) const
+{
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    if(lowest == NULL || lowest == highest || lowest->getBandwidth() == 0)
+        return lowest;
+
+    /* utilities are ln(S/Smin) + 1, so that lowest is 1 */
+    const float smin = lowest->getBandwidth();
+    const float umax = std::log(highest->getBandwidth() / smin) + 1.0;
+    if(umax <= 1.0)
+        return lowest;
+
+    size_t levels = 0;
+    BaseRepresentation *prev = NULL;
+    for(BaseRepresentation *rep = lowest; rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        levels++;
+        prev = rep;
+    }
+
+    const vlc_tick_t min = std::max(ctx.buffering_min, VLC_TICK_FROM_SEC(1));
+    const vlc_tick_t buffertime = getBolaBufferTime(ctx.buffering_target, min, levels);
+    if(buffertime <= min)
+        return lowest;
+
+    /* lowest below Qmin, highest beyond the buffer time */
+    const float gp = (umax - 1.0) / ((float) buffertime / min - 1.0);
+    const float Vp = secf_from_vlc_tick(min) / gp;
+    const float Q = secf_from_vlc_tick(ctx.buffering_level);
+
+    BaseRepresentation *ret = NULL;
+    float argmax = 0;
+    prev = NULL;
+    for(BaseRepresentation *rep = lowest; rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        const float u = std::log(rep->getBandwidth() / smin) + 1.0;
+        const float arg = (Vp * (u + gp) - Q) / rep->getBandwidth();
+        if(ret == NULL || arg >= argmax)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+    return ret;
+}
+
+BaseRepresentation *BufferBasedAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet, BaseRepresentation *prevRep)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+
+    vlc_mutex_lock(&lock);
+
+    std::map<ID, BufferBasedContext>::iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return selector.lowest(adaptSet);
+    }
+
+    BufferBasedContext &ctx = (*it).second;
+    if(b_hybrid)
+    {
+        /* Hysteresis, so we don't flip on each segment */
+        const vlc_tick_t min = std::max(ctx.buffering_min, VLC_TICK_FROM_SEC(1));
+        const vlc_tick_t switchon = getBolaBufferTime(ctx.buffering_target, min, 1) / 2;
+        if(ctx.buffering_level >= switchon)
+            ctx.b_buffer_based = true;
+        else if(ctx.buffering_level < switchon / 2)
+            ctx.b_buffer_based = false;
+    }
+    else ctx.b_buffer_based = true;
+    const BufferBasedContext ctxcopy = ctx;
+
+    vlc_mutex_unlock(&lock);
+
+    const uint64_t bps = ctxcopy.last_download_rate * bolaThroughputSafety;
+
+    BaseRepresentation *rep;
+    if(prevRep == NULL || !ctxcopy.b_buffer_based) /* Starting or throughput rule */
+    {
+        rep = bps ? selector.select(adaptSet, bps) : selector.lowest(adaptSet);
+    }
+    else
+    {
+        rep = getBufferBasedRepresentation(adaptSet, selector, ctxcopy);
+        /* BOLA-O: don't step up beyond what the link sustains, or the
+         * buffer growing back would make us oscillate */
+        if(rep && bps && rep->getBandwidth() > prevRep->getBandwidth())
+        {
+            BaseRepresentation *sustainable = selector.select(adaptSet, bps);
+            if(sustainable && sustainable->getBandwidth() < rep->getBandwidth())
+                rep = (sustainable->getBandwidth() > prevRep->getBandwidth()) ? sustainable : prevRep;
+        }
+    }
+
+    BwDebug( msg_Info(p_obj, "Stream %s buffering level %.2f%% %s rep %" PRIu64 " kBps dl %" PRIu64 " kBps",
+                      adaptSet->getID().str().c_str(),
+                      (float) 100 * ctxcopy.buffering_level / ctxcopy.buffering_target,
+                      ctxcopy.b_buffer_based ? "bola" : "rate",
+                      rep ? rep->getBandwidth() / 8000 : 0, bps / 8000); );
+
+    return rep;
+}
+
+void BufferBasedAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize, vlc_tick_t time)
+{
+    if(unlikely(time == 0))
+        return;
+
+    vlc_mutex_lock(&lock);
+    std::map<ID, BufferBasedContext>::iterator it = streams.find(id);
+    if(it != streams.end())
+    {
+        BufferBasedContext &ctx = (*it).second;
+        ctx.last_download_rate = ctx.average.push(CLOCK_FREQ * dlsize * 8 / time);
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+void BufferBasedAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    switch(event.type)
+    {
+    case SegmentTrackerEvent::BUFFERING_STATE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            if(event.u.buffering.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                {
+                    BufferBasedContext ctx;
+                    streams.insert(std::pair<ID, BufferBasedContext>(id, ctx));
+                }
+            }
+            else
+            {
+                std::map<ID, BufferBasedContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+            }
+            vlc_mutex_unlock(&lock);
+            BwDebug(msg_Info(p_obj, "Stream %s is now known %sactive", id.str().c_str(),
+                             (event.u.buffering.enabled) ? "" : "in"));
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        {
+            const ID &id = *event.u.buffering_level.id;
+            vlc_mutex_lock(&lock);
+            std::map<ID, BufferBasedContext>::iterator it = streams.find(id);
+            if(it != streams.end())
+            {
+                BufferBasedContext &ctx = (*it).second;
+                if(event.u.buffering_level.minimum > 0)
+                    ctx.buffering_min = event.u.buffering_level.minimum;
+                ctx.buffering_level = event.u.buffering_level.current;
+                ctx.buffering_target = event.u.buffering_level.target;
+            }
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    default:
+            break;
+    }
+}
@@ -46,6 +46,9 @@ AbstractPlaylist::AbstractPlaylist (vlc_object_t *p_object_) :
     minBufferTime = 0;
     timeShiftBufferDepth.Set( 0 );
     suggestedPresentationDelay.Set( 0 );
+    targetLatency.Set( 0 );
+    liveDelay = 0;
+    b_lowlatency = false;
 }
 
 AbstractPlaylist::~AbstractPlaylist()
@@ -86,15 +89,49 @@ void AbstractPlaylist::setMinBuffering( vlc_tick_t min )
 
 vlc_tick_t AbstractPlaylist::getMinBuffering() const
 {
+    /* Can't buffer more than the distance to the live edge */
+    if( isLowLatency() )
+        return getLiveDelay() / 2;
     return std::max(minBufferTime, VLC_TICK_FROM_SEC(6));
 }
 
 vlc_tick_t AbstractPlaylist::getMaxBuffering() const
 {
+    if( isLowLatency() )
+        return getLiveDelay();
     const vlc_tick_t minbuf = getMinBuffering();
     return std::max(minbuf, VLC_TICK_FROM_SEC(60));
 }
 
+void AbstractPlaylist::setLowLatency( bool b )
+{
+    b_lowlatency = b;
+}
+
+bool AbstractPlaylist::isLowLatency() const
+{
+    return b_lowlatency && isLive();
+}
+
+void AbstractPlaylist::setLiveDelay( vlc_tick_t delay )
+{
+    liveDelay = delay;
+}
+
+vlc_tick_t AbstractPlaylist::getLiveDelay() const
+{
+    /* Distance from the live edge to start playback at */
+    if( isLowLatency() )
+    {
+        if( liveDelay )
+            return liveDelay;
+        if( targetLatency.Get() )
+            return targetLatency.Get();
+        return VLC_TICK_FROM_SEC(3);
+    }
+    return getMaxBuffering() + /* FIXME: add dynamic pts-delay */ VLC_TICK_FROM_SEC(1);
+}
+
 Url AbstractPlaylist::getUrlSegment() const
 {
     Url ret;
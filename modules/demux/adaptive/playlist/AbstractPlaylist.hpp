@@ -45,6 +45,10 @@ namespace adaptive
                 void                            setMinBuffering( vlc_tick_t );
                 vlc_tick_t                      getMinBuffering() const;
                 vlc_tick_t                      getMaxBuffering() const;
+                void                            setLowLatency( bool );
+                bool                            isLowLatency() const;
+                void                            setLiveDelay( vlc_tick_t );
+                vlc_tick_t                      getLiveDelay() const;
                 virtual void                    debug() = 0;
 
                 void    addPeriod               (BasePeriod *period);
@@ -69,6 +73,7 @@ namespace adaptive
                 Property<vlc_tick_t>                   maxSegmentDuration;
                 Property<vlc_tick_t>                   timeShiftBufferDepth;
                 Property<vlc_tick_t>                   suggestedPresentationDelay;
+                Property<vlc_tick_t>                   targetLatency;
 
             protected:
                 vlc_object_t                       *p_object;
@@ -77,6 +82,8 @@ namespace adaptive
                 std::string                         playlistUrl;
                 std::string                         type;
                 vlc_tick_t                          minBufferTime;
+                vlc_tick_t                          liveDelay;
+                bool                                b_lowlatency;
         };
     }
 }
@@ -164,11 +164,10 @@ std::size_t SegmentInformation::getAllSegments(std::vector<ISegment *> &retSegme
 
 uint64_t SegmentInformation::getLiveStartSegmentNumber(uint64_t def) const
 {
-    const vlc_tick_t i_max_buffering = getPlaylist()->getMaxBuffering() +
-                                    /* FIXME: add dynamic pts-delay */ VLC_TICK_FROM_SEC(1);
+    const vlc_tick_t i_max_buffering = getPlaylist()->getLiveDelay();
 
-    /* Try to never buffer up to really end */
-    const uint64_t OFFSET_FROM_END = 3;
+    /* Try to never buffer up to really end, unless targeting the live edge */
+    const uint64_t OFFSET_FROM_END = getPlaylist()->isLowLatency() ? 0 : 3;
 
     if( mediaSegmentTemplate )
     {
@@ -558,6 +557,11 @@ void SegmentInformation::setSegmentTemplate(MediaSegmentTemplate *templ)
         mediaSegmentTemplate = templ;
 }
 
+MediaSegmentTemplate * SegmentInformation::getSegmentTemplate() const
+{
+    return mediaSegmentTemplate;
+}
+
 static void insertIntoSegment(std::vector<ISegment *> &seglist, size_t start,
                               size_t end, stime_t time, stime_t duration)
 {
@@ -79,7 +79,7 @@ namespace adaptive
                 ISegment * getNextSegment(SegmentInfoType, uint64_t, uint64_t *, bool *) const;
                 bool getSegmentNumberByTime(vlc_tick_t, uint64_t *) const;
                 bool getPlaybackTimeDurationBySegmentNumber(uint64_t, vlc_tick_t *, vlc_tick_t *) const;
-                uint64_t getLiveStartSegmentNumber(uint64_t) const;
+                virtual uint64_t getLiveStartSegmentNumber(uint64_t) const;
                 virtual void mergeWith(SegmentInformation *, vlc_tick_t);
                 virtual void mergeWithTimeline(SegmentTimeline *); /* ! don't use with global merge */
                 virtual void pruneBySegmentNumber(uint64_t);
@@ -98,6 +98,7 @@ namespace adaptive
                 void appendSegmentList(SegmentList *, bool = false);
                 void setSegmentBase(SegmentBase *);
                 void setSegmentTemplate(MediaSegmentTemplate *);
+                MediaSegmentTemplate * getSegmentTemplate() const; /* own, not inherited */
                 void setSwitchPolicy(SwitchPolicy);
                 virtual Url getUrlSegment() const; /* impl */
                 Property<Url *> baseUrl;
@@ -43,6 +43,7 @@ MediaSegmentTemplate::MediaSegmentTemplate( SegmentInformation *parent ) :
     debugName = "SegmentTemplate";
     classId = Segment::CLASSID_SEGMENT;
     startNumber.Set( 1 );
+    availabilityTimeOffset.Set( 0 );
     initialisationSegment.Set( NULL );
     templated = true;
     parentSegmentInformation = parent;
@@ -89,7 +90,9 @@ uint64_t MediaSegmentTemplate::getCurrentLiveTemplateNumber() const
         const Timescale timescale = inheritTimescale();
         time_t streamstart = parentSegmentInformation->getPlaylist()->availabilityStartTime.Get();
         streamstart += parentSegmentInformation->getPeriodStart();
-        stime_t elapsed = timescale.ToScaled(vlc_tick_from_sec(playbacktime - streamstart));
+        /* chunked segments are available before being complete */
+        stime_t elapsed = timescale.ToScaled(vlc_tick_from_sec(playbacktime - streamstart) +
+                                             availabilityTimeOffset.Get());
         number += elapsed / dur;
     }
 
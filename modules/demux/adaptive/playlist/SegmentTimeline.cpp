@@ -223,31 +223,51 @@ void SegmentTimeline::mergeWith(SegmentTimeline &other)
         return;
     }
 
-    Element *last = elements.back();
     while(other.elements.size())
     {
         Element *el = other.elements.front();
         other.elements.pop_front();
 
-        if(last->contains(el->t)) /* Same element, but prev could have been middle of repeat */
-        {
-            const uint64_t count = (el->t - last->t) / last->d;
-            last->r = std::max(last->r, el->r + count);
-            delete el;
-        }
-        else if(el->t < last->t)
+        if(mergeWithLast(el->r, el->t))
         {
             delete el;
         }
         else /* Did not exist in previous list */
         {
-            elements.push_back(el);
+            const Element *last = elements.back();
             el->number = last->number + last->r + 1;
-            last = el;
+            elements.push_back(el);
         }
     }
 }
 
+bool SegmentTimeline::mergeElement(stime_t d, uint64_t r, stime_t t)
+{
+    if(elements.empty())
+        return false;
+
+    if(!mergeWithLast(r, t))
+    {
+        const Element *last = elements.back();
+        Element *el = new (std::nothrow) Element(last->number + last->r + 1, d, r, t);
+        if(el)
+            elements.push_back(el);
+    }
+    return true;
+}
+
+bool SegmentTimeline::mergeWithLast(uint64_t r, stime_t t)
+{
+    Element *last = elements.back();
+    if(last->contains(t)) /* Same element, but prev could have been middle of repeat */
+    {
+        const uint64_t count = (t - last->t) / last->d;
+        last->r = std::max(last->r, r + count);
+        return true;
+    }
+    return t < last->t;
+}
+
 void SegmentTimeline::debug(vlc_object_t *obj, int indent) const
 {
     std::stringstream ss;
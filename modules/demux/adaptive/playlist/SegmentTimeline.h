@@ -50,9 +50,13 @@ namespace adaptive
                 void pruneByPlaybackTime(vlc_tick_t);
                 size_t pruneBySequenceNumber(uint64_t);
                 void mergeWith(SegmentTimeline &);
+                /* Merges a single element of an updated timeline,
+                   false if there is nothing to merge with */
+                bool mergeElement(stime_t d, uint64_t r, stime_t t);
                 void debug(vlc_object_t *, int = 0) const;
 
             private:
+                bool mergeWithLast(uint64_t, stime_t);
                 std::list<Element *> elements;
 
                 class Element
@@ -24,6 +24,7 @@
 #include "CommandsQueue.hpp"
 #include "FakeESOutID.hpp"
 #include "FakeESOut.hpp"
+#include "../tools/MemoryBudget.hpp"
 #include <vlc_es_out.h>
 #include <vlc_block.h>
 #include <vlc_meta.h>
@@ -56,6 +57,11 @@ vlc_tick_t AbstractCommand::getTime() const
     return VLC_TICK_INVALID;
 }
 
+size_t AbstractCommand::getSize() const
+{
+    return 0;
+}
+
 int AbstractCommand::getType() const
 {
     return type;
@@ -97,6 +103,11 @@ vlc_tick_t EsOutSendCommand::getTime() const
         return AbstractCommand::getTime();
 }
 
+size_t EsOutSendCommand::getSize() const
+{
+    return p_block ? p_block->i_buffer : 0;
+}
+
 const void * EsOutSendCommand::esIdentifier() const
 {
     return static_cast<const void *>(p_fakeid);
@@ -240,10 +251,11 @@ std::ostream& operator<<(std::ostream& ostr, const std::list<AbstractCommand *>&
 }
 #endif
 
-CommandsQueue::CommandsQueue( CommandsFactory *f )
+CommandsQueue::CommandsQueue( CommandsFactory *f, MemoryBudget *b )
 {
     bufferinglevel = VLC_TICK_INVALID;
     pcr = VLC_TICK_INVALID;
+    budget = b;
     b_drop = false;
     b_draining = false;
     b_eof = false;
@@ -287,6 +299,8 @@ void CommandsQueue::Schedule( AbstractCommand *command )
     }
     else
     {
+        if( budget )
+            budget->add( command->getSize() );
         incoming.push_back( command );
     }
     vlc_mutex_unlock(&lock);
@@ -381,6 +395,10 @@ vlc_tick_t CommandsQueue::Process( es_out_t *out, vlc_tick_t barrier )
                 lastdts = dts;
         }
 
+        /* data is no longer ours once sent */
+        if( budget )
+            budget->remove( command->getSize() );
+
         command->Execute( out );
         delete command;
     }
@@ -411,7 +429,7 @@ void CommandsQueue::Abort( bool b_reset )
     commands.splice( commands.end(), incoming );
     while( !commands.empty() )
     {
-        delete commands.front();
+        LockedDelete( commands.front() );
         commands.pop_front();
     }
 
@@ -507,6 +525,13 @@ vlc_tick_t CommandsQueue::getFirstDTS() const
     return i_firstdts;
 }
 
+void CommandsQueue::LockedDelete( AbstractCommand *command )
+{
+    if( budget )
+        budget->remove( command->getSize() );
+    delete command;
+}
+
 void CommandsQueue::LockedSetDraining()
 {
     LockedCommit();
@@ -28,6 +28,7 @@
 
 namespace adaptive
 {
+    class MemoryBudget;
     class FakeESOut;
     class FakeESOutID;
 
@@ -38,6 +39,7 @@ namespace adaptive
             virtual ~AbstractCommand();
             virtual void Execute( es_out_t * ) = 0;
             virtual vlc_tick_t getTime() const;
+            virtual size_t getSize() const; /* of the queued data */
             int getType() const;
 
         protected:
@@ -59,6 +61,7 @@ namespace adaptive
             virtual ~EsOutSendCommand();
             virtual void Execute( es_out_t *out );
             virtual vlc_tick_t getTime() const;
+            virtual size_t getSize() const;
             const void * esIdentifier() const;
 
         protected:
@@ -151,7 +154,7 @@ namespace adaptive
     class CommandsQueue
     {
         public:
-            CommandsQueue( CommandsFactory * );
+            CommandsQueue( CommandsFactory *, MemoryBudget * );
             ~CommandsQueue();
             const CommandsFactory * factory() const;
             void Schedule( AbstractCommand * );
@@ -174,10 +177,12 @@ namespace adaptive
             vlc_mutex_t lock;
             void LockedCommit();
             void LockedSetDraining();
+            void LockedDelete( AbstractCommand * );
             std::list<AbstractCommand *> incoming;
             std::list<AbstractCommand *> commands;
             vlc_tick_t bufferinglevel;
             vlc_tick_t pcr;
+            MemoryBudget *budget; /* shared with the other streams, can be NULL */
             bool b_draining;
             bool b_drop;
             bool b_eof;
@@ -0,0 +1,83 @@
+/*
+ * MemoryBudget.cpp
+ *****************************************************************************
+ * Copyright © 2019 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "MemoryBudget.hpp"
+
+using namespace adaptive;
+
+MemoryBudget::MemoryBudget()
+{
+    vlc_mutex_init(&lock);
+    limit = 0;
+    used = 0;
+    peak = 0;
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+void MemoryBudget::setLimit(size_t l)
+{
+    vlc_mutex_locker locker(&lock);
+    limit = l;
+}
+
+size_t MemoryBudget::getLimit() const
+{
+    vlc_mutex_locker locker(&lock);
+    return limit;
+}
+
+void MemoryBudget::add(size_t size)
+{
+    vlc_mutex_locker locker(&lock);
+    used += size;
+    if(used > peak)
+        peak = used;
+}
+
+void MemoryBudget::remove(size_t size)
+{
+    vlc_mutex_locker locker(&lock);
+    used = (size < used) ? used - size : 0;
+}
+
+size_t MemoryBudget::getUsed() const
+{
+    vlc_mutex_locker locker(&lock);
+    return used;
+}
+
+size_t MemoryBudget::getPeak() const
+{
+    vlc_mutex_locker locker(&lock);
+    return peak;
+}
+
+bool MemoryBudget::isExceeded() const
+{
+    vlc_mutex_locker locker(&lock);
+    return limit && used >= limit;
+}
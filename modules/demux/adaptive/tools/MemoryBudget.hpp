@@ -0,0 +1,50 @@
+/*
+ * MemoryBudget.hpp
+ *****************************************************************************
+ * Copyright © 2019 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef MEMORYBUDGET_HPP
+#define MEMORYBUDGET_HPP
+
+#include <vlc_common.h>
+
+namespace adaptive
+{
+    /* Accounts the bytes held by the buffers of all the streams,
+     * downloaded or demuxed, against an optional limit. */
+    class MemoryBudget
+    {
+        public:
+            MemoryBudget();
+            ~MemoryBudget();
+            void    setLimit(size_t); /* 0 for none */
+            size_t  getLimit() const;
+            void    add(size_t);
+            void    remove(size_t);
+            size_t  getUsed() const;
+            size_t  getPeak() const;
+            bool    isExceeded() const;
+
+        private:
+            mutable vlc_mutex_t lock;
+            size_t  limit;
+            size_t  used;
+            size_t  peak;
+    };
+}
+
+#endif // MEMORYBUDGET_HPP
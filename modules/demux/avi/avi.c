@@ -38,6 +38,7 @@
 #include <vlc_input.h>
 
 #include <vlc_dialog.h>
+#include <vlc_seekindex.h>
 
 #include <vlc_meta.h>
 #include <vlc_codecs.h>
@@ -220,6 +221,7 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static bool AVI_IndexLoadCache( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -707,7 +709,13 @@ aviindex:
                 b_index = true;
                 goto aviindex;
             }
-            if( i_do_index == 0 )
+            if( i_do_index == 0 && AVI_IndexLoadCache( p_demux ) )
+            {
+                /* The index was already built on a previous opening */
+                b_index = true;
+                p_sys->i_length = AVI_MovieGetLength( p_demux );
+            }
+            else if( i_do_index == 0 )
             {
                 const char *psz_msg = _(
                     "Because this file index is broken or missing, "
@@ -2569,6 +2577,87 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+/* Version of the layout of the cached index entries */
+#define AVI_SEEKINDEX_VERSION 1
+
+static bool AVI_IndexLoadCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    vlc_seekindex_t *p_cache = vlc_seekindex_New( p_demux, p_demux->s, "avi",
+                                                  AVI_SEEKINDEX_VERSION );
+    if( p_cache == NULL )
+        return false;
+
+    size_t i_count;
+    const vlc_seekindex_entry_t *p_entries;
+    bool b_ok = false;
+
+    if( vlc_seekindex_Load( p_cache ) )
+        goto end;
+
+    p_entries = vlc_seekindex_GetEntries( p_cache, &i_count );
+    for( size_t i = 0; i < i_count; i++ )
+        if( p_entries[i].track >= p_sys->i_track )
+            goto end;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->track[i]->idx );
+    }
+
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        avi_entry_t index;
+        index.i_id      = 0;
+        index.i_flags   = p_entries[i].flags;
+        index.i_pos     = p_entries[i].offset;
+        index.i_length  = p_entries[i].size;
+        index.i_lengthtotal = p_entries[i].size;
+        avi_index_Append( &p_sys->track[p_entries[i].track]->idx,
+                          &p_sys->i_movi_lastchunk_pos, &index );
+    }
+    b_ok = true;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        msg_Dbg( p_demux, "stream[%u] loaded %u cached index entries",
+                 i, p_sys->track[i]->idx.i_size );
+end:
+    vlc_seekindex_Delete( p_cache );
+    return b_ok;
+}
+
+static void AVI_IndexStoreCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    vlc_seekindex_t *p_cache = vlc_seekindex_New( p_demux, p_demux->s, "avi",
+                                                  AVI_SEEKINDEX_VERSION );
+    if( p_cache == NULL )
+        return;
+
+    /* Entries are stored per track, in file order */
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+
+        for( uint32_t j = 0; j < p_index->i_size; j++ )
+        {
+            const vlc_seekindex_entry_t entry = {
+                .time = 0,
+                .offset = p_index->p_entry[j].i_pos,
+                .size = p_index->p_entry[j].i_length,
+                .track = i,
+                .flags = p_index->p_entry[j].i_flags,
+            };
+            if( vlc_seekindex_Append( p_cache, &entry ) )
+                goto end;
+        }
+    }
+    vlc_seekindex_Store( p_cache );
+end:
+    vlc_seekindex_Delete( p_cache );
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2581,6 +2670,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     vlc_tick_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0, true );
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0, true );
@@ -2591,6 +2681,9 @@ static void AVI_IndexCreate( demux_t *p_demux )
         return;
     }
 
+    if( AVI_IndexLoadCache( p_demux ) )
+        return;
+
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
@@ -2619,7 +2712,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && vlc_tick_now() - i_dialog_update > VLC_TICK_FROM_MS(100) )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2698,6 +2794,9 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( !b_cancelled )
+        AVI_IndexStoreCache( p_demux );
 }
 
 /* */
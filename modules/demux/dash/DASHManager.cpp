@@ -32,6 +32,7 @@
 #include "DASHManager.h"
 #include "mpd/ProgramInformation.h"
 #include "mpd/IsoffMainParser.h"
+#include "mpd/IsoffMainUpdater.h"
 #include "xml/DOMParser.h"
 #include "xml/Node.h"
 #include "../adaptive/tools/Helper.h"
@@ -113,14 +114,6 @@ bool DASHManager::updatePlaylist()
             return false;
         }
 
-        xml::DOMParser parser(mpdstream);
-        if(!parser.parse(true))
-        {
-            vlc_stream_Delete(mpdstream);
-            block_Release(p_block);
-            return false;
-        }
-
         vlc_tick_t minsegmentTime = 0;
         std::vector<AbstractStream *>::iterator it;
         for(it=streams.begin(); it!=streams.end(); it++)
@@ -130,6 +123,28 @@ bool DASHManager::updatePlaylist()
                 minsegmentTime = segmentTime;
         }
 
+        /* Merge the new timeline entries in place, without a tree */
+        MPD *mpd = dynamic_cast<MPD *>(playlist);
+        if(mpd)
+        {
+            IsoffMainUpdater updater(mpd, mpdstream);
+            if(updater.update(minsegmentTime))
+            {
+                vlc_stream_Delete(mpdstream);
+                block_Release(p_block);
+                return true;
+            }
+            msg_Dbg(p_demux, "MPD can't be updated in place, parsing it all");
+        }
+
+        xml::DOMParser parser(mpdstream);
+        if(vlc_stream_Seek(mpdstream, 0) != VLC_SUCCESS || !parser.parse(true))
+        {
+            vlc_stream_Delete(mpdstream);
+            block_Release(p_block);
+            return false;
+        }
+
         IsoffMainParser mpdparser(parser.getRootNode(), VLC_OBJECT(p_demux),
                                   mpdstream, Helper::getDirectoryPath(url).append("/"));
         MPD *newmpd = mpdparser.parse();
@@ -44,6 +44,7 @@
 #include "../adaptive/tools/Debug.hpp"
 #include "../adaptive/tools/Conversions.hpp"
 #include <vlc_stream.h>
+#include <vlc_charset.h>
 #include <cstdio>
 
 using namespace dash::mpd;
@@ -80,6 +81,7 @@ MPD * IsoffMainParser::parse()
     {
         parseMPDAttributes(mpd, root);
         parseProgramInformation(DOMHelper::getFirstChildElementByName(root, "ProgramInformation"), mpd);
+        parseServiceDescription(DOMHelper::getFirstChildElementByName(root, "ServiceDescription"), mpd);
         parseMPDBaseUrl(mpd, root);
         parsePeriods(mpd, root);
         mpd->debug();
@@ -121,6 +123,10 @@ void    IsoffMainParser::parseMPDAttributes   (MPD *mpd, xml::Node *node)
     if(it != attr.end())
         mpd->availabilityStartTime.Set(UTCTime(it->second).time());
 
+    it = attr.find("availabilityEndTime");
+    if(it != attr.end())
+        mpd->availabilityEndTime.Set(UTCTime(it->second).time());
+
     it = attr.find("timeShiftBufferDepth");
         if(it != attr.end())
             mpd->timeShiftBufferDepth.Set(IsoTime(it->second));
@@ -176,6 +182,15 @@ size_t IsoffMainParser::parseSegmentTemplate(Node *templateNode, SegmentInformat
     if(templateNode->hasAttribute("duration"))
         mediaTemplate->duration.Set(Integer<stime_t>(templateNode->getAttributeValue("duration")));
 
+    if(templateNode->hasAttribute("availabilityTimeOffset"))
+    {
+        /* INF is for segments always available, nothing to offset */
+        const std::string ato = templateNode->getAttributeValue("availabilityTimeOffset");
+        double offset = us_strtod(ato.c_str(), NULL);
+        if(offset > 0.0 && ato != "INF")
+            mediaTemplate->availabilityTimeOffset.Set(vlc_tick_from_sec(offset));
+    }
+
     InitSegmentTemplate *initTemplate = NULL;
 
     if(templateNode->hasAttribute("initialization"))
@@ -503,6 +518,18 @@ void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
     }
 }
 
+void IsoffMainParser::parseServiceDescription(Node *node, MPD *mpd)
+{
+    if(!node)
+        return;
+
+    /* Low latency DASH, target in ms */
+    Node *latency = DOMHelper::getFirstChildElementByName(node, "Latency");
+    if(latency && latency->hasAttribute("target"))
+        mpd->targetLatency.Set(VLC_TICK_FROM_MS(
+                    Integer<uint64_t>(latency->getAttributeValue("target"))));
+}
+
 Profile IsoffMainParser::getProfile() const
 {
     Profile res(Profile::Unknown);
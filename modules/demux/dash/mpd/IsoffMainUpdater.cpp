@@ -0,0 +1,265 @@
+/*
+ * IsoffMainUpdater.cpp
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "IsoffMainUpdater.h"
+#include "../adaptive/playlist/SegmentTemplate.h"
+#include "../adaptive/playlist/SegmentTimeline.h"
+#include "../adaptive/playlist/SegmentInformation.hpp"
+#include "../adaptive/playlist/BasePeriod.h"
+#include "../adaptive/playlist/BaseAdaptationSet.h"
+#include "../adaptive/playlist/BaseRepresentation.h"
+#include "../adaptive/tools/Conversions.hpp"
+#include "MPD.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace dash::mpd;
+using namespace adaptive::playlist;
+
+IsoffMainUpdater::Level::Level(const std::string &name_, SegmentInformation *info_)
+{
+    name = name_;
+    info = info_;
+    nextid = 0;
+    b_seen = false;
+}
+
+IsoffMainUpdater::IsoffMainUpdater(MPD *mpd_, stream_t *stream_)
+{
+    mpd = mpd_;
+    stream = stream_;
+    reader = NULL;
+    periodindex = 0;
+    timeline = NULL;
+    nexttime = 0;
+    b_nexttime = false;
+    prunebarrier = 0;
+}
+
+IsoffMainUpdater::~IsoffMainUpdater()
+{
+    if(reader)
+        xml_ReaderDelete(reader);
+}
+
+bool IsoffMainUpdater::update(vlc_tick_t prunebarrier_)
+{
+    prunebarrier = prunebarrier_;
+
+    if(!reader && !(reader = xml_ReaderCreate(stream, stream)))
+        return false;
+
+    const int i_flags = reader->obj.flags;
+    reader->obj.flags |= OBJECT_FLAGS_QUIET;
+
+    bool b_ret = false;
+    const char *data;
+    int type;
+    while((type = xml_ReaderNextNode(reader, &data)) > 0)
+    {
+        if(type == XML_READER_STARTELEM)
+        {
+            const bool b_empty = xml_ReaderIsEmptyElement(reader);
+            if(!startElement(std::string(data)))
+                break;
+            if(b_empty)
+                endElement();
+        }
+        else if(type == XML_READER_ENDELEM)
+        {
+            if(levels.empty())
+                break;
+            endElement();
+            if(levels.empty()) /* Done with the MPD */
+            {
+                b_ret = true;
+                break;
+            }
+        }
+    }
+
+    reader->obj.flags = i_flags;
+    return b_ret;
+}
+
+/* Same numbering as IsoffMainParser::parseSegmentInformation() */
+static ID getChildID(const char *id, uint64_t *nextid)
+{
+    if(id)
+        return ID(std::string(id));
+    return ID((*nextid)++);
+}
+
+bool IsoffMainUpdater::startElement(const std::string &name)
+{
+    if(levels.empty())
+    {
+        if(name != "MPD")
+            return false;
+
+        /* As AbstractPlaylist::mergeWith(), unset if no longer present */
+        time_t endtime = 0;
+        const char *attrname, *attrvalue;
+        while((attrname = xml_ReaderNextAttr(reader, &attrvalue)))
+        {
+            if(!strcmp(attrname, "availabilityEndTime"))
+                endtime = UTCTime(attrvalue).time();
+        }
+        mpd->availabilityEndTime.Set(endtime);
+
+        levels.push_back(Level(name, NULL));
+        return true;
+    }
+
+    Level &parent = levels.back();
+    SegmentInformation *info = NULL;
+
+    if(name == "S")
+    {
+        /* Timelines can only be merged with non empty ones */
+        if(timeline && parent.name == "SegmentTimeline" && !mergeTimelineElement())
+            return false;
+        /* leaf, no need to stack it */
+        levels.push_back(Level(name, NULL));
+        return true;
+    }
+
+    const char *attrname, *attrvalue;
+    if(name == "Period" && parent.name == "MPD")
+    {
+        const std::vector<BasePeriod *> &periods = mpd->getPeriods();
+        if(periodindex < periods.size())
+            info = periods.at(periodindex);
+        periodindex++;
+    }
+    else if((name == "AdaptationSet" && parent.name == "Period") ||
+            (name == "Representation" && parent.name == "AdaptationSet"))
+    {
+        const char *id = NULL;
+        std::string idvalue;
+        while((attrname = xml_ReaderNextAttr(reader, &attrvalue)))
+        {
+            if(!strcmp(attrname, "id"))
+            {
+                idvalue = attrvalue;
+                id = idvalue.c_str();
+            }
+        }
+        const ID childid = getChildID(id, &parent.nextid);
+        if(parent.info == NULL)
+            info = NULL;
+        else if(name == "AdaptationSet")
+            info = static_cast<BasePeriod *>(parent.info)->getAdaptationSetByID(childid);
+        else
+            info = static_cast<BaseAdaptationSet *>(parent.info)->getRepresentationByID(childid);
+    }
+    else if(name == "SegmentTemplate" && parent.info && !parent.b_seen)
+    {
+        /* Only the first one is parsed, and templates without media are ignored */
+        parent.b_seen = true;
+        bool b_media = false;
+        while((attrname = xml_ReaderNextAttr(reader, &attrvalue)))
+        {
+            if(!strcmp(attrname, "media") && *attrvalue)
+                b_media = true;
+        }
+        if(b_media)
+        {
+            /* No template to merge with */
+            if(!parent.info->getSegmentTemplate())
+                return false;
+            info = parent.info;
+        }
+    }
+    else if(name == "SegmentTimeline" && parent.name == "SegmentTemplate" &&
+            parent.info && !parent.b_seen)
+    {
+        parent.b_seen = true;
+        /* No timeline to merge with */
+        MediaSegmentTemplate *templ = parent.info->getSegmentTemplate();
+        if(!templ || !(timeline = templ->segmentTimeline.Get()))
+            return false;
+        nexttime = 0;
+        b_nexttime = false;
+        info = parent.info;
+    }
+    else if(name == "SegmentList" && parent.info)
+    {
+        /* Segment lists are merged by the full parser only */
+        return false;
+    }
+
+    levels.push_back(Level(name, info));
+    return true;
+}
+
+void IsoffMainUpdater::endElement()
+{
+    const Level &level = levels.back();
+    if(level.name == "SegmentTimeline" && timeline)
+    {
+        if(prunebarrier)
+            timeline->pruneByPlaybackTime(prunebarrier);
+        timeline = NULL;
+    }
+    levels.pop_back();
+}
+
+/* Same as IsoffMainParser::parseTimeline() followed by
+ * SegmentTimeline::mergeWith() */
+bool IsoffMainUpdater::mergeTimelineElement()
+{
+    stime_t d = 0, t = 0;
+    uint64_t r = 0; // never repeats by default
+    bool b_duration = false;
+
+    const char *attrname, *attrvalue;
+    while((attrname = xml_ReaderNextAttr(reader, &attrvalue)))
+    {
+        if(!strcmp(attrname, "d"))
+        {
+            d = strtoll(attrvalue, NULL, 10);
+            b_duration = true;
+        }
+        else if(!strcmp(attrname, "r"))
+        {
+            r = strtoull(attrvalue, NULL, 10);
+        }
+        else if(!strcmp(attrname, "t"))
+        {
+            t = strtoll(attrvalue, NULL, 10);
+        }
+    }
+
+    if(!b_duration) /* Mandatory */
+        return true;
+
+    if(!t && b_nexttime)
+        t = nexttime;
+    nexttime = t + d * (stime_t)(r + 1);
+    b_nexttime = true;
+
+    return timeline->mergeElement(d, r, t);
+}
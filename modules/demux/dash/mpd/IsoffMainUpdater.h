@@ -0,0 +1,94 @@
+/*
+ * IsoffMainUpdater.h
+ *****************************************************************************
+ * Copyright (C) 2019 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef ISOFFMAINUPDATER_H_
+#define ISOFFMAINUPDATER_H_
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../adaptive/playlist/SegmentInfoCommon.h"
+
+#include <vlc_common.h>
+#include <vlc_xml.h>
+
+#include <string>
+#include <vector>
+
+namespace adaptive
+{
+    namespace playlist
+    {
+        class SegmentInformation;
+        class SegmentTimeline;
+    }
+}
+
+namespace dash
+{
+    namespace mpd
+    {
+        class MPD;
+
+        using namespace adaptive::playlist;
+        using namespace adaptive;
+
+        /* Refreshes an already parsed MPD from an updated document, in a
+         * single streaming pass and without building the document tree.
+         * Only the new SegmentTimeline entries are merged in place, the
+         * same way the playlists mergeWith() does. Anything it can't merge
+         * fails the update, which then needs the full parser. */
+        class IsoffMainUpdater
+        {
+            public:
+                IsoffMainUpdater            (MPD *, stream_t *);
+                ~IsoffMainUpdater           ();
+                bool    update              (vlc_tick_t prunebarrier);
+
+            private:
+                bool    startElement        (const std::string &);
+                void    endElement          ();
+                bool    mergeTimelineElement();
+
+                class Level
+                {
+                    public:
+                        Level(const std::string &, SegmentInformation *);
+                        std::string name;
+                        SegmentInformation *info; /* matching element of the current MPD */
+                        uint64_t nextid; /* for the children without id */
+                        bool b_seen; /* SegmentTemplate or SegmentTimeline child */
+                };
+
+                MPD                 *mpd;
+                stream_t            *stream;
+                xml_reader_t        *reader;
+                std::vector<Level>   levels;
+                size_t               periodindex;
+                SegmentTimeline     *timeline; /* being merged */
+                stime_t              nexttime;
+                bool                 b_nexttime;
+                vlc_tick_t           prunebarrier;
+        };
+    }
+}
+
+#endif /* ISOFFMAINUPDATER_H_ */
@@ -43,6 +43,8 @@ HLSSegment::HLSSegment( ICanonicalUrl *parent, uint64_t seq ) :
 {
     setSequenceNumber(seq);
     utcTime = 0;
+    mediaSequence = seq;
+    independent = true;
 #ifdef HAVE_GCRYPT
     ctx = NULL;
 #endif
@@ -74,10 +76,10 @@ void HLSSegment::onChunkDownload(block_t **pp_block, SegmentChunk *chunk, BaseRe
             {
                 encryption.iv.clear();
                 encryption.iv.resize(16);
-                encryption.iv[15] = (getSequenceNumber() - Segment::SEQUENCE_FIRST) & 0xff;
-                encryption.iv[14] = ((getSequenceNumber() - Segment::SEQUENCE_FIRST) >> 8)& 0xff;
-                encryption.iv[13] = ((getSequenceNumber() - Segment::SEQUENCE_FIRST) >> 16)& 0xff;
-                encryption.iv[12] = ((getSequenceNumber() - Segment::SEQUENCE_FIRST) >> 24)& 0xff;
+                encryption.iv[15] = (mediaSequence - Segment::SEQUENCE_FIRST) & 0xff;
+                encryption.iv[14] = ((mediaSequence - Segment::SEQUENCE_FIRST) >> 8)& 0xff;
+                encryption.iv[13] = ((mediaSequence - Segment::SEQUENCE_FIRST) >> 16)& 0xff;
+                encryption.iv[12] = ((mediaSequence - Segment::SEQUENCE_FIRST) >> 24)& 0xff;
             }
 
             if( gcry_cipher_open(&ctx, GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CBC, 0) ||
@@ -134,6 +136,11 @@ vlc_tick_t HLSSegment::getUTCTime() const
     return utcTime;
 }
 
+bool HLSSegment::isIndependent() const
+{
+    return independent;
+}
+
 void HLSSegment::setEncryption(SegmentEncryption &enc)
 {
     encryption = enc;
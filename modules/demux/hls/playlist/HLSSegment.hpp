@@ -55,10 +55,13 @@ namespace hls
                 virtual ~HLSSegment();
                 void setEncryption(SegmentEncryption &);
                 vlc_tick_t getUTCTime() const;
+                bool isIndependent() const;
                 virtual int compare(ISegment *) const; /* reimpl */
 
             protected:
                 vlc_tick_t utcTime;
+                uint64_t mediaSequence; /* differs from the number of parts */
+                bool independent; /* parts not starting with a keyframe */
                 virtual void onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *); /* reimpl */
 
                 SegmentEncryption encryption;
@@ -177,12 +177,8 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
         if(substream)
         {
-            std::list<Tag *> tagslist = parseEntries(substream);
+            appendSegmentsFromStream(p_obj, rep, substream);
             vlc_stream_Delete(substream);
-
-            parseSegments(p_obj, rep, tagslist);
-
-            releaseTagsList(tagslist);
         }
         block_Release(p_block);
         return true;
@@ -190,10 +186,46 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
     return false;
 }
 
-void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::list<Tag *> &tagslist)
+void M3U8Parser::appendSegmentsFromStream(vlc_object_t *p_obj, Representation *rep, stream_t *stream)
+{
+    std::list<Tag *> tagslist = parseEntries(stream);
+    parseSegments(p_obj, rep, tagslist);
+    releaseTagsList(tagslist);
+}
+
+/* Low latency parts are numbered within their parent segment number */
+static const unsigned PART_NUMBER_BITS = 8;
+
+static uint64_t getPartNumber(uint64_t sequence, size_t part)
+{
+    return (sequence << PART_NUMBER_BITS) | std::min(part, (size_t)(1 << PART_NUMBER_BITS) - 1);
+}
+
+static vlc_tick_t getPartsDuration(const std::list<const AttributesTag *> &parts,
+                                   vlc_tick_t partTargetDuration)
+{
+    vlc_tick_t total = 0;
+    std::list<const AttributesTag *>::const_iterator it;
+    for(it = parts.begin(); it != parts.end(); ++it)
+    {
+        const Attribute *uriAttr = (*it)->getAttributeByName("URI");
+        if(!uriAttr || uriAttr->quotedString().empty())
+            continue;
+        const Attribute *durAttr = (*it)->getAttributeByName("DURATION");
+        total += durAttr ? vlc_tick_from_sec(durAttr->floatingPoint()) : partTargetDuration;
+    }
+    return total;
+}
+
+void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const std::list<Tag *> &tagslist)
 {
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
 
+    /* On refresh, the segments before the last loaded one would be
+     * dropped when merging: they are only accounted, not created */
+    const uint64_t knownSequence = rep->b_loaded ? rep->lastMediaSequence : 0;
+    uint64_t lastSequence = 0;
+
     rep->setTimescale(100);
     rep->b_loaded = true;
 
@@ -207,6 +239,13 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
     SegmentEncryption encryption;
     const ValuesListTag *ctx_extinf = NULL;
 
+    /* Low latency HLS: the parts of the last segments are played instead of
+     * the whole segments, including the ones still being produced */
+    const bool b_lowlatency = var_InheritBool(p_obj, "adaptive-lowlatency");
+    bool b_parts = b_lowlatency && rep->partTargetDuration;
+    std::list<const AttributesTag *> ctx_parts;
+    const AttributesTag *ctx_preloadhint = NULL;
+
     std::list<Tag *>::const_iterator it;
     for(it = tagslist.begin(); it != tagslist.end(); ++it)
     {
@@ -236,9 +275,55 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     break;
                 }
 
-                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
+                const bool b_segmentparts = b_parts && !ctx_parts.empty() &&
+                                            encryption.method == SegmentEncryption::NONE;
+
+                if(sequenceNumber < knownSequence)
+                {
+                    vlc_tick_t nzDuration = 0;
+                    if(b_segmentparts)
+                        nzDuration = getPartsDuration(ctx_parts, rep->partTargetDuration);
+                    else if(ctx_extinf && ctx_extinf->getAttributeByName("DURATION"))
+                        nzDuration = vlc_tick_from_sec(ctx_extinf->getAttributeByName("DURATION")->floatingPoint());
+                    else
+                        nzDuration = vlc_tick_from_sec(rep->targetDuration);
+                    nzStartTime += nzDuration;
+                    if(absReferenceTime != VLC_TICK_INVALID)
+                        absReferenceTime += nzDuration;
+                    if(ctx_byterange && !b_segmentparts)
+                    {
+                        std::pair<std::size_t,std::size_t> range = ctx_byterange->getValue().getByteRange();
+                        if(range.first == 0)
+                            range.first = prevbyterangeoffset;
+                        prevbyterangeoffset = range.first + range.second;
+                    }
+                    ctx_extinf = NULL;
+                    ctx_byterange = NULL;
+                    ctx_parts.clear();
+                    discontinuity = false;
+                    sequenceNumber++;
+                    break;
+                }
+
+                if(b_segmentparts)
+                {
+                    /* duration and byterange are the whole segment ones */
+                    ctx_extinf = NULL;
+                    ctx_byterange = NULL;
+                    lastSequence = sequenceNumber;
+                    createPartSegments(rep, segmentList, ctx_parts, sequenceNumber++,
+                                       &nzStartTime, &absReferenceTime, &discontinuity);
+                    ctx_parts.clear();
+                    break;
+                }
+                ctx_parts.clear();
+
+                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, b_parts ? getPartNumber(sequenceNumber, 0)
+                                                                                 : sequenceNumber);
                 if(!segment)
                     break;
+                lastSequence = sequenceNumber;
+                segment->mediaSequence = sequenceNumber++;
 
                 segment->setSourceUrl(uritag->getValue().value);
                 if((unsigned)rep->getStreamFormat() == StreamFormat::UNKNOWN)
@@ -257,7 +342,6 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                 segment->duration.Set(duration * (uint64_t) rep->getTimescale());
                 segment->startTime.Set(rep->getTimescale().ToScaled(nzStartTime));
                 nzStartTime += nzDuration;
-                totalduration += nzDuration;
                 if(absReferenceTime != VLC_TICK_INVALID)
                 {
                     segment->utcTime = absReferenceTime;
@@ -363,6 +447,48 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
             }
             break;
 
+            case AttributesTag::EXTXPARTINF:
+            {
+                const Attribute *targetAttr =
+                        static_cast<const AttributesTag *>(tag)->getAttributeByName("PART-TARGET");
+                if(b_lowlatency && targetAttr && targetAttr->floatingPoint() > 0.0)
+                {
+                    rep->partTargetDuration = vlc_tick_from_sec(targetAttr->floatingPoint());
+                    b_parts = true;
+                }
+            }
+            break;
+
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                /* Recommended distance from the live edge */
+                const AttributesTag *controltag = static_cast<const AttributesTag *>(tag);
+                const Attribute *holdbackAttr = controltag->getAttributeByName("PART-HOLD-BACK");
+                if(!b_lowlatency || !holdbackAttr)
+                    holdbackAttr = controltag->getAttributeByName("HOLD-BACK");
+                if(holdbackAttr && holdbackAttr->floatingPoint() > 0.0)
+                    rep->getPlaylist()->targetLatency.Set(vlc_tick_from_sec(holdbackAttr->floatingPoint()));
+            }
+            break;
+
+            case AttributesTag::EXTXPART:
+                if(b_parts)
+                    ctx_parts.push_back(static_cast<const AttributesTag *>(tag));
+                break;
+
+            case AttributesTag::EXTXPRELOADHINT:
+            {
+                /* Next part, served as soon as it is produced. Open ended
+                 * byte ranges are not supported. */
+                const AttributesTag *hinttag = static_cast<const AttributesTag *>(tag);
+                const Attribute *typeAttr = hinttag->getAttributeByName("TYPE");
+                if(b_parts && typeAttr && typeAttr->value == "PART" &&
+                   hinttag->getAttributeByName("URI") &&
+                   !hinttag->getAttributeByName("BYTERANGE-START"))
+                    ctx_preloadhint = hinttag;
+            }
+            break;
+
             case Tag::EXTXDISCONTINUITY:
                 discontinuity  = true;
                 break;
@@ -373,6 +499,23 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
         }
     }
 
+    /* Parts of the segment still being produced */
+    if(b_parts && encryption.method == SegmentEncryption::NONE)
+    {
+        if(ctx_preloadhint)
+            ctx_parts.push_back(ctx_preloadhint);
+        if(!ctx_parts.empty())
+        {
+            lastSequence = sequenceNumber;
+            createPartSegments(rep, segmentList, ctx_parts, sequenceNumber,
+                               &nzStartTime, &absReferenceTime, &discontinuity);
+        }
+    }
+
+    rep->lastMediaSequence = std::max(lastSequence, knownSequence);
+
+    totalduration = nzStartTime;
+
     if(rep->isLive())
     {
         rep->getPlaylist()->duration.Set(0);
@@ -384,6 +527,67 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
 
     rep->appendSegmentList(segmentList, true);
 }
+
+void M3U8Parser::createPartSegments(Representation *rep, SegmentList *segmentList,
+                                    const std::list<const AttributesTag *> &parts,
+                                    uint64_t sequence, vlc_tick_t *pnzStartTime,
+                                    vlc_tick_t *pabsReferenceTime, bool *pdiscontinuity)
+{
+    std::size_t prevbyterangeoffset = 0;
+    size_t index = 0;
+
+    std::list<const AttributesTag *>::const_iterator it;
+    for(it = parts.begin(); it != parts.end(); ++it)
+    {
+        const AttributesTag *parttag = *it;
+        const Attribute *uriAttr = parttag->getAttributeByName("URI");
+        if(!uriAttr || uriAttr->quotedString().empty())
+            continue;
+
+        HLSSegment *part = new (std::nothrow) HLSSegment(rep, getPartNumber(sequence, index++));
+        if(!part)
+            break;
+        part->mediaSequence = sequence;
+        part->setSourceUrl(uriAttr->quotedString());
+        if((unsigned)rep->getStreamFormat() == StreamFormat::UNKNOWN)
+            setFormatFromExtension(rep, uriAttr->quotedString());
+
+        /* only preload hints have no duration */
+        const Attribute *durAttr = parttag->getAttributeByName("DURATION");
+        const vlc_tick_t nzDuration = durAttr ? vlc_tick_from_sec(durAttr->floatingPoint())
+                                              : rep->partTargetDuration;
+        part->duration.Set(rep->getTimescale().ToScaled(nzDuration));
+        part->startTime.Set(rep->getTimescale().ToScaled(*pnzStartTime));
+        *pnzStartTime += nzDuration;
+        if(*pabsReferenceTime != VLC_TICK_INVALID)
+        {
+            part->utcTime = *pabsReferenceTime;
+            *pabsReferenceTime += nzDuration;
+        }
+
+        const Attribute *independentAttr = parttag->getAttributeByName("INDEPENDENT");
+        part->independent = (independentAttr && independentAttr->value == "YES");
+
+        const Attribute *byterangeAttr = parttag->getAttributeByName("BYTERANGE");
+        if(byterangeAttr)
+        {
+            std::pair<std::size_t,std::size_t> range = byterangeAttr->unescapeQuotes().getByteRange();
+            if(byterangeAttr->value.find('@') == std::string::npos)
+                range.first = prevbyterangeoffset;
+            prevbyterangeoffset = range.first + range.second;
+            part->setByteRange(range.first, prevbyterangeoffset - 1);
+        }
+
+        if(*pdiscontinuity)
+        {
+            part->discontinuity = true;
+            *pdiscontinuity = false;
+        }
+
+        segmentList->addSegment(part);
+    }
+}
+
 M3U8 * M3U8Parser::parse(vlc_object_t *p_object, stream_t *p_stream, const std::string &playlisturl)
 {
     char *psz_line = vlc_stream_ReadLine(p_stream);
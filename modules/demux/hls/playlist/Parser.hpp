@@ -35,6 +35,7 @@ namespace adaptive
         class MediaSegmentTemplate;
         class BasePeriod;
         class BaseAdaptationSet;
+        class SegmentList;
     }
 
     namespace http
@@ -62,12 +63,16 @@ namespace hls
 
                 M3U8 *             parse  (vlc_object_t *p_obj, stream_t *p_stream, const std::string &);
                 bool appendSegmentsFromPlaylistURI(vlc_object_t *, Representation *);
+                void appendSegmentsFromStream(vlc_object_t *, Representation *, stream_t *);
 
             private:
                 Representation * createRepresentation(BaseAdaptationSet *, const AttributesTag *);
                 void createAndFillRepresentation(vlc_object_t *, BaseAdaptationSet *,
                                                  const AttributesTag *, const std::list<Tag *>&);
                 void parseSegments(vlc_object_t *, Representation *, const std::list<Tag *>&);
+                void createPartSegments(Representation *, SegmentList *,
+                                        const std::list<const AttributesTag *> &,
+                                        uint64_t, vlc_tick_t *, vlc_tick_t *, bool *);
                 void setFormatFromExtension(Representation *rep, const std::string &);
                 std::list<Tag *> parseEntries(stream_t *);
                 AuthStorage *auth;
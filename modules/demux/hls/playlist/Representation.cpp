@@ -45,6 +45,8 @@ Representation::Representation  ( BaseAdaptationSet *set ) :
     switchpolicy = SegmentInformation::SWITCH_SEGMENT_ALIGNED; /* FIXME: based on streamformat */
     nextUpdateTime = 0;
     targetDuration = 0;
+    partTargetDuration = 0;
+    lastMediaSequence = 0;
     streamFormat = StreamFormat::UNKNOWN;
 }
 
@@ -102,14 +104,19 @@ void Representation::debug(vlc_object_t *obj, int indent) const
 void Representation::scheduleNextUpdate(uint64_t number)
 {
     const AbstractPlaylist *playlist = getPlaylist();
-    const time_t now = time(NULL);
+    const vlc_tick_t now = vlc_tick_now();
 
     /* Compute new update time */
     vlc_tick_t minbuffer = getMinAheadTime(number);
 
     /* Update frequency must always be at least targetDuration (if any)
      * but we need to update before reaching that last segment, thus -1 */
-    if(targetDuration)
+    if(partTargetDuration)
+    {
+        /* parts are only listed for the last segments */
+        minbuffer = partTargetDuration;
+    }
+    else if(targetDuration)
     {
         if(minbuffer > vlc_tick_from_sec( 2 * targetDuration + 1 ))
             minbuffer -= vlc_tick_from_sec( targetDuration + 1 );
@@ -124,24 +131,23 @@ void Representation::scheduleNextUpdate(uint64_t number)
             minbuffer /= 2;
     }
 
-    nextUpdateTime = now + SEC_FROM_VLC_TICK(minbuffer);
+    nextUpdateTime = now + minbuffer;
 
-    msg_Dbg(playlist->getVLCObject(), "Updated playlist ID %s, next update in %" PRId64 "s",
-            getID().str().c_str(), (int64_t) nextUpdateTime - now);
+    msg_Dbg(playlist->getVLCObject(), "Updated playlist ID %s, next update in %" PRId64 "ms",
+            getID().str().c_str(), MS_FROM_VLC_TICK(minbuffer));
 
     debug(playlist->getVLCObject(), 0);
 }
 
 bool Representation::needsUpdate() const
 {
-    return !b_loaded || (isLive() && nextUpdateTime < time(NULL));
+    return !b_loaded || (isLive() && nextUpdateTime < vlc_tick_now());
 }
 
 bool Representation::runLocalUpdates(vlc_tick_t, uint64_t number, bool prune)
 {
-    const time_t now = time(NULL);
     AbstractPlaylist *playlist = getPlaylist();
-    if(!b_loaded || (isLive() && nextUpdateTime < now))
+    if(needsUpdate())
     {
         /* ugly hack */
         M3U8 *m3u = dynamic_cast<M3U8 *>(playlist);
@@ -159,6 +165,28 @@ bool Representation::runLocalUpdates(vlc_tick_t, uint64_t number, bool prune)
     return true;
 }
 
+uint64_t Representation::getLiveStartSegmentNumber(uint64_t def) const
+{
+    uint64_t number = BaseRepresentation::getLiveStartSegmentNumber(def);
+    if(!partTargetDuration)
+        return number;
+
+    /* Start on a part the decoder can start from */
+    std::vector<ISegment *> list;
+    std::vector<ISegment *>::const_iterator it;
+    getSegments(INFOTYPE_MEDIA, list);
+    uint64_t independent = number;
+    for(it = list.begin(); it != list.end(); ++it)
+    {
+        const HLSSegment *hlsSeg = dynamic_cast<HLSSegment *>(*it);
+        if(!hlsSeg || hlsSeg->getSequenceNumber() > number)
+            break;
+        if(hlsSeg->isIndependent())
+            independent = hlsSeg->getSequenceNumber();
+    }
+    return independent;
+}
+
 uint64_t Representation::translateSegmentNumber(uint64_t num, const SegmentInformation *from) const
 {
     if(consistentSegmentNumber())
@@ -52,13 +52,16 @@ namespace hls
                 virtual void debug(vlc_object_t *, int) const;  /* reimpl */
                 virtual bool runLocalUpdates(vlc_tick_t, uint64_t, bool); /* reimpl */
                 virtual uint64_t translateSegmentNumber(uint64_t, const SegmentInformation *) const; /* reimpl */
+                virtual uint64_t getLiveStartSegmentNumber(uint64_t) const; /* reimpl */
 
             private:
                 StreamFormat streamFormat;
                 bool b_live;
                 bool b_loaded;
-                time_t nextUpdateTime;
+                vlc_tick_t nextUpdateTime;
                 time_t targetDuration;
+                vlc_tick_t partTargetDuration; /* low latency parts, if any */
+                uint64_t lastMediaSequence; /* of the loaded segments */
                 Url playlistUrl;
         };
     }
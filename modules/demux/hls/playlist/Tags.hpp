@@ -97,6 +97,10 @@ namespace hls
                     EXTXMAP,
                     EXTXMEDIA,
                     EXTXSTREAMINF,
+                    EXTXPART,
+                    EXTXPARTINF,
+                    EXTXPRELOADHINT,
+                    EXTXSERVERCONTROL,
                 };
                 AttributesTag(int, const std::string &);
                 virtual ~AttributesTag();
@@ -44,6 +44,7 @@ public:
         :demuxer(demux)
         ,b_seekable(false)
         ,b_fastseekable(false)
+        ,i_cluster_prefetch(0)
         ,i_pts(VLC_TICK_INVALID)
         ,i_pcr(VLC_TICK_INVALID)
         ,i_start_pts(VLC_TICK_0)
@@ -67,6 +68,7 @@ public:
     demux_t                 & demuxer;
     bool                    b_seekable;
     bool                    b_fastseekable;
+    size_t                  i_cluster_prefetch;
 
     vlc_tick_t              i_pts;
     vlc_tick_t              i_pcr;
@@ -1167,6 +1167,28 @@ void matroska_segment_c::ESDestroy( )
     }
 }
 
+/* Reads ahead the rest of the current cluster, up to the prefetch size,
+ * when the data up to i_needed_end is not already in memory. The blocks
+ * and block groups are then parsed from memory instead of with several
+ * small stream reads each. */
+void matroska_segment_c::PrefetchCluster( uint64 i_needed_end )
+{
+    if( sys.i_cluster_prefetch == 0 || cluster == NULL || !cluster->IsFiniteSize() )
+        return;
+
+    vlc_stream_io_callback *io_callback = dynamic_cast<vlc_stream_io_callback *>( &es.I_O() );
+    if( io_callback == NULL || io_callback->isPrefetched( i_needed_end ) )
+        return;
+
+    const uint64 i_pos = io_callback->getFilePointer();
+    const uint64 i_cluster_end = cluster->GetDataStart() + cluster->GetSize();
+    if( i_pos >= i_needed_end || i_needed_end > i_cluster_end ||
+        i_needed_end - i_pos > sys.i_cluster_prefetch )
+        return; /* broken element, or bigger than allowed */
+
+    io_callback->prefetch( std::min<uint64>( i_cluster_end - i_pos, sys.i_cluster_prefetch ) );
+}
+
 int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, bool *pb_key_picture, bool *pb_discardable_picture, int64_t *pi_duration )
 {
     pp_simpleblock = NULL;
@@ -1202,6 +1224,7 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
             vars.obj->cluster = &kcluster;
             vars.b_cluster_timecode = false;
             vars.ep->Down ();
+            vars.obj->PrefetchCluster( kcluster.GetDataStart() + 1 );
         }
         E_CASE( KaxCues, kcue )
         {
@@ -1234,6 +1257,8 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
         E_CASE( KaxBlockGroup, kbgroup )
         {
             vars.obj->i_block_pos = kbgroup.GetElementPosition();
+            if( kbgroup.IsFiniteSize() )
+                vars.obj->PrefetchCluster( kbgroup.GetEndPosition() );
             vars.ep->Down ();
         }
         E_CASE( KaxSimpleBlock, ksblock )
@@ -1245,6 +1270,7 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
             }
 
             vars.simpleblock = &ksblock;
+            vars.obj->PrefetchCluster( ksblock.GetEndPosition() );
             vars.simpleblock->ReadData( vars.obj->es.I_O() );
             vars.simpleblock->SetParent( *vars.obj->cluster );
 
@@ -173,6 +173,7 @@ private:
     bool TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
+    void PrefetchCluster( uint64 i_needed_end );
 
     SegmentSeeker _seeker;
 
@@ -81,6 +81,12 @@ vlc_module_begin ()
             N_("Preload clusters"),
             N_("Find all cluster positions by jumping cluster-to-cluster before playback"), true );
 
+    add_integer( "mkv-cluster-prefetch", 8192,
+            N_("Cluster read-ahead (KiB)"),
+            N_("Read clusters ahead in a single request of at most this size, "
+               "and parse their blocks from memory. 0 disables the read-ahead."), true );
+        change_integer_range( 0, 262144 )
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -121,6 +127,7 @@ static int Open( vlc_object_t * p_this )
     if ( !p_sys->b_seekable || vlc_stream_Control(
           p_demux->s, STREAM_CAN_FASTSEEK, &p_sys->b_fastseekable ) )
         p_sys->b_fastseekable = false;
+    p_sys->i_cluster_prefetch = var_InheritInteger( p_demux, "mkv-cluster-prefetch" ) * 1024;
 
     es_out_Control( p_demux->out, ES_OUT_SET_ES_CAT_POLICY, VIDEO_ES,
                     ES_OUT_ES_POLICY_EXCLUSIVE );
@@ -279,6 +286,13 @@ static void Close( vlc_object_t *p_this )
             p_segment->ESDestroy();
     }
 
+    for( size_t i = 0; i < p_sys->streams.size(); i++ )
+    {
+        const vlc_stream_io_callback & io = p_sys->streams[i]->io_callback;
+        msg_Dbg( p_demux, "stream %zu: %u reads (%u read-ahead), %u seeks", i,
+                 io.i_stream_reads, io.i_prefetches, io.i_stream_seeks );
+    }
+
     delete p_sys;
 }
 
@@ -31,6 +31,14 @@ namespace mkv {
  *****************************************************************************/
 vlc_stream_io_callback::vlc_stream_io_callback( stream_t *s_, bool b_owner_ )
                        : s( s_), b_owner( b_owner_ )
+                       , p_prefetch( NULL )
+                       , i_prefetch_alloc( 0 )
+                       , i_prefetch_size( 0 )
+                       , i_prefetch_pos( 0 )
+                       , i_prefetch_start( 0 )
+                       , i_stream_reads( 0 )
+                       , i_stream_seeks( 0 )
+                       , i_prefetches( 0 )
 {
     mb_eof = false;
 }
@@ -40,14 +48,70 @@ uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
     if( i_size <= 0 || mb_eof )
         return 0;
 
-    int i_ret = vlc_stream_Read( s, p_buffer, i_size );
-    return i_ret < 0 ? 0 : i_ret;
+    size_t i_copied = 0;
+    if( i_prefetch_pos < i_prefetch_size )
+    {
+        i_copied = __MIN( i_size, i_prefetch_size - i_prefetch_pos );
+        memcpy( p_buffer, &p_prefetch[i_prefetch_pos], i_copied );
+        i_prefetch_pos += i_copied;
+        if( i_copied == i_size )
+            return i_copied;
+    }
+    /* the stream is at the end of the buffer, if any */
+    dropPrefetch();
+
+    i_stream_reads++;
+    int i_ret = vlc_stream_Read( s, static_cast<uint8_t *>( p_buffer ) + i_copied,
+                                 i_size - i_copied );
+    return i_copied + ( i_ret < 0 ? 0 : i_ret );
+}
+
+void vlc_stream_io_callback::dropPrefetch( void )
+{
+    i_prefetch_size = i_prefetch_pos = 0;
+}
+
+bool vlc_stream_io_callback::prefetch( size_t i_size )
+{
+    if( mb_eof || s == NULL )
+        return false;
+
+    /* keep what is left of the previous buffer */
+    size_t i_left = i_prefetch_size - i_prefetch_pos;
+    if( i_left >= i_size )
+        return true;
+
+    if( i_size > i_prefetch_alloc )
+    {
+        uint8_t *p_realloc = static_cast<uint8_t *>( realloc( p_prefetch, i_size ) );
+        if( unlikely( p_realloc == NULL ) )
+            return false;
+        p_prefetch = p_realloc;
+        i_prefetch_alloc = i_size;
+    }
+
+    if( i_left )
+    {
+        memmove( p_prefetch, &p_prefetch[i_prefetch_pos], i_left );
+        i_prefetch_start += i_prefetch_pos;
+    }
+    else
+        i_prefetch_start = vlc_stream_Tell( s );
+    i_prefetch_pos = 0;
+    i_prefetch_size = i_left;
+
+    i_stream_reads++;
+    i_prefetches++;
+    ssize_t i_ret = vlc_stream_Read( s, &p_prefetch[i_left], i_size - i_left );
+    if( i_ret > 0 )
+        i_prefetch_size += i_ret;
+    return i_prefetch_size > 0;
 }
 
 void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
 {
     int64_t i_pos, i_size;
-    int64_t i_current = vlc_stream_Tell( s );
+    int64_t i_current = getFilePointer();
 
     switch( mode )
     {
@@ -69,11 +133,25 @@ void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
             // if previous setFilePointer() failed we may be back in the available data
             i_size = stream_Size( s );
             if ( i_size != 0 && i_pos < i_size )
+            {
+                dropPrefetch();
+                i_stream_seeks++;
                 mb_eof = vlc_stream_Seek( s, i_pos ) != VLC_SUCCESS;
+            }
         }
         return;
     }
 
+    /* within the read-ahead buffer */
+    if( i_prefetch_size && i_pos >= 0 &&
+        static_cast<uint64_t>( i_pos ) >= i_prefetch_start &&
+        static_cast<uint64_t>( i_pos ) <= i_prefetch_start + i_prefetch_size )
+    {
+        i_prefetch_pos = i_pos - i_prefetch_start;
+        mb_eof = false;
+        return;
+    }
+
     if( i_pos < 0 || ( ( i_size = stream_Size( s ) ) != 0 && i_pos >= i_size ) )
     {
         mb_eof = true;
@@ -81,6 +159,8 @@ void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
     }
 
     mb_eof = false;
+    dropPrefetch();
+    i_stream_seeks++;
     if( vlc_stream_Seek( s, i_pos ) )
     {
         mb_eof = true;
@@ -92,6 +172,8 @@ uint64 vlc_stream_io_callback::getFilePointer( void )
 {
     if ( s == NULL )
         return 0;
+    if ( i_prefetch_size )
+        return i_prefetch_start + i_prefetch_pos;
     return vlc_stream_Tell( s );
 }
 
@@ -112,7 +194,7 @@ uint64 vlc_stream_io_callback::toRead( void )
     if( i_size <= 0 )
         return UINT64_MAX;
 
-    return static_cast<uint64>( i_size - vlc_stream_Tell( s ) );
+    return static_cast<uint64>( i_size - getFilePointer() );
 }
 
 } // namespace
@@ -47,17 +47,40 @@ class vlc_stream_io_callback: public IOCallback
     bool           mb_eof;
     bool           b_owner;
 
+    /* read-ahead buffer, the stream is positioned at its end */
+    uint8_t        *p_prefetch;
+    size_t         i_prefetch_alloc;
+    size_t         i_prefetch_size;
+    size_t         i_prefetch_pos;
+    uint64_t       i_prefetch_start;
+
+    void           dropPrefetch    ( void );
+
   public:
     vlc_stream_io_callback( stream_t *, bool owner );
 
     virtual ~vlc_stream_io_callback()
     {
+        free( p_prefetch );
         if( b_owner )
             vlc_stream_Delete( s );
     }
 
     bool IsEOF() const { return mb_eof; }
 
+    /* Reads up to i_size bytes from the current position in one request,
+     * the following reads and seeks within them are done in memory */
+    bool             prefetch        ( size_t i_size );
+    bool             isPrefetched    ( uint64_t i_end ) const
+    {
+        return i_prefetch_size && i_end <= i_prefetch_start + i_prefetch_size;
+    }
+
+    /* requests sent to the stream */
+    unsigned         i_stream_reads;
+    unsigned         i_stream_seeks;
+    unsigned         i_prefetches;
+
     virtual uint32   read            ( void *p_buffer, size_t i_size);
     virtual void     setFilePointer  ( int64_t i_offset, seek_mode mode = seek_beginning );
     virtual size_t   write           ( const void *p_buffer, size_t i_size);
@@ -362,6 +362,45 @@ static int MP4_PeekBoxHeader( stream_t *p_stream, MP4_Box_t *p_box )
     return 1;
 }
 
+/* Sample tables smaller than this are always read */
+#define MP4_DEFERRED_BOX_MIN_SIZE 1024
+
+/*****************************************************************************
+ * MP4_Box_IsDeferrable : Checks if a box can be left unread for now
+ *****************************************************************************
+ * Only the per sample and per chunk tables are deferred, and only within
+ * trees created by MP4_BoxGetRootLazy (not in cmov or in memory boxes).
+ *****************************************************************************/
+static bool MP4_Box_IsDeferrable( const MP4_Box_t *p_box )
+{
+    if( p_box->i_size < MP4_DEFERRED_BOX_MIN_SIZE ||
+        !p_box->p_father || p_box->p_father->i_type != ATOM_stbl )
+        return false;
+
+    switch( p_box->i_type )
+    {
+        case ATOM_stts:
+        case ATOM_ctts:
+        case ATOM_stsz:
+        case ATOM_stz2:
+        case ATOM_stco:
+        case ATOM_co64:
+        case ATOM_stss:
+        case ATOM_stsh:
+        case ATOM_sdtp:
+        case ATOM_sbgp:
+            break;
+        default:
+            return false;
+    }
+
+    const MP4_Box_t *p_root = p_box->p_father;
+    while( p_root->p_father )
+        p_root = p_root->p_father;
+
+    return p_root->i_type == ATOM_root && (p_root->e_flags & BOX_FLAG_LAZY);
+}
+
 /*****************************************************************************
  * MP4_ReadBoxRestricted : Reads box from current position
  *****************************************************************************
@@ -423,7 +462,12 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
 
     const uint64_t i_next = p_box->i_pos + p_box->i_size;
     p_box->p_father = p_father;
-    if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
+    if( MP4_Box_IsDeferrable( p_box ) )
+    {
+        /* only keep its position, MP4_BoxLoadDeferred will read it */
+        p_box->e_flags |= BOX_FLAG_DEFERRED;
+    }
+    else if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
     {
         msg_Warn( p_stream, "Failed reading box %4.4s", (char*) &peekbox.i_type );
         MP4_BoxFree( p_box );
@@ -5316,13 +5360,65 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
     return p_fakeroot;
 }
 
+static int MP4_BoxLoadDeferred_Internal( stream_t *p_stream, MP4_Box_t *p_container )
+{
+    int i_ret = VLC_SUCCESS;
+    MP4_Box_t *p_prev = NULL;
+    MP4_Box_t **pp_box = &p_container->p_first;
+
+    while( *pp_box )
+    {
+        MP4_Box_t *p_box = *pp_box;
+        if( p_box->e_flags & BOX_FLAG_DEFERRED )
+        {
+            p_box->e_flags &= ~BOX_FLAG_DEFERRED;
+            if( MP4_Seek( p_stream, p_box->i_pos ) != VLC_SUCCESS ||
+                MP4_Box_Read_Specific( p_stream, p_box, p_container ) != VLC_SUCCESS )
+            {
+                msg_Warn( p_stream, "Failed reading deferred box %4.4s",
+                          (char*) &p_box->i_type );
+                /* unlink it, as if it had failed while reading the tree */
+                *pp_box = p_box->p_next;
+                if( p_container->p_last == p_box )
+                    p_container->p_last = p_prev;
+                p_box->p_next = NULL;
+                MP4_BoxFree( p_box );
+                i_ret = VLC_EGENERIC;
+                continue;
+            }
+        }
+        else if( MP4_BoxLoadDeferred_Internal( p_stream, p_box ) != VLC_SUCCESS )
+        {
+            i_ret = VLC_EGENERIC;
+        }
+
+        p_prev = p_box;
+        pp_box = &p_box->p_next;
+    }
+
+    return i_ret;
+}
+
+int MP4_BoxLoadDeferred( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    const uint64_t i_pos = vlc_stream_Tell( p_stream );
+
+    int i_ret = MP4_BoxLoadDeferred_Internal( p_stream, p_box );
+
+    if( vlc_stream_Tell( p_stream ) != i_pos &&
+        MP4_Seek( p_stream, i_pos ) != VLC_SUCCESS )
+        i_ret = VLC_EGENERIC;
+
+    return i_ret;
+}
+
 /*****************************************************************************
  * MP4_BoxGetRoot : Parse the entire file, and create all boxes in memory
  *****************************************************************************
  *  The first box is a virtual box "root" and is the father for all first
  *  level boxes for the file, a sort of virtual contener
  *****************************************************************************/
-MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
+static MP4_Box_t *MP4_BoxGetRoot_Internal( stream_t *p_stream, bool b_lazy )
 {
     int i_result;
 
@@ -5330,6 +5426,9 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
     if( p_vroot == NULL )
         return NULL;
 
+    if( b_lazy )
+        p_vroot->e_flags = BOX_FLAG_LAZY;
+
     p_vroot->i_shortsize = 1;
     uint64_t i_size;
     if( vlc_stream_GetSize( p_stream, &i_size ) == 0 )
@@ -5366,6 +5465,13 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
         const uint32_t stoplist[] = { ATOM_sidx, 0 };
         const uint32_t excludelist[] = { ATOM_moof, ATOM_mdat, 0 };
         MP4_ReadBoxContainerChildrenIndexed( p_stream, p_vroot, stoplist, excludelist, false );
+
+        /* fragments demuxing expects the whole moov */
+        if( p_vroot->e_flags & BOX_FLAG_LAZY )
+        {
+            p_vroot->e_flags &= ~BOX_FLAG_LAZY;
+            MP4_BoxLoadDeferred( p_stream, p_vroot );
+        }
         return p_vroot;
     }
 
@@ -5411,6 +5517,16 @@ error:
     return NULL;
 }
 
+MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
+{
+    return MP4_BoxGetRoot_Internal( p_stream, false );
+}
+
+MP4_Box_t *MP4_BoxGetRootLazy( stream_t *p_stream )
+{
+    return MP4_BoxGetRoot_Internal( p_stream, true );
+}
+
 
 static void MP4_BoxDumpStructure_Internal( stream_t *s, const MP4_Box_t *p_box,
                                            unsigned int i_level )
@@ -5440,7 +5556,8 @@ static void MP4_BoxDumpStructure_Internal( stream_t *s, const MP4_Box_t *p_box,
                   "+ %4.4s size %"PRIu64" offset %" PRIuMAX "%s",
                     (char*)&i_displayedtype, p_box->i_size,
                   (uintmax_t)p_box->i_pos,
-                p_box->e_flags & BOX_FLAG_INCOMPLETE ? " (\?\?\?\?)" : "" );
+                p_box->e_flags & BOX_FLAG_INCOMPLETE ? " (\?\?\?\?)" :
+                p_box->e_flags & BOX_FLAG_DEFERRED ? " (deferred)" : "" );
         msg_Dbg( s, "%s", str );
     }
     p_child = p_box->p_first;
@@ -5591,7 +5708,8 @@ static void MP4_BoxGet_Internal( const MP4_Box_t **pp_result, const MP4_Box_t *p
                 {
                     goto error_box;
                 }
-                if( p_box->i_type == i_fourcc )
+                if( p_box->i_type == i_fourcc &&
+                    !(p_box->e_flags & BOX_FLAG_DEFERRED) )
                 {
                     if( !i_number )
                     {
@@ -5687,7 +5805,8 @@ unsigned MP4_BoxCount( const MP4_Box_t *p_box, const char *psz_fmt, ... )
     i_count = 1;
     for( p_next = p_result->p_next; p_next != NULL; p_next = p_next->p_next)
     {
-        if( p_next->i_type == p_result->i_type)
+        if( p_next->i_type == p_result->i_type &&
+            !(p_next->e_flags & BOX_FLAG_DEFERRED) )
         {
             i_count++;
         }
@@ -1835,8 +1835,10 @@ struct MP4_Box_s
 
     enum
     {
-        BOX_FLAG_NONE = 0,
-        BOX_FLAG_INCOMPLETE,
+        BOX_FLAG_NONE       = 0,
+        BOX_FLAG_INCOMPLETE = 1 << 0,
+        BOX_FLAG_DEFERRED   = 1 << 1, /* not read yet, see MP4_BoxLoadDeferred */
+        BOX_FLAG_LAZY       = 1 << 2, /* root: defer reading sample tables */
     }            e_flags;
 
     UUID_t       i_uuid;  /* Set if i_type == "uuid" */
@@ -1904,6 +1906,23 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_BoxGetRootLazy : same as MP4_BoxGetRoot, but large sample tables
+ *****************************************************************************
+ *  (stco, stsz, stts, ...) of non fragmented files are not read: they are
+ *  kept as deferred boxes, which MP4_BoxGet ignores, until loaded with
+ *  MP4_BoxLoadDeferred. The stream must stay seekable.
+ *****************************************************************************/
+MP4_Box_t *MP4_BoxGetRootLazy( stream_t * );
+
+/*****************************************************************************
+ * MP4_BoxLoadDeferred : reads all the deferred boxes below p_box
+ *****************************************************************************
+ *  The stream position is restored. Boxes failing to load are removed.
+ *  returns VLC_EGENERIC if one of the boxes could not be read
+ *****************************************************************************/
+int MP4_BoxLoadDeferred( stream_t *, MP4_Box_t *p_box );
+
 /*****************************************************************************
  * MP4_BoxNew : Allocates a new MP4 Box with its atom type
  *****************************************************************************
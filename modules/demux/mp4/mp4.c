@@ -165,9 +165,11 @@ const char *psz_meta_roots[] = { "/moov/udta/meta/ilst",
  * Declaration of local function
  *****************************************************************************/
 static void MP4_TrackSetup( demux_t *, mp4_track_t *, MP4_Box_t  *, bool, bool );
+static int  MP4_TrackIndex( demux_t *, mp4_track_t * );
 static void MP4_TrackInit( mp4_track_t * );
 static void MP4_TrackClean( es_out_t *, mp4_track_t * );
 
+static block_t * MP4_Block_Prepare( demux_t *, mp4_track_t *, block_t * );
 static void MP4_Block_Send( demux_t *, mp4_track_t *, block_t * );
 
 static void MP4_TrackSelect  ( demux_t *, mp4_track_t *, bool );
@@ -326,31 +328,40 @@ static es_out_id_t * MP4_AddTrackES( es_out_t *out, mp4_track_t *p_track )
     return p_es;
 }
 
-/* Return time in microsecond of a track */
-static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+static inline uint64_t MP4_ChunkGetOffset( const mp4_track_t *p_track,
+                                           uint32_t i_chunk )
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
-    const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    return p_track->p_chunk_offset[i_chunk];
+}
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
-    int64_t sdts = p_chunk->i_first_dts;
+static inline stime_t MP4_ChunkGetDuration( const mp4_track_t *p_track,
+                                            uint32_t i_chunk )
+{
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    return MP4_SampleRuns_GetTime( &p_track->dts, ck->i_sample_first + ck->i_sample_count )
+         - MP4_SampleRuns_GetTime( &p_track->dts, ck->i_sample_first );
+}
 
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+/* Return the chunk containing a sample */
+static uint32_t MP4_TrackGetChunk( const mp4_track_t *p_track, uint32_t i_sample )
+{
+    uint32_t i_low = 0, i_high = p_track->i_chunk_count;
+    while( i_high - i_low > 1 )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
-        {
-            sdts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
+        uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_track->chunk[i_mid].i_sample_first <= i_sample )
+            i_low = i_mid;
         else
-        {
-            sdts += i_sample * p_chunk->p_sample_delta_dts[i_index];
-            break;
-        }
+            i_high = i_mid;
     }
+    return i_low;
+}
+
+/* Return time in microsecond of a track */
+static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    stime_t sdts = MP4_SampleRuns_GetTime( &p_track->dts, p_track->i_sample );
 
     vlc_tick_t i_dts = MP4_rescale_mtime( sdts, p_track->i_timescale );
 
@@ -380,26 +391,14 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
                                          vlc_tick_t *pi_delta )
 {
     VLC_UNUSED( p_demux );
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    int32_t i_offset;
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
-
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( !MP4_SampleRuns_GetValue( &p_track->pts, p_track->i_sample, &i_offset ) )
         return false;
 
-    for( i_index = 0; i_index < ck->i_entries_pts ; i_index++ )
-    {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
-        {
-            *pi_delta = MP4_rescale_mtime( ck->p_sample_offset_pts[i_index],
-                                           p_track->i_timescale );
-            return true;
-        }
-
-        i_sample -= ck->p_sample_count_pts[i_index];
-    }
-    return false;
+    *pi_delta = MP4_rescale_mtime( i_offset + p_track->i_cts_shift,
+                                   p_track->i_timescale );
+    return true;
 }
 
 static inline vlc_tick_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *p_track,
@@ -408,43 +407,14 @@ static inline vlc_tick_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *
     VLC_UNUSED( p_demux );
 
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
-    stime_t i_duration = 0;
 
-    /* Forward to right index, and set remaining count in that index */
-    unsigned i_index = 0;
-    unsigned i_remain = 0;
-    for( unsigned i = p_chunk->i_sample_first;
-         i<p_track->i_sample && i_index < p_chunk->i_entries_dts; )
-    {
-        if( p_track->i_sample - i >= p_chunk->p_sample_count_dts[i_index] )
-        {
-            i += p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            i_remain = p_track->i_sample - i;
-            break;
-        }
-    }
+    /* Do not count beyond the current chunk */
+    uint32_t i_end = p_chunk->i_sample_first + p_chunk->i_sample_count;
+    if( i_end - p_track->i_sample > i_nb_samples )
+        i_end = p_track->i_sample + i_nb_samples;
 
-    /* Compute total duration from all samples from index */
-    while( i_nb_samples > 0 && i_index < p_chunk->i_entries_dts )
-    {
-        if( i_nb_samples >= p_chunk->p_sample_count_dts[i_index] - i_remain )
-        {
-            i_duration += (p_chunk->p_sample_count_dts[i_index] - i_remain) *
-                          (int64_t) p_chunk->p_sample_delta_dts[i_index];
-            i_nb_samples -= (p_chunk->p_sample_count_dts[i_index] - i_remain);
-            i_index++;
-            i_remain = 0;
-        }
-        else
-        {
-            i_duration += i_nb_samples * p_chunk->p_sample_delta_dts[i_index];
-            break;
-        }
-    }
+    stime_t i_duration = MP4_SampleRuns_GetTime( &p_track->dts, i_end ) -
+                         MP4_SampleRuns_GetTime( &p_track->dts, p_track->i_sample );
 
     return MP4_rescale_mtime( i_duration, p_track->i_timescale );
 }
@@ -460,8 +430,10 @@ static int LoadInitFrag( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
-    /* Load all boxes ( except raw data ) */
-    MP4_Box_t *p_root = MP4_BoxGetRoot( p_demux->s );
+    /* Load all boxes ( except raw data ). On local files, the sample tables
+     * are only read for the tracks being played */
+    MP4_Box_t *p_root = p_sys->b_fastseekable ? MP4_BoxGetRootLazy( p_demux->s )
+                                              : MP4_BoxGetRoot( p_demux->s );
     if( p_root == NULL || !MP4_BoxGet( p_root, "/moov" ) )
     {
         MP4_BoxFree( p_root );
@@ -580,13 +552,13 @@ static void MP4_GetInterleaving( demux_t *p_demux, vlc_tick_t *pi_max_contiguous
         if( !cur->i_chunk_count )
             continue;
 
-        if( tk == NULL || cur->chunk[0].i_offset < tk->chunk[0].i_offset )
+        if( tk == NULL || MP4_ChunkGetOffset( cur, 0 ) < MP4_ChunkGetOffset( tk, 0 ) )
             tk = cur;
     }
 
     for( ; tk != NULL; )
     {
-        i_duration += tk->chunk[tk->i_chunk].i_duration;
+        i_duration += MP4_ChunkGetDuration( tk, tk->i_chunk );
         tk->i_chunk++;
 
         /* Find next chunk in data order */
@@ -598,7 +570,8 @@ static void MP4_GetInterleaving( demux_t *p_demux, vlc_tick_t *pi_max_contiguous
                 continue;
 
             if( nexttk == NULL ||
-                cur->chunk[cur->i_chunk].i_offset < nexttk->chunk[nexttk->i_chunk].i_offset )
+                MP4_ChunkGetOffset( cur, cur->i_chunk ) <
+                MP4_ChunkGetOffset( nexttk, nexttk->i_chunk ) )
                 nexttk = cur;
         }
 
@@ -663,13 +636,16 @@ static block_t * MP4_Block_Convert( demux_t *p_demux, const mp4_track_t *p_track
     return p_block;
 }
 
-static void MP4_Block_Send( demux_t *p_demux, mp4_track_t *p_track, block_t *p_block )
+/* Converts a sample and applies the track flags. Returns the block to send to
+ * the track es, or NULL if the sample was dropped or consumed (ASF in mov). */
+static block_t * MP4_Block_Prepare( demux_t *p_demux, mp4_track_t *p_track,
+                                    block_t *p_block )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     p_block = MP4_Block_Convert( p_demux, p_track, p_block );
     if( p_block == NULL )
-        return;
+        return NULL;
 
     if ( p_track->b_chans_reorder )
     {
@@ -702,8 +678,16 @@ static void MP4_Block_Send( demux_t *p_demux, mp4_track_t *p_track, block_t *p_b
         }
         block_Release(p_block);
         p_demux->s = p_stream;
+        return NULL;
     }
-    else
+
+    return p_block;
+}
+
+static void MP4_Block_Send( demux_t *p_demux, mp4_track_t *p_track, block_t *p_block )
+{
+    p_block = MP4_Block_Prepare( p_demux, p_track, p_block );
+    if( p_block )
         es_out_Send( p_demux->out, p_track->p_es, p_block );
 }
 
@@ -1273,6 +1257,10 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
     demux_sys_t *p_sys = p_demux->p_sys;
     uint32_t i_nb_samples = 0;
     uint32_t i_samplessize = 0;
+    /* Samples of the same run are sent as a single chain */
+    block_t *p_chain = NULL;
+    block_t **pp_chain_last = &p_chain;
+    int i_ret = VLC_DEMUXER_SUCCESS;
 
     if( !tk->b_ok || tk->i_sample >= tk->i_sample_count )
         return VLC_DEMUXER_EOS;
@@ -1289,7 +1277,10 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
     for( ; i_demux_max_nzdts >= i_current_nzdts; )
     {
         if( tk->i_sample >= tk->i_sample_count )
-            return VLC_DEMUXER_EOS;
+        {
+            i_ret = VLC_DEMUXER_EOS;
+            break;
+        }
 
 #if 0
         msg_Dbg( p_demux, "tk(%i)=%"PRId64" mv=%"PRId64" pos=%"PRIu64, tk->i_track_ID,
@@ -1310,7 +1301,6 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
                     msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
                                        ": Failed to seek to %"PRIu64,
                               tk->i_track_ID, i_readpos );
-                    MP4_TrackSelect( p_demux, tk, false );
                     goto end;
                 }
             }
@@ -1321,7 +1311,6 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
                 msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
                                    ": Failed to read %d bytes sample at %"PRIu64,
                           tk->i_track_ID, i_samplessize, i_readpos );
-                MP4_TrackSelect( p_demux, tk, false );
                 goto end;
             }
 
@@ -1344,7 +1333,9 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
 
             p_block->i_length = MP4_GetSamplesDuration( p_demux, tk, i_nb_samples );
 
-            MP4_Block_Send( p_demux, tk, p_block );
+            p_block = MP4_Block_Prepare( p_demux, tk, p_block );
+            if( p_block )
+                block_ChainLastAppend( &pp_chain_last, p_block );
         }
 
         /* Next sample */
@@ -1359,9 +1350,14 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
         i_readpos = MP4_TrackGetPos( tk );
     }
 
-    return VLC_DEMUXER_SUCCESS;
+    if( p_chain )
+        es_out_SendChain( p_demux->out, tk->p_es, p_chain );
+    return i_ret;
 
 end:
+    if( p_chain )
+        es_out_SendChain( p_demux->out, tk->p_es, p_chain );
+    MP4_TrackSelect( p_demux, tk, false );
     return VLC_DEMUXER_EGENERIC;
 }
 
@@ -1553,7 +1549,8 @@ static int Seek( demux_t *p_demux, vlc_tick_t i_date, bool b_accurate )
     {
         mp4_track_t *tk = &p_sys->track[i_track];
         tk->i_next_block_flags |= BLOCK_FLAG_DISCONTINUITY;
-        if( tk->fmt.i_cat == VIDEO_ES )
+        /* tracks not indexed yet are sought when selected */
+        if( tk->fmt.i_cat == VIDEO_ES || !tk->b_indexed )
             continue;
         MP4_TrackSeek( p_demux, tk, i_start );
     }
@@ -2393,7 +2390,8 @@ static void LoadChapter( demux_t  *p_demux )
             }
             if( j < p_sys->i_tracks )
             {
-                LoadChapterApple( p_demux, &p_sys->track[j] );
+                if( MP4_TrackIndex( p_demux, &p_sys->track[j] ) == VLC_SUCCESS )
+                    LoadChapterApple( p_demux, &p_sys->track[j] );
                 break;
             }
         }
@@ -2437,21 +2435,8 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         return VLC_ENOMEM;
     }
 
-    /* first we read chunk offset */
-    for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-    {
-        mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-
-        ck->i_offset = BOXDATA(p_co64)->i_chunk_offset[i_chunk];
-
-        ck->i_first_dts = 0;
-        ck->i_entries_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->i_entries_pts = 0;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
-    }
+    /* chunk offsets are read from the stco/co64 table */
+    p_demux_track->p_chunk_offset = BOXDATA(p_co64)->i_chunk_offset;
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
         to be used for the sample XXX begin to 1
@@ -2512,54 +2497,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2591,24 +2528,16 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     if( stsz->i_sample_size )
     {
-        /* 1: all sample have the same size, so no need to construct a table */
-        p_demux_track->i_sample_size = stsz->i_sample_size;
+        /* 1: all sample have the same size, so no need to construct a table.
+         * Keep the size if the ES setup already fixed it up */
+        if( p_demux_track->i_sample_size == 0 )
+            p_demux_track->i_sample_size = stsz->i_sample_size;
         p_demux_track->p_sample_size = NULL;
     }
     else
     {
         /* 2: each sample can have a different size */
-        p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
@@ -2622,20 +2551,14 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
 
     /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     * The table is not expanded: runs are indexed by their first sample and
+     * dts, and both sample -> dts and dts -> sample are binary searches. */
 
-    int64_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
@@ -2646,99 +2569,20 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
-
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+        if( MP4_SampleRuns_Init( &p_demux_track->dts,
+                                 stts->pi_sample_count, stts->pi_sample_delta,
+                                 stts->i_entry_count,
+                                 p_demux_track->i_sample_count, true ) )
         {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* save first dts */
-            ck->i_first_dts = i_next_dts;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-            }
+            msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32,
+                     stts->i_entry_count );
+            return VLC_ENOMEM;
         }
-    }
 
+        if( p_demux_track->dts.i_samples < p_demux_track->i_sample_count )
+            msg_Warn( p_demux, "STTS table only covers %"PRIu32" samples",
+                      p_demux_track->dts.i_samples );
+    }
 
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
@@ -2750,96 +2594,25 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        int64_t i_cts_shift = 0;
+        p_demux_track->i_cts_shift = 0;
         const MP4_Box_t *p_cslg = MP4_BoxGet( p_demux_track->p_stbl, "cslg" );
         if( p_cslg && BOXDATA(p_cslg) )
-            i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
-
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+            p_demux_track->i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
 
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+        if( MP4_SampleRuns_Init( &p_demux_track->pts,
+                                 ctts->pi_sample_count, ctts->pi_sample_offset,
+                                 ctts->i_entry_count,
+                                 p_demux_track->i_sample_count, false ) )
         {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
-            }
+            msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32,
+                     ctts->i_entry_count );
+            return VLC_ENOMEM;
         }
     }
 
     msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
-             i_next_dts / p_demux_track->i_timescale );
+             p_demux_track->dts.i_duration / p_demux_track->i_timescale );
 
     return VLC_SUCCESS;
 }
@@ -2883,17 +2656,20 @@ static void TrackGetESSampleRate( demux_t *p_demux,
         p_chunk--;
     }
 
+    const uint32_t i_first = p_chunk->i_sample_first;
     uint64_t i_sample = 0;
-    uint64_t i_total_duration = 0;
     do
     {
         i_sample += p_chunk->i_sample_count;
-        i_total_duration += p_chunk->i_duration;
         p_chunk++;
     }
     while( p_chunk < &p_track->chunk[p_track->i_chunk_count] &&
            p_chunk->i_sample_description_index == i_sd_index );
 
+    const uint64_t i_total_duration =
+        MP4_SampleRuns_GetTime( &p_track->dts, i_first + i_sample ) -
+        MP4_SampleRuns_GetTime( &p_track->dts, i_first );
+
     if( i_sample > 0 && i_total_duration )
         vlc_ureduce( pi_num, pi_den,
                      i_sample * p_track->i_timescale,
@@ -2911,7 +2687,16 @@ static int TrackCreateES( demux_t *p_demux, mp4_track_t *p_track,
     demux_sys_t *p_sys = p_demux->p_sys;
     unsigned int i_sample_description_index;
 
-    if( p_sys->b_fragmented || p_track->i_chunk_count == 0 )
+    if( !p_track->b_indexed && !p_sys->b_fragmented )
+    {
+        /* sample tables not loaded yet, use the first chunks description */
+        const MP4_Box_t *p_stsc = MP4_BoxGet( p_track->p_stbl, "stsc" );
+        if( p_stsc && BOXDATA(p_stsc) && BOXDATA(p_stsc)->i_entry_count )
+            i_sample_description_index = BOXDATA(p_stsc)->i_sample_description_index[0];
+        else
+            i_sample_description_index = 0;
+    }
+    else if( p_sys->b_fragmented || p_track->i_chunk_count == 0 )
         i_sample_description_index = 1; /* XXX */
     else
         i_sample_description_index =
@@ -3022,17 +2807,22 @@ static int TrackGetNearestSeekPoint( demux_t *p_demux, mp4_track_t *p_track,
         const MP4_Box_data_stss_t *p_stss_data = BOXDATA(p_stss);
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss_data->i_entry_count; i_index++ )
+        if( p_stss_data->i_entry_count > 0 )
         {
-            if( i_index >= p_stss_data->i_entry_count - 1 ||
-                i_sample < p_stss_data->i_sample_number[i_index+1] )
+            /* last sync sample before the next entry above i_sample */
+            uint32_t i_low = 0, i_high = p_stss_data->i_entry_count;
+            while( i_high - i_low > 1 )
             {
-                *pi_sync_sample = p_stss_data->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stss gives %d --> %" PRIu32 " (sample number)",
-                         i_sample, *pi_sync_sample );
-                i_ret = VLC_SUCCESS;
-                break;
+                uint32_t i_mid = i_low + (i_high - i_low) / 2;
+                if( p_stss_data->i_sample_number[i_mid] <= i_sample )
+                    i_low = i_mid;
+                else
+                    i_high = i_mid;
             }
+            *pi_sync_sample = p_stss_data->i_sample_number[i_low];
+            msg_Dbg( p_demux, "stss gives %d --> %" PRIu32 " (sample number)",
+                     i_sample, *pi_sync_sample );
+            i_ret = VLC_SUCCESS;
         }
     }
 
@@ -3087,10 +2877,8 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
                                    uint32_t *pi_sample )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    uint64_t     i_dts;
-    unsigned int i_sample;
-    unsigned int i_chunk;
-    int          i_index;
+    uint32_t     i_sample;
+    uint32_t     i_chunk;
     stime_t      i_start;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
@@ -3134,61 +2922,16 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = MP4_rescale_qtime( start, p_track->i_timescale );
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
-    {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
-    }
-
-    /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
-    {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-            break;
-        }
-    }
-
+    /* *** find sample and its chunk *** */
+    i_sample = MP4_SampleRuns_GetSample( &p_track->dts, i_start );
     if( i_sample >= p_track->i_sample_count )
     {
         msg_Warn( p_demux, "track[Id 0x%x] will be disabled "
-                  "(seeking too far) chunk=%d sample=%d",
-                  p_track->i_track_ID, i_chunk, i_sample );
+                  "(seeking too far) sample=%u",
+                  p_track->i_track_ID, i_sample );
         return( VLC_EGENERIC );
     }
-
+    i_chunk = MP4_TrackGetChunk( p_track, i_sample );
 
     /* *** Try to find nearest sync points *** */
     uint32_t i_sync_sample;
@@ -3196,19 +2939,7 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         TrackGetNearestSeekPoint( p_demux, p_track, i_sample, &i_sync_sample ) )
     {
         /* Go to chunk */
-        if( i_sync_sample <= i_sample )
-        {
-            while( i_chunk > 0 &&
-                   i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                i_chunk--;
-        }
-        else
-        {
-            while( i_chunk < p_track->i_chunk_count - 1 &&
-                   i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                    p_track->chunk[i_chunk].i_sample_count )
-                i_chunk++;
-        }
+        i_chunk = MP4_TrackGetChunk( p_track, i_sync_sample );
         i_sample = i_sync_sample;
     }
 
@@ -3512,14 +3243,6 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
         }
     }
 
-    /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
-    {
-        msg_Err( p_demux, "cannot create chunks index" );
-        return; /* cannot create chunks index */
-    }
-
     p_track->i_chunk  = 0;
     p_track->i_sample = 0;
 
@@ -3599,6 +3322,26 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     if( !p_track->b_enable )
         p_track->fmt.i_priority = ES_PRIORITY_NOT_DEFAULTABLE;
 
+    /* Create chunk index table and sample index table. With a lazily loaded
+     * moov, it is delayed until selection, except for video which needs the
+     * sample count for its frame rate. */
+    if( !(p_sys->p_root->e_flags & BOX_FLAG_LAZY) ||
+        p_track->fmt.i_cat == VIDEO_ES || p_track->b_chapters_source )
+    {
+        if( MP4_TrackIndex( p_demux, p_track ) )
+        {
+            msg_Err( p_demux, "cannot create chunks index" );
+            return; /* cannot create chunks index */
+        }
+    }
+    else
+    {
+        /* constant sizes are too small to be deferred */
+        const MP4_Box_t *p_stsz = MP4_BoxGet( p_track->p_stbl, "stsz" );
+        if( p_stsz && BOXDATA(p_stsz) )
+            p_track->i_sample_size = BOXDATA(p_stsz)->i_sample_size;
+    }
+
     if( TrackCreateES( p_demux,
                        p_track, p_track->i_chunk,
                       (p_track->b_chapters_source || !b_create_es) ? NULL : &p_track->p_es ) )
@@ -3611,15 +3354,6 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     p_track->b_ok = true;
 }
 
-static void DestroyChunk( mp4_chunk_t *ck )
-{
-    free( ck->p_sample_count_dts );
-    free( ck->p_sample_delta_dts );
-    free( ck->p_sample_count_pts );
-    free( ck->p_sample_offset_pts );
-    free( ck->p_sample_size );
-}
-
 /****************************************************************************
  * MP4_TrackClean:
  ****************************************************************************
@@ -3632,15 +3366,9 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
-    }
     free( p_track->chunk );
-
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
+    MP4_SampleRuns_Clean( &p_track->dts );
+    MP4_SampleRuns_Clean( &p_track->pts );
 
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
@@ -3655,6 +3383,31 @@ static void MP4_TrackInit( mp4_track_t *p_track )
     p_track->i_timescale = 1;
 }
 
+/****************************************************************************
+ * MP4_TrackIndex:
+ ****************************************************************************
+ * Loads the deferred sample tables and creates the chunks and samples index
+ ****************************************************************************/
+static int MP4_TrackIndex( demux_t *p_demux, mp4_track_t *p_track )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_track->b_indexed )
+        return VLC_SUCCESS;
+
+    MP4_Box_t *p_trak = MP4_GetTrakByTrackID( p_sys->p_moov, p_track->i_track_ID );
+    if( p_trak && MP4_BoxLoadDeferred( p_demux->s, p_trak ) != VLC_SUCCESS )
+        msg_Warn( p_demux, "cannot load all sample tables of track[Id 0x%x]",
+                  p_track->i_track_ID );
+
+    if( TrackCreateChunksIndex( p_demux, p_track ) ||
+        TrackCreateSamplesIndex( p_demux, p_track ) )
+        return VLC_EGENERIC;
+
+    p_track->b_indexed = true;
+    return VLC_SUCCESS;
+}
+
 static void MP4_TrackSelect( demux_t *p_demux, mp4_track_t *p_track, bool b_select )
 {
     if( !p_track->b_ok || p_track->b_chapters_source )
@@ -3683,6 +3436,14 @@ static int MP4_TrackSeek( demux_t *p_demux, mp4_track_t *p_track,
 
     p_track->b_selected = false;
 
+    if( MP4_TrackIndex( p_demux, p_track ) )
+    {
+        msg_Err( p_demux, "cannot create chunks index of track[Id 0x%x]",
+                 p_track->i_track_ID );
+        p_track->b_ok = false;
+        return VLC_EGENERIC;
+    }
+
     if( TrackTimeToSampleChunk( p_demux, p_track, i_start,
                                 &i_chunk, &i_sample ) )
     {
@@ -3911,7 +3672,7 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
     unsigned int i_sample;
     uint64_t i_pos;
 
-    i_pos = p_track->chunk[p_track->i_chunk].i_offset;
+    i_pos = MP4_ChunkGetOffset( p_track, p_track->i_chunk );
 
     if( p_track->i_sample_size )
     {
@@ -28,37 +28,19 @@
 #include <vlc_common.h>
 #include "libmp4.h"
 #include "fragments.h"
+#include "sampletable.h"
 #include "../asf/asfpacket.h"
 
-/* Contain all information about a chunk */
+/* Contain all information about a chunk
+ * offset and timing are looked up in the track tables, so that the chunk
+ * table does not duplicate the sample tables */
 typedef struct
 {
-    uint64_t     i_offset; /* absolute position of this chunk in the file */
     uint32_t     i_sample_description_index; /* index for SampleEntry to use */
     uint32_t     i_sample_count; /* how many samples in this chunk */
     uint32_t     i_sample_first; /* index of the first sample in this chunk */
     uint32_t     i_sample; /* index of the next sample to read in this chunk */
     uint32_t     i_virtual_run_number; /* chunks interleaving sequence */
-
-    /* now provide way to calculate pts, dts, and offset without too
-        much memory and with fast access */
-
-    /* with this we can calculate dts/pts without waste memory */
-    uint64_t     i_first_dts;   /* DTS of the first sample */
-    uint64_t     i_duration;    /* total duration of all samples */
-
-    uint32_t     i_entries_dts;
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-
-    uint32_t     i_entries_pts;
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
-
-    uint32_t     *p_sample_size;
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
-
 } mp4_chunk_t;
 
 typedef struct
@@ -83,6 +65,7 @@ typedef struct
     bool b_selected;  /* is the trak being played */
     bool b_chapters_source;   /* True when used for chapter only */
     bool b_forced_spu; /* forced track selection (never done by default/priority) */
+    bool b_indexed;    /* chunks and samples tables are created */
     uint32_t i_switch_group;
 
     bool b_mac_encoding;
@@ -116,12 +99,16 @@ typedef struct
     uint32_t         i_sample_count;
 
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
+    const uint64_t *p_chunk_offset; /* stco/co64 table, one per chunk */
 
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-//                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* stsz table */
+
+    mp4_sample_runs_t dts; /* stts */
+    mp4_sample_runs_t pts; /* ctts */
+    stime_t          i_cts_shift; /* cslg composition to decode shift */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * sampletable.c : MP4 compact sample tables
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "sampletable.h"
+
+int MP4_SampleRuns_Init( mp4_sample_runs_t *p_runs,
+                         const uint32_t *pi_count, const int32_t *pi_value,
+                         uint32_t i_entries, uint32_t i_max_samples,
+                         bool b_timed )
+{
+    p_runs->pi_count = pi_count;
+    p_runs->pi_value = pi_value;
+    p_runs->pi_first = NULL;
+    p_runs->pi_start = NULL;
+    p_runs->i_runs = 0;
+    p_runs->i_samples = 0;
+    p_runs->i_duration = 0;
+
+    /* Only keep the runs covering the track samples */
+    uint64_t i_total = 0;
+    uint32_t i_runs = 0;
+    while( i_runs < i_entries && i_total < i_max_samples )
+        i_total += pi_count[i_runs++];
+
+    if( i_runs == 0 )
+        return VLC_SUCCESS;
+
+    p_runs->pi_first = vlc_alloc( i_runs, sizeof(*p_runs->pi_first) );
+    if( b_timed )
+        p_runs->pi_start = vlc_alloc( i_runs, sizeof(*p_runs->pi_start) );
+    if( unlikely(!p_runs->pi_first || (b_timed && !p_runs->pi_start)) )
+    {
+        MP4_SampleRuns_Clean( p_runs );
+        return VLC_ENOMEM;
+    }
+
+    uint32_t i_first = 0;
+    stime_t i_time = 0;
+    for( uint32_t i = 0; i < i_runs; i++ )
+    {
+        p_runs->pi_first[i] = i_first;
+        if( b_timed )
+            p_runs->pi_start[i] = i_time;
+
+        uint32_t i_count = __MIN( pi_count[i], i_max_samples - i_first );
+        i_first += i_count;
+        /* deltas are unsigned, even though stored as int32_t */
+        i_time += (stime_t) i_count * (uint32_t) pi_value[i];
+    }
+
+    p_runs->i_runs = i_runs;
+    p_runs->i_samples = i_first;
+    if( b_timed )
+        p_runs->i_duration = i_time;
+
+    return VLC_SUCCESS;
+}
+
+void MP4_SampleRuns_Clean( mp4_sample_runs_t *p_runs )
+{
+    free( p_runs->pi_first );
+    free( p_runs->pi_start );
+    p_runs->pi_first = NULL;
+    p_runs->pi_start = NULL;
+    p_runs->i_runs = 0;
+    p_runs->i_samples = 0;
+    p_runs->i_duration = 0;
+}
+
+uint32_t MP4_SampleRuns_Lookup( const mp4_sample_runs_t *p_runs, uint32_t i_sample )
+{
+    if( i_sample >= p_runs->i_samples )
+        return p_runs->i_runs;
+
+    /* Last run starting at or before the sample. Empty runs share their
+     * first sample with the next one, so they are skipped. */
+    uint32_t i_low = 0, i_high = p_runs->i_runs;
+    while( i_high - i_low > 1 )
+    {
+        uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_runs->pi_first[i_mid] <= i_sample )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+stime_t MP4_SampleRuns_GetTime( const mp4_sample_runs_t *p_runs, uint32_t i_sample )
+{
+    uint32_t i_run = MP4_SampleRuns_Lookup( p_runs, i_sample );
+    if( i_run == p_runs->i_runs )
+        return p_runs->i_duration;
+
+    return p_runs->pi_start[i_run] + (stime_t)( i_sample - p_runs->pi_first[i_run] ) *
+                                     (uint32_t) p_runs->pi_value[i_run];
+}
+
+static inline stime_t MP4_SampleRuns_GetRunEnd( const mp4_sample_runs_t *p_runs,
+                                                uint32_t i_run )
+{
+    return ( i_run + 1 < p_runs->i_runs ) ? p_runs->pi_start[i_run + 1]
+                                          : p_runs->i_duration;
+}
+
+uint32_t MP4_SampleRuns_GetSample( const mp4_sample_runs_t *p_runs, stime_t i_time )
+{
+    if( p_runs->i_runs == 0 || i_time > p_runs->i_duration )
+        return p_runs->i_samples;
+
+    /* First run ending at or after the time */
+    uint32_t i_low = 0, i_high = p_runs->i_runs - 1;
+    while( i_low < i_high )
+    {
+        uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( MP4_SampleRuns_GetRunEnd( p_runs, i_mid ) < i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    const uint32_t i_delta = p_runs->pi_value[i_low];
+    const uint32_t i_first = p_runs->pi_first[i_low];
+    if( i_delta == 0 || i_time <= p_runs->pi_start[i_low] )
+        return i_first;
+
+    uint64_t i_offset = ( i_time - p_runs->pi_start[i_low] ) / i_delta;
+    return ( i_offset < p_runs->i_samples - i_first ) ? i_first + i_offset
+                                                      : p_runs->i_samples;
+}
+
+bool MP4_SampleRuns_GetValue( const mp4_sample_runs_t *p_runs, uint32_t i_sample,
+                              int32_t *pi_value )
+{
+    uint32_t i_run = MP4_SampleRuns_Lookup( p_runs, i_sample );
+    if( i_run == p_runs->i_runs )
+        return false;
+
+    *pi_value = p_runs->pi_value[i_run];
+    return true;
+}
@@ -0,0 +1,62 @@
+/*****************************************************************************
+ * sampletable.h : MP4 compact sample tables
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MP4_SAMPLETABLE_H_
+#define VLC_MP4_SAMPLETABLE_H_
+
+#include <vlc_common.h>
+#include "libmp4.h"
+
+/* Run-length coded sample table (stts or ctts).
+ *
+ * The runs are not copied: counts and values point to the box data, which
+ * must outlive the table. Only the index of the first sample of each run
+ * is added, and for timed tables (stts) the sum of the deltas before each
+ * run, so that sample -> value and time -> sample are binary searches. */
+typedef struct
+{
+    const uint32_t *pi_count; /* samples in each run */
+    const int32_t  *pi_value; /* delta or offset of each run */
+    uint32_t       *pi_first; /* first sample of each run */
+    stime_t        *pi_start; /* time of the first sample of each run */
+    uint32_t        i_runs;
+    uint32_t        i_samples; /* number of samples covered by the runs */
+    stime_t         i_duration; /* sum of all the deltas (timed only) */
+} mp4_sample_runs_t;
+
+int  MP4_SampleRuns_Init( mp4_sample_runs_t *p_runs,
+                          const uint32_t *pi_count, const int32_t *pi_value,
+                          uint32_t i_entries, uint32_t i_max_samples,
+                          bool b_timed );
+void MP4_SampleRuns_Clean( mp4_sample_runs_t *p_runs );
+
+/* Returns the run containing a sample, or i_runs if it is not covered */
+uint32_t MP4_SampleRuns_Lookup( const mp4_sample_runs_t *p_runs, uint32_t i_sample );
+
+/* Timed tables: time of a sample, saturated at i_duration */
+stime_t  MP4_SampleRuns_GetTime( const mp4_sample_runs_t *p_runs, uint32_t i_sample );
+/* Timed tables: first sample at the time, else the sample spanning it,
+ * or i_samples beyond the end */
+uint32_t MP4_SampleRuns_GetSample( const mp4_sample_runs_t *p_runs, stime_t i_time );
+
+/* Value (ctts offset) of a sample */
+bool MP4_SampleRuns_GetValue( const mp4_sample_runs_t *p_runs, uint32_t i_sample,
+                              int32_t *pi_value );
+
+#endif
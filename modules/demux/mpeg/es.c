@@ -36,6 +36,7 @@
 #include <vlc_codec.h>
 #include <vlc_codecs.h>
 #include <vlc_input.h>
+#include <vlc_seekindex.h>
 
 #include "../../packetizer/a52.h"
 #include "../../packetizer/dts_header.h"
@@ -165,8 +166,22 @@ typedef struct
     float rgf_replay_peak[AUDIO_REPLAY_GAIN_MAX];
 
     sync_table_t mllt;
+
+    /* Cached seek points, recorded while the timeline is exact */
+    struct
+    {
+        vlc_seekindex_t *p_index;
+        bool        b_linear; /* timestamps are exact since the last reset */
+        bool        b_dirty;
+        uint64_t    i_pos; /* offset of the next packetized frame */
+        vlc_tick_t  i_next; /* time of the next seek point to record */
+    } seekindex;
 } demux_sys_t;
 
+/* Interval between two cached seek points */
+#define ES_SEEKINDEX_INTERVAL VLC_TICK_FROM_SEC(1)
+#define ES_SEEKINDEX_VERSION 2
+
 static int MpgaProbe( demux_t *p_demux, uint64_t *pi_offset );
 static int MpgaInit( demux_t *p_demux );
 
@@ -176,6 +191,8 @@ static int AacInit( demux_t *p_demux );
 static int EA52Probe( demux_t *p_demux, uint64_t *pi_offset );
 static int A52Probe( demux_t *p_demux, uint64_t *pi_offset );
 static int A52Init( demux_t *p_demux );
+static int A52CheckSync( const uint8_t *p_peek, bool *p_big_endian,
+                         unsigned *pi_samples, bool b_eac3 );
 
 static int DtsProbe( demux_t *p_demux, uint64_t *pi_offset );
 static int DtsInit( demux_t *p_demux );
@@ -186,6 +203,9 @@ static int MlpInit( demux_t *p_demux );
 
 static bool Parse( demux_t *p_demux, block_t **pp_output );
 static uint64_t SeekByMlltTable( demux_t *p_demux, vlc_tick_t *pi_time );
+static void SeekIndexOpen( demux_t *p_demux );
+static void SeekIndexAdd( demux_t *p_demux, const block_t *p_block );
+static int SeekByIndex( demux_t *p_demux, vlc_tick_t i_time );
 
 static const codec_t p_codecs[] = {
     { VLC_CODEC_MP4A, false, "mp4 audio",  AacProbe,  AacInit },
@@ -266,6 +286,9 @@ static int OpenCommon( demux_t *p_demux,
         }
     }
 
+    if( i_cat == AUDIO_ES )
+        SeekIndexOpen( p_demux );
+
     for( ;; )
     {
         if( Parse( p_demux, &p_sys->p_packetized_data ) )
@@ -362,6 +385,9 @@ static int Demux( demux_t *p_demux )
                                    / (p_sys->i_pts - 1);
         p_sys->i_bytes += p_block_out->i_buffer;
 
+        if( p_sys->seekindex.p_index )
+            SeekIndexAdd( p_demux, p_block_out );
+
 
         p_block_out->p_next = NULL;
         es_out_Send( p_demux->out, p_sys->p_es, p_block_out );
@@ -383,6 +409,12 @@ static void Close( vlc_object_t * p_this )
         block_ChainRelease( p_sys->p_packetized_data );
     if( p_sys->mllt.p_bits )
         free( p_sys->mllt.p_bits );
+    if( p_sys->seekindex.p_index )
+    {
+        if( p_sys->seekindex.b_dirty )
+            vlc_seekindex_Store( p_sys->seekindex.p_index );
+        vlc_seekindex_Delete( p_sys->seekindex.p_index );
+    }
     demux_PacketizerDestroy( p_sys->p_packetizer );
     free( p_sys );
 }
@@ -438,6 +470,17 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         case DEMUX_SET_TIME:
+            p_sys->seekindex.b_linear = false;
+            if( p_sys->seekindex.p_index )
+            {
+                va_list ap;
+
+                va_copy( ap, args );
+                int i_ret = SeekByIndex( p_demux, va_arg( ap, vlc_tick_t ) );
+                va_end( ap );
+                if( i_ret == VLC_SUCCESS )
+                    return VLC_SUCCESS;
+            }
             if( p_sys->mllt.p_bits )
             {
                 vlc_tick_t i_time = va_arg(args, vlc_tick_t);
@@ -457,6 +500,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             break;
     }
 
+    if( i_query == DEMUX_SET_POSITION )
+        p_sys->seekindex.b_linear = false;
+
     int ret = demux_vaControlHelper( p_demux->s, p_sys->i_stream_offset, -1,
                                        p_sys->i_bitrate_avg, 1, i_query, args );
     if( ret != VLC_SUCCESS )
@@ -911,6 +957,150 @@ static uint64_t SeekByMlltTable( demux_t *p_demux, vlc_tick_t *pi_time )
     return p_cur->i_pos;
 }
 
+/*****************************************************************************
+ * Seek index cache
+ *****************************************************************************
+ * While playing linearly from the start (or from a cached seek point), the
+ * time and offset of each frame are exact, so seek points are recorded
+ * every second and cached. Seeking within the cached range then no longer
+ * depends on the bitrate estimation.
+ *****************************************************************************/
+static void SeekIndexOpen( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_seekable;
+
+    /* The offsets are the sums of the packetized frames sizes: only the
+     * packetizers that output the input frames as is can be indexed. The
+     * AAC one strips the ADTS/LOAS headers, the DTS one converts the 14 bits
+     * streams, and the MLP frames are not all starting with a sync. */
+    switch( p_sys->codec.i_codec )
+    {
+        case VLC_CODEC_MPGA:
+        case VLC_CODEC_A52:
+        case VLC_CODEC_EAC3:
+            break;
+        default:
+            return;
+    }
+
+    /* Seeking to a cached point requires resetting the packetizer */
+    if( p_sys->p_packetizer->pf_flush == NULL
+     || vlc_stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_seekable )
+     || !b_seekable )
+        return;
+
+    p_sys->seekindex.p_index = vlc_seekindex_New( p_demux, p_demux->s, "es",
+                                                  ES_SEEKINDEX_VERSION );
+    if( p_sys->seekindex.p_index == NULL )
+        return;
+
+    p_sys->seekindex.b_linear = true;
+    p_sys->seekindex.b_dirty = false;
+    p_sys->seekindex.i_pos = p_sys->i_stream_offset;
+    p_sys->seekindex.i_next = 0;
+
+    if( vlc_seekindex_Load( p_sys->seekindex.p_index ) == VLC_SUCCESS )
+    {
+        size_t i_count;
+        const vlc_seekindex_entry_t *p_entries =
+            vlc_seekindex_GetEntries( p_sys->seekindex.p_index, &i_count );
+
+        if( i_count > 0 )
+            p_sys->seekindex.i_next = p_entries[i_count - 1].time
+                                    + ES_SEEKINDEX_INTERVAL;
+    }
+}
+
+static void SeekIndexAdd( demux_t *p_demux, const block_t *p_block )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_pos = p_sys->seekindex.i_pos;
+
+    p_sys->seekindex.i_pos += p_block->i_buffer;
+
+    /* p_block timestamps already include the time offset */
+    if( !p_sys->seekindex.b_linear || p_block->i_pts == VLC_TICK_INVALID
+     || p_block->i_pts - VLC_TICK_0 < p_sys->seekindex.i_next )
+        return;
+
+    const vlc_seekindex_entry_t entry = {
+        .time = p_block->i_pts - VLC_TICK_0,
+        .offset = i_pos,
+    };
+
+    if( vlc_seekindex_Append( p_sys->seekindex.p_index, &entry ) )
+        return;
+    p_sys->seekindex.i_next = entry.time + ES_SEEKINDEX_INTERVAL;
+    p_sys->seekindex.b_dirty = true;
+}
+
+/* Checks that a cached point is at the start of a frame: the packetizer
+ * drops the garbage between frames, which shifts the next offsets */
+static bool SeekIndexCheckSync( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+    bool b_big_endian;
+
+    switch( p_sys->codec.i_codec )
+    {
+        case VLC_CODEC_MPGA:
+            return vlc_stream_Peek( p_demux->s, &p_peek, 4 ) == 4
+                && MpgaCheckSync( p_peek );
+        case VLC_CODEC_A52:
+        case VLC_CODEC_EAC3:
+            return vlc_stream_Peek( p_demux->s, &p_peek,
+                                    VLC_A52_MIN_HEADER_SIZE )
+                       == VLC_A52_MIN_HEADER_SIZE
+                && A52CheckSync( p_peek, &b_big_endian, NULL,
+                                 p_sys->codec.i_codec == VLC_CODEC_EAC3 ) > 0;
+        default:
+            return false;
+    }
+}
+
+static int SeekByIndex( demux_t *p_demux, vlc_tick_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const vlc_seekindex_entry_t *p_entry =
+        vlc_seekindex_Find( p_sys->seekindex.p_index, 0, i_time );
+
+    /* Only seek within the cached range */
+    if( p_entry == NULL || i_time - p_entry->time > 2 * ES_SEEKINDEX_INTERVAL
+     || vlc_stream_Seek( p_demux->s, p_entry->offset ) )
+        return VLC_EGENERIC;
+
+    if( !SeekIndexCheckSync( p_demux ) )
+    {
+        msg_Warn( p_demux, "cached seek point %"PRIu64" is not a frame, "
+                  "discarding the seek index", p_entry->offset );
+        /* The emptied index replaces the cached one on close */
+        vlc_seekindex_Reset( p_sys->seekindex.p_index );
+        p_sys->seekindex.b_dirty = true;
+        p_sys->seekindex.i_next = 0;
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_demux, "seeking to cached point %"PRId64" at %"PRIu64,
+             p_entry->time, p_entry->offset );
+
+    /* Restart the timestamps from the seek point */
+    if( p_sys->p_packetized_data )
+        block_ChainRelease( p_sys->p_packetized_data );
+    p_sys->p_packetized_data = NULL;
+    p_sys->p_packetizer->pf_flush( p_sys->p_packetizer );
+    p_sys->b_start = true;
+    p_sys->i_pts = 0;
+    p_sys->i_time_offset = p_entry->time;
+    /* The byte count no longer matches the timestamps */
+    p_sys->b_estimate_bitrate = false;
+
+    p_sys->seekindex.b_linear = true;
+    p_sys->seekindex.i_pos = p_entry->offset;
+    return VLC_SUCCESS;
+}
+
 static int ID3TAG_Parse_Handler( uint32_t i_tag, const uint8_t *p_payload, size_t i_payload, void *p_priv )
 {
     demux_t *p_demux = (demux_t *) p_priv;
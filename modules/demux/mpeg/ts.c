@@ -1397,64 +1397,68 @@ static block_t * ConvertPESBlock( demux_t *p_demux, ts_es_t *p_es,
 }
 
 /****************************************************************************
- * fanouts current block to all subdecoders / shared pid es
+ * fanouts current block chain to all subdecoders / shared pid es
  ****************************************************************************/
+static block_t * DuplicateDataChain( block_t *p_chain )
+{
+    block_t *p_dup = NULL;
+    block_t **pp_last = &p_dup;
+    for( ; p_chain; p_chain = p_chain->p_next )
+    {
+        block_t *p_block = block_Duplicate( p_chain );
+        if( p_block )
+            block_ChainLastAppend( &pp_last, p_block );
+    }
+    return p_dup;
+}
+
 static void SendDataChain( demux_t *p_demux, ts_es_t *p_es, block_t *p_chain )
 {
-    while( p_chain )
+    if( !p_chain )
+        return;
+
+    if( p_es->i_next_block_flags )
+    {
+        p_chain->i_flags |= p_es->i_next_block_flags;
+        p_es->i_next_block_flags = 0;
+    }
+
+    /* The whole chain belongs to the same es: hand it at once */
+    for( ts_es_t *p_es_send = p_es; p_es_send; p_es_send = p_es_send->p_next )
     {
-        block_t *p_block = p_chain;
-        p_chain = p_block->p_next;
-        p_block->p_next = NULL;
+        if( !p_es_send->p_program->b_selected )
+            continue;
 
-        ts_es_t *p_es_send = p_es;
-        if( p_es_send->i_next_block_flags )
+        /* Send a copy to each extra es */
+        for( ts_es_t *p_extra_es = p_es_send->p_extraes; p_extra_es;
+             p_extra_es = p_extra_es->p_next )
         {
-            p_block->i_flags |= p_es_send->i_next_block_flags;
-            p_es_send->i_next_block_flags = 0;
+            if( p_extra_es->id )
+            {
+                block_t *p_dup = DuplicateDataChain( p_chain );
+                if( p_dup )
+                    es_out_SendChain( p_demux->out, p_extra_es->id, p_dup );
+            }
         }
 
-        while( p_es_send )
+        if( p_es_send->id )
         {
-            if( p_es_send->p_program->b_selected )
+            if( p_es_send->p_next )
             {
-                /* Send a copy to each extra es */
-                ts_es_t *p_extra_es = p_es_send->p_extraes;
-                while( p_extra_es )
-                {
-                    if( p_extra_es->id )
-                    {
-                        block_t *p_dup = block_Duplicate( p_block );
-                        if( p_dup )
-                            es_out_Send( p_demux->out, p_extra_es->id, p_dup );
-                    }
-                    p_extra_es = p_extra_es->p_next;
-                }
-
-                if( p_es_send->p_next )
-                {
-                    if( p_es_send->id )
-                    {
-                        block_t *p_dup = block_Duplicate( p_block );
-                        if( p_dup )
-                            es_out_Send( p_demux->out, p_es_send->id, p_dup );
-                    }
-                }
-                else
-                {
-                    if( p_es_send->id )
-                    {
-                        es_out_Send( p_demux->out, p_es_send->id, p_block );
-                        p_block = NULL;
-                    }
-                }
+                block_t *p_dup = DuplicateDataChain( p_chain );
+                if( p_dup )
+                    es_out_SendChain( p_demux->out, p_es_send->id, p_dup );
+            }
+            else
+            {
+                es_out_SendChain( p_demux->out, p_es_send->id, p_chain );
+                p_chain = NULL;
             }
-            p_es_send = p_es_send->p_next;
         }
-
-        if( p_block )
-            block_Release( p_block );
     }
+
+    if( p_chain )
+        block_ChainRelease( p_chain );
 }
 
 /****************************************************************************
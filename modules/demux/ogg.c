@@ -49,6 +49,7 @@
 #include "ogg.h"
 #include "oggseek.h"
 #include "ogg_granule.h"
+#include "ogg_page.h"
 #include "opus.h"
 
 /*****************************************************************************
@@ -268,6 +269,8 @@ static void Close( vlc_object_t *p_this )
 
     /* Cleanup the bitstream parser */
     ogg_sync_clear( &p_sys->oy );
+    if( p_sys->p_page_block )
+        block_Release( p_sys->p_page_block );
 
     Ogg_EndOfStream( p_demux );
 
@@ -489,7 +492,22 @@ static int Demux( demux_t * p_demux )
         }
     }
 
-    for( i_stream = 0; i_stream < p_sys->i_streams; i_stream++ )
+    /* A new page only belongs to the logical stream with its serial */
+    int i_first_stream = 0;
+    if( !p_sys->b_page_waiting && p_sys->i_streams > 1 )
+    {
+        const int i_serial = ogg_page_serialno( &p_sys->current_page );
+        for( i_stream = 0; i_stream < p_sys->i_streams; i_stream++ )
+        {
+            if( p_sys->pp_stream[i_stream]->os.serialno == i_serial )
+            {
+                i_first_stream = i_stream;
+                break;
+            }
+        }
+    }
+
+    for( i_stream = i_first_stream; i_stream < p_sys->i_streams; i_stream++ )
     {
         logical_stream_t *p_stream = p_sys->pp_stream[i_stream];
 
@@ -900,20 +918,58 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 static int Ogg_ReadPage( demux_t *p_demux, ogg_page *p_oggpage )
 {
     demux_sys_t *p_ogg = p_demux->p_sys  ;
-    int i_read = 0;
-    char *p_buffer;
 
-    while( ogg_sync_pageout( &p_ogg->oy, p_oggpage ) != 1 )
+    /* Data left in the sync layer (by seeking): only complete its page,
+     * so that it gets empty and the next pages are read directly */
+    while( p_ogg->oy.fill > p_ogg->oy.returned )
     {
-        p_buffer = ogg_sync_buffer( &p_ogg->oy, OGGSEEK_BYTES_TO_READ );
+        int i_ret = ogg_sync_pageout( &p_ogg->oy, p_oggpage );
+        if( i_ret == 1 )
+            return VLC_SUCCESS;
+        if( i_ret < 0 ) /* skipped garbage */
+            continue;
 
-        i_read = vlc_stream_Read( p_demux->s, p_buffer, OGGSEEK_BYTES_TO_READ );
+        const size_t i_left = p_ogg->oy.fill - p_ogg->oy.returned;
+        const uint8_t *p_left = &p_ogg->oy.data[p_ogg->oy.returned];
+        size_t i_header, i_toread;
+        if( i_left < OGG_PAGE_HEADER_SIZE )
+            i_toread = OGG_PAGE_HEADER_SIZE - i_left;
+        else if( i_left < OGG_PAGE_HEADER_SIZE + p_left[26] )
+            i_toread = OGG_PAGE_HEADER_SIZE + p_left[26] - i_left;
+        else
+            i_toread = Ogg_PageSize( p_left, i_left, &i_header ) - i_left;
+
+        char *p_buffer = ogg_sync_buffer( &p_ogg->oy, i_toread );
+        if( !p_buffer )
+            return VLC_EGENERIC;
+        ssize_t i_read = vlc_stream_Read( p_demux->s, p_buffer, i_toread );
         if( i_read <= 0 )
             return VLC_EGENERIC;
-
         ogg_sync_wrote( &p_ogg->oy, i_read );
     }
 
+    /* The page data is only valid until the next read */
+    if( p_ogg->p_page_block )
+    {
+        block_Release( p_ogg->p_page_block );
+        p_ogg->p_page_block = NULL;
+    }
+
+    const uint64_t i_skipped = p_ogg->i_skipped;
+    size_t i_header;
+    block_t *p_block = Ogg_PageRead( p_demux->s, &i_header, &p_ogg->i_skipped );
+    if( p_ogg->i_skipped != i_skipped )
+        msg_Warn( p_demux, "skipped %"PRIu64" bytes of invalid data",
+                  p_ogg->i_skipped - i_skipped );
+    if( !p_block )
+        return VLC_EGENERIC;
+
+    p_ogg->p_page_block = p_block;
+    p_oggpage->header = p_block->p_buffer;
+    p_oggpage->header_len = i_header;
+    p_oggpage->body = &p_block->p_buffer[i_header];
+    p_oggpage->body_len = p_block->i_buffer - i_header;
+
     return VLC_SUCCESS;
 }
 
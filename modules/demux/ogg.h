@@ -195,6 +195,8 @@ typedef struct
 
     /* current page being parsed */
     ogg_page current_page;
+    block_t *p_page_block; /* its data, unless from the sync layer */
+    uint64_t i_skipped; /* garbage bytes skipped by the page reader */
 
     /* */
     vlc_meta_t          *p_meta;
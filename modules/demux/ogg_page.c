@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * ogg_page.c : ogg pages reader
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+
+#include "ogg_page.h"
+
+/*****************************************************************************
+ * CRC, slicing by 8: each table advances the CRC of one more byte, so that
+ * 8 bytes are folded with independent lookups instead of 8 chained ones.
+ *****************************************************************************/
+static uint32_t crc_tables[8][256];
+
+static void Ogg_PageCRCInit( void )
+{
+    for( unsigned i = 0; i < 256; i++ )
+    {
+        uint32_t r = i << 24;
+        for( unsigned j = 0; j < 8; j++ )
+            r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : r << 1;
+        crc_tables[0][i] = r;
+    }
+    for( unsigned i = 0; i < 256; i++ )
+        for( unsigned k = 1; k < 8; k++ )
+            crc_tables[k][i] = (crc_tables[k - 1][i] << 8) ^
+                               crc_tables[0][crc_tables[k - 1][i] >> 24];
+}
+
+uint32_t Ogg_PageCRC( uint32_t i_crc, const uint8_t *p, size_t i_data )
+{
+    static vlc_once_t once = VLC_STATIC_ONCE;
+    vlc_once( &once, Ogg_PageCRCInit );
+
+    for( ; i_data >= 8; i_data -= 8, p += 8 )
+    {
+        i_crc ^= GetDWBE( p );
+        i_crc = crc_tables[7][i_crc >> 24] ^
+                crc_tables[6][(i_crc >> 16) & 0xff] ^
+                crc_tables[5][(i_crc >> 8) & 0xff] ^
+                crc_tables[4][i_crc & 0xff] ^
+                crc_tables[3][p[4]] ^
+                crc_tables[2][p[5]] ^
+                crc_tables[1][p[6]] ^
+                crc_tables[0][p[7]];
+    }
+    for( ; i_data; i_data--, p++ )
+        i_crc = (i_crc << 8) ^ crc_tables[0][(i_crc >> 24) ^ *p];
+
+    return i_crc;
+}
+
+/*****************************************************************************
+ * Pages
+ *****************************************************************************/
+size_t Ogg_PageSize( const uint8_t *p_peek, size_t i_peek, size_t *pi_header )
+{
+    if( i_peek < OGG_PAGE_HEADER_SIZE )
+        return 0;
+
+    const size_t i_header = OGG_PAGE_HEADER_SIZE + p_peek[26];
+    if( i_peek < i_header )
+        return 0;
+
+    size_t i_body = 0;
+    for( size_t i = OGG_PAGE_HEADER_SIZE; i < i_header; i++ )
+        i_body += p_peek[i];
+
+    *pi_header = i_header;
+    return i_header + i_body;
+}
+
+bool Ogg_PageCheck( const uint8_t *p_page, size_t i_page )
+{
+    static const uint8_t zero[4] = { 0, 0, 0, 0 };
+
+    /* computed with the CRC field zeroed */
+    uint32_t i_crc = Ogg_PageCRC( 0, p_page, 22 );
+    i_crc = Ogg_PageCRC( i_crc, zero, 4 );
+    i_crc = Ogg_PageCRC( i_crc, &p_page[26], i_page - 26 );
+
+    return i_crc == GetDWLE( &p_page[22] );
+}
+
+static bool Ogg_IsCapturePattern( const uint8_t *p )
+{
+    return !memcmp( p, "OggS", 4 ) && p[4] == 0 /* version */;
+}
+
+/* Skips up to the next capture pattern */
+static int Ogg_PageResync( stream_t *s, uint64_t *pi_skipped )
+{
+    const uint8_t *p_peek;
+    ssize_t i_peek = vlc_stream_Peek( s, &p_peek, 4096 );
+    if( i_peek < OGG_PAGE_HEADER_SIZE )
+        return VLC_EGENERIC;
+
+    /* never the current position, which is not a valid page */
+    size_t i_skip = 1;
+    while( i_skip + 5 <= (size_t) i_peek &&
+           !Ogg_IsCapturePattern( &p_peek[i_skip] ) )
+        i_skip++;
+    if( i_skip + 5 > (size_t) i_peek )
+        i_skip = i_peek - 4; /* can be the start of a pattern */
+
+    if( vlc_stream_Read( s, NULL, i_skip ) != (ssize_t) i_skip )
+        return VLC_EGENERIC;
+    *pi_skipped += i_skip;
+    return VLC_SUCCESS;
+}
+
+block_t *Ogg_PageRead( stream_t *s, size_t *pi_header, uint64_t *pi_skipped )
+{
+    for( ;; )
+    {
+        const uint8_t *p_peek;
+        ssize_t i_peek = vlc_stream_Peek( s, &p_peek, OGG_PAGE_HEADER_SIZE + 255 );
+        if( i_peek < OGG_PAGE_HEADER_SIZE )
+            return NULL;
+
+        size_t i_header;
+        size_t i_page = 0;
+        if( Ogg_IsCapturePattern( p_peek ) )
+        {
+            i_page = Ogg_PageSize( p_peek, i_peek, &i_header );
+            if( i_page == 0 ) /* truncated header at the end */
+                return NULL;
+            if( vlc_stream_Peek( s, &p_peek, i_page ) < (ssize_t) i_page )
+                return NULL;
+            if( !Ogg_PageCheck( p_peek, i_page ) )
+                i_page = 0;
+        }
+
+        if( i_page == 0 )
+        {
+            if( Ogg_PageResync( s, pi_skipped ) != VLC_SUCCESS )
+                return NULL;
+            continue;
+        }
+
+        block_t *p_block = vlc_stream_Block( s, i_page );
+        if( p_block == NULL || p_block->i_buffer < i_page )
+        {
+            if( p_block )
+                block_Release( p_block );
+            return NULL;
+        }
+        *pi_header = i_header;
+        return p_block;
+    }
+}
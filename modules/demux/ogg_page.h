@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * ogg_page.h : ogg pages reader
+ *****************************************************************************
+ * Copyright (C) 2019 VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_OGG_PAGE_H_
+#define VLC_OGG_PAGE_H_
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_PAGE_MAX_SIZE (OGG_PAGE_HEADER_SIZE + 255 + 255 * 255)
+
+/* Ogg CRC (polynomial 0x04c11db7, not reflected, no final xor),
+ * continued from i_crc, 0 to start */
+uint32_t Ogg_PageCRC( uint32_t i_crc, const uint8_t *p_data, size_t i_data );
+
+/* Size of the page starting with a capture pattern, and of its header,
+ * or 0 if more data is needed */
+size_t   Ogg_PageSize( const uint8_t *p_peek, size_t i_peek, size_t *pi_header );
+
+/* Checks the CRC of a whole page */
+bool     Ogg_PageCheck( const uint8_t *p_page, size_t i_page );
+
+/* Reads the next valid page from the stream, skipping garbage and pages
+ * with a bad CRC. The page is checked in the stream buffer, and copied
+ * once, to the returned block. */
+block_t *Ogg_PageRead( stream_t *, size_t *pi_header, uint64_t *pi_skipped );
+
+#endif
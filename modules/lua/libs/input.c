@@ -215,8 +215,27 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_INT( lost_pictures )
         STATS_INT( played_abuffers )
         STATS_INT( lost_abuffers )
+        STATS_INT( packetizer_time )
+        STATS_INT( decoder_time )
+#define STATS_HISTOGRAM( n ) \
+        lua_createtable( L, INPUT_STATS_HISTOGRAM_SIZE, 0 ); \
+        for( int i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++ ) \
+        { \
+            lua_pushinteger( L, p_item->p_stats->i_ ## n[i] ); \
+            lua_rawseti( L, -2, i + 1 ); \
+        } \
+        lua_setfield( L, -2, #n );
+        STATS_HISTOGRAM( video_decode_time )
+        STATS_HISTOGRAM( audio_decode_time )
+        STATS_HISTOGRAM( video_fifo_depth )
+        STATS_HISTOGRAM( audio_fifo_depth )
+        STATS_HISTOGRAM( picture_wait )
+        STATS_HISTOGRAM( vout_latency )
+        STATS_HISTOGRAM( aout_drift )
+        STATS_HISTOGRAM( aout_latency )
 #undef STATS_INT
 #undef STATS_FLOAT
+#undef STATS_HISTOGRAM
     }
     vlc_mutex_unlock( &p_item->lock );
     return 1;
@@ -79,7 +79,7 @@ bool Thumbnailer::generate( medialibrary::MediaPtr media, const std::string& mrl
     {
         vlc::threads::mutex_locker lock( ctx.mutex );
         vlc_thumbnailer_RequestByPos( m_thumbnailer.get(), .3f,
-                                      VLC_THUMBNAILER_SEEK_FAST, ctx.item,
+                                      VLC_THUMBNAILER_SEEK_KEYFRAME, ctx.item,
                                       VLC_TICK_FROM_SEC( 3 ),
                                       &onThumbnailComplete, &ctx );
 
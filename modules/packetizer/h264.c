@@ -337,6 +337,8 @@ static int Open( vlc_object_t *p_this )
                      p_h264_startcode, sizeof(p_h264_startcode), startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
+    /* NALs are only trimmed, never modified in place */
+    p_sys->packetizer.b_zerocopy = true;
 
     p_sys->b_slice = false;
     p_sys->frame.p_head = NULL;
@@ -868,7 +870,7 @@ static block_t *OutputPicture( decoder_t *p_dec )
     p_sys->leading.p_head = NULL;
     p_sys->leading.pp_append = &p_sys->leading.p_head;
 
-    p_pic = block_ChainGather( p_pic );
+    p_pic = block_ChainGatherShared( p_pic );
 
     if( !p_pic )
     {
@@ -1022,6 +1024,10 @@ static block_t *OutputPicture( decoder_t *p_dec )
             break;
     }
 
+    /* All the slices of a picture agree on being a reference or not */
+    if( p_sys->slice.i_nal_ref_idc == 0 )
+        p_pic->i_flags |= BLOCK_FLAG_DISPOSABLE;
+
     if( !p_sys->b_recovered )
     {
         if( p_sys->i_recoveryfnum != UINT_MAX ) /* recovering from SEI */
@@ -1066,7 +1072,16 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
     if( !p_sys->sps[p_sps->i_id].p_sps )
         msg_Dbg( p_dec, "found NAL_SPS (sps_id=%d)", p_sps->i_id );
 
-    StoreSPS( p_sys, p_sps->i_id, p_frag, p_sps );
+    /* Store a copy, not a slice keeping the whole input block */
+    block_t *p_copy = block_Duplicate( p_frag );
+    block_Release( p_frag );
+    if( unlikely( !p_copy ) )
+    {
+        h264_release_sps( p_sps );
+        return;
+    }
+
+    StoreSPS( p_sys, p_sps->i_id, p_copy, p_sps );
 }
 
 static void PutPPS( decoder_t *p_dec, block_t *p_frag )
@@ -1093,7 +1108,15 @@ static void PutPPS( decoder_t *p_dec, block_t *p_frag )
     if( !p_sys->pps[p_pps->i_id].p_pps )
         msg_Dbg( p_dec, "found NAL_PPS (pps_id=%d sps_id=%d)", p_pps->i_id, p_pps->i_sps_id );
 
-    StorePPS( p_sys, p_pps->i_id, p_frag, p_pps );
+    block_t *p_copy = block_Duplicate( p_frag );
+    block_Release( p_frag );
+    if( unlikely( !p_copy ) )
+    {
+        h264_release_pps( p_pps );
+        return;
+    }
+
+    StorePPS( p_sys, p_pps->i_id, p_copy, p_pps );
 }
 
 static void GetSPSPPS( uint8_t i_pps_id, void *priv,
@@ -191,6 +191,8 @@ static int Open(vlc_object_t *p_this)
                     p_hevc_startcode, sizeof(p_hevc_startcode), startcode_FindAnnexB,
                     p_hevc_startcode, 1, 5,
                     PacketizeReset, PacketizeParse, PacketizeValidate, p_dec);
+    /* NALs are only trimmed, never modified in place */
+    p_sys->packetizer.b_zerocopy = true;
 
     /* Copy properties */
     es_format_Copy(&p_dec->fmt_out, &p_dec->fmt_in);
@@ -814,7 +816,7 @@ static block_t *GatherAndValidateChain(block_t *p_outputchain)
         if(p_outputchain->i_flags & BLOCK_FLAG_DROP)
             p_output = p_outputchain; /* Avoid useless gather */
         else
-            p_output = block_ChainGather(p_outputchain);
+            p_output = block_ChainGatherShared(p_outputchain);
     }
 
     if(p_output && (p_output->i_flags & BLOCK_FLAG_DROP))
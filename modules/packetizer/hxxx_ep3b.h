@@ -20,10 +20,38 @@
  *****************************************************************************/
 #include <vlc_bits.h>
 
+#include "startcode_helper.h"
+
+/* Skips up to i_max bytes after p which can't be emulation prevention
+ * bytes, as long as the current byte isn't a zero: up to the next two
+ * zero bytes. Returns the number of skipped bytes. */
+static inline size_t hxxx_ep3b_skip( uint8_t **pp, uint8_t *end, unsigned *pi_prev, size_t i_max )
+{
+    uint8_t *p = *pp;
+    if( (*pi_prev & 0x01) || end - p < 2 )
+        return 0;
+
+    const uint8_t *z = startcode_FindZeroPair( &p[1], end );
+    size_t i_skip = (z ? z : end) - &p[1];
+    if( i_skip > i_max )
+        i_skip = i_max;
+    if( i_skip == 0 )
+        return 0;
+
+    p += i_skip;
+    *pi_prev = (!p[-1] << 1) | !p[0];
+    *pp = p;
+    return i_skip;
+}
+
 static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi_prev, size_t i_count )
 {
     for( size_t i=0; i<i_count; i++ )
     {
+        /* large skips don't need to look at every byte */
+        if( i_count - i > 16 )
+            i += hxxx_ep3b_skip( &p, end, pi_prev, i_count - i - 1 );
+
         if( ++p >= end )
             return p;
 
@@ -88,6 +116,7 @@ static size_t hxxx_ep3b_total_size( const uint8_t *p, const uint8_t *p_end )
     size_t i = 0;
     while( p < p_end )
     {
+        i += hxxx_ep3b_skip( (uint8_t **) &p, (uint8_t *)p_end, &i_prev, SIZE_MAX );
         uint8_t *n = hxxx_ep3b_to_rbsp( (uint8_t *)p, (uint8_t *)p_end, &i_prev, 1 );
         if( n > p )
             ++i;
@@ -101,7 +130,7 @@ static size_t hxxx_bsfw_byte_forward_ep3b( bs_t *s, size_t i_count )
     struct hxxx_bsfw_ep3b_ctx_s *ctx = (struct hxxx_bsfw_ep3b_ctx_s *) s->p_priv;
     if( s->p == NULL )
     {
-        ctx->i_bytesize = hxxx_ep3b_total_size( s->p_start, s->p_end );
+        /* the size is only computed if needed, see remain */
         s->p = s->p_start;
         ctx->i_bytepos = 1;
         return 1;
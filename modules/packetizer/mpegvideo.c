@@ -508,7 +508,8 @@ static block_t *ParseMPEGBlock( decoder_t *p_dec, block_t *p_frag )
             p_pic->i_flags |= BLOCK_FLAG_TYPE_P;
             break;
         case 0x03:
-            p_pic->i_flags |= BLOCK_FLAG_TYPE_B;
+            /* MPEG-1/2 B pictures are never references */
+            p_pic->i_flags |= BLOCK_FLAG_TYPE_B | BLOCK_FLAG_DISPOSABLE;
             break;
         }
 
@@ -55,6 +55,10 @@ typedef struct
 
     unsigned i_au_min_size;
 
+    /* Output the units as slices of the input blocks, when possible,
+     * instead of copies. They must then not be modified by the parser. */
+    bool b_zerocopy;
+
     void *p_private;
     packetizer_reset_t    pf_reset;
     packetizer_parse_t    pf_parse;
@@ -79,6 +83,7 @@ static inline void packetizer_Init( packetizer_t *p_pack,
     p_pack->i_au_prepend = i_au_prepend;
     p_pack->p_au_prepend = p_au_prepend;
     p_pack->i_au_min_size = i_au_min_size;
+    p_pack->b_zerocopy = false;
 
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
@@ -102,6 +107,25 @@ static inline void packetizer_Flush( packetizer_t *p_pack )
     p_pack->pf_reset( p_pack->p_private, true );
 }
 
+/* References the next unit from the current block of the bytestream,
+ * with its prepended bytes, if it is entirely within it */
+static inline block_t *packetizer_Slice( packetizer_t *p_pack, block_t *p_block )
+{
+    const size_t i_prepend = p_pack->i_au_prepend;
+    const size_t i_start = p_pack->bytestream.i_block_offset;
+
+    if( p_block->i_buffer - i_start < p_pack->i_offset || i_start < i_prepend ||
+        ( i_prepend && memcmp( &p_block->p_buffer[i_start - i_prepend],
+                               p_pack->p_au_prepend, i_prepend ) ) )
+        return NULL;
+
+    block_t *p_pic = block_Slice( p_block, i_start - i_prepend,
+                                  i_prepend + p_pack->i_offset );
+    if( p_pic )
+        block_SkipBytes( &p_pack->bytestream, p_pack->i_offset );
+    return p_pic;
+}
+
 static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_block )
 {
     block_t *p_block = ( pp_block ) ? *pp_block : NULL;
@@ -128,7 +152,11 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
     }
 
     if( p_block )
+    {
+        if( p_pack->b_zerocopy )
+            p_block = block_Share( p_block );
         block_BytestreamPush( &p_pack->bytestream, p_block );
+    }
 
     for( ;; )
     {
@@ -181,15 +209,25 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             /* Get the new fragment and set the pts/dts */
             block_t *p_block_bytestream = p_pack->bytestream.p_block;
 
-            p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+            p_pic = NULL;
+            if( p_pack->b_zerocopy )
+                p_pic = packetizer_Slice( p_pack, p_block_bytestream );
+            if( p_pic == NULL )
+            {
+                p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+                if( unlikely( p_pic == NULL ) )
+                    return NULL;
+
+                block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
+                                p_pic->i_buffer - p_pack->i_au_prepend );
+                if( p_pack->i_au_prepend > 0 )
+                    memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
+            }
+            p_pic->i_flags = 0;
+            p_pic->i_length = 0;
             p_pic->i_pts = p_block_bytestream->i_pts;
             p_pic->i_dts = p_block_bytestream->i_dts;
 
-            block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
-                            p_pic->i_buffer - p_pack->i_au_prepend );
-            if( p_pack->i_au_prepend > 0 )
-                memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
-
             p_pack->i_offset = 0;
 
             /* Parse the NAL */
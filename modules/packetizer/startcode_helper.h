@@ -25,6 +25,13 @@
 #if !defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
    #include <emmintrin.h>
 #endif
+#if defined(HAVE_AVX2_INTRINSICS)
+   #include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+   #include <arm_neon.h>
+   #define STARTCODE_NEON 1
+#endif
 
 /* Looks up efficiently for an AnnexB startcode 0x00 0x00 0x01
  * by using a 4 times faster trick than single byte lookup. */
@@ -57,7 +64,7 @@ static inline const uint8_t * startcode_FindAnnexB_SSE2( const uint8_t *p, const
             return p;
     }
 
-    if( p == end )
+    if( p > end )
         return NULL;
 
     alignedend = end - ((intptr_t) end & 15);
@@ -140,16 +147,186 @@ static inline const uint8_t * startcode_FindAnnexB_Bits( const uint8_t *p, const
 }
 #undef TRY_MATCH
 
-#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+/* The wide versions compare each offset of a vector and the next two bytes
+ * with overlapping unaligned loads: the mask only has the exact matches,
+ * without any candidate to check. */
+#if defined(HAVE_AVX2_INTRINSICS)
+
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindAnnexB_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8( 0x01 );
+
+    for( ; end - p >= 32 + 2; p += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *) &p[0] );
+        __m256i b = _mm256_loadu_si256( (const __m256i *) &p[1] );
+        __m256i c = _mm256_loadu_si256( (const __m256i *) &p[2] );
+        __m256i res = _mm256_and_si256( _mm256_cmpeq_epi8( a, zeros ),
+                                        _mm256_cmpeq_epi8( b, zeros ) );
+        res = _mm256_and_si256( res, _mm256_cmpeq_epi8( c, ones ) );
+        uint32_t match = _mm256_movemask_epi8( res );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+
+    for( ; end - p >= 3; p++ ) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    }
+
+    return NULL;
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline const uint8_t * startcode_FindZeroPair_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+
+    for( ; end - p >= 32 + 1; p += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *) &p[0] );
+        __m256i b = _mm256_loadu_si256( (const __m256i *) &p[1] );
+        __m256i res = _mm256_and_si256( _mm256_cmpeq_epi8( a, zeros ),
+                                        _mm256_cmpeq_epi8( b, zeros ) );
+        uint32_t match = _mm256_movemask_epi8( res );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+
+    for( ; end - p >= 2; p++ ) {
+        if (p[0] == 0 && p[1] == 0)
+            return p;
+    }
+
+    return NULL;
+}
+
+#endif
+
+#ifdef STARTCODE_NEON
+
+/* NEON has no movemask: narrowing each 16 bits lane by 4 bits packs the
+ * comparison result in a 64 bits mask with 4 bits per byte */
+static inline uint64_t startcode_MaskNEON( uint8x16_t res )
+{
+    uint8x8_t narrow = vshrn_n_u16( vreinterpretq_u16_u8( res ), 4 );
+    return vget_lane_u64( vreinterpret_u64_u8( narrow ), 0 );
+}
+
+static inline const uint8_t * startcode_FindAnnexB_NEON( const uint8_t *p, const uint8_t *end )
+{
+    const uint8x16_t zeros = vdupq_n_u8( 0x00 );
+    const uint8x16_t ones = vdupq_n_u8( 0x01 );
+
+    for( ; end - p >= 16 + 2; p += 16 )
+    {
+        uint8x16_t res = vandq_u8( vceqq_u8( vld1q_u8( &p[0] ), zeros ),
+                                   vceqq_u8( vld1q_u8( &p[1] ), zeros ) );
+        res = vandq_u8( res, vceqq_u8( vld1q_u8( &p[2] ), ones ) );
+        uint64_t match = startcode_MaskNEON( res );
+        if( match )
+            return p + vlc_ctzll( match ) / 4;
+    }
+
+    for( ; end - p >= 3; p++ ) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    }
+
+    return NULL;
+}
+
+static inline const uint8_t * startcode_FindZeroPair_NEON( const uint8_t *p, const uint8_t *end )
+{
+    const uint8x16_t zeros = vdupq_n_u8( 0x00 );
+
+    for( ; end - p >= 16 + 1; p += 16 )
+    {
+        uint8x16_t res = vandq_u8( vceqq_u8( vld1q_u8( &p[0] ), zeros ),
+                                   vceqq_u8( vld1q_u8( &p[1] ), zeros ) );
+        uint64_t match = startcode_MaskNEON( res );
+        if( match )
+            return p + vlc_ctzll( match ) / 4;
+    }
+
+    for( ; end - p >= 2; p++ ) {
+        if (p[0] == 0 && p[1] == 0)
+            return p;
+    }
+
+    return NULL;
+}
+
+#endif
+
+/* Looks up for two consecutive zero bytes, which start any startcode and
+ * emulation prevention sequence. Returns the first of them, or NULL. */
+static inline const uint8_t * startcode_FindZeroPair_Bits( const uint8_t *p, const uint8_t *end )
+{
+    const uint8_t *a = p + 4 - ((intptr_t)p & 3);
+
+    for( ; p < a && end - p >= 2; p++ ) {
+        if (p[0] == 0 && p[1] == 0)
+            return p;
+    }
+
+    for( ; end - p >= 4 + 1; p += 4 ) {
+        uint32_t x = *(const uint32_t*)p;
+        if ((x - 0x01010101) & (~x) & 0x80808080)
+        {
+            for( unsigned i = 0; i < 4; i++ )
+                if (p[i] == 0 && p[i + 1] == 0)
+                    return p + i;
+        }
+    }
+
+    for( ; end - p >= 2; p++ ) {
+        if (p[0] == 0 && p[1] == 0)
+            return p;
+    }
+
+    return NULL;
+}
+
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS) || \
+    defined(HAVE_AVX2_INTRINSICS) || defined(STARTCODE_NEON)
 static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
 {
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2())
+        return startcode_FindAnnexB_AVX2(p, end);
+#endif
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
     if (vlc_CPU_SSE2())
         return startcode_FindAnnexB_SSE2(p, end);
-    else
-        return startcode_FindAnnexB_Bits(p, end);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        return startcode_FindAnnexB_NEON(p, end);
+#endif
+    return startcode_FindAnnexB_Bits(p, end);
 }
 #else
     #define startcode_FindAnnexB startcode_FindAnnexB_Bits
 #endif
 
+#if defined(HAVE_AVX2_INTRINSICS) || defined(STARTCODE_NEON)
+static inline const uint8_t * startcode_FindZeroPair( const uint8_t *p, const uint8_t *end )
+{
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2())
+        return startcode_FindZeroPair_AVX2(p, end);
+#endif
+#ifdef STARTCODE_NEON
+    if (vlc_CPU_ARM_NEON())
+        return startcode_FindZeroPair_NEON(p, end);
+#endif
+    return startcode_FindZeroPair_Bits(p, end);
+}
+#else
+    #define startcode_FindZeroPair startcode_FindZeroPair_Bits
+#endif
+
 #endif
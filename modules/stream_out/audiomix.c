@@ -0,0 +1,789 @@
+/*****************************************************************************
+ * audiomix.c: multi-stream audio mixer stream output module
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_aout.h>
+#include <vlc_meta.h>
+#include <vlc_modules.h>
+#include <vlc_arrays.h>
+#include <vlc_charset.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define RATE_TEXT N_("Mixer sample rate")
+#define RATE_LONGTEXT N_( \
+    "Sample rate all the inputs are resampled to before being mixed." )
+
+#define CHANNELS_TEXT N_("Mixer channels")
+#define CHANNELS_LONGTEXT N_( \
+    "Number of channels of the mixed output (1, 2 or 6)." )
+
+#define GAIN_TEXT N_("Input gains")
+#define GAIN_LONGTEXT N_( \
+    "Colon separated list of linear gains applied to the audio " \
+    "elementary streams, in the order they are added (ex: 1.0:0.5:0.5). " \
+    "Inputs without an explicit gain use 1.0." )
+
+#define LATENCY_TEXT N_("Mixer latency (ms)")
+#define LATENCY_LONGTEXT N_( \
+    "Maximum time the mixer waits for late inputs before mixing them " \
+    "as silence." )
+
+#define FRAME_TEXT N_("Frame length (ms)")
+#define FRAME_LONGTEXT N_( \
+    "Duration of each mixed output block." )
+
+static const int pi_channels[] = { 1, 2, 6 };
+static const char *const ppsz_channels[] = { "1", "2", "6" };
+
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define SOUT_CFG_PREFIX "sout-audiomix-"
+
+vlc_module_begin()
+    set_shortname( N_("Audio mixer") )
+    set_description( N_("Multi-stream audio mixer stream output") )
+    set_help( N_("Decodes every audio elementary stream, resamples them to "
+                 "a common format and sums them into a single FL32 stream. "
+                 "Use #audiomix:display to play the mix through the audio "
+                 "output, or #audiomix:transcode{...} to encode it.") )
+    set_capability( "sout stream", 0 )
+    add_shortcut( "audiomix" )
+    set_category( CAT_SOUT )
+    set_subcategory( SUBCAT_SOUT_STREAM )
+
+    add_integer( SOUT_CFG_PREFIX "rate", 48000, RATE_TEXT, RATE_LONGTEXT,
+                 false )
+    add_integer( SOUT_CFG_PREFIX "channels", 2, CHANNELS_TEXT,
+                 CHANNELS_LONGTEXT, false )
+        change_integer_list( pi_channels, ppsz_channels )
+    add_string( SOUT_CFG_PREFIX "gain", NULL, GAIN_TEXT, GAIN_LONGTEXT,
+                false )
+    add_integer( SOUT_CFG_PREFIX "latency", 200, LATENCY_TEXT,
+                 LATENCY_LONGTEXT, true )
+    add_integer_with_range( SOUT_CFG_PREFIX "frame", 20, 5, 100,
+                            FRAME_TEXT, FRAME_LONGTEXT, true )
+
+    set_callbacks( Open, Close )
+vlc_module_end()
+
+static const char *const ppsz_sout_options[] = {
+    "rate", "channels", "gain", "latency", "frame", NULL
+};
+
+/* Maximum tolerated gap or overlap between two decoded buffers of the same
+ * input before the input timeline is corrected */
+#define MIX_SYNC_TOLERANCE VLC_TICK_FROM_MS(20)
+
+/*****************************************************************************
+ * Local structures
+ *****************************************************************************/
+typedef struct sout_stream_id_sys_t sout_stream_id_sys_t;
+
+struct decoder_owner
+{
+    decoder_t dec;
+    sout_stream_id_sys_t *id;
+};
+
+static inline struct decoder_owner *dec_get_owner( decoder_t *p_dec )
+{
+    return container_of( p_dec, struct decoder_owner, dec );
+}
+
+struct sout_stream_id_sys_t
+{
+    /* Non audio ES are passed through untouched */
+    void           *downstream_id;
+
+    decoder_t      *p_decoder;
+    block_t        *p_decoded;
+    block_t       **pp_decoded_last;
+
+    /* Conversion from the decoder output to the mixer format */
+    aout_filters_t *p_filters;
+    audio_sample_format_t filters_in;
+
+    float           f_gain;
+
+    /* Converted samples waiting to be mixed, interleaved FL32 */
+    float          *p_samples;
+    size_t          i_samples; /* in frames */
+    size_t          i_alloc;   /* in frames */
+    vlc_tick_t      i_start;   /* date of p_samples[0] */
+    bool            b_discontinuity; /* flagged by the last input block */
+};
+
+typedef struct
+{
+    audio_sample_format_t fmt;
+    unsigned        i_frame_length;
+    vlc_tick_t      i_latency;
+
+    float          *pf_gains;
+    size_t          i_gains;
+    size_t          i_next_gain;
+
+    int                    i_inputs;
+    sout_stream_id_sys_t **pp_inputs;
+
+    void           *out_id;
+    date_t          out_date;
+    bool            b_started;
+} sout_stream_sys_t;
+
+static void *Add( sout_stream_t *, const es_format_t * );
+static void  Del( sout_stream_t *, void * );
+static int   Send( sout_stream_t *, void *, block_t * );
+static void  Flush( sout_stream_t *, void * );
+
+/*****************************************************************************
+ * Mixing kernel
+ *****************************************************************************/
+
+/**
+ * Accumulates a scaled input into the mix.
+ *
+ * The loop has no dependency between iterations and the pointers cannot
+ * alias, so it is vectorised by the compiler on all SIMD targets.
+ */
+static void MixFL32( float *restrict dst, const float *restrict src,
+                     size_t i_count, float f_gain )
+{
+    if( f_gain == 1.f )
+    {
+        for( size_t i = 0; i < i_count; i++ )
+            dst[i] += src[i];
+    }
+    else
+    {
+        for( size_t i = 0; i < i_count; i++ )
+            dst[i] += f_gain * src[i];
+    }
+}
+
+/*****************************************************************************
+ * Input queue
+ *****************************************************************************/
+static int InputReserve( sout_stream_id_sys_t *id, size_t i_frames,
+                         unsigned i_channels )
+{
+    if( id->i_samples + i_frames <= id->i_alloc )
+        return VLC_SUCCESS;
+
+    size_t i_alloc = __MAX( id->i_alloc * 2, id->i_samples + i_frames );
+    float *p = realloc( id->p_samples,
+                        i_alloc * i_channels * sizeof(*p) );
+    if( unlikely(p == NULL) )
+        return VLC_ENOMEM;
+    id->p_samples = p;
+    id->i_alloc = i_alloc;
+    return VLC_SUCCESS;
+}
+
+static void InputConsume( sout_stream_id_sys_t *id, size_t i_frames,
+                          unsigned i_channels, unsigned i_rate )
+{
+    if( i_frames >= id->i_samples )
+    {
+        id->i_start += vlc_tick_from_samples( id->i_samples, i_rate );
+        id->i_samples = 0;
+        return;
+    }
+    memmove( id->p_samples, &id->p_samples[i_frames * i_channels],
+             (id->i_samples - i_frames) * i_channels * sizeof(float) );
+    id->i_samples -= i_frames;
+    id->i_start += vlc_tick_from_samples( i_frames, i_rate );
+}
+
+static vlc_tick_t InputEnd( const sout_stream_id_sys_t *id, unsigned i_rate )
+{
+    return id->i_start + vlc_tick_from_samples( id->i_samples, i_rate );
+}
+
+static void InputPush( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                       block_t *p_block )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const unsigned i_channels = p_sys->fmt.i_channels;
+    const unsigned i_rate = p_sys->fmt.i_rate;
+    const float *p_src = (const float *)p_block->p_buffer;
+    size_t i_frames = p_block->i_nb_samples;
+    /* Gaps are filled with silence up to the mixer latency */
+    const vlc_tick_t i_max_gap = __MAX( p_sys->i_latency, MIX_SYNC_TOLERANCE );
+    bool b_discontinuity = false;
+
+    if( p_block->i_pts != VLC_TICK_INVALID &&
+        ( id->b_discontinuity ||
+          ( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY ) ) )
+    {
+        id->b_discontinuity = false;
+        b_discontinuity = true;
+    }
+    else if( p_block->i_pts != VLC_TICK_INVALID && id->i_samples > 0 )
+    {
+        vlc_tick_t i_drift = p_block->i_pts - InputEnd( id, i_rate );
+        if( i_drift > i_max_gap || i_drift < -i_max_gap )
+        {
+            msg_Dbg( p_stream, "input timestamps jumped by %"PRId64" ms",
+                     MS_FROM_VLC_TICK( i_drift ) );
+            b_discontinuity = true;
+        }
+    }
+
+    if( b_discontinuity )
+    {
+        /* Restart the input timeline, the mixer follows (see Mix()) */
+        id->i_samples = 0;
+        id->i_start = p_block->i_pts;
+    }
+    else if( id->i_samples == 0 )
+    {
+        if( p_block->i_pts != VLC_TICK_INVALID )
+            id->i_start = p_block->i_pts;
+    }
+    else if( p_block->i_pts != VLC_TICK_INVALID )
+    {
+        /* Keep the input timeline consistent with its timestamps */
+        vlc_tick_t i_drift = p_block->i_pts - InputEnd( id, i_rate );
+
+        if( i_drift > MIX_SYNC_TOLERANCE )
+        {
+            size_t i_silence = samples_from_vlc_tick( i_drift, i_rate );
+            if( InputReserve( id, i_silence, i_channels ) == VLC_SUCCESS )
+            {
+                memset( &id->p_samples[id->i_samples * i_channels], 0,
+                        i_silence * i_channels * sizeof(float) );
+                id->i_samples += i_silence;
+            }
+        }
+        else if( i_drift < -MIX_SYNC_TOLERANCE )
+        {
+            size_t i_drop = samples_from_vlc_tick( -i_drift, i_rate );
+            if( i_drop >= i_frames )
+                goto out;
+            p_src += i_drop * i_channels;
+            i_frames -= i_drop;
+        }
+    }
+
+    /* Anything older than the mixer clock has already been mixed */
+    if( p_sys->b_started && id->i_samples == 0 && !b_discontinuity )
+    {
+        vlc_tick_t i_now = date_Get( &p_sys->out_date );
+        if( id->i_start < i_now )
+        {
+            size_t i_drop = samples_from_vlc_tick( i_now - id->i_start,
+                                                   i_rate );
+            if( i_drop >= i_frames )
+                goto out;
+            p_src += i_drop * i_channels;
+            i_frames -= i_drop;
+            id->i_start = i_now;
+        }
+    }
+
+    if( InputReserve( id, i_frames, i_channels ) )
+        goto out;
+    memcpy( &id->p_samples[id->i_samples * i_channels], p_src,
+            i_frames * i_channels * sizeof(float) );
+    id->i_samples += i_frames;
+out:
+    block_Release( p_block );
+}
+
+/*****************************************************************************
+ * Mixer
+ *****************************************************************************/
+static bool MixReady( sout_stream_sys_t *p_sys, vlc_tick_t i_end )
+{
+    vlc_tick_t i_max = VLC_TICK_INVALID;
+    bool b_all = true;
+
+    for( int i = 0; i < p_sys->i_inputs; i++ )
+    {
+        const sout_stream_id_sys_t *id = p_sys->pp_inputs[i];
+        if( id->i_samples == 0 )
+        {
+            b_all = false;
+            continue;
+        }
+        vlc_tick_t i_input_end = InputEnd( id, p_sys->fmt.i_rate );
+        if( i_input_end < i_end )
+            b_all = false;
+        if( i_max == VLC_TICK_INVALID || i_input_end > i_max )
+            i_max = i_input_end;
+    }
+
+    if( i_max == VLC_TICK_INVALID )
+        return false;
+    /* Do not wait forever for a stalled input */
+    return b_all || i_max >= i_end + p_sys->i_latency;
+}
+
+/* Earliest queued sample of all the inputs */
+static vlc_tick_t MixFirst( const sout_stream_sys_t *p_sys )
+{
+    vlc_tick_t i_first = VLC_TICK_INVALID;
+
+    for( int i = 0; i < p_sys->i_inputs; i++ )
+    {
+        const sout_stream_id_sys_t *id = p_sys->pp_inputs[i];
+        if( id->i_samples > 0 &&
+            ( i_first == VLC_TICK_INVALID || id->i_start < i_first ) )
+            i_first = id->i_start;
+    }
+    return i_first;
+}
+
+static void Mix( sout_stream_t *p_stream )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const unsigned i_channels = p_sys->fmt.i_channels;
+    const unsigned i_rate = p_sys->fmt.i_rate;
+    const size_t i_frame = p_sys->i_frame_length;
+
+    if( !p_sys->b_started )
+    {
+        vlc_tick_t i_first = MixFirst( p_sys );
+        if( i_first == VLC_TICK_INVALID )
+            return;
+        date_Init( &p_sys->out_date, i_rate, 1 );
+        date_Set( &p_sys->out_date, i_first );
+        p_sys->b_started = true;
+    }
+
+    for( ;; )
+    {
+        vlc_tick_t i_pts = date_Get( &p_sys->out_date );
+        vlc_tick_t i_end = i_pts + vlc_tick_from_samples( i_frame, i_rate );
+
+        if( !MixReady( p_sys, i_end ) )
+            break;
+
+        /* Jump to the inputs, or back to an earlier discontinuity, rather
+         * than mixing more than the latency worth of silence */
+        vlc_tick_t i_first = MixFirst( p_sys );
+        if( i_first > i_pts + p_sys->i_latency ||
+            i_first < i_pts - p_sys->i_latency )
+        {
+            date_Set( &p_sys->out_date, i_first );
+            continue;
+        }
+
+        block_t *p_out = block_Alloc( i_frame * i_channels * sizeof(float) );
+        if( unlikely(p_out == NULL) )
+            break;
+
+        float *p_dst = (float *)p_out->p_buffer;
+        memset( p_dst, 0, p_out->i_buffer );
+
+        for( int i = 0; i < p_sys->i_inputs; i++ )
+        {
+            sout_stream_id_sys_t *id = p_sys->pp_inputs[i];
+            if( id->i_samples == 0 )
+                continue;
+
+            /* Position of the mix window within the input queue */
+            int64_t i_offset = samples_from_vlc_tick( i_pts - id->i_start,
+                                                      i_rate );
+            size_t i_dst = i_offset < 0 ? -i_offset : 0;
+            size_t i_src = i_offset > 0 ? i_offset : 0;
+
+            if( i_dst < i_frame && i_src < id->i_samples )
+            {
+                size_t i_count = __MIN( i_frame - i_dst,
+                                        id->i_samples - i_src );
+                MixFL32( &p_dst[i_dst * i_channels],
+                         &id->p_samples[i_src * i_channels],
+                         i_count * i_channels, id->f_gain );
+            }
+
+            if( i_offset + (int64_t)i_frame > 0 )
+                InputConsume( id, i_offset + i_frame, i_channels, i_rate );
+        }
+
+        p_out->i_nb_samples = i_frame;
+        p_out->i_pts = p_out->i_dts = i_pts;
+        p_out->i_length = i_end - i_pts;
+        date_Increment( &p_sys->out_date, i_frame );
+
+        if( p_sys->out_id == NULL )
+        {
+            es_format_t fmt;
+            es_format_Init( &fmt, AUDIO_ES, VLC_CODEC_FL32 );
+            fmt.audio = p_sys->fmt;
+            fmt.i_bitrate = i_rate * i_channels * 32;
+            p_sys->out_id = sout_StreamIdAdd( p_stream->p_next, &fmt );
+            es_format_Clean( &fmt );
+        }
+
+        if( p_sys->out_id != NULL )
+            sout_StreamIdSend( p_stream->p_next, p_sys->out_id, p_out );
+        else
+            block_Release( p_out );
+    }
+}
+
+/*****************************************************************************
+ * Decoder
+ *****************************************************************************/
+static int audio_update_format( decoder_t *p_dec )
+{
+    if( !AOUT_FMT_LINEAR(&p_dec->fmt_out.audio) )
+        return VLC_EGENERIC;
+
+    p_dec->fmt_out.audio.i_format = p_dec->fmt_out.i_codec;
+    aout_FormatPrepare( &p_dec->fmt_out.audio );
+    return VLC_SUCCESS;
+}
+
+static void decoder_queue_audio( decoder_t *p_dec, block_t *p_audio )
+{
+    sout_stream_id_sys_t *id = dec_get_owner( p_dec )->id;
+
+    *id->pp_decoded_last = p_audio;
+    id->pp_decoded_last = &p_audio->p_next;
+}
+
+static block_t *Convert( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                         block_t *p_block )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const audio_sample_format_t *p_dec_out = &id->p_decoder->fmt_out.audio;
+
+    if( id->p_filters != NULL &&
+        ( id->filters_in.i_format != p_dec_out->i_format ||
+          id->filters_in.i_rate != p_dec_out->i_rate ||
+          id->filters_in.i_physical_channels !=
+                                            p_dec_out->i_physical_channels ) )
+    {
+        msg_Dbg( p_stream, "input format changed, reloading filters" );
+        aout_FiltersDelete( p_stream, id->p_filters );
+        id->p_filters = NULL;
+    }
+
+    if( id->p_filters == NULL )
+    {
+        id->filters_in = *p_dec_out;
+        id->p_filters = aout_FiltersNew( p_stream, &id->filters_in,
+                                         &p_sys->fmt, NULL, NULL );
+        if( id->p_filters == NULL )
+        {
+            msg_Err( p_stream, "cannot convert %4.4s/%uHz to the mixer format",
+                     (const char *)&p_dec_out->i_format, p_dec_out->i_rate );
+            block_Release( p_block );
+            return NULL;
+        }
+    }
+
+    p_block->i_dts = p_block->i_pts;
+    return aout_FiltersPlay( id->p_filters, p_block, 1.f );
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    sout_stream_t     *p_stream = (sout_stream_t*)p_this;
+    sout_stream_sys_t *p_sys;
+
+    if( !p_stream->p_next )
+    {
+        msg_Err( p_stream, "cannot create chain" );
+        return VLC_EGENERIC;
+    }
+
+    p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    config_ChainParse( p_stream, SOUT_CFG_PREFIX, ppsz_sout_options,
+                       p_stream->p_cfg );
+
+    p_sys->fmt.i_format = VLC_CODEC_FL32;
+    p_sys->fmt.i_rate = var_GetInteger( p_stream, SOUT_CFG_PREFIX "rate" );
+    if( p_sys->fmt.i_rate == 0 )
+        p_sys->fmt.i_rate = 48000;
+    switch( var_GetInteger( p_stream, SOUT_CFG_PREFIX "channels" ) )
+    {
+        case 1:
+            p_sys->fmt.i_physical_channels = AOUT_CHAN_CENTER;
+            break;
+        case 6:
+            p_sys->fmt.i_physical_channels = AOUT_CHANS_5_1;
+            break;
+        default:
+            p_sys->fmt.i_physical_channels = AOUT_CHANS_STEREO;
+            break;
+    }
+    aout_FormatPrepare( &p_sys->fmt );
+
+    p_sys->i_frame_length = p_sys->fmt.i_rate *
+        var_GetInteger( p_stream, SOUT_CFG_PREFIX "frame" ) / 1000;
+    p_sys->i_latency = VLC_TICK_FROM_MS(
+        var_GetInteger( p_stream, SOUT_CFG_PREFIX "latency" ) );
+
+    char *psz_gains = var_GetNonEmptyString( p_stream,
+                                             SOUT_CFG_PREFIX "gain" );
+    if( psz_gains )
+    {
+        char *psz_save, *psz_tok = strtok_r( psz_gains, ":", &psz_save );
+        for( ; psz_tok != NULL; psz_tok = strtok_r( NULL, ":", &psz_save ) )
+        {
+            float *pf = realloc( p_sys->pf_gains,
+                                 (p_sys->i_gains + 1) * sizeof(*pf) );
+            if( unlikely(pf == NULL) )
+                break;
+            p_sys->pf_gains = pf;
+            p_sys->pf_gains[p_sys->i_gains++] = us_atof( psz_tok );
+        }
+        free( psz_gains );
+    }
+
+    TAB_INIT( p_sys->i_inputs, p_sys->pp_inputs );
+
+    /* Do not let the user audio filters leak into the conversion chains */
+    var_Create( p_stream, "audio-time-stretch", VLC_VAR_BOOL );
+    var_Create( p_stream, "audio-filter", VLC_VAR_STRING );
+
+    p_stream->pf_add    = Add;
+    p_stream->pf_del    = Del;
+    p_stream->pf_send   = Send;
+    p_stream->pf_flush  = Flush;
+    p_stream->p_sys     = p_sys;
+
+    msg_Dbg( p_stream, "mixing to %uHz, %u channels, %u samples per block",
+             p_sys->fmt.i_rate, p_sys->fmt.i_channels,
+             p_sys->i_frame_length );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close( vlc_object_t * p_this )
+{
+    sout_stream_t     *p_stream = (sout_stream_t*)p_this;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    assert( p_sys->i_inputs == 0 );
+    if( p_sys->out_id != NULL )
+        sout_StreamIdDel( p_stream->p_next, p_sys->out_id );
+
+    var_Destroy( p_stream, "audio-filter" );
+    var_Destroy( p_stream, "audio-time-stretch" );
+
+    TAB_CLEAN( p_sys->i_inputs, p_sys->pp_inputs );
+    free( p_sys->pf_gains );
+    free( p_sys );
+}
+
+static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = calloc( 1, sizeof( *id ) );
+    if( unlikely(id == NULL) )
+        return NULL;
+
+    if( p_fmt->i_cat != AUDIO_ES )
+    {
+        id->downstream_id = sout_StreamIdAdd( p_stream->p_next, p_fmt );
+        if( id->downstream_id == NULL )
+        {
+            free( id );
+            return NULL;
+        }
+        return id;
+    }
+
+    struct decoder_owner *p_owner = vlc_object_create( p_stream,
+                                                       sizeof( *p_owner ) );
+    if( unlikely(p_owner == NULL) )
+    {
+        free( id );
+        return NULL;
+    }
+    p_owner->id = id;
+
+    decoder_t *p_dec = &p_owner->dec;
+    p_dec->p_module = NULL;
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, AUDIO_ES, 0 );
+    p_dec->pf_decode = NULL;
+
+    static const struct decoder_owner_callbacks dec_cbs =
+    {
+        .audio = {
+            .format_update = audio_update_format,
+            .queue = decoder_queue_audio,
+        },
+    };
+    p_dec->cbs = &dec_cbs;
+
+    p_dec->p_module = module_need_var( p_dec, "audio decoder", "codec" );
+    if( p_dec->p_module == NULL )
+    {
+        msg_Err( p_stream, "cannot find audio decoder for %4.4s",
+                 (const char *)&p_fmt->i_codec );
+        es_format_Clean( &p_dec->fmt_in );
+        es_format_Clean( &p_dec->fmt_out );
+        vlc_object_release( p_dec );
+        free( id );
+        return NULL;
+    }
+
+    id->p_decoder = p_dec;
+    id->p_decoded = NULL;
+    id->pp_decoded_last = &id->p_decoded;
+    id->f_gain = p_sys->i_next_gain < p_sys->i_gains
+               ? p_sys->pf_gains[p_sys->i_next_gain] : 1.f;
+    p_sys->i_next_gain++;
+
+    TAB_APPEND( p_sys->i_inputs, p_sys->pp_inputs, id );
+
+    msg_Dbg( p_stream, "mixing ES %d (%4.4s) with gain %f", p_fmt->i_id,
+             (const char *)&p_fmt->i_codec, id->f_gain );
+    return id;
+}
+
+static void Del( sout_stream_t *p_stream, void *_id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = _id;
+
+    if( id->p_decoder == NULL )
+    {
+        sout_StreamIdDel( p_stream->p_next, id->downstream_id );
+        free( id );
+        return;
+    }
+
+    TAB_REMOVE( p_sys->i_inputs, p_sys->pp_inputs, id );
+
+    decoder_t *p_dec = id->p_decoder;
+    module_unneed( p_dec, p_dec->p_module );
+    if( p_dec->p_description )
+        vlc_meta_Delete( p_dec->p_description );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    vlc_object_release( p_dec );
+
+    block_ChainRelease( id->p_decoded );
+    if( id->p_filters != NULL )
+        aout_FiltersDelete( p_stream, id->p_filters );
+    free( id->p_samples );
+    free( id );
+
+    /* The remaining inputs no longer have to wait for this one */
+    Mix( p_stream );
+}
+
+static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
+{
+    sout_stream_id_sys_t *id = _id;
+
+    if( id->p_decoder == NULL )
+        return sout_StreamIdSend( p_stream->p_next, id->downstream_id,
+                                  p_buffer );
+
+    while( p_buffer != NULL )
+    {
+        block_t *p_next = p_buffer->p_next;
+        p_buffer->p_next = NULL;
+
+        if( p_buffer->i_flags & BLOCK_FLAG_DISCONTINUITY )
+            id->b_discontinuity = true;
+        if( id->p_decoder->pf_decode( id->p_decoder, p_buffer )
+                                                            != VLCDEC_SUCCESS )
+        {
+            block_ChainRelease( p_next );
+            return VLC_EGENERIC;
+        }
+        p_buffer = p_next;
+    }
+
+    block_t *p_decoded = id->p_decoded;
+    id->p_decoded = NULL;
+    id->pp_decoded_last = &id->p_decoded;
+
+    while( p_decoded != NULL )
+    {
+        block_t *p_next = p_decoded->p_next;
+        p_decoded->p_next = NULL;
+
+        block_t *p_mixable = Convert( p_stream, id, p_decoded );
+        if( p_mixable != NULL )
+            InputPush( p_stream, id, p_mixable );
+        p_decoded = p_next;
+    }
+
+    Mix( p_stream );
+    return VLC_SUCCESS;
+}
+
+static void Flush( sout_stream_t *p_stream, void *_id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_sys_t *id = _id;
+
+    if( id->p_decoder == NULL )
+    {
+        sout_StreamFlush( p_stream->p_next, id->downstream_id );
+        return;
+    }
+
+    if( id->p_decoder->pf_flush != NULL )
+        id->p_decoder->pf_flush( id->p_decoder );
+    block_ChainRelease( id->p_decoded );
+    id->p_decoded = NULL;
+    id->pp_decoded_last = &id->p_decoded;
+    if( id->p_filters != NULL )
+        aout_FiltersFlush( id->p_filters );
+    id->i_samples = 0;
+    id->b_discontinuity = false;
+
+    /* Restart the mix timeline from the next input timestamps, whether the
+     * input seeked backward or forward */
+    if( p_sys->b_started )
+    {
+        p_sys->b_started = false;
+        date_Set( &p_sys->out_date, VLC_TICK_INVALID );
+        if( p_sys->out_id != NULL )
+            sout_StreamFlush( p_stream->p_next, p_sys->out_id );
+    }
+}
@@ -27,6 +27,7 @@
 # include <stdatomic.h>
 
 # include <vlc_viewpoint.h>
+# include <vlc_input_item.h>
 
 /* Max input rate factor (1/4 -> 4) */
 # define AOUT_MAX_INPUT_RATE (4)
@@ -74,9 +75,20 @@ typedef struct
         float rate; /**< Play-out speed rate */
         vlc_tick_t resamp_start_drift; /**< Resampler drift absolute value */
         int resamp_type; /**< Resampler mode (FIXME: redundant / resampling) */
+        int resampling; /**< Current resampling (Hz) */
         bool discontinuity;
     } sync;
 
+    struct
+    {
+        atomic_uint drift[INPUT_STATS_HISTOGRAM_SIZE];
+        atomic_uint latency[INPUT_STATS_HISTOGRAM_SIZE];
+        atomic_uint resampled;
+        atomic_uint silences;
+        atomic_uint flushes;
+        atomic_int resampling; /**< Copy of sync.resampling (Hz) */
+    } stats;
+
     int requested_stereo_mode; /**< Requested stereo mode set by the user */
 
     audio_sample_format_t input_format;
@@ -141,6 +153,23 @@ int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
 void aout_DecDelete(audio_output_t *);
 int aout_DecPlay(audio_output_t *aout, block_t *block);
 void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *);
+
+/** Audio output synchronization statistics */
+struct aout_sync_stats
+{
+    unsigned drift[INPUT_STATS_HISTOGRAM_SIZE]; /**< A/V drift histogram */
+    unsigned latency[INPUT_STATS_HISTOGRAM_SIZE]; /**< Output delay histogram */
+    unsigned resampled; /**< Buffers played while resampling */
+    unsigned silences; /**< Silence insertions */
+    unsigned flushes; /**< Flushes of late buffers */
+    float resampling; /**< Current resampling ratio */
+    float loudness_momentary; /**< Momentary loudness (NaN if unknown) */
+    float loudness_shortterm; /**< Short-term loudness (NaN if unknown) */
+    float loudness_integrated; /**< Integrated loudness (NaN if unknown) */
+    float loudness_true_peak; /**< True peak level (NaN if unknown) */
+};
+
+void aout_DecGetResetSyncStats(audio_output_t *, struct aout_sync_stats *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, vlc_tick_t i_date);
 void aout_DecChangeRate(audio_output_t *aout, float rate);
 void aout_DecFlush(audio_output_t *, bool wait);
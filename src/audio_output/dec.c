@@ -103,10 +103,20 @@ error:
     owner->sync.rate = 1.f;
     owner->sync.end = VLC_TICK_INVALID;
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+    owner->sync.resampling = 0;
     owner->sync.discontinuity = true;
 
     atomic_init (&owner->buffers_lost, 0);
     atomic_init (&owner->buffers_played, 0);
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++)
+    {
+        atomic_init (&owner->stats.drift[i], 0);
+        atomic_init (&owner->stats.latency[i], 0);
+    }
+    atomic_init (&owner->stats.resampled, 0);
+    atomic_init (&owner->stats.silences, 0);
+    atomic_init (&owner->stats.flushes, 0);
+    atomic_init (&owner->stats.resampling, 0);
     atomic_store_explicit(&owner->vp.update, true, memory_order_relaxed);
     return 0;
 }
@@ -162,6 +172,9 @@ static int aout_CheckReady (audio_output_t *aout)
         msg_Dbg (aout, "restarting filters...");
         owner->sync.end = VLC_TICK_INVALID;
         owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+        owner->sync.resampling = 0;
+        atomic_store_explicit(&owner->stats.resampling, 0,
+                              memory_order_relaxed);
 
         if (owner->mixer_format.i_format)
         {
@@ -193,6 +206,49 @@ void aout_RequestRestart (audio_output_t *aout, unsigned mode)
     msg_Dbg (aout, "restart requested (%u)", mode);
 }
 
+/*
+ * Statistics
+ */
+
+/** Returns the histogram bin of a non-negative duration */
+static unsigned aout_StatsBin (vlc_tick_t duration, unsigned bins)
+{
+    uint64_t ms = MS_FROM_VLC_TICK(duration);
+    unsigned bin = 0;
+
+    while (ms > 0 && bin < bins - 1)
+    {
+        ms >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+static void aout_StatsAddSync (aout_owner_t *owner, vlc_tick_t delay,
+                               vlc_tick_t drift)
+{
+    const unsigned half = INPUT_STATS_HISTOGRAM_SIZE / 2;
+    unsigned bin;
+
+    if (drift >= 0)
+        bin = half + aout_StatsBin (drift, half);
+    else
+        bin = half - 1 - aout_StatsBin (-drift, half);
+
+    atomic_fetch_add_explicit(&owner->stats.drift[bin], 1,
+                              memory_order_relaxed);
+    bin = aout_StatsBin (delay > 0 ? delay : 0, INPUT_STATS_HISTOGRAM_SIZE);
+    atomic_fetch_add_explicit(&owner->stats.latency[bin], 1,
+                              memory_order_relaxed);
+}
+
+static void aout_StatsSetResampling (aout_owner_t *owner, int resampling)
+{
+    owner->sync.resampling = resampling;
+    atomic_store_explicit(&owner->stats.resampling, resampling,
+                          memory_order_relaxed);
+}
+
 /*
  * Buffer management
  */
@@ -203,6 +259,7 @@ static void aout_StopResampling (audio_output_t *aout)
 
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
     aout_FiltersAdjustResampling (owner->filters, 0);
+    aout_StatsSetResampling (owner, 0);
 }
 
 static void aout_DecSilence (audio_output_t *aout, vlc_tick_t length, vlc_tick_t pts)
@@ -217,6 +274,7 @@ static void aout_DecSilence (audio_output_t *aout, vlc_tick_t length, vlc_tick_t
         return; /* uho! */
 
     msg_Dbg (aout, "inserting %zu zeroes", frames);
+    atomic_fetch_add_explicit(&owner->stats.silences, 1, memory_order_relaxed);
     memset (block->p_buffer, 0, block->i_buffer);
     block->i_nb_samples = frames;
     block->i_pts = pts;
@@ -229,7 +287,7 @@ static void aout_DecSynchronize(audio_output_t *aout, vlc_tick_t dec_pts)
 {
     aout_owner_t *owner = aout_owner (aout);
     const float rate = owner->sync.rate;
-    vlc_tick_t drift;
+    vlc_tick_t delay, drift;
 
     /**
      * Depending on the drift between the actual and intended playback times,
@@ -247,9 +305,10 @@ static void aout_DecSynchronize(audio_output_t *aout, vlc_tick_t dec_pts)
      * all samples in the buffer will have been played. Then:
      *    pts = vlc_tick_now() + delay
      */
-    if (aout->time_get(aout, &drift) != 0)
+    if (aout->time_get(aout, &delay) != 0)
         return; /* nothing can be done if timing is unknown */
-    drift += vlc_tick_now () - dec_pts;
+    drift = delay + vlc_tick_now () - dec_pts;
+    aout_StatsAddSync (owner, delay, drift);
 
     /* Late audio output.
      * This can happen due to insufficient caching, scheduling jitter
@@ -267,6 +326,8 @@ static void aout_DecSynchronize(audio_output_t *aout, vlc_tick_t dec_pts)
             msg_Dbg (aout, "playback too late (%"PRId64"): "
                      "flushing buffers", drift);
         aout->flush(aout, false);
+        atomic_fetch_add_explicit(&owner->stats.flushes, 1,
+                                  memory_order_relaxed);
 
         aout_StopResampling (aout);
         owner->sync.end = VLC_TICK_INVALID;
@@ -339,8 +400,11 @@ static void aout_DecSynchronize(audio_output_t *aout, vlc_tick_t dec_pts)
     if (!aout_FiltersAdjustResampling (owner->filters, adj))
     {   /* Everything is back to normal: stop resampling. */
         owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+        aout_StatsSetResampling (owner, 0);
         msg_Dbg (aout, "resampling stopped (drift: %"PRId64" us)", drift);
     }
+    else
+        aout_StatsSetResampling (owner, owner->sync.resampling + adj);
 }
 
 /*****************************************************************************
@@ -385,6 +449,9 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
     owner->sync.discontinuity = false;
     aout->play(aout, block, block->i_pts);
     atomic_fetch_add_explicit(&owner->buffers_played, 1, memory_order_relaxed);
+    if (owner->sync.resampling != 0)
+        atomic_fetch_add_explicit(&owner->stats.resampled, 1,
+                                  memory_order_relaxed);
     return ret;
 drop:
     owner->sync.discontinuity = true;
@@ -405,6 +472,47 @@ void aout_DecGetResetStats(audio_output_t *aout, unsigned *restrict lost,
                                        memory_order_relaxed);
 }
 
+void aout_DecGetResetSyncStats(audio_output_t *aout,
+                               struct aout_sync_stats *restrict stats)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++)
+    {
+        stats->drift[i] = atomic_exchange_explicit(&owner->stats.drift[i], 0,
+                                                   memory_order_relaxed);
+        stats->latency[i] = atomic_exchange_explicit(&owner->stats.latency[i],
+                                                     0, memory_order_relaxed);
+    }
+    stats->resampled = atomic_exchange_explicit(&owner->stats.resampled, 0,
+                                                memory_order_relaxed);
+    stats->silences = atomic_exchange_explicit(&owner->stats.silences, 0,
+                                               memory_order_relaxed);
+    stats->flushes = atomic_exchange_explicit(&owner->stats.flushes, 0,
+                                              memory_order_relaxed);
+
+    /* The resampler plays the input as if its rate was offset by the
+     * resampling (see aout_FiltersPlay()). */
+    int resampling = atomic_load_explicit(&owner->stats.resampling,
+                                          memory_order_relaxed);
+    unsigned rate = owner->input_format.i_rate;
+
+    stats->resampling = rate ? (float)(rate + resampling) / rate : 1.f;
+
+    /* Published by the loudness filter, if any */
+    if (var_Type(aout, "loudness-integrated") != 0)
+    {
+        stats->loudness_momentary = var_GetFloat(aout, "loudness-momentary");
+        stats->loudness_shortterm = var_GetFloat(aout, "loudness-short-term");
+        stats->loudness_integrated = var_GetFloat(aout, "loudness-integrated");
+        stats->loudness_true_peak = var_GetFloat(aout,
+                                                 "loudness-true-peak-level");
+    }
+    else
+        stats->loudness_momentary = stats->loudness_shortterm =
+        stats->loudness_integrated = stats->loudness_true_peak = NAN;
+}
+
 void aout_DecChangePause (audio_output_t *aout, bool paused, vlc_tick_t date)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -63,6 +63,16 @@ enum reload
     RELOAD_DECODER_AOUT /* Stop the aout and reload the decoder module */
 };
 
+/* Packetized data handed from the decoder thread to the decoding stage */
+struct decoder_stage_unit
+{
+    block_t     *p_chain;
+    es_format_t *p_fmt; /* new decoder input format, or NULL */
+    bool         b_drain;
+};
+
+#define DECODER_STAGE_SIZE 8
+
 struct decoder_owner
 {
     decoder_t        dec;
@@ -111,6 +121,9 @@ struct decoder_owner
     /* -- Theses variables need locking on read *and* write -- */
     /* Preroll */
     vlc_tick_t i_preroll_end;
+    vlc_tick_t i_preroll_last; /* end of the last input block in preroll */
+    bool       b_preroll_skip; /* constant */
+    bool       b_keyframes_only; /* constant, thumbnailing */
     /* Pause & Rate */
     bool reset_out_state;
     vlc_tick_t pause_date;
@@ -131,6 +144,24 @@ struct decoder_owner
     atomic_bool drained;
     bool b_idle;
 
+    /* Decoding stage, when the packetizer runs alone on the decoder thread.
+     * fmt and fmt_lost belong to the decoder thread, enabled is constant once
+     * the threads run, the rest is protected by the fifo lock. */
+    struct
+    {
+        bool         enabled;
+        bool         busy;
+        bool         closing;
+        bool         fmt_lost;
+        vlc_thread_t thread;
+        vlc_cond_t   wait;       /* units to decode */
+        vlc_cond_t   wait_space; /* units decoded */
+        es_format_t  fmt;        /* last format sent, decoder thread only */
+        struct decoder_stage_unit units[DECODER_STAGE_SIZE];
+        unsigned     first;
+        unsigned     count;
+    } stage;
+
     /* CC */
 #define MAX_CC_DECODERS 64 /* The es_out only creates one type of es */
     struct
@@ -630,12 +661,28 @@ static int vout_update_format( decoder_t *p_dec )
     return 0;
 }
 
+static struct input_stats *DecoderGetStats( struct decoder_owner *p_owner )
+{
+    input_thread_t *p_input = p_owner->p_input;
+
+    return p_input != NULL ? input_priv(p_input)->stats : NULL;
+}
+
 static picture_t *vout_new_buffer( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    struct input_stats *stats = DecoderGetStats( p_owner );
     assert( p_owner->p_vout );
 
-    return vout_GetPicture( p_owner->p_vout );
+    if( stats == NULL )
+        return vout_GetPicture( p_owner->p_vout );
+
+    /* May be called from the decoder module threads */
+    vlc_tick_t i_start = vlc_tick_now();
+    picture_t *p_picture = vout_GetPicture( p_owner->p_vout );
+    input_stats_AddHistogram( stats->picture_wait,
+                              MS_FROM_VLC_TICK( vlc_tick_now() - i_start ) );
+    return p_picture;
 }
 
 static subpicture_t *spu_new_buffer( decoder_t *p_dec,
@@ -803,18 +850,35 @@ static int DecoderTimedWait( decoder_t *p_dec, vlc_tick_t deadline )
         return VLC_SUCCESS;
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    while( !p_owner->flushing
+    while( !p_owner->flushing && !p_owner->stage.closing
         && vlc_fifo_TimedWaitCond( p_owner->p_fifo, &p_owner->wait_timed,
                                    deadline ) == 0 );
-    int ret = p_owner->flushing ? VLC_EGENERIC : VLC_SUCCESS;
+    int ret = p_owner->flushing || p_owner->stage.closing ? VLC_EGENERIC
+                                                         : VLC_SUCCESS;
     vlc_fifo_Unlock( p_owner->p_fifo );
     return ret;
 }
 
-static inline void DecoderUpdatePreroll( vlc_tick_t *pi_preroll, const block_t *p )
+static inline void DecoderResetPreroll( struct decoder_owner *p_owner )
 {
+    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    p_owner->i_preroll_last = VLC_TICK_INVALID;
+}
+
+static inline void DecoderUpdatePreroll( struct decoder_owner *p_owner,
+                                         const block_t *p )
+{
+    vlc_tick_t *pi_preroll = &p_owner->i_preroll_end;
+
     if( p->i_flags & BLOCK_FLAG_PREROLL )
+    {
         *pi_preroll = (vlc_tick_t)INT64_MAX;
+
+        vlc_tick_t i_date = p->i_pts != VLC_TICK_INVALID ? p->i_pts : p->i_dts;
+        if( i_date != VLC_TICK_INVALID )
+            p_owner->i_preroll_last = __MAX( p_owner->i_preroll_last,
+                                             i_date + p->i_length );
+    }
     /* Check if we can use the packet for end of preroll */
     else if( (p->i_flags & BLOCK_FLAG_DISCONTINUITY) &&
              (p->i_buffer == 0 || (p->i_flags & BLOCK_FLAG_CORRUPTED)) )
@@ -1088,7 +1152,7 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
     }
 
     prerolled = p_owner->i_preroll_end > (vlc_tick_t)INT64_MIN;
-    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    DecoderResetPreroll( p_owner );
     vlc_mutex_unlock( &p_owner->lock );
 
     if( unlikely(prerolled) )
@@ -1157,6 +1221,11 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
             /* Ensure no earlier higher pts breaks still state */
             vout_Flush( p_vout, p_picture->date );
         }
+
+        struct input_stats *stats = DecoderGetStats( p_owner );
+        if( stats != NULL && p_picture->date != VLC_TICK_INVALID )
+            input_stats_AddSignedHistogram( stats->vout_latency,
+                                            p_picture->date - vlc_tick_now() );
         vout_PutPicture( p_vout, p_picture );
     }
     else
@@ -1264,7 +1333,7 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
     }
 
     prerolled = p_owner->i_preroll_end > (vlc_tick_t)INT64_MIN;
-    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    DecoderResetPreroll( p_owner );
     vlc_mutex_unlock( &p_owner->lock );
 
     if( unlikely(prerolled) )
@@ -1335,20 +1404,48 @@ static void DecoderUpdateStatAudio( struct decoder_owner *p_owner,
 {
     input_thread_t *p_input = p_owner->p_input;
     unsigned played = 0;
+    struct aout_sync_stats sync;
 
     /* Update ugly stat */
     if( p_input == NULL )
         return;
 
+    struct input_stats *stats = input_priv(p_input)->stats;
+
     if( p_owner->p_aout != NULL )
     {
         unsigned aout_lost;
 
         aout_DecGetResetStats( p_owner->p_aout, &aout_lost, &played );
         lost += aout_lost;
-    }
 
-    struct input_stats *stats = input_priv(p_input)->stats;
+        if( stats != NULL )
+        {
+            aout_DecGetResetSyncStats( p_owner->p_aout, &sync );
+            for( size_t i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++ )
+            {
+                atomic_fetch_add_explicit(&stats->aout_drift[i],
+                                          sync.drift[i], memory_order_relaxed);
+                atomic_fetch_add_explicit(&stats->aout_latency[i],
+                                          sync.latency[i], memory_order_relaxed);
+            }
+            atomic_fetch_add_explicit(&stats->aout_resampled, sync.resampled,
+                                      memory_order_relaxed);
+            atomic_fetch_add_explicit(&stats->aout_silences, sync.silences,
+                                      memory_order_relaxed);
+            atomic_fetch_add_explicit(&stats->aout_flushes, sync.flushes,
+                                      memory_order_relaxed);
+            vlc_atomic_store_float(&stats->aout_resampling, sync.resampling);
+            vlc_atomic_store_float(&stats->loudness_momentary,
+                                   sync.loudness_momentary);
+            vlc_atomic_store_float(&stats->loudness_shortterm,
+                                   sync.loudness_shortterm);
+            vlc_atomic_store_float(&stats->loudness_integrated,
+                                   sync.loudness_integrated);
+            vlc_atomic_store_float(&stats->loudness_true_peak,
+                                   sync.loudness_true_peak);
+        }
+    }
 
     if( stats != NULL )
     {
@@ -1438,12 +1535,118 @@ static void DecoderQueueSpu( decoder_t *p_dec, subpicture_t *p_spu )
     }
 }
 
+static void DecoderAddPacketizerTime( struct decoder_owner *p_owner,
+                                      vlc_tick_t i_duration )
+{
+    struct input_stats *stats = DecoderGetStats( p_owner );
+
+    if( stats != NULL )
+        atomic_fetch_add_explicit( &stats->packetizer_time, i_duration,
+                                   memory_order_relaxed );
+}
+
+static void DecoderAddDecoderTime( decoder_t *p_dec, bool b_drain,
+                                   vlc_tick_t i_duration )
+{
+    struct input_stats *stats = DecoderGetStats( dec_get_owner( p_dec ) );
+
+    if( stats == NULL )
+        return;
+
+    atomic_fetch_add_explicit( &stats->decoder_time, i_duration,
+                               memory_order_relaxed );
+    if( b_drain )
+        return;
+
+    if( p_dec->fmt_in.i_cat == VIDEO_ES )
+        input_stats_AddHistogram( stats->video_decode_time,
+                                  MS_FROM_VLC_TICK( i_duration ) );
+    else if( p_dec->fmt_in.i_cat == AUDIO_ES )
+        input_stats_AddHistogram( stats->audio_decode_time,
+                                  MS_FROM_VLC_TICK( i_duration ) );
+}
+
+static block_t *DecoderPacketize( decoder_t *p_dec, block_t **pp_block )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+    vlc_tick_t i_start = vlc_tick_now();
+
+    block_t *p_packetized_block = p_packetizer->pf_packetize( p_packetizer,
+                                                              pp_block );
+    DecoderAddPacketizerTime( p_owner, vlc_tick_now() - i_start );
+    return p_packetized_block;
+}
+
+static int DecoderHandleReload( decoder_t *p_dec )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    /* Here, the atomic doesn't prevent to miss a reload request.
+     * DecoderProcess() can still be called after the decoder module or the
+     * audio output requested a reload. This will only result in a drop of an
+     * input block or an output buffer. */
+    enum reload reload;
+    if( ( reload = atomic_exchange( &p_owner->reload, RELOAD_NO_REQUEST ) ) )
+    {
+        msg_Warn( p_dec, "Reloading the decoder module%s",
+                  reload == RELOAD_DECODER_AOUT ? " and the audio output" : "" );
+
+        return ReloadDecoder( p_dec, false, &p_dec->fmt_in, reload );
+    }
+    return VLC_SUCCESS;
+}
+
 static void DecoderProcess( decoder_t *p_dec, block_t *p_block );
+/* Marks the video blocks that will not be displayed, because their picture
+ * is before the end of the preroll: the decoder can then skip the frames
+ * that are not references and the output of the others. The packetizers
+ * do not keep the flag of the demuxed blocks. Returns whether the block
+ * can be dropped without being decoded at all, which is also the case of
+ * the inter frames when thumbnailing from keyframes. */
+static bool DecoderSkipBlock( decoder_t *p_dec, block_t *p_block )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    if( p_dec->fmt_in.i_cat != VIDEO_ES )
+        return false;
+
+    /* Only the blocks known to be inter frames are dropped, the type of
+     * the others is unknown */
+    if( p_owner->b_keyframes_only
+     && (p_block->i_flags & BLOCK_FLAG_TYPE_MASK & ~BLOCK_FLAG_TYPE_I) )
+        return true;
+
+    if( !(p_block->i_flags & BLOCK_FLAG_PREROLL)
+     && p_block->i_pts != VLC_TICK_INVALID )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        if( p_owner->i_preroll_last != VLC_TICK_INVALID
+         && p_block->i_pts + p_block->i_length <= p_owner->i_preroll_last )
+            p_block->i_flags |= BLOCK_FLAG_PREROLL;
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+
+    return p_owner->b_preroll_skip
+        && (p_block->i_flags & BLOCK_FLAG_PREROLL)
+        && (p_block->i_flags & BLOCK_FLAG_DISPOSABLE);
+}
+
 static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    const bool b_drain = p_block == NULL;
+
+    if( p_block != NULL && DecoderSkipBlock( p_dec, p_block ) )
+    {
+        block_Release( p_block );
+        return;
+    }
+
+    vlc_tick_t i_start = vlc_tick_now();
 
     int ret = p_dec->pf_decode( p_dec, p_block );
+    DecoderAddDecoderTime( p_dec, b_drain, vlc_tick_now() - i_start );
     switch( ret )
     {
         case VLCDEC_SUCCESS:
@@ -1479,23 +1682,9 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
-    if( p_owner->error )
+    if( p_owner->error || DecoderHandleReload( p_dec ) != VLC_SUCCESS )
         goto error;
 
-    /* Here, the atomic doesn't prevent to miss a reload request.
-     * DecoderProcess() can still be called after the decoder module or the
-     * audio output requested a reload. This will only result in a drop of an
-     * input block or an output buffer. */
-    enum reload reload;
-    if( ( reload = atomic_exchange( &p_owner->reload, RELOAD_NO_REQUEST ) ) )
-    {
-        msg_Warn( p_dec, "Reloading the decoder module%s",
-                  reload == RELOAD_DECODER_AOUT ? " and the audio output" : "" );
-
-        if( ReloadDecoder( p_dec, false, &p_dec->fmt_in, reload ) != VLC_SUCCESS )
-            goto error;
-    }
-
     bool packetize = p_owner->p_packetizer != NULL;
     if( p_block )
     {
@@ -1503,7 +1692,7 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
             goto error;
 
         vlc_mutex_lock( &p_owner->lock );
-        DecoderUpdatePreroll( &p_owner->i_preroll_end, p_block );
+        DecoderUpdatePreroll( p_owner, p_block );
         vlc_mutex_unlock( &p_owner->lock );
         if( unlikely( p_block->i_flags & BLOCK_FLAG_CORE_PRIVATE_RELOADED ) )
         {
@@ -1525,8 +1714,7 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
         block_t **pp_block = p_block ? &p_block : NULL;
         decoder_t *p_packetizer = p_owner->p_packetizer;
 
-        while( (p_packetized_block =
-                p_packetizer->pf_packetize( p_packetizer, pp_block ) ) )
+        while( (p_packetized_block = DecoderPacketize( p_dec, pp_block ) ) )
         {
             if( !es_format_IsSimilar( &p_dec->fmt_in, &p_packetizer->fmt_out ) )
             {
@@ -1574,6 +1762,178 @@ error:
         block_Release( p_block );
 }
 
+static void DecoderStageRelease( struct decoder_stage_unit *p_unit )
+{
+    block_ChainRelease( p_unit->p_chain );
+    if( p_unit->p_fmt != NULL )
+    {
+        es_format_Clean( p_unit->p_fmt );
+        free( p_unit->p_fmt );
+    }
+}
+
+/* Drops the queued units, with the fifo locked */
+static void DecoderStageReleaseAll( struct decoder_owner *p_owner )
+{
+    for( ; p_owner->stage.count > 0; p_owner->stage.count-- )
+    {
+        DecoderStageRelease( &p_owner->stage.units[p_owner->stage.first] );
+        p_owner->stage.first = ( p_owner->stage.first + 1 ) % DECODER_STAGE_SIZE;
+    }
+}
+
+static void DecoderStageQueue( decoder_t *p_dec, block_t *p_chain,
+                               es_format_t *p_fmt, bool b_drain )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    struct decoder_stage_unit unit = { p_chain, p_fmt, b_drain };
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    while( p_owner->stage.count == DECODER_STAGE_SIZE
+        && !p_owner->flushing && !p_owner->stage.closing )
+        vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->stage.wait_space );
+
+    if( p_owner->flushing || p_owner->stage.closing )
+    {   /* Dropped, the format is sent again after the flush */
+        vlc_fifo_Unlock( p_owner->p_fifo );
+        DecoderStageRelease( &unit );
+        return;
+    }
+
+    unsigned i = ( p_owner->stage.first + p_owner->stage.count )
+               % DECODER_STAGE_SIZE;
+    p_owner->stage.units[i] = unit;
+    p_owner->stage.count++;
+    vlc_cond_signal( &p_owner->stage.wait );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+/* Waits for the decoding stage to decode all the queued units */
+static void DecoderStageWaitIdle( struct decoder_owner *p_owner )
+{
+    vlc_fifo_Lock( p_owner->p_fifo );
+    while( ( p_owner->stage.count > 0 || p_owner->stage.busy )
+        && !p_owner->flushing && !p_owner->stage.closing )
+        vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->stage.wait_space );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+}
+
+static es_format_t *DecoderStageCopyFormat( struct decoder_owner *p_owner,
+                                            const es_format_t *p_fmt )
+{
+    es_format_t *p_copy = malloc( sizeof (*p_copy) );
+
+    if( likely(p_copy != NULL)
+     && es_format_Copy( p_copy, p_fmt ) != VLC_SUCCESS )
+    {
+        es_format_Clean( p_copy );
+        free( p_copy );
+        p_copy = NULL;
+    }
+
+    es_format_Clean( &p_owner->stage.fmt );
+    es_format_Copy( &p_owner->stage.fmt, p_fmt );
+    /* Sent again with the next unit on failure */
+    p_owner->stage.fmt_lost = p_copy == NULL;
+    return p_copy;
+}
+
+/**
+ * Packetize a block and queue the result to the decoding stage
+ *
+ * \param p_dec the decoder object
+ * \param p_block the block to packetize, or NULL to drain
+ */
+static void DecoderProcessStage( decoder_t *p_dec, block_t *p_block )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+    block_t **pp_block = p_block ? &p_block : NULL;
+    block_t *p_packetized_block;
+
+    if( p_block )
+    {
+        if( p_block->i_buffer <= 0 )
+        {
+            block_Release( p_block );
+            return;
+        }
+
+        vlc_mutex_lock( &p_owner->lock );
+        DecoderUpdatePreroll( p_owner, p_block );
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+
+    while( (p_packetized_block = DecoderPacketize( p_dec, pp_block ) ) )
+    {
+        es_format_t *p_fmt = NULL;
+
+        /* The decoding stage restarts the module if needed */
+        if( p_owner->stage.fmt_lost
+         || !es_format_IsSimilar( &p_owner->stage.fmt, &p_packetizer->fmt_out ) )
+            p_fmt = DecoderStageCopyFormat( p_owner, &p_packetizer->fmt_out );
+
+        if( p_packetizer->pf_get_cc )
+            PacketizerGetCc( p_dec, p_packetizer );
+
+        DecoderStageQueue( p_dec, p_packetized_block, p_fmt, false );
+    }
+
+    if( !pp_block )
+    {   /* Drain the decoder after the packetizer is drained */
+        DecoderStageQueue( p_dec, NULL, NULL, true );
+        DecoderStageWaitIdle( p_owner );
+    }
+}
+
+/**
+ * Decode a unit from the packetizer
+ *
+ * \param p_dec the decoder object
+ * \param p_unit the unit to decode
+ */
+static void DecoderStageDecode( decoder_t *p_dec,
+                                struct decoder_stage_unit *p_unit )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    block_t *p_block = p_unit->p_chain;
+
+    if( p_unit->p_fmt != NULL )
+    {
+        if( !p_owner->error
+         && !es_format_IsSimilar( &p_dec->fmt_in, p_unit->p_fmt ) )
+        {
+            msg_Dbg( p_dec, "restarting module due to input format change");
+
+            /* Drain the decoder module */
+            DecoderDecode( p_dec, NULL );
+
+            ReloadDecoder( p_dec, false, p_unit->p_fmt, RELOAD_DECODER );
+        }
+        es_format_Clean( p_unit->p_fmt );
+        free( p_unit->p_fmt );
+    }
+
+    while( p_block )
+    {
+        block_t *p_next = p_block->p_next;
+        p_block->p_next = NULL;
+
+        if( p_owner->error || DecoderHandleReload( p_dec ) != VLC_SUCCESS )
+        {
+            block_Release( p_block );
+            block_ChainRelease( p_next );
+            return;
+        }
+
+        DecoderDecode( p_dec, p_block );
+        p_block = p_next;
+    }
+
+    if( p_unit->b_drain && !p_owner->error )
+        DecoderDecode( p_dec, NULL );
+}
+
 static void DecoderProcessFlush( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
@@ -1622,7 +1982,7 @@ static void DecoderProcessFlush( decoder_t *p_dec )
             vout_FlushSubpictureChannel( p_owner->p_vout, p_owner->i_spu_channel );
     }
 
-    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    DecoderResetPreroll( p_owner );
     vlc_mutex_unlock( &p_owner->lock );
 }
 
@@ -1668,18 +2028,85 @@ static void OutputChangeRate( decoder_t *p_dec, float rate )
     }
 }
 
+/**
+ * Applies the pause and rate changes to the output
+ *
+ * Called with the fifo locked, which is released while the output is
+ * updated.
+ *
+ * \return true if the pause state changed
+ */
+static bool DecoderUpdateOutputState( decoder_t *p_dec, bool *p_paused,
+                                      float *p_rate )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    /* Reset the original pause/rate state when a new aout/vout is created:
+     * this will trigger the OutputChangePause/OutputChangeRate code path
+     * if needed. */
+    if( p_owner->reset_out_state )
+    {
+        *p_rate = 1.f;
+        *p_paused = false;
+        p_owner->reset_out_state = false;
+    }
+
+    if( *p_paused != p_owner->paused )
+    {   /* Update playing/paused status of the output */
+        int canc = vlc_savecancel();
+        vlc_tick_t date = p_owner->pause_date;
+
+        *p_paused = p_owner->paused;
+        vlc_fifo_Unlock( p_owner->p_fifo );
+
+        vlc_mutex_lock( &p_owner->lock );
+        OutputChangePause( p_dec, *p_paused, date );
+        vlc_mutex_unlock( &p_owner->lock );
+
+        vlc_restorecancel( canc );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        return true;
+    }
+
+    if( *p_rate != p_owner->rate )
+    {
+        int canc = vlc_savecancel();
+
+        *p_rate = p_owner->rate;
+        vlc_fifo_Unlock( p_owner->p_fifo );
+
+        vlc_mutex_lock( &p_owner->lock );
+        OutputChangeRate( p_dec, *p_rate );
+        vlc_mutex_unlock( &p_owner->lock );
+
+        vlc_restorecancel( canc );
+        vlc_fifo_Lock( p_owner->p_fifo );
+    }
+    return false;
+}
+
 /**
  * The decoding main loop
  *
+ * When the decoding stage is enabled, this thread only packetizes, and the
+ * decoding stage updates the output state.
+ *
  * \param p_dec the decoder
  */
 static void *DecoderThread( void *p_data )
 {
     decoder_t *p_dec = (decoder_t *)p_data;
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    struct input_stats *stats = DecoderGetStats( p_owner );
+    atomic_uintmax_t *fifo_depth = NULL;
     float rate = 1.f;
     bool paused = false;
 
+    if( stats != NULL && p_dec->fmt_in.i_cat == VIDEO_ES )
+        fifo_depth = stats->video_fifo_depth;
+    else if( stats != NULL && p_dec->fmt_in.i_cat == AUDIO_ES )
+        fifo_depth = stats->audio_fifo_depth;
+
     /* The decoder's main loop */
     vlc_fifo_Lock( p_owner->p_fifo );
     vlc_fifo_CleanupPush( p_owner->p_fifo );
@@ -1691,6 +2118,16 @@ static void *DecoderThread( void *p_data )
              * for the sake of flushing (glitches could otherwise happen). */
             int canc = vlc_savecancel();
 
+            if( p_owner->stage.enabled )
+            {   /* Drop the queued units and wait for the one being decoded.
+                 * The format changes they carried are sent again. */
+                DecoderStageReleaseAll( p_owner );
+                while( p_owner->stage.busy )
+                    vlc_fifo_WaitCond( p_owner->p_fifo,
+                                       &p_owner->stage.wait_space );
+                p_owner->stage.fmt_lost = true;
+            }
+
             vlc_fifo_Unlock( p_owner->p_fifo );
 
             /* Flush the decoder (and the output) */
@@ -1707,47 +2144,9 @@ static void *DecoderThread( void *p_data )
             continue;
         }
 
-        /* Reset the original pause/rate state when a new aout/vout is created:
-         * this will trigger the OutputChangePause/OutputChangeRate code path
-         * if needed. */
-        if( p_owner->reset_out_state )
-        {
-            rate = 1.f;
-            paused = false;
-            p_owner->reset_out_state = false;
-        }
-
-        if( paused != p_owner->paused )
-        {   /* Update playing/paused status of the output */
-            int canc = vlc_savecancel();
-            vlc_tick_t date = p_owner->pause_date;
-
-            paused = p_owner->paused;
-            vlc_fifo_Unlock( p_owner->p_fifo );
-
-            vlc_mutex_lock( &p_owner->lock );
-            OutputChangePause( p_dec, paused, date );
-            vlc_mutex_unlock( &p_owner->lock );
-
-            vlc_restorecancel( canc );
-            vlc_fifo_Lock( p_owner->p_fifo );
+        if( !p_owner->stage.enabled
+         && DecoderUpdateOutputState( p_dec, &paused, &rate ) )
             continue;
-        }
-
-        if( rate != p_owner->rate )
-        {
-            int canc = vlc_savecancel();
-
-            rate = p_owner->rate;
-            vlc_fifo_Unlock( p_owner->p_fifo );
-
-            vlc_mutex_lock( &p_owner->lock );
-            OutputChangeRate( p_dec, rate );
-            vlc_mutex_unlock( &p_owner->lock );
-
-            vlc_restorecancel( canc );
-            vlc_fifo_Lock( p_owner->p_fifo );
-        }
 
         if( p_owner->paused && p_owner->frames_countdown == 0 )
         {   /* Wait for resumption from pause */
@@ -1776,12 +2175,19 @@ static void *DecoderThread( void *p_data )
              * drain. Pass p_block = NULL to decoder just once. */
         }
 
+        if( p_block != NULL && fifo_depth != NULL )
+            input_stats_AddHistogram( fifo_depth,
+                                      vlc_fifo_GetCount( p_owner->p_fifo ) );
         vlc_fifo_Unlock( p_owner->p_fifo );
 
         int canc = vlc_savecancel();
-        DecoderProcess( p_dec, p_block );
+        if( p_owner->stage.enabled )
+            DecoderProcessStage( p_dec, p_block );
+        else
+            DecoderProcess( p_dec, p_block );
 
-        if( p_block == NULL && p_dec->fmt_out.i_cat == AUDIO_ES )
+        if( p_block == NULL && !p_owner->stage.enabled
+         && p_dec->fmt_out.i_cat == AUDIO_ES )
         {   /* Draining: the decoder is drained and all decoded buffers are
              * queued to the output at this point. Now drain the output. */
             if( p_owner->p_aout != NULL )
@@ -1804,6 +2210,63 @@ static void *DecoderThread( void *p_data )
     vlc_assert_unreachable();
 }
 
+/**
+ * The decoding stage loop, fed with packetized units by DecoderThread
+ *
+ * \param p_dec the decoder
+ */
+static void *DecoderStageThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    float rate = 1.f;
+    bool paused = false;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    while( !p_owner->stage.closing )
+    {
+        if( DecoderUpdateOutputState( p_dec, &paused, &rate ) )
+            continue;
+
+        if( p_owner->stage.count == 0 || p_owner->flushing
+         || ( p_owner->paused && p_owner->frames_countdown == 0 ) )
+        {
+            vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->stage.wait );
+            continue;
+        }
+
+        struct decoder_stage_unit unit =
+            p_owner->stage.units[p_owner->stage.first];
+        p_owner->stage.first = ( p_owner->stage.first + 1 ) % DECODER_STAGE_SIZE;
+        p_owner->stage.count--;
+        p_owner->stage.busy = true;
+        vlc_cond_signal( &p_owner->stage.wait_space );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+
+        DecoderStageDecode( p_dec, &unit );
+
+        vlc_mutex_lock( &p_owner->lock );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        p_owner->stage.busy = false;
+        vlc_cond_signal( &p_owner->stage.wait_space );
+        vlc_cond_signal( &p_owner->wait_acknowledge );
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    return NULL;
+}
+
+/* Wakes the decoding stage and the decoder thread waiting for it up, with
+ * the fifo locked */
+static void DecoderStageSignal( struct decoder_owner *p_owner )
+{
+    if( p_owner->stage.enabled )
+    {
+        vlc_cond_signal( &p_owner->stage.wait );
+        vlc_cond_signal( &p_owner->stage.wait_space );
+    }
+}
+
 static const struct decoder_owner_callbacks dec_video_cbs =
 {
     .video = {
@@ -1864,7 +2327,9 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         return NULL;
     p_dec = &p_owner->dec;
 
-    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    DecoderResetPreroll( p_owner );
+    p_owner->b_preroll_skip = var_InheritBool( p_dec, "preroll-skip" );
+    p_owner->b_keyframes_only = false;
     p_owner->i_last_rate = INPUT_RATE_DEFAULT;
     p_owner->p_input = p_input;
     p_owner->p_resource = p_resource;
@@ -1897,6 +2362,14 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     atomic_init( &p_owner->reload, RELOAD_NO_REQUEST );
     p_owner->b_idle = false;
 
+    p_owner->stage.enabled = false;
+    p_owner->stage.busy = false;
+    p_owner->stage.closing = false;
+    p_owner->stage.fmt_lost = false;
+    p_owner->stage.first = 0;
+    p_owner->stage.count = 0;
+    es_format_Init( &p_owner->stage.fmt, fmt->i_cat, 0 );
+
     p_owner->mouse_event = NULL;
     p_owner->opaque = NULL;
 
@@ -1916,6 +2389,8 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     vlc_cond_init( &p_owner->wait_acknowledge );
     vlc_cond_init( &p_owner->wait_fifo );
     vlc_cond_init( &p_owner->wait_timed );
+    vlc_cond_init( &p_owner->stage.wait );
+    vlc_cond_init( &p_owner->stage.wait_space );
 
     /* Load a packetizer module if the input is not already packetized */
     if( p_sout == NULL && !fmt->b_packetized )
@@ -1943,7 +2418,12 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
             if( !input_priv( p_input )->b_thumbnailing )
                 p_dec->cbs = &dec_video_cbs;
             else
+            {
                 p_dec->cbs = &dec_thumbnailer_cbs;
+                /* Set by the thumbnailer on the input */
+                p_owner->b_keyframes_only =
+                    var_GetBool( p_input, "thumbnail-keyframe" );
+            }
             p_owner->pf_update_stat = DecoderUpdateStatVideo;
             break;
         case AUDIO_ES:
@@ -1993,6 +2473,12 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->cc.p_sout_input = NULL;
     p_owner->cc.b_sout_created = false;
     p_owner->i_ts_delay = 0;
+
+    /* Decode on a separate thread, see DecoderStageThread */
+    if( p_owner->p_packetizer != NULL && p_dec->cbs == &dec_video_cbs
+     && var_InheritBool( p_dec, "packetizer-thread" )
+     && es_format_Copy( &p_owner->stage.fmt, &p_dec->fmt_in ) == VLC_SUCCESS )
+        p_owner->stage.enabled = true;
     return p_dec;
 }
 
@@ -2014,6 +2500,8 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     /* Free all packets still in the decoder fifo. */
     block_FifoRelease( p_owner->p_fifo );
+    DecoderStageReleaseAll( p_owner );
+    es_format_Clean( &p_owner->stage.fmt );
 
     /* Cleanup */
 #ifdef ENABLE_SOUT
@@ -2075,6 +2563,8 @@ static void DeleteDecoder( decoder_t * p_dec )
         vlc_object_release( p_owner->p_packetizer );
     }
 
+    vlc_cond_destroy( &p_owner->stage.wait_space );
+    vlc_cond_destroy( &p_owner->stage.wait );
     vlc_cond_destroy( &p_owner->wait_timed );
     vlc_cond_destroy( &p_owner->wait_fifo );
     vlc_cond_destroy( &p_owner->wait_acknowledge );
@@ -2155,10 +2645,26 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     }
 #endif
 
+    if( p_owner->stage.enabled
+     && vlc_clone( &p_owner->stage.thread, DecoderStageThread, p_dec,
+                   i_priority ) )
+    {
+        msg_Warn( p_dec, "cannot spawn decoding stage thread" );
+        p_owner->stage.enabled = false;
+    }
+
     /* Spawn the decoder thread */
     if( vlc_clone( &p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
         msg_Err( p_dec, "cannot spawn decoder thread" );
+        if( p_owner->stage.enabled )
+        {
+            vlc_fifo_Lock( p_owner->p_fifo );
+            p_owner->stage.closing = true;
+            vlc_cond_signal( &p_owner->stage.wait );
+            vlc_fifo_Unlock( p_owner->p_fifo );
+            vlc_join( p_owner->stage.thread, NULL );
+        }
         DeleteDecoder( p_dec );
         return NULL;
     }
@@ -2208,7 +2714,9 @@ void input_DecoderDelete( decoder_t *p_dec )
     vlc_fifo_Lock( p_owner->p_fifo );
     /* Signal DecoderTimedWait */
     p_owner->flushing = true;
+    p_owner->stage.closing = true;
     vlc_cond_signal( &p_owner->wait_timed );
+    DecoderStageSignal( p_owner );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     /* Make sure we aren't waiting/decoding anymore */
@@ -2228,6 +2736,8 @@ void input_DecoderDelete( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 
     vlc_join( p_owner->thread, NULL );
+    if( p_owner->stage.enabled )
+        vlc_join( p_owner->stage.thread, NULL );
 
     /* */
     if( p_owner->cc.b_supported )
@@ -2241,11 +2751,11 @@ void input_DecoderDelete( decoder_t *p_dec )
 }
 
 /**
- * Put a block_t in the decoder's fifo.
+ * Put a block_t, or a chain of block_t, in the decoder's fifo.
  * Thread-safe w.r.t. the decoder. May be a cancellation point.
  *
  * \param p_dec the decoder object
- * \param p_block the data block
+ * \param p_block the data block or block chain
  */
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
@@ -2285,7 +2795,8 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
+    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining
+     || p_owner->stage.count > 0 || p_owner->stage.busy )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2357,6 +2868,7 @@ void input_DecoderFlush( decoder_t *p_dec )
 
     vlc_fifo_Signal( p_owner->p_fifo );
     vlc_cond_signal( &p_owner->wait_timed );
+    DecoderStageSignal( p_owner );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
@@ -2475,6 +2987,7 @@ void input_DecoderChangePause( decoder_t *p_dec, bool b_paused, vlc_tick_t i_dat
     p_owner->pause_date = i_date;
     p_owner->frames_countdown = 0;
     vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderStageSignal( p_owner );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2485,6 +2998,7 @@ void input_DecoderChangeRate( decoder_t *dec, float rate )
     vlc_fifo_Lock( owner->p_fifo );
     owner->rate = rate;
     vlc_fifo_Signal( owner->p_fifo );
+    DecoderStageSignal( owner );
     vlc_fifo_Unlock( owner->p_fifo );
 }
 
@@ -2537,7 +3051,8 @@ void input_DecoderWait( decoder_t *p_dec )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && p_owner->stage.count == 0 && !p_owner->stage.busy )
         {
             msg_Err( p_dec, "buffer deadlock prevented" );
             vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2559,6 +3074,7 @@ void input_DecoderFrameNext( decoder_t *p_dec, vlc_tick_t *pi_duration )
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->frames_countdown++;
     vlc_fifo_Signal( p_owner->p_fifo );
+    DecoderStageSignal( p_owner );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     vlc_mutex_lock( &p_owner->lock );
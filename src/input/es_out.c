@@ -2160,33 +2160,48 @@ static void EsOutCreateCCChannels( es_out_t *out, vlc_fourcc_t codec, uint64_t i
 }
 
 /**
- * Send a block for the given es_out
+ * Send a chain of blocks for the given es_out
+ *
+ * The whole chain is accounted, marked and queued to the decoder(s) under a
+ * single lock.
  *
  * \param out the es_out to send from
  * \param es the es_out_id
- * \param p_block the data block to send
+ * \param p_chain the data block chain to send
  */
-static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
+static int EsOutSendChain( es_out_t *out, es_out_id_t *es, block_t *p_chain )
 {
     es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
     input_thread_t *p_input = p_sys->p_input;
 
-    assert( p_block->p_next == NULL );
+    if( p_chain == NULL )
+        return VLC_SUCCESS;
 
     struct input_stats *stats = input_priv(p_input)->stats;
     if( stats != NULL )
     {
-        input_rate_Add( &stats->demux_bitrate, p_block->i_buffer );
+        uintmax_t i_count = 0, i_bytes = 0;
+        uintmax_t i_corrupted = 0, i_discontinuity = 0;
 
-        /* Update number of corrupted data packats */
-        if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
-            atomic_fetch_add_explicit(&stats->demux_corrupted, 1,
-                                      memory_order_relaxed);
+        for( block_t *p_block = p_chain; p_block; p_block = p_block->p_next )
+        {
+            i_count++;
+            i_bytes += p_block->i_buffer;
+            /* Update number of corrupted data packats */
+            if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
+                i_corrupted++;
+            /* Update number of discontinuities */
+            if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
+                i_discontinuity++;
+        }
 
-        /* Update number of discontinuities */
-        if( p_block->i_flags & BLOCK_FLAG_DISCONTINUITY )
-            atomic_fetch_add_explicit(&stats->demux_discontinuity, 1,
+        input_rate_AddBatch( &stats->demux_bitrate, i_count, i_bytes );
+        if( i_corrupted > 0 )
+            atomic_fetch_add_explicit(&stats->demux_corrupted, i_corrupted,
                                       memory_order_relaxed);
+        if( i_discontinuity > 0 )
+            atomic_fetch_add_explicit(&stats->demux_discontinuity,
+                                      i_discontinuity, memory_order_relaxed);
     }
 
     vlc_mutex_lock( &p_sys->lock );
@@ -2194,17 +2209,20 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Mark preroll blocks */
     if( p_sys->i_preroll_end >= 0 )
     {
-        vlc_tick_t i_date = p_block->i_pts;
-        if( p_block->i_pts == VLC_TICK_INVALID )
-            i_date = p_block->i_dts;
+        for( block_t *p_block = p_chain; p_block; p_block = p_block->p_next )
+        {
+            vlc_tick_t i_date = p_block->i_pts;
+            if( p_block->i_pts == VLC_TICK_INVALID )
+                i_date = p_block->i_dts;
 
-        if( i_date + p_block->i_length < p_sys->i_preroll_end )
-            p_block->i_flags |= BLOCK_FLAG_PREROLL;
+            if( i_date + p_block->i_length < p_sys->i_preroll_end )
+                p_block->i_flags |= BLOCK_FLAG_PREROLL;
+        }
     }
 
     if( !es->p_dec )
     {
-        block_Release( p_block );
+        block_ChainRelease( p_chain );
         vlc_mutex_unlock( &p_sys->lock );
         return VLC_SUCCESS;
     }
@@ -2230,12 +2248,19 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     /* Decode */
     if( es->p_dec_record )
     {
-        block_t *p_dup = block_Duplicate( p_block );
+        block_t *p_dup = NULL;
+        block_t **pp_dup_last = &p_dup;
+        for( block_t *p_block = p_chain; p_block; p_block = p_block->p_next )
+        {
+            block_t *p_dup_block = block_Duplicate( p_block );
+            if( p_dup_block )
+                block_ChainLastAppend( &pp_dup_last, p_dup_block );
+        }
         if( p_dup )
             input_DecoderDecode( es->p_dec_record, p_dup,
                                  input_priv(p_input)->b_out_pace_control );
     }
-    input_DecoderDecode( es->p_dec, p_block,
+    input_DecoderDecode( es->p_dec, p_chain,
                          input_priv(p_input)->b_out_pace_control );
 
     es_format_t fmt_dsc;
@@ -2267,6 +2292,19 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     return VLC_SUCCESS;
 }
 
+/**
+ * Send a block for the given es_out
+ *
+ * \param out the es_out to send from
+ * \param es the es_out_id
+ * \param p_block the data block to send
+ */
+static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
+{
+    assert( p_block->p_next == NULL );
+    return EsOutSendChain( out, es, p_block );
+}
+
 static void
 EsOutDrainDecoder( es_out_t *out, es_out_id_t *es )
 {
@@ -3136,6 +3174,9 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
         }
         return ret;
     }
+    case ES_OUT_JUMP_TIMESHIFT:
+        /* No timeshift buffer at this level */
+        return VLC_EGENERIC;
     default:
         msg_Err( p_sys->p_input, "unknown query 0x%x in %s", i_query,
                  __func__  );
@@ -3161,6 +3202,7 @@ static const struct es_out_callbacks es_out_cbs =
     .del = EsOutDel,
     .control = EsOutControl,
     .destroy = EsOutDelete,
+    .send_chain = EsOutSendChain,
 };
 
 /****************************************************************************
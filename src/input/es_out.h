@@ -90,7 +90,11 @@ enum es_out_query_private_e
     ES_OUT_SET_VBI_PAGE,                            /* arg1=unsigned res=can fail */
 
     /* Set VBI/Teletext menu transparent */
-    ES_OUT_SET_VBI_TRANSPARENCY                     /* arg1=bool res=can fail */
+    ES_OUT_SET_VBI_TRANSPARENCY,                    /* arg1=bool res=can fail */
+
+    /* Move the playback in the timeshift buffer, relatively to the current
+     * position (only handled by the timeshift es_out) */
+    ES_OUT_JUMP_TIMESHIFT,                          /* arg1=vlc_tick_t i_delta res=can fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -167,6 +171,10 @@ static inline int es_out_GetGroupForced( es_out_t *p_out )
     assert( !i_ret );
     return i_group;
 }
+static inline int es_out_JumpTimeshift( es_out_t *p_out, vlc_tick_t i_delta )
+{
+    return es_out_Control( p_out, ES_OUT_JUMP_TIMESHIFT, i_delta );
+}
 static inline void es_out_Eos( es_out_t *p_out )
 {
     int i_ret = es_out_Control( p_out, ES_OUT_SET_EOS );
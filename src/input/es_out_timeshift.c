@@ -50,6 +50,7 @@
 #include "input_internal.h"
 #include "es_out.h"
 #include "es_out_timeshift.h"
+#include "timeshift_storage.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -85,7 +86,6 @@ typedef struct attribute_packed
 {
     es_out_id_t *p_es;
     block_t *p_block;
-    int     i_offset;  /* We do not use file > INT_MAX */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -162,33 +162,13 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
-typedef struct ts_storage_t ts_storage_t;
-struct ts_storage_t
-{
-    ts_storage_t *p_next;
-
-    /* */
-#ifdef _WIN32
-    char    *psz_file;  /* Filename */
-#endif
-    size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
-
-    /* */
-    int      i_cmd_r;
-    int      i_cmd_w;
-    int      i_cmd_max;
-    ts_cmd_t *p_cmd;
-};
-
 typedef struct
 {
     vlc_thread_t   thread;
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    uint64_t       i_tmp_total_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
@@ -209,8 +189,7 @@ typedef struct
     vlc_tick_t     i_buffering_delay;
 
     /* */
-    ts_storage_t   *p_storage_r;
-    ts_storage_t   *p_storage_w;
+    vlc_timeshift_storage_t *p_storage;
 
     vlc_tick_t     i_cmd_delay;
 
@@ -228,6 +207,7 @@ typedef struct
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    uint64_t       i_tmp_total_max;   /* Maximal total size of the temporary files in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -257,24 +237,19 @@ static void         TsAutoStop( es_out_t * );
 
 static void         TsStop( ts_thread_t * );
 static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
-static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
+static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush, int *pi_flags );
 static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, vlc_tick_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, vlc_tick_t i_delta );
 
 static void         *TsRun( void * );
 
-static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
-static void         TsStorageDelete( ts_storage_t * );
-static void         TsStoragePack( ts_storage_t *p_storage );
-static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
-static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
-static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
-
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
+static bool CmdIsClock( const ts_cmd_t * );
+static bool CmdIsReplayable( const ts_cmd_t * );
 
 static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool b_copy );
 static void CmdInitSend   ( ts_cmd_t *, es_out_id_t *, block_t * );
@@ -292,9 +267,6 @@ static int  CmdExecuteSend   ( es_out_t *, ts_cmd_t * );
 static void CmdExecuteDel    ( es_out_t *, ts_cmd_t * );
 static int  CmdExecuteControl( es_out_t *, ts_cmd_t * );
 
-/* File helpers */
-static int GetTmpFile( char **ppsz_file, const char *psz_path );
-
 static const struct es_out_callbacks es_out_timeshift_cbs;
 
 /*****************************************************************************
@@ -332,6 +304,9 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB",
              (int)p_sys->i_tmp_size_max/(1024*1024) );
 
+    const int64_t i_tmp_total_max = var_InheritInteger( p_input, "input-timeshift-size" );
+    p_sys->i_tmp_total_max = i_tmp_total_max > 0 ? (uint64_t)i_tmp_total_max * 1024 * 1024 : 0;
+
     p_sys->psz_tmp_path = var_InheritString( p_input, "input-timeshift-path" );
 #if defined (_WIN32) && !VLC_WINSTORE_APP
     if( p_sys->psz_tmp_path == NULL )
@@ -462,6 +437,41 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     return i_ret;
 }
+static int SendChain( es_out_t *p_out, es_out_id_t *p_es, block_t *p_chain )
+{
+    es_out_sys_t *p_sys = container_of(p_out, es_out_sys_t, out);
+    int i_ret = VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+
+    TsAutoStop( p_out );
+
+    if( p_sys->b_delayed )
+    {
+        /* The timeshift storage keeps one command per block */
+        while( p_chain )
+        {
+            block_t *p_next = p_chain->p_next;
+            ts_cmd_t cmd;
+
+            p_chain->p_next = NULL;
+            CmdInitSend( &cmd, p_es, p_chain );
+            TsPushCmd( p_sys->p_ts, &cmd );
+            p_chain = p_next;
+        }
+    }
+    else if( p_es->p_es )
+        i_ret = es_out_SendChain( p_sys->p_out, p_es->p_es, p_chain );
+    else
+    {
+        block_ChainRelease( p_chain );
+        i_ret = VLC_EGENERIC;
+    }
+
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_ret;
+}
 static void Del( es_out_t *p_out, es_out_id_t *p_es )
 {
     es_out_sys_t *p_sys = container_of(p_out, es_out_sys_t, out);
@@ -727,6 +737,15 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     case ES_OUT_POST_SUBNODE:
         return es_out_vaControl( p_sys->p_out, i_query, args );
 
+    case ES_OUT_JUMP_TIMESHIFT:
+    {
+        const vlc_tick_t i_delta = va_arg( args, vlc_tick_t );
+
+        if( !p_sys->b_delayed )
+            return VLC_EGENERIC;
+        return TsSeek( p_sys->p_ts, i_delta );
+    }
+
     case ES_OUT_MODIFY_PCR_SYSTEM:
     {
         const bool    b_absolute = va_arg( args, int );
@@ -777,6 +796,7 @@ static const struct es_out_callbacks es_out_timeshift_cbs =
     .del = Del,
     .control = Control,
     .destroy = Destroy,
+    .send_chain = SendChain,
 };
 
 /*****************************************************************************
@@ -800,6 +820,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_tmp_total_max = p_sys->i_tmp_total_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -813,14 +834,22 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
-    p_ts->p_storage_r = NULL;
-    p_ts->p_storage_w = NULL;
+    p_ts->p_storage = vlc_timeshift_storage_New( p_ts->psz_tmp_path,
+                                                 p_ts->i_tmp_size_max,
+                                                 p_ts->i_tmp_total_max,
+                                                 sizeof(ts_cmd_t) );
+    if( !p_ts->p_storage )
+    {
+        TsDestroy( p_ts );
+        return VLC_EGENERIC;
+    }
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
     {
         msg_Err( p_sys->p_input, "cannot create timeshift thread" );
 
+        vlc_timeshift_storage_Delete( p_ts->p_storage );
         TsDestroy( p_ts );
 
         p_sys->b_delayed = false;
@@ -850,72 +879,61 @@ static void TsStop( ts_thread_t *p_ts )
     for( ;; )
     {
         ts_cmd_t cmd;
+        int i_flags;
 
-        if( TsPopCmdLocked( p_ts, &cmd, true ) )
+        if( TsPopCmdLocked( p_ts, &cmd, true, &i_flags ) )
             break;
 
-        CmdClean( &cmd );
+        /* Replayed commands were already cleaned */
+        if( !(i_flags & VLC_TIMESHIFT_REPLAY) )
+            CmdClean( &cmd );
     }
-    assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    vlc_timeshift_storage_Delete( p_ts->p_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
 }
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
-    vlc_mutex_lock( &p_ts->lock );
+    ts_cmd_t cmd = *p_cmd;
+    block_t *p_block = NULL;
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    /* The block data is stored on disk, not in the command */
+    if( cmd.i_type == C_SEND )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        p_block = cmd.u.send.p_block;
+        cmd.u.send.p_block = NULL;
+    }
 
-        if( !p_storage )
-        {
-            CmdClean( p_cmd );
-            vlc_mutex_unlock( &p_ts->lock );
-            /* TODO warn the user (but only once) */
-            return;
-        }
+    vlc_mutex_lock( &p_ts->lock );
 
-        if( !p_ts->p_storage_w )
-        {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
-        }
-        else
-        {
-            TsStoragePack( p_ts->p_storage_w );
-            p_ts->p_storage_w->p_next = p_storage;
-            p_ts->p_storage_w = p_storage;
-        }
+    if( vlc_timeshift_storage_Push( p_ts->p_storage, cmd.i_date, &cmd, p_block ) )
+    {
+        /* TODO warn the user (but only once) */
+        CmdClean( p_cmd );
+        vlc_mutex_unlock( &p_ts->lock );
+        return;
     }
 
-    /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
-
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
 }
-static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
+static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush, int *pi_flags )
 {
     vlc_mutex_assert( &p_ts->lock );
 
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
+    block_t *p_block;
+    if( vlc_timeshift_storage_Pop( p_ts->p_storage, p_cmd, &p_block,
+                                   !b_flush, pi_flags ) )
         return VLC_EGENERIC;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
-
-    while( TsStorageIsEmpty( p_ts->p_storage_r ) )
-    {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
-            break;
+    if( p_cmd->i_type == C_SEND )
+        p_cmd->u.send.p_block = p_block;
 
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
-    }
+    /* The ES is destroyed once deleted: forbid seeking back before */
+    if( p_cmd->i_type == C_DEL && !(*pi_flags & VLC_TIMESHIFT_REPLAY) )
+        vlc_timeshift_storage_DropHistory( p_ts->p_storage );
 
     return VLC_SUCCESS;
 }
@@ -924,7 +942,7 @@ static bool TsHasCmd( ts_thread_t *p_ts )
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd = !TsStorageIsEmpty( p_ts->p_storage_r );
+    b_cmd = !vlc_timeshift_storage_IsEmpty( p_ts->p_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -936,7 +954,7 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     vlc_mutex_lock( &p_ts->lock );
     b_unused = !p_ts->b_paused &&
                p_ts->i_rate == p_ts->i_rate_source &&
-               TsStorageIsEmpty( p_ts->p_storage_r );
+               vlc_timeshift_storage_IsEmpty( p_ts->p_storage );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_unused;
@@ -990,17 +1008,124 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
 
     return i_ret;
 }
+static int TsSeek( ts_thread_t *p_ts, vlc_tick_t i_delta )
+{
+    vlc_tick_t i_first, i_read, i_last;
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_ts->lock );
+    /* Commands are dated by their reception, which follows the stream time */
+    if( !vlc_timeshift_storage_GetDates( p_ts->p_storage, &i_first, &i_read, &i_last ) )
+    {
+        i_ret = vlc_timeshift_storage_Seek( p_ts->p_storage, i_read + i_delta );
+        if( !i_ret )
+        {
+            msg_Dbg( p_ts->p_input, "es out timeshift: seek by %"PRId64" ms "
+                     "(buffer of %"PRId64" s)", MS_FROM_VLC_TICK(i_delta),
+                     SEC_FROM_VLC_TICK(i_last - i_first) );
+            vlc_cond_signal( &p_ts->wait );
+        }
+    }
+    vlc_mutex_unlock( &p_ts->lock );
+
+    return i_ret;
+}
+
+static void TsExecuteCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_ts->p_out, p_cmd );
+        CmdCleanAdd( p_cmd );
+        break;
+    case C_SEND:
+        CmdExecuteSend( p_ts->p_out, p_cmd );
+        CmdCleanSend( p_cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_ts->p_out, p_cmd );
+        CmdCleanControl( p_cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_ts->p_out, p_cmd );
+        break;
+    default:
+        vlc_assert_unreachable();
+        break;
+    }
+}
+
+/* Returns the date to execute a command at, following the reading speed */
+static vlc_tick_t TsGetDeadlineLocked( ts_thread_t *p_ts, const ts_cmd_t *p_cmd,
+                                       bool b_buffering,
+                                       vlc_tick_t *pi_buffering_date )
+{
+    vlc_mutex_assert( &p_ts->lock );
+
+    if( b_buffering && *pi_buffering_date < 0 )
+    {
+        *pi_buffering_date = p_cmd->i_date;
+    }
+    else if( *pi_buffering_date > 0 )
+    {
+        p_ts->i_buffering_delay += *pi_buffering_date - p_cmd->i_date; /* It is < 0 */
+        if( b_buffering )
+            *pi_buffering_date = p_cmd->i_date;
+        else
+            *pi_buffering_date = -1;
+    }
+
+    if( p_ts->i_rate_date < 0 )
+        p_ts->i_rate_date = p_cmd->i_date;
+
+    p_ts->i_rate_delay = 0;
+    if( p_ts->i_rate_source != p_ts->i_rate )
+    {
+        const vlc_tick_t i_duration = p_cmd->i_date - p_ts->i_rate_date;
+        p_ts->i_rate_delay = i_duration * p_ts->i_rate / p_ts->i_rate_source - i_duration;
+    }
+    if( p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay < 0 && p_ts->i_rate != p_ts->i_rate_source )
+    {
+        const int canc = vlc_savecancel();
+
+        /* Auto reset to rate 1.0 */
+        msg_Warn( p_ts->p_input, "es out timeshift: auto reset rate to %d", p_ts->i_rate_source );
+
+        p_ts->i_cmd_delay = 0;
+        p_ts->i_buffering_delay = 0;
+
+        p_ts->i_rate_delay = 0;
+        p_ts->i_rate_date = -1;
+        p_ts->i_rate = p_ts->i_rate_source;
+
+        if( !es_out_SetRate( p_ts->p_out, p_ts->i_rate_source, p_ts->i_rate ) )
+        {
+            vlc_value_t val = { .i_int = p_ts->i_rate };
+            /* Warn back input
+             * FIXME it is perfectly safe BUT it is ugly as it may hide a
+             * rate change requested by user */
+            input_ControlPushHelper( p_ts->p_input, INPUT_CONTROL_SET_RATE, &val );
+        }
+
+        vlc_restorecancel( canc );
+    }
+    return p_cmd->i_date + p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay;
+}
 
 static void *TsRun( void *p_data )
 {
     ts_thread_t *p_ts = p_data;
     vlc_tick_t i_buffering_date = -1;
+    bool b_restart = false;
 
     for( ;; )
     {
         ts_cmd_t cmd;
-        vlc_tick_t  i_deadline;
+        vlc_tick_t  i_deadline = VLC_TICK_INVALID;
         bool b_buffering;
+        bool b_execute = true;
+        int i_flags;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -1011,7 +1136,11 @@ static void *TsRun( void *p_data )
             const int canc = vlc_savecancel();
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
-            if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
+            /* Skipped commands are handled even when paused, so that the
+             * storage does not grow over its limit */
+            if( ( !p_ts->b_paused || b_buffering ||
+                  vlc_timeshift_storage_IsSkipping( p_ts->p_storage ) ) &&
+                !TsPopCmdLocked( p_ts, &cmd, false, &i_flags ) )
             {
                 vlc_restorecancel( canc );
                 break;
@@ -1021,273 +1150,75 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
-        if( b_buffering && i_buffering_date < 0 )
+        if( i_flags & VLC_TIMESHIFT_DISCONTINUITY )
+            b_restart = true;
+
+        if( i_flags & VLC_TIMESHIFT_SKIP )
         {
-            i_buffering_date = cmd.i_date;
+            /* Commands skipped by a seek forward are executed at once,
+             * except the data and the clock */
+            b_execute = !(i_flags & VLC_TIMESHIFT_REPLAY) &&
+                        cmd.i_type != C_SEND && !CmdIsClock( &cmd );
         }
-        else if( i_buffering_date > 0 )
+        else if( i_flags & VLC_TIMESHIFT_REPLAY )
         {
-            p_ts->i_buffering_delay += i_buffering_date - cmd.i_date; /* It is < 0 */
-            if( b_buffering )
-                i_buffering_date = cmd.i_date;
-            else
-                i_buffering_date = -1;
+            /* Only the data and the clock are sent again after a seek
+             * back, the other commands were already executed */
+            b_execute = CmdIsReplayable( &cmd );
         }
 
-        if( p_ts->i_rate_date < 0 )
-            p_ts->i_rate_date = cmd.i_date;
-
-        p_ts->i_rate_delay = 0;
-        if( p_ts->i_rate_source != p_ts->i_rate )
-        {
-            const vlc_tick_t i_duration = cmd.i_date - p_ts->i_rate_date;
-            p_ts->i_rate_delay = i_duration * p_ts->i_rate / p_ts->i_rate_source - i_duration;
-        }
-        if( p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay < 0 && p_ts->i_rate != p_ts->i_rate_source )
+        if( b_execute && !(i_flags & VLC_TIMESHIFT_SKIP) )
         {
-            const int canc = vlc_savecancel();
-
-            /* Auto reset to rate 1.0 */
-            msg_Warn( p_ts->p_input, "es out timeshift: auto reset rate to %d", p_ts->i_rate_source );
-
-            p_ts->i_cmd_delay = 0;
-            p_ts->i_buffering_delay = 0;
+            if( b_restart )
+            {
+                const int canc = vlc_savecancel();
 
-            p_ts->i_rate_delay = 0;
-            p_ts->i_rate_date = -1;
-            p_ts->i_rate = p_ts->i_rate_source;
+                /* Restart the playback from this command after a seek */
+                es_out_Control( p_ts->p_out, ES_OUT_RESET_PCR );
+                p_ts->i_cmd_delay = vlc_tick_now() - cmd.i_date;
+                p_ts->i_buffering_delay = 0;
+                p_ts->i_rate_date = -1;
+                i_buffering_date = -1;
+                b_restart = false;
 
-            if( !es_out_SetRate( p_ts->p_out, p_ts->i_rate_source, p_ts->i_rate ) )
-            {
-                vlc_value_t val = { .i_int = p_ts->i_rate };
-                /* Warn back input
-                 * FIXME it is perfectly safe BUT it is ugly as it may hide a
-                 * rate change requested by user */
-                input_ControlPushHelper( p_ts->p_input, INPUT_CONTROL_SET_RATE, &val );
+                vlc_restorecancel( canc );
             }
 
-            vlc_restorecancel( canc );
+            i_deadline = TsGetDeadlineLocked( p_ts, &cmd, b_buffering,
+                                              &i_buffering_date );
         }
-        i_deadline = cmd.i_date + p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay;
 
         vlc_cleanup_pop();
         vlc_mutex_unlock( &p_ts->lock );
 
-        /* Regulate the speed of command processing to the same one than
-         * reading  */
-        vlc_cleanup_push( cmd_cleanup_routine, &cmd );
-
-        vlc_tick_wait( i_deadline );
-
-        vlc_cleanup_pop();
-
-        /* Execute the command  */
-        const int canc = vlc_savecancel();
-        switch( cmd.i_type )
+        if( !b_execute )
         {
-        case C_ADD:
-            CmdExecuteAdd( p_ts->p_out, &cmd );
-            CmdCleanAdd( &cmd );
-            break;
-        case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
-            CmdCleanSend( &cmd );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
-            CmdCleanControl( &cmd );
-            break;
-        case C_DEL:
-            CmdExecuteDel( p_ts->p_out, &cmd );
-            break;
-        default:
-            vlc_assert_unreachable();
-            break;
+            /* Replayed commands were already cleaned */
+            if( !(i_flags & VLC_TIMESHIFT_REPLAY) )
+                CmdClean( &cmd );
+            else if( cmd.i_type == C_SEND )
+                CmdCleanSend( &cmd );
+            continue;
         }
-        vlc_restorecancel( canc );
-    }
-
-    return NULL;
-}
-
-/*****************************************************************************
- *
- *****************************************************************************/
-static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
-{
-    ts_storage_t *p_storage = malloc( sizeof (*p_storage) );
-    if( unlikely(p_storage == NULL) )
-        return NULL;
-
-    char *psz_file;
-    int fd = GetTmpFile( &psz_file, psz_tmp_path );
-    if( fd == -1 )
-    {
-        free( p_storage );
-        return NULL;
-    }
 
-    p_storage->p_filew = fdopen( fd, "w+b" );
-    if( p_storage->p_filew == NULL )
-    {
-        vlc_close( fd );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-    p_storage->p_filer = vlc_fopen( psz_file, "rb" );
-    if( p_storage->p_filer == NULL )
-    {
-        fclose( p_storage->p_filew );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-#ifndef _WIN32
-    vlc_unlink( psz_file );
-    free( psz_file );
-#else
-    p_storage->psz_file = psz_file;
-#endif
-    p_storage->p_next = NULL;
-
-    /* */
-    p_storage->i_file_max = i_tmp_size_max;
-    p_storage->i_file_size = 0;
-
-    /* */
-    p_storage->i_cmd_w = 0;
-    p_storage->i_cmd_r = 0;
-    p_storage->i_cmd_max = 30000;
-    p_storage->p_cmd = vlc_alloc( p_storage->i_cmd_max, sizeof(*p_storage->p_cmd) );
-    //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
-
-    if( !p_storage->p_cmd )
-    {
-        TsStorageDelete( p_storage );
-        return NULL;
-    }
-    return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
-}
-
-static void TsStorageDelete( ts_storage_t *p_storage )
-{
-    while( p_storage->i_cmd_r < p_storage->i_cmd_w )
-    {
-        ts_cmd_t cmd;
-
-        TsStoragePopCmd( p_storage, &cmd, true );
-
-        CmdClean( &cmd );
-    }
-    free( p_storage->p_cmd );
-
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
-#ifdef _WIN32
-    vlc_unlink( p_storage->psz_file );
-    free( p_storage->psz_file );
-#endif
-    free( p_storage );
-}
-
-static void TsStoragePack( ts_storage_t *p_storage )
-{
-    /* Try to release a bit of memory */
-    if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
-        return;
-
-    p_storage->i_cmd_max = __MAX( p_storage->i_cmd_w, 1 );
-
-    ts_cmd_t *p_new = realloc( p_storage->p_cmd, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
-    if( p_new )
-        p_storage->p_cmd = p_new;
-}
-static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
-{
-    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
-    {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
-
-        if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
-            return true;
-    }
-    return p_storage->i_cmd_w >= p_storage->i_cmd_max;
-}
-static bool TsStorageIsEmpty( ts_storage_t *p_storage )
-{
-    return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
-}
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
-{
-    ts_cmd_t cmd = *p_cmd;
-
-    assert( !TsStorageIsFull( p_storage, p_cmd ) );
+        if( i_deadline != VLC_TICK_INVALID )
+        {
+            /* Regulate the speed of command processing to the same one than
+             * reading  */
+            vlc_cleanup_push( cmd_cleanup_routine, &cmd );
 
-    if( cmd.i_type == C_SEND )
-    {
-        block_t *p_block = cmd.u.send.p_block;
+            vlc_tick_wait( i_deadline );
 
-        cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
-
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
-        {
-            block_Release( p_block );
-            return;
-        }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
-        {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
+            vlc_cleanup_pop();
         }
-        p_storage->i_file_size += p_block->i_buffer;
-        block_Release( p_block );
 
-        if( b_flush )
-            fflush( p_storage->p_filew );
+        /* Execute the command  */
+        const int canc = vlc_savecancel();
+        TsExecuteCmd( p_ts, &cmd );
+        vlc_restorecancel( canc );
     }
-    p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
-}
-static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
-{
-    assert( !TsStorageIsEmpty( p_storage ) );
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
-    {
-        block_t block;
-
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
-        {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
-            p_cmd->u.send.p_block = p_block;
-        }
-        else
-        {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
-        }
-    }
+    return NULL;
 }
 
 /*****************************************************************************
@@ -1314,6 +1245,31 @@ static void CmdClean( ts_cmd_t *p_cmd )
     }
 }
 
+/* Commands driving the clock, useless when skipped */
+static bool CmdIsClock( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Commands that do not own resources and can be executed again */
+static bool CmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    return p_cmd->i_type == C_SEND || CmdIsClock( p_cmd ) ||
+           ( p_cmd->i_type == C_CONTROL &&
+             p_cmd->u.control.i_query == ES_OUT_SET_TIMES );
+}
+
 static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_fmt, bool b_copy )
 {
     p_cmd->i_type = C_ADD;
@@ -1651,30 +1607,3 @@ static void CmdCleanControl( ts_cmd_t *p_cmd )
         break;
     }
 }
-
-static int GetTmpFile( char **filename, const char *dirname )
-{
-    if( dirname != NULL
-     && asprintf( filename, "%s"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX",
-                  dirname ) >= 0 )
-    {
-        vlc_mkdir( dirname, 0700 );
-
-        int fd = vlc_mkstemp( *filename );
-        if( fd != -1 )
-            return fd;
-
-        free( *filename );
-    }
-
-    *filename = strdup( DIR_SEP"tmp"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX" );
-    if( unlikely(*filename == NULL) )
-        return -1;
-
-    int fd = vlc_mkstemp( *filename );
-    if( fd != -1 )
-        return fd;
-
-    free( *filename );
-    return -1;
-}
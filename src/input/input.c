@@ -1938,6 +1938,17 @@ static bool Control( input_thread_t *p_input,
                 break;
             }
 
+            /* Seek in the timeshift buffer when it is in use: the demuxer
+             * is ahead of the playback */
+            const vlc_tick_t i_delta = absolute
+                ? param.time.i_val - var_GetInteger( p_input, "time" )
+                : param.time.i_val;
+            if( es_out_JumpTimeshift( priv->p_es_out, i_delta ) == VLC_SUCCESS )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_Control( priv->p_es_out, ES_OUT_RESET_PCR );
 
@@ -31,6 +31,7 @@
 #include <vlc_demux.h>
 #include <vlc_input.h>
 #include <vlc_viewpoint.h>
+#include <vlc_atomic.h>
 #include <libvlc.h>
 #include "input_interface.h"
 #include "misc/interrupt.h"
@@ -352,15 +353,76 @@ struct input_stats {
     atomic_uintmax_t demux_discontinuity;
     atomic_uintmax_t decoded_audio;
     atomic_uintmax_t decoded_video;
+    atomic_uintmax_t packetizer_time;
+    atomic_uintmax_t decoder_time;
+    atomic_uintmax_t video_decode_time[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t audio_decode_time[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t video_fifo_depth[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t audio_fifo_depth[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t picture_wait[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t vout_latency[INPUT_STATS_HISTOGRAM_SIZE];
     atomic_uintmax_t played_abuffers;
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    atomic_uintmax_t aout_drift[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t aout_latency[INPUT_STATS_HISTOGRAM_SIZE];
+    atomic_uintmax_t aout_resampled;
+    atomic_uintmax_t aout_silences;
+    atomic_uintmax_t aout_flushes;
+    vlc_atomic_float aout_resampling;
+    vlc_atomic_float loudness_momentary;
+    vlc_atomic_float loudness_shortterm;
+    vlc_atomic_float loudness_integrated;
+    vlc_atomic_float loudness_true_peak;
 };
 
 struct input_stats *input_stats_Create(void);
 void input_stats_Destroy(struct input_stats *);
 void input_rate_Add(input_rate_t *, uintmax_t);
+void input_rate_AddBatch(input_rate_t *, uintmax_t, uintmax_t);
 void input_stats_Compute(struct input_stats *, input_stats_t*);
 
+/** Returns the histogram bin of a non-negative value */
+static inline unsigned input_stats_Bin(uintmax_t value, unsigned bins)
+{
+    unsigned bin = 0;
+
+    while (value > 0 && bin < bins - 1)
+    {
+        value >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+/**
+ * Counts a value in a histogram, without locking.
+ *
+ * \param hist histogram of INPUT_STATS_HISTOGRAM_SIZE bins
+ * \param value number of elements, or duration in milliseconds
+ */
+static inline void input_stats_AddHistogram(atomic_uintmax_t *hist,
+                                            uintmax_t value)
+{
+    unsigned bin = input_stats_Bin(value, INPUT_STATS_HISTOGRAM_SIZE);
+
+    atomic_fetch_add_explicit(&hist[bin], 1, memory_order_relaxed);
+}
+
+/** Counts a signed duration in a histogram, without locking */
+static inline void input_stats_AddSignedHistogram(atomic_uintmax_t *hist,
+                                                  vlc_tick_t duration)
+{
+    const unsigned half = INPUT_STATS_HISTOGRAM_SIZE / 2;
+    unsigned bin;
+
+    if (duration >= 0)
+        bin = half + input_stats_Bin(MS_FROM_VLC_TICK(duration), half);
+    else
+        bin = half - 1 - input_stats_Bin(MS_FROM_VLC_TICK(-duration), half);
+
+    atomic_fetch_add_explicit(&hist[bin], 1, memory_order_relaxed);
+}
+
 #endif
@@ -0,0 +1,449 @@
+/*****************************************************************************
+ * seekindex.c: persistent demuxer seek index cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+#include <vlc_seekindex.h>
+
+/*
+ * File layout (integers are little endian):
+ *
+ *  8 bytes  magic
+ *  4 bytes  demuxer index version
+ *  8 bytes  file size
+ *  8 bytes  file modification time (seconds)
+ *  4 bytes  URL length, followed by the URL (not nul-terminated)
+ *  8 bytes  entry count, followed by the entries
+ *  4 bytes  checksum of the entries
+ *
+ * Each entry is a sequence of variable length integers (7 bits per byte,
+ * least significant first): the time and offset as zig-zag encoded
+ * differences from the previous entry, then the size, track and flags.
+ * Typical entries thus take 5 to 10 bytes instead of 32.
+ */
+static const char magic[8] = { 'V', 'L', 'C', 'S', 'I', 'D', 'X', '1' };
+
+/* Largest cache file that will be loaded */
+#define SEEKINDEX_MAX_FILE (256 << 20)
+
+struct vlc_seekindex
+{
+    vlc_object_t *obj;
+    char *url;
+    char *path;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t version;
+
+    vlc_seekindex_entry_t *entries;
+    size_t count;
+    size_t max;
+};
+
+#undef vlc_seekindex_New
+vlc_seekindex_t *vlc_seekindex_New(vlc_object_t *obj, stream_t *s,
+                                   const char *name, uint32_t version)
+{
+    if (!var_InheritBool(obj, "seek-index-cache") || s->psz_url == NULL)
+        return NULL;
+
+    /* Only local files have a known modification time */
+    char *filepath = vlc_uri2path(s->psz_url);
+    if (filepath == NULL)
+        return NULL;
+
+    struct stat st;
+    int val = vlc_stat(filepath, &st);
+    free(filepath);
+    if (val != 0 || !S_ISREG(st.st_mode))
+        return NULL;
+
+    uint64_t size;
+    if (vlc_stream_GetSize(s, &size) || size != (uint64_t)st.st_size)
+        return NULL;
+
+    vlc_seekindex_t *idx = malloc(sizeof (*idx));
+    if (unlikely(idx == NULL))
+        return NULL;
+
+    char *cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    struct md5_s md5;
+    char *hash;
+
+    InitMD5(&md5);
+    AddMD5(&md5, name, strlen(name) + 1);
+    AddMD5(&md5, s->psz_url, strlen(s->psz_url));
+    EndMD5(&md5);
+    hash = psz_md5_hash(&md5);
+
+    idx->url = strdup(s->psz_url);
+    if (cachedir == NULL || hash == NULL
+     || asprintf(&idx->path, "%s" DIR_SEP "seekindex" DIR_SEP "%s.idx",
+                 cachedir, hash) == -1)
+        idx->path = NULL;
+    free(hash);
+    free(cachedir);
+
+    if (unlikely(idx->url == NULL || idx->path == NULL))
+    {
+        free(idx->path);
+        free(idx->url);
+        free(idx);
+        return NULL;
+    }
+
+    idx->obj = obj;
+    idx->size = size;
+    idx->mtime = st.st_mtime;
+    idx->version = version;
+    idx->entries = NULL;
+    idx->count = 0;
+    idx->max = 0;
+    return idx;
+}
+
+void vlc_seekindex_Delete(vlc_seekindex_t *idx)
+{
+    free(idx->entries);
+    free(idx->path);
+    free(idx->url);
+    free(idx);
+}
+
+void vlc_seekindex_Reset(vlc_seekindex_t *idx)
+{
+    idx->count = 0;
+}
+
+int vlc_seekindex_Append(vlc_seekindex_t *idx,
+                         const vlc_seekindex_entry_t *entry)
+{
+    if (idx->count >= idx->max)
+    {
+        size_t max = idx->max ? idx->max * 2 : 1024;
+        vlc_seekindex_entry_t *entries;
+
+        if (unlikely(max > SIZE_MAX / sizeof (*entries)))
+            return VLC_ENOMEM;
+        entries = realloc(idx->entries, max * sizeof (*entries));
+        if (unlikely(entries == NULL))
+            return VLC_ENOMEM;
+        idx->entries = entries;
+        idx->max = max;
+    }
+    idx->entries[idx->count++] = *entry;
+    return VLC_SUCCESS;
+}
+
+const vlc_seekindex_entry_t *
+vlc_seekindex_GetEntries(const vlc_seekindex_t *idx, size_t *count)
+{
+    *count = idx->count;
+    return idx->entries;
+}
+
+const vlc_seekindex_entry_t *
+vlc_seekindex_Find(const vlc_seekindex_t *idx, uint32_t track,
+                   vlc_tick_t time)
+{
+    size_t lo = 0, hi = idx->count;
+
+    /* First entry after the time */
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (idx->entries[mid].time <= time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    while (lo > 0)
+    {
+        const vlc_seekindex_entry_t *entry = &idx->entries[--lo];
+
+        if (entry->track == track)
+            return entry;
+    }
+    return NULL;
+}
+
+/*
+ * Serialization
+ */
+
+static uint64_t ZigZag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t UnZigZag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t *PutVarint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        *(p++) = v | 0x80;
+        v >>= 7;
+    }
+    *(p++) = v;
+    return p;
+}
+
+static const uint8_t *GetVarint(const uint8_t *p, const uint8_t *end,
+                                uint64_t *pv)
+{
+    uint64_t v = 0;
+
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t b = *(p++);
+
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *pv = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t Checksum(const uint8_t *p, size_t len)
+{   /* Adler-32 */
+    uint32_t a = 1, b = 0;
+
+    while (len > 0)
+    {
+        size_t n = len < 5552 ? len : 5552;
+
+        len -= n;
+        while (n-- > 0)
+        {
+            a += *(p++);
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+#define HEADER_SIZE (sizeof (magic) + 4 + 8 + 8 + 4)
+#define ENTRY_MAX_SIZE (2 * 10 + 3 * 5)
+
+static void CreateDir(const char *path)
+{
+    char dir[strlen(path) + 1];
+
+    strcpy(dir, path);
+    for (char *p = dir + 1; *p; p++)
+    {
+        if (*p != DIR_SEP_CHAR)
+            continue;
+        *p = '\0';
+        vlc_mkdir(dir, 0700);
+        *p = DIR_SEP_CHAR;
+    }
+}
+
+int vlc_seekindex_Store(vlc_seekindex_t *idx)
+{
+    size_t urllen = strlen(idx->url);
+    size_t bufsize;
+
+    if (mul_overflow(idx->count, ENTRY_MAX_SIZE, &bufsize)
+     || add_overflow(bufsize, HEADER_SIZE + urllen + 8 + 4, &bufsize))
+        return VLC_ENOMEM;
+
+    uint8_t *buf = malloc(bufsize);
+    if (unlikely(buf == NULL))
+        return VLC_ENOMEM;
+
+    uint8_t *p = buf;
+    memcpy(p, magic, sizeof (magic));
+    p += sizeof (magic);
+    SetDWLE(p, idx->version);
+    SetQWLE(p + 4, idx->size);
+    SetQWLE(p + 12, idx->mtime);
+    SetDWLE(p + 20, urllen);
+    p += 24;
+    memcpy(p, idx->url, urllen);
+    p += urllen;
+    SetQWLE(p, idx->count);
+    p += 8;
+
+    uint8_t *start = p;
+    vlc_tick_t time = 0;
+    uint64_t offset = 0;
+
+    for (size_t i = 0; i < idx->count; i++)
+    {
+        const vlc_seekindex_entry_t *entry = &idx->entries[i];
+
+        p = PutVarint(p, ZigZag(entry->time - time));
+        p = PutVarint(p, ZigZag(entry->offset - offset));
+        p = PutVarint(p, entry->size);
+        p = PutVarint(p, entry->track);
+        p = PutVarint(p, entry->flags);
+        time = entry->time;
+        offset = entry->offset;
+    }
+    SetDWLE(p, Checksum(start, p - start));
+    p += 4;
+
+    /* Write to a temporary file, and rename it so that readers never see a
+     * partial index */
+    char *tmp;
+    int ret = VLC_EGENERIC;
+
+    if (asprintf(&tmp, "%s.part", idx->path) == -1)
+    {
+        free(buf);
+        return VLC_ENOMEM;
+    }
+
+    CreateDir(idx->path);
+
+    FILE *stream = vlc_fopen(tmp, "wb");
+    if (stream != NULL)
+    {
+        size_t len = p - buf;
+        bool ok = fwrite(buf, 1, len, stream) == len;
+
+        if (fclose(stream) == 0 && ok && vlc_rename(tmp, idx->path) == 0)
+        {
+            msg_Dbg(idx->obj, "stored %zu seek index entries in %s",
+                    idx->count, idx->path);
+            ret = VLC_SUCCESS;
+        }
+        else
+            vlc_unlink(tmp);
+    }
+
+    if (ret != VLC_SUCCESS)
+        msg_Warn(idx->obj, "cannot store seek index %s: %s", idx->path,
+                 vlc_strerror_c(errno));
+    free(tmp);
+    free(buf);
+    return ret;
+}
+
+static int Parse(vlc_seekindex_t *idx, const uint8_t *p, size_t len)
+{
+    const uint8_t *end = p + len;
+    size_t urllen = strlen(idx->url);
+
+    if (len < HEADER_SIZE + urllen + 8 + 4
+     || memcmp(p, magic, sizeof (magic)))
+        return VLC_EGENERIC;
+    p += sizeof (magic);
+
+    if (GetDWLE(p) != idx->version
+     || GetQWLE(p + 4) != idx->size
+     || (int64_t)GetQWLE(p + 12) != idx->mtime
+     || GetDWLE(p + 20) != urllen
+     || memcmp(p + 24, idx->url, urllen))
+        return VLC_EGENERIC;
+    p += 24 + urllen;
+
+    uint64_t count = GetQWLE(p);
+    p += 8;
+    end -= 4;
+    if (Checksum(p, end - p) != GetDWLE(end))
+        return VLC_EGENERIC;
+
+    vlc_seekindex_entry_t entry = { 0, 0, 0, 0, 0 };
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t v[5];
+
+        for (unsigned j = 0; j < 5; j++)
+        {
+            p = GetVarint(p, end, &v[j]);
+            if (p == NULL)
+                return VLC_EGENERIC;
+        }
+        if (v[2] > UINT32_MAX || v[3] > UINT32_MAX || v[4] > UINT32_MAX)
+            return VLC_EGENERIC;
+
+        entry.time += UnZigZag(v[0]);
+        entry.offset += UnZigZag(v[1]);
+        entry.size = v[2];
+        entry.track = v[3];
+        entry.flags = v[4];
+        if (vlc_seekindex_Append(idx, &entry))
+            return VLC_ENOMEM;
+    }
+    return (p == end) ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+int vlc_seekindex_Load(vlc_seekindex_t *idx)
+{
+    vlc_seekindex_Reset(idx);
+
+    FILE *stream = vlc_fopen(idx->path, "rb");
+    if (stream == NULL)
+        return VLC_EGENERIC;
+
+    int ret = VLC_EGENERIC;
+    struct stat st;
+
+    if (fstat(fileno(stream), &st) == 0 && st.st_size > 0
+     && st.st_size <= SEEKINDEX_MAX_FILE)
+    {
+        size_t len = st.st_size;
+        uint8_t *buf = malloc(len);
+
+        if (likely(buf != NULL))
+        {
+            if (fread(buf, 1, len, stream) == len)
+                ret = Parse(idx, buf, len);
+            free(buf);
+        }
+    }
+    fclose(stream);
+
+    if (ret == VLC_SUCCESS)
+        msg_Dbg(idx->obj, "loaded %zu seek index entries from %s",
+                idx->count, idx->path);
+    else
+        vlc_seekindex_Reset(idx);
+    return ret;
+}
@@ -25,6 +25,7 @@
 # include "config.h"
 #endif
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -64,10 +65,34 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->demux_discontinuity, 0);
     atomic_init(&stats->decoded_audio, 0);
     atomic_init(&stats->decoded_video, 0);
+    atomic_init(&stats->packetizer_time, 0);
+    atomic_init(&stats->decoder_time, 0);
+    for (size_t i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++)
+    {
+        atomic_init(&stats->video_decode_time[i], 0);
+        atomic_init(&stats->audio_decode_time[i], 0);
+        atomic_init(&stats->video_fifo_depth[i], 0);
+        atomic_init(&stats->audio_fifo_depth[i], 0);
+        atomic_init(&stats->picture_wait[i], 0);
+        atomic_init(&stats->vout_latency[i], 0);
+    }
     atomic_init(&stats->played_abuffers, 0);
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    for (size_t i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++)
+    {
+        atomic_init(&stats->aout_drift[i], 0);
+        atomic_init(&stats->aout_latency[i], 0);
+    }
+    atomic_init(&stats->aout_resampled, 0);
+    atomic_init(&stats->aout_silences, 0);
+    atomic_init(&stats->aout_flushes, 0);
+    vlc_atomic_init_float(&stats->aout_resampling, 1.f);
+    vlc_atomic_init_float(&stats->loudness_momentary, NAN);
+    vlc_atomic_init_float(&stats->loudness_shortterm, NAN);
+    vlc_atomic_init_float(&stats->loudness_integrated, NAN);
+    vlc_atomic_init_float(&stats->loudness_true_peak, NAN);
     return stats;
 }
 
@@ -103,6 +128,49 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                  memory_order_relaxed);
     st->i_lost_abuffers = atomic_load_explicit(&stats->lost_abuffers,
                                                memory_order_relaxed);
+    for (size_t i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++)
+    {
+        st->i_aout_drift[i] = atomic_load_explicit(&stats->aout_drift[i],
+                                                   memory_order_relaxed);
+        st->i_aout_latency[i] = atomic_load_explicit(&stats->aout_latency[i],
+                                                     memory_order_relaxed);
+    }
+    st->i_aout_resampled_abuffers =
+        atomic_load_explicit(&stats->aout_resampled, memory_order_relaxed);
+    st->i_aout_silences = atomic_load_explicit(&stats->aout_silences,
+                                               memory_order_relaxed);
+    st->i_aout_flushes = atomic_load_explicit(&stats->aout_flushes,
+                                              memory_order_relaxed);
+    st->f_aout_resampling = vlc_atomic_load_float(&stats->aout_resampling);
+    st->f_loudness_momentary =
+        vlc_atomic_load_float(&stats->loudness_momentary);
+    st->f_loudness_shortterm =
+        vlc_atomic_load_float(&stats->loudness_shortterm);
+    st->f_loudness_integrated =
+        vlc_atomic_load_float(&stats->loudness_integrated);
+    st->f_loudness_true_peak =
+        vlc_atomic_load_float(&stats->loudness_true_peak);
+
+    /* Decoders */
+    st->i_packetizer_time = atomic_load_explicit(&stats->packetizer_time,
+                                                 memory_order_relaxed);
+    st->i_decoder_time = atomic_load_explicit(&stats->decoder_time,
+                                              memory_order_relaxed);
+    for (size_t i = 0; i < INPUT_STATS_HISTOGRAM_SIZE; i++)
+    {
+        st->i_video_decode_time[i] = atomic_load_explicit(
+                    &stats->video_decode_time[i], memory_order_relaxed);
+        st->i_audio_decode_time[i] = atomic_load_explicit(
+                    &stats->audio_decode_time[i], memory_order_relaxed);
+        st->i_video_fifo_depth[i] = atomic_load_explicit(
+                    &stats->video_fifo_depth[i], memory_order_relaxed);
+        st->i_audio_fifo_depth[i] = atomic_load_explicit(
+                    &stats->audio_fifo_depth[i], memory_order_relaxed);
+        st->i_picture_wait[i] = atomic_load_explicit(&stats->picture_wait[i],
+                                                     memory_order_relaxed);
+        st->i_vout_latency[i] = atomic_load_explicit(&stats->vout_latency[i],
+                                                     memory_order_relaxed);
+    }
 
     /* Vouts */
     st->i_decoded_video = atomic_load_explicit(&stats->decoded_video,
@@ -120,7 +188,18 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
  */
 void input_rate_Add(input_rate_t *counter, uintmax_t val)
 {
-    counter->updates++;
+    input_rate_AddBatch(counter, 1, val);
+}
+
+/** Update a counter element with several updates at once
+ * \param p_counter the counter to update
+ * \param updates the number of updates (e.g. blocks) being accounted
+ * \param val the sum of the values of those updates
+ */
+void input_rate_AddBatch(input_rate_t *counter, uintmax_t updates,
+                         uintmax_t val)
+{
+    counter->updates += updates;
     counter->value += val;
 
     /* Ignore samples within a second of another */
@@ -46,7 +46,7 @@ typedef struct vlc_thumbnailer_params_t
         VLC_THUMBNAILER_SEEK_TIME,
         VLC_THUMBNAILER_SEEK_POS,
     } type;
-    bool fast_seek;
+    enum vlc_thumbnailer_seek_speed speed;
     input_item_t* input_item;
     /**
      * A positive value will be used as the timeout duration
@@ -131,16 +131,28 @@ static int thumbnailer_request_Start( void* owner, void* entity, void** out )
                                      request->params.input_item );
     if ( unlikely( input == NULL ) )
         return VLC_EGENERIC;
+
+    const bool keyframe = request->params.speed == VLC_THUMBNAILER_SEEK_KEYFRAME;
+    var_Create( input, "thumbnail-keyframe", VLC_VAR_BOOL );
+    var_SetBool( input, "thumbnail-keyframe", keyframe );
+    if ( keyframe )
+    {
+        /* Only the keyframes reach the decoder: frame threading would wait
+         * for several of them before outputting the first one. The requests
+         * run in parallel anyway. */
+        var_Create( input, "avcodec-threads", VLC_VAR_INTEGER );
+        var_SetInteger( input, "avcodec-threads", 1 );
+    }
+
+    const bool fast_seek = request->params.speed != VLC_THUMBNAILER_SEEK_PRECISE;
     if ( request->params.type == VLC_THUMBNAILER_SEEK_TIME )
     {
-        input_SetTime( input, request->params.time,
-                       request->params.fast_seek );
+        input_SetTime( input, request->params.time, fast_seek );
     }
     else
     {
         assert( request->params.type == VLC_THUMBNAILER_SEEK_POS );
-        input_SetPosition( input, request->params.pos,
-                       request->params.fast_seek );
+        input_SetPosition( input, request->params.pos, fast_seek );
     }
     if ( input_Start( input ) != VLC_SUCCESS )
         return VLC_EGENERIC;
@@ -214,7 +226,7 @@ vlc_thumbnailer_RequestByTime( vlc_thumbnailer_t *thumbnailer,
             &(const vlc_thumbnailer_params_t){
                 .time = time,
                 .type = VLC_THUMBNAILER_SEEK_TIME,
-                .fast_seek = speed == VLC_THUMBNAILER_SEEK_FAST,
+                .speed = speed,
                 .input_item = input_item,
                 .timeout = timeout,
                 .cb = cb,
@@ -232,7 +244,7 @@ vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *thumbnailer,
             &(const vlc_thumbnailer_params_t){
                 .pos = pos,
                 .type = VLC_THUMBNAILER_SEEK_POS,
-                .fast_seek = speed == VLC_THUMBNAILER_SEEK_FAST,
+                .speed = speed,
                 .input_item = input_item,
                 .timeout = timeout,
                 .cb = cb,
@@ -256,9 +268,15 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
     if ( unlikely( thumbnailer == NULL ) )
         return NULL;
     thumbnailer->parent = parent;
+    /* Each request runs its own input, mostly bound by the decoding: run as
+     * many as there are CPUs by default, the others wait in the queue */
+    int threads = var_InheritInteger( parent, "thumbnail-threads" );
+    if ( threads <= 0 )
+        threads = vlc_GetCPUCount();
+
     struct background_worker_config cfg = {
         .default_timeout = -1,
-        .max_threads = 1,
+        .max_threads = threads,
         .pf_release = thumbnailer_request_Release,
         .pf_hold = thumbnailer_request_Hold,
         .pf_start = thumbnailer_request_Start,
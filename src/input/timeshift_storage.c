@@ -0,0 +1,757 @@
+/*****************************************************************************
+ * timeshift_storage.c: disk storage for the timeshift es_out
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_block.h>
+#include "timeshift_storage.h"
+
+/* Maximum number of records in a segment */
+#define TIMESHIFT_SEGMENT_RECORDS 30000
+
+/* Header of a block written in a segment file */
+struct timeshift_block
+{
+    vlc_tick_t i_dts;
+    vlc_tick_t i_pts;
+    vlc_tick_t i_length;
+    uint32_t   i_flags;
+    unsigned   i_nb_samples;
+    size_t     i_buffer;
+};
+
+/* Time index entry of a record */
+struct timeshift_record
+{
+    vlc_tick_t i_date;
+    size_t     i_offset;    /* Offset of the block in the file */
+    bool       b_block;
+};
+
+/* Position of a record in the storage */
+struct timeshift_pos
+{
+    uint64_t i_seq;         /* Sequence number of the segment */
+    size_t   i_index;       /* Index of the record in the segment */
+};
+
+typedef struct timeshift_segment timeshift_segment_t;
+struct timeshift_segment
+{
+    timeshift_segment_t *p_next;
+    uint64_t i_seq;
+
+#ifdef _WIN32
+    char    *psz_file;      /* Filename */
+#endif
+    int      fd;            /* Written sequentially */
+#ifdef HAVE_MMAP
+    uint8_t *p_map;         /* Read-only mapping, NULL if not mapped */
+    size_t   i_map_size;
+#else
+    int      fd_read;
+#endif
+    size_t   i_file_max;    /* Max size in bytes */
+    size_t   i_file_size;   /* Current size in bytes */
+
+    size_t   i_count;
+    size_t   i_max;
+    struct timeshift_record *p_records;
+    uint8_t  *p_data;       /* Records data, i_record_size bytes each */
+};
+
+struct vlc_timeshift_storage
+{
+    char     *psz_path;
+    size_t   i_segment_size;
+    uint64_t i_max_size;
+    size_t   i_record_size;
+
+    uint64_t i_size;        /* Total size of the files */
+    uint64_t i_next_seq;
+
+    timeshift_segment_t *p_first;   /* Oldest segment */
+    timeshift_segment_t *p_read;    /* Segment of the read position */
+    timeshift_segment_t *p_write;   /* Last segment */
+    size_t   i_first;       /* First record that can be sought to */
+    size_t   i_read;        /* Next record to read */
+
+    struct timeshift_pos done;      /* Records before were popped once */
+    struct timeshift_pos skip;      /* Records before are skipped */
+    bool     b_skip;
+    bool     b_discontinuity;
+};
+
+static int PosCmp( struct timeshift_pos a, struct timeshift_pos b )
+{
+    if( a.i_seq != b.i_seq )
+        return a.i_seq < b.i_seq ? -1 : 1;
+    if( a.i_index != b.i_index )
+        return a.i_index < b.i_index ? -1 : 1;
+    return 0;
+}
+
+/*****************************************************************************
+ * Segments
+ *****************************************************************************/
+static int GetTmpFile( char **filename, const char *dirname )
+{
+    if( dirname != NULL
+     && asprintf( filename, "%s"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX",
+                  dirname ) >= 0 )
+    {
+        vlc_mkdir( dirname, 0700 );
+
+        int fd = vlc_mkstemp( *filename );
+        if( fd != -1 )
+            return fd;
+
+        free( *filename );
+    }
+
+    *filename = strdup( DIR_SEP"tmp"DIR_SEP PACKAGE_NAME"-timeshift.XXXXXX" );
+    if( unlikely(*filename == NULL) )
+        return -1;
+
+    int fd = vlc_mkstemp( *filename );
+    if( fd != -1 )
+        return fd;
+
+    free( *filename );
+    return -1;
+}
+
+static void SegmentDelete( timeshift_segment_t *p_seg )
+{
+#ifdef HAVE_MMAP
+    if( p_seg->p_map != NULL )
+        munmap( p_seg->p_map, p_seg->i_map_size );
+#else
+    vlc_close( p_seg->fd_read );
+#endif
+    vlc_close( p_seg->fd );
+#ifdef _WIN32
+    vlc_unlink( p_seg->psz_file );
+    free( p_seg->psz_file );
+#endif
+    free( p_seg->p_records );
+    free( p_seg->p_data );
+    free( p_seg );
+}
+
+static timeshift_segment_t *SegmentNew( vlc_timeshift_storage_t *p_storage )
+{
+    timeshift_segment_t *p_seg = malloc( sizeof(*p_seg) );
+    if( unlikely(p_seg == NULL) )
+        return NULL;
+
+    char *psz_file;
+    p_seg->fd = GetTmpFile( &psz_file, p_storage->psz_path );
+    if( p_seg->fd == -1 )
+    {
+        free( p_seg );
+        return NULL;
+    }
+
+#ifdef HAVE_MMAP
+    p_seg->p_map = NULL;
+    p_seg->i_map_size = 0;
+#else
+    p_seg->fd_read = vlc_open( psz_file, O_RDONLY );
+    if( p_seg->fd_read == -1 )
+    {
+        vlc_close( p_seg->fd );
+        vlc_unlink( psz_file );
+        free( psz_file );
+        free( p_seg );
+        return NULL;
+    }
+#endif
+
+#ifndef _WIN32
+    vlc_unlink( psz_file );
+    free( psz_file );
+#else
+    p_seg->psz_file = psz_file;
+#endif
+
+    p_seg->p_next = NULL;
+    p_seg->i_seq = p_storage->i_next_seq++;
+    p_seg->i_file_max = p_storage->i_segment_size;
+    p_seg->i_file_size = 0;
+    p_seg->i_count = 0;
+    p_seg->i_max = TIMESHIFT_SEGMENT_RECORDS;
+    p_seg->p_records = vlc_alloc( p_seg->i_max, sizeof(*p_seg->p_records) );
+    p_seg->p_data = vlc_alloc( p_seg->i_max, p_storage->i_record_size );
+    if( !p_seg->p_records || !p_seg->p_data )
+    {
+        SegmentDelete( p_seg );
+        return NULL;
+    }
+    return p_seg;
+}
+
+static void SegmentPack( timeshift_segment_t *p_seg, size_t i_record_size )
+{
+    /* Try to release a bit of memory */
+    if( p_seg->i_count >= p_seg->i_max )
+        return;
+
+    p_seg->i_max = __MAX( p_seg->i_count, 1 );
+
+    struct timeshift_record *p_records =
+        realloc( p_seg->p_records, p_seg->i_max * sizeof(*p_records) );
+    if( p_records )
+        p_seg->p_records = p_records;
+    uint8_t *p_data = realloc( p_seg->p_data, p_seg->i_max * i_record_size );
+    if( p_data )
+        p_seg->p_data = p_data;
+}
+
+static bool SegmentIsFull( const timeshift_segment_t *p_seg, size_t i_size )
+{
+    if( i_size > 0 && p_seg->i_count > 0 &&
+        p_seg->i_file_size + i_size >= p_seg->i_file_max )
+        return true;
+    return p_seg->i_count >= p_seg->i_max;
+}
+
+/* Returns the index of the first record dated at or after i_date */
+static size_t SegmentFind( const timeshift_segment_t *p_seg, size_t i_start,
+                           vlc_tick_t i_date )
+{
+    size_t i_low = i_start, i_high = p_seg->i_count;
+
+    while( i_low < i_high )
+    {
+        size_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_seg->p_records[i_mid].i_date < i_date )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static int WriteFull( int fd, const void *p_data, size_t i_size )
+{
+    const uint8_t *p = p_data;
+
+    while( i_size > 0 )
+    {
+        ssize_t i_ret = write( fd, p, i_size );
+        if( i_ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            return VLC_EGENERIC;
+        }
+        p += i_ret;
+        i_size -= i_ret;
+    }
+    return VLC_SUCCESS;
+}
+
+#ifdef HAVE_MMAP
+static void SegmentUnmap( timeshift_segment_t *p_seg )
+{
+    if( p_seg->p_map != NULL )
+    {
+        munmap( p_seg->p_map, p_seg->i_map_size );
+        p_seg->p_map = NULL;
+        p_seg->i_map_size = 0;
+    }
+}
+
+static const uint8_t *SegmentMap( timeshift_segment_t *p_seg, size_t i_end )
+{
+    if( p_seg->p_map != NULL && p_seg->i_map_size >= i_end )
+        return p_seg->p_map;
+
+    SegmentUnmap( p_seg );
+
+    /* Map the whole segment at once: the file grows up to i_file_max and
+     * only the written part is ever read. A record bigger than the segment
+     * size is alone in its segment and extends the mapping. */
+    const size_t i_size = __MAX( p_seg->i_file_max, i_end );
+    void *p_map = mmap( NULL, i_size, PROT_READ, MAP_SHARED, p_seg->fd, 0 );
+    if( p_map == MAP_FAILED )
+        return NULL;
+
+    p_seg->p_map = p_map;
+    p_seg->i_map_size = i_size;
+    return p_map;
+}
+
+static block_t *SegmentReadBlock( timeshift_segment_t *p_seg, size_t i_offset )
+{
+    struct timeshift_block hdr;
+
+    const uint8_t *p_map = SegmentMap( p_seg, i_offset + sizeof(hdr) );
+    if( p_map == NULL )
+        return NULL;
+    memcpy( &hdr, &p_map[i_offset], sizeof(hdr) );
+
+    p_map = SegmentMap( p_seg, i_offset + sizeof(hdr) + hdr.i_buffer );
+    if( p_map == NULL )
+        return NULL;
+
+    block_t *p_block = block_Alloc( hdr.i_buffer );
+    if( unlikely(p_block == NULL) )
+        return NULL;
+    memcpy( p_block->p_buffer, &p_map[i_offset + sizeof(hdr)], hdr.i_buffer );
+
+    p_block->i_dts        = hdr.i_dts;
+    p_block->i_pts        = hdr.i_pts;
+    p_block->i_length     = hdr.i_length;
+    p_block->i_flags      = hdr.i_flags;
+    p_block->i_nb_samples = hdr.i_nb_samples;
+    return p_block;
+}
+#else
+static void SegmentUnmap( timeshift_segment_t *p_seg )
+{
+    VLC_UNUSED(p_seg);
+}
+
+static int ReadFull( int fd, void *p_data, size_t i_size )
+{
+    uint8_t *p = p_data;
+
+    while( i_size > 0 )
+    {
+        ssize_t i_ret = read( fd, p, i_size );
+        if( i_ret < 0 && errno == EINTR )
+            continue;
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p += i_ret;
+        i_size -= i_ret;
+    }
+    return VLC_SUCCESS;
+}
+
+static block_t *SegmentReadBlock( timeshift_segment_t *p_seg, size_t i_offset )
+{
+    struct timeshift_block hdr;
+
+    if( lseek( p_seg->fd_read, i_offset, SEEK_SET ) == (off_t)-1 ||
+        ReadFull( p_seg->fd_read, &hdr, sizeof(hdr) ) )
+        return NULL;
+
+    block_t *p_block = block_Alloc( hdr.i_buffer );
+    if( unlikely(p_block == NULL) )
+        return NULL;
+    if( ReadFull( p_seg->fd_read, p_block->p_buffer, hdr.i_buffer ) )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    p_block->i_dts        = hdr.i_dts;
+    p_block->i_pts        = hdr.i_pts;
+    p_block->i_length     = hdr.i_length;
+    p_block->i_flags      = hdr.i_flags;
+    p_block->i_nb_samples = hdr.i_nb_samples;
+    return p_block;
+}
+#endif
+
+static int SegmentWriteBlock( timeshift_segment_t *p_seg, const block_t *p_block )
+{
+    const struct timeshift_block hdr = {
+        .i_dts        = p_block->i_dts,
+        .i_pts        = p_block->i_pts,
+        .i_length     = p_block->i_length,
+        .i_flags      = p_block->i_flags,
+        .i_nb_samples = p_block->i_nb_samples,
+        .i_buffer     = p_block->i_buffer,
+    };
+
+    if( WriteFull( p_seg->fd, &hdr, sizeof(hdr) ) ||
+        WriteFull( p_seg->fd, p_block->p_buffer, p_block->i_buffer ) )
+    {
+        /* Drop the partial write, the next block will overwrite it */
+        lseek( p_seg->fd, p_seg->i_file_size, SEEK_SET );
+        return VLC_EGENERIC;
+    }
+    p_seg->i_file_size += sizeof(hdr) + p_block->i_buffer;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Storage
+ *****************************************************************************/
+vlc_timeshift_storage_t *vlc_timeshift_storage_New( const char *psz_path,
+                                                    size_t i_segment_size,
+                                                    uint64_t i_max_size,
+                                                    size_t i_record_size )
+{
+    vlc_timeshift_storage_t *p_storage = malloc( sizeof(*p_storage) );
+    if( unlikely(p_storage == NULL) )
+        return NULL;
+
+    p_storage->psz_path = NULL;
+    if( psz_path != NULL )
+    {
+        p_storage->psz_path = strdup( psz_path );
+        if( unlikely(p_storage->psz_path == NULL) )
+        {
+            free( p_storage );
+            return NULL;
+        }
+    }
+
+    p_storage->i_segment_size = i_segment_size;
+    p_storage->i_max_size = i_max_size;
+    p_storage->i_record_size = i_record_size;
+    p_storage->i_size = 0;
+    p_storage->i_next_seq = 0;
+    p_storage->p_first = NULL;
+    p_storage->p_read = NULL;
+    p_storage->p_write = NULL;
+    p_storage->i_first = 0;
+    p_storage->i_read = 0;
+    p_storage->done = (struct timeshift_pos) { 0, 0 };
+    p_storage->skip = (struct timeshift_pos) { 0, 0 };
+    p_storage->b_skip = false;
+    p_storage->b_discontinuity = false;
+    return p_storage;
+}
+
+void vlc_timeshift_storage_Delete( vlc_timeshift_storage_t *p_storage )
+{
+    while( p_storage->p_first )
+    {
+        timeshift_segment_t *p_next = p_storage->p_first->p_next;
+        SegmentDelete( p_storage->p_first );
+        p_storage->p_first = p_next;
+    }
+    free( p_storage->psz_path );
+    free( p_storage );
+}
+
+static void DropFirstSegment( vlc_timeshift_storage_t *p_storage )
+{
+    timeshift_segment_t *p_seg = p_storage->p_first;
+
+    assert( p_seg != p_storage->p_read );
+    p_storage->p_first = p_seg->p_next;
+    p_storage->i_first = 0;
+    p_storage->i_size -= p_seg->i_file_size;
+    SegmentDelete( p_seg );
+}
+
+/* Keeps the total size under the limit: drops the oldest history first,
+ * then skips whole unread segments until the rest fits in the limit. One
+ * segment of margin is allowed before skipping, so that nothing is skipped
+ * when the reading follows the writing with a full buffer. */
+static void Trim( vlc_timeshift_storage_t *p_storage )
+{
+    if( p_storage->i_max_size == 0 )
+        return;
+
+    while( p_storage->i_size > p_storage->i_max_size &&
+           p_storage->p_first != p_storage->p_read )
+        DropFirstSegment( p_storage );
+
+    if( p_storage->i_size <= p_storage->i_max_size + p_storage->i_segment_size )
+        return;
+
+    /* All the history is gone: the size is the one of the unread segments */
+    uint64_t i_size = p_storage->i_size;
+    timeshift_segment_t *p_seg = p_storage->p_read;
+    while( p_seg != p_storage->p_write && i_size > p_storage->i_max_size )
+    {
+        i_size -= p_seg->i_file_size;
+        p_seg = p_seg->p_next;
+    }
+    if( p_seg == p_storage->p_read )
+        return;
+
+    const struct timeshift_pos next = { p_seg->i_seq, 0 };
+    if( !p_storage->b_skip || PosCmp( p_storage->skip, next ) < 0 )
+    {
+        p_storage->b_skip = true;
+        p_storage->skip = next;
+        p_storage->b_discontinuity = true;
+    }
+}
+
+static void ReadNextSegment( vlc_timeshift_storage_t *p_storage )
+{
+    while( p_storage->i_read >= p_storage->p_read->i_count &&
+           p_storage->p_read->p_next != NULL )
+    {
+        SegmentUnmap( p_storage->p_read );
+        p_storage->p_read = p_storage->p_read->p_next;
+        p_storage->i_read = 0;
+    }
+}
+
+int vlc_timeshift_storage_Push( vlc_timeshift_storage_t *p_storage,
+                                vlc_tick_t i_date, const void *p_record,
+                                block_t *p_block )
+{
+    const size_t i_size = p_block ? sizeof(struct timeshift_block) + p_block->i_buffer
+                                  : 0;
+
+    /* A new segment is only linked once its first record is written, so
+     * that the linked segments are never empty */
+    timeshift_segment_t *p_seg = p_storage->p_write;
+    const bool b_new = !p_seg || SegmentIsFull( p_seg, i_size );
+    if( b_new )
+    {
+        p_seg = SegmentNew( p_storage );
+        if( !p_seg )
+            return VLC_EGENERIC;
+    }
+
+    struct timeshift_record *p_rec = &p_seg->p_records[p_seg->i_count];
+
+    assert( p_seg->i_count == 0 || p_rec[-1].i_date <= i_date );
+    p_rec->i_date = i_date;
+    p_rec->i_offset = p_seg->i_file_size;
+    p_rec->b_block = p_block != NULL;
+
+    if( p_block && SegmentWriteBlock( p_seg, p_block ) )
+    {
+        if( b_new )
+            SegmentDelete( p_seg );
+        return VLC_EGENERIC;
+    }
+
+    if( b_new )
+    {
+        if( !p_storage->p_write )
+        {
+            p_storage->p_first = p_storage->p_read = p_seg;
+            p_storage->i_first = p_storage->i_read = 0;
+            p_storage->done = (struct timeshift_pos) { p_seg->i_seq, 0 };
+        }
+        else
+        {
+            SegmentPack( p_storage->p_write, p_storage->i_record_size );
+            p_storage->p_write->p_next = p_seg;
+        }
+        p_storage->p_write = p_seg;
+    }
+
+    if( p_block )
+    {
+        p_storage->i_size += i_size;
+        block_Release( p_block );
+    }
+
+    memcpy( &p_seg->p_data[p_seg->i_count * p_storage->i_record_size],
+            p_record, p_storage->i_record_size );
+    p_seg->i_count++;
+
+    Trim( p_storage );
+    return VLC_SUCCESS;
+}
+
+bool vlc_timeshift_storage_IsEmpty( vlc_timeshift_storage_t *p_storage )
+{
+    /* Segments are only created with a record */
+    return !p_storage->p_read ||
+           ( p_storage->i_read >= p_storage->p_read->i_count &&
+             !p_storage->p_read->p_next );
+}
+
+static struct timeshift_pos GetReadPos( const vlc_timeshift_storage_t *p_storage )
+{
+    const timeshift_segment_t *p_read = p_storage->p_read;
+
+    if( p_storage->i_read >= p_read->i_count && p_read->p_next )
+        return (struct timeshift_pos) { p_read->p_next->i_seq, 0 };
+    return (struct timeshift_pos) { p_read->i_seq, p_storage->i_read };
+}
+
+bool vlc_timeshift_storage_IsSkipping( vlc_timeshift_storage_t *p_storage )
+{
+    return p_storage->b_skip && !vlc_timeshift_storage_IsEmpty( p_storage ) &&
+           PosCmp( GetReadPos( p_storage ), p_storage->skip ) < 0;
+}
+
+int vlc_timeshift_storage_Pop( vlc_timeshift_storage_t *p_storage,
+                               void *p_record, block_t **pp_block, bool b_data,
+                               int *pi_flags )
+{
+    if( vlc_timeshift_storage_IsEmpty( p_storage ) )
+        return VLC_EGENERIC;
+
+    ReadNextSegment( p_storage );
+
+    timeshift_segment_t *p_seg = p_storage->p_read;
+    const size_t i_index = p_storage->i_read;
+    const struct timeshift_pos pos = { p_seg->i_seq, i_index };
+    const struct timeshift_record *p_rec = &p_seg->p_records[i_index];
+    int i_flags = 0;
+
+    if( PosCmp( pos, p_storage->done ) < 0 )
+        i_flags |= VLC_TIMESHIFT_REPLAY;
+    else
+        p_storage->done = (struct timeshift_pos) { p_seg->i_seq, i_index + 1 };
+
+    if( p_storage->b_skip )
+    {
+        if( PosCmp( pos, p_storage->skip ) < 0 )
+            i_flags |= VLC_TIMESHIFT_SKIP;
+        else
+            p_storage->b_skip = false;
+    }
+    if( !(i_flags & VLC_TIMESHIFT_SKIP) && p_storage->b_discontinuity )
+    {
+        i_flags |= VLC_TIMESHIFT_DISCONTINUITY;
+        p_storage->b_discontinuity = false;
+    }
+
+    memcpy( p_record, &p_seg->p_data[i_index * p_storage->i_record_size],
+            p_storage->i_record_size );
+
+    *pp_block = NULL;
+    if( p_rec->b_block && b_data && !(i_flags & VLC_TIMESHIFT_SKIP) )
+        *pp_block = SegmentReadBlock( p_seg, p_rec->i_offset );
+
+    p_storage->i_read++;
+    if( p_storage->i_read >= p_seg->i_count && p_seg->p_next )
+    {
+        ReadNextSegment( p_storage );
+        Trim( p_storage );
+    }
+
+    *pi_flags = i_flags;
+    return VLC_SUCCESS;
+}
+
+static bool GetFirst( vlc_timeshift_storage_t *p_storage,
+                      timeshift_segment_t **pp_seg, size_t *pi_index )
+{
+    timeshift_segment_t *p_seg = p_storage->p_first;
+    size_t i_index = p_storage->i_first;
+
+    while( p_seg && i_index >= p_seg->i_count )
+    {
+        p_seg = p_seg->p_next;
+        i_index = 0;
+    }
+    if( !p_seg )
+        return false;
+
+    *pp_seg = p_seg;
+    *pi_index = i_index;
+    return true;
+}
+
+int vlc_timeshift_storage_GetDates( vlc_timeshift_storage_t *p_storage,
+                                    vlc_tick_t *pi_first, vlc_tick_t *pi_read,
+                                    vlc_tick_t *pi_last )
+{
+    timeshift_segment_t *p_write = p_storage->p_write;
+    if( !p_write )
+        return VLC_EGENERIC;
+
+    const vlc_tick_t i_last = p_write->p_records[p_write->i_count - 1].i_date;
+    timeshift_segment_t *p_seg;
+    size_t i_index;
+
+    *pi_last = i_last;
+    *pi_first = GetFirst( p_storage, &p_seg, &i_index )
+              ? p_seg->p_records[i_index].i_date : i_last;
+
+    if( vlc_timeshift_storage_IsEmpty( p_storage ) )
+        *pi_read = i_last;
+    else if( p_storage->i_read < p_storage->p_read->i_count )
+        *pi_read = p_storage->p_read->p_records[p_storage->i_read].i_date;
+    else
+        *pi_read = p_storage->p_read->p_next->p_records[0].i_date;
+    return VLC_SUCCESS;
+}
+
+int vlc_timeshift_storage_Seek( vlc_timeshift_storage_t *p_storage,
+                                vlc_tick_t i_date )
+{
+    timeshift_segment_t *p_seg;
+    size_t i_index;
+
+    /* Nothing to seek to: no history and nothing left to read */
+    if( !GetFirst( p_storage, &p_seg, &i_index )
+     || i_date < p_seg->p_records[i_index].i_date )
+        return VLC_EGENERIC;
+
+    /* Find the segment, then the record using the segment time index */
+    while( p_seg->p_next &&
+           p_seg->p_records[p_seg->i_count - 1].i_date < i_date )
+    {
+        p_seg = p_seg->p_next;
+        i_index = 0;
+    }
+    i_index = SegmentFind( p_seg, i_index, i_date );
+
+    const struct timeshift_pos target = { p_seg->i_seq, i_index };
+    const struct timeshift_pos current = GetReadPos( p_storage );
+
+    if( PosCmp( target, current ) < 0 )
+    {
+        if( p_storage->p_read != p_seg )
+            SegmentUnmap( p_storage->p_read );
+        p_storage->p_read = p_seg;
+        p_storage->i_read = i_index;
+        p_storage->b_skip = false;
+    }
+    else if( PosCmp( target, current ) > 0 )
+    {
+        p_storage->b_skip = true;
+        p_storage->skip = target;
+    }
+    p_storage->b_discontinuity = true;
+    return VLC_SUCCESS;
+}
+
+void vlc_timeshift_storage_DropHistory( vlc_timeshift_storage_t *p_storage )
+{
+    if( !p_storage->p_read )
+        return;
+
+    ReadNextSegment( p_storage );
+    while( p_storage->p_first != p_storage->p_read )
+        DropFirstSegment( p_storage );
+    p_storage->i_first = p_storage->i_read;
+}
+
+uint64_t vlc_timeshift_storage_GetSize( vlc_timeshift_storage_t *p_storage )
+{
+    return p_storage->i_size;
+}
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ * timeshift_storage.h: disk storage for the timeshift es_out
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_TIMESHIFT_STORAGE_H
+#define LIBVLC_INPUT_TIMESHIFT_STORAGE_H 1
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+/**
+ * The timeshift storage is a queue of fixed size records (the commands of
+ * the timeshift es_out), each optionally carrying a block whose data is
+ * written to disk.
+ *
+ * Records are stored in a chain of segments, one temporary file each. The
+ * segments are mapped in memory (when supported) to read the blocks back.
+ * Each segment keeps the date of its records, which are increasing, so
+ * that the read position can be moved anywhere by date.
+ *
+ * Records that have been read are kept as history, so that the read
+ * position can go back in time, until the total size of the segments
+ * reaches the configured limit. If the unread records alone exceed the
+ * limit, the oldest ones are skipped.
+ */
+typedef struct vlc_timeshift_storage vlc_timeshift_storage_t;
+
+/** Flags returned with a popped record */
+enum
+{
+    /** The record was already popped once (the read position went back) */
+    VLC_TIMESHIFT_REPLAY        = 0x1,
+    /** The record is before the target of a forward seek or of a skip */
+    VLC_TIMESHIFT_SKIP          = 0x2,
+    /** First record that is not skipped after a seek or a skip */
+    VLC_TIMESHIFT_DISCONTINUITY = 0x4,
+};
+
+/**
+ * Creates an empty storage.
+ *
+ * \param psz_path directory of the temporary files (NULL for the default)
+ * \param i_segment_size maximum size in bytes of a segment file
+ * \param i_max_size maximum total size in bytes of the segments files,
+ *        0 for no limit
+ * \param i_record_size size in bytes of a record
+ */
+vlc_timeshift_storage_t *vlc_timeshift_storage_New( const char *psz_path,
+                                                    size_t i_segment_size,
+                                                    uint64_t i_max_size,
+                                                    size_t i_record_size );
+
+/**
+ * Deletes the storage and its files.
+ *
+ * The records that were never popped are lost: the caller should pop them
+ * first if they own resources.
+ */
+void vlc_timeshift_storage_Delete( vlc_timeshift_storage_t * );
+
+/**
+ * Appends a record.
+ *
+ * \param i_date the record date, not lower than the previous one
+ * \param p_record the record (i_record_size bytes), copied
+ * \param p_block an optional block, written to disk and released on success
+ * \return VLC_SUCCESS, or an error if the record could not be stored (the
+ *         block is then left to the caller)
+ */
+int vlc_timeshift_storage_Push( vlc_timeshift_storage_t *, vlc_tick_t i_date,
+                                const void *p_record, block_t *p_block );
+
+/**
+ * Pops the record at the read position.
+ *
+ * \param p_record filled with the record
+ * \param pp_block filled with the block of the record read back from disk,
+ *        or NULL if it has none, if it is skipped or if b_data is false
+ * \param b_data whether the block data is needed
+ * \param pi_flags filled with VLC_TIMESHIFT_* flags
+ * \return VLC_SUCCESS, or an error if there is nothing to read
+ */
+int vlc_timeshift_storage_Pop( vlc_timeshift_storage_t *, void *p_record,
+                               block_t **pp_block, bool b_data,
+                               int *pi_flags );
+
+/** Returns whether there is no record left to read */
+bool vlc_timeshift_storage_IsEmpty( vlc_timeshift_storage_t * );
+
+/** Returns whether records are being skipped (they should be popped even
+ * when the playback is paused) */
+bool vlc_timeshift_storage_IsSkipping( vlc_timeshift_storage_t * );
+
+/**
+ * Gets the dates of the stored records.
+ *
+ * \param pi_first date of the oldest record that can be sought to
+ * \param pi_read date of the record at the read position (or of the last
+ *        record if there is nothing to read)
+ * \param pi_last date of the last record
+ * \return VLC_SUCCESS, or an error if the storage is empty
+ */
+int vlc_timeshift_storage_GetDates( vlc_timeshift_storage_t *,
+                                    vlc_tick_t *pi_first, vlc_tick_t *pi_read,
+                                    vlc_tick_t *pi_last );
+
+/**
+ * Moves the read position to the first record dated at or after i_date.
+ *
+ * Going forward, the records in between are popped with the
+ * VLC_TIMESHIFT_SKIP flag. Going back, the records popped again have the
+ * VLC_TIMESHIFT_REPLAY flag. A date after the last record moves to the end.
+ *
+ * \return VLC_SUCCESS, or an error if i_date is before the oldest record or
+ *         if there is no record to seek to
+ */
+int vlc_timeshift_storage_Seek( vlc_timeshift_storage_t *, vlc_tick_t i_date );
+
+/**
+ * Forgets the records before the read position: the read position cannot
+ * go back before it anymore.
+ */
+void vlc_timeshift_storage_DropHistory( vlc_timeshift_storage_t * );
+
+/** Returns the total size in bytes of the segments files */
+uint64_t vlc_timeshift_storage_GetSize( vlc_timeshift_storage_t * );
+
+#endif
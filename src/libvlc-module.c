@@ -658,6 +658,12 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define SEEK_INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define SEEK_INDEX_CACHE_LONGTEXT N_( \
+    "Store the seek indexes that demuxers build by scanning local files " \
+    "in the cache directory, so that later opens of the same files can " \
+    "seek without scanning them again." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -697,6 +703,12 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift size")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "This is the maximum total size in MiB of the timeshift temporary " \
+    "files. The oldest part of the timeshift buffer is dropped beyond it. " \
+    "Use 0 for no limit." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -936,6 +948,19 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define PACKETIZER_THREAD_TEXT N_("Packetize video on a separate thread")
+#define PACKETIZER_THREAD_LONGTEXT N_( \
+    "Run the video packetizer and the video decoder on two threads, so " \
+    "that the next frames are parsed while the current one is decoded. " \
+    "This helps with expensive packetizers in front of multi-threaded " \
+    "decoders.")
+
+#define PREROLL_SKIP_TEXT N_("Skip non-reference frames before a precise seek")
+#define PREROLL_SKIP_LONGTEXT N_( \
+    "After a precise seek, the video is decoded from the previous keyframe " \
+    "up to the target without being displayed. Do not decode the frames " \
+    "that no other frame depends on during that time.")
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -1144,12 +1169,32 @@ static const char *const ppsz_prefres[] = {
 
 #define PREPARSE_THREADS_TEXT N_( "Preparsing threads" )
 #define PREPARSE_THREADS_LONGTEXT N_( \
-    "Maximum number of threads used to preparse items" )
+    "Maximum number of threads used to preparse local items " \
+    "(0 for the number of CPUs)" )
+
+#define PREPARSE_NETWORK_THREADS_TEXT N_( "Network preparsing threads" )
+#define PREPARSE_NETWORK_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to preparse network items" )
+
+#define PREPARSE_HOST_THREADS_TEXT N_( "Preparsing threads per host" )
+#define PREPARSE_HOST_THREADS_LONGTEXT N_( \
+    "Maximum number of network items of a same host preparsed at once " \
+    "(0 for no limit)" )
+
+#define PREPARSE_CACHE_SIZE_TEXT N_( "Preparsing cache size" )
+#define PREPARSE_CACHE_SIZE_LONGTEXT N_( \
+    "Number of local files whose preparsing results are kept, to be " \
+    "reused as long as the files are not modified (0 to disable)" )
 
 #define FETCH_ART_THREADS_TEXT N_( "Fetch-art threads" )
 #define FETCH_ART_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to fetch art" )
 
+#define THUMBNAIL_THREADS_TEXT N_( "Thumbnailing threads" )
+#define THUMBNAIL_THREADS_LONGTEXT N_( \
+    "Maximum number of thumbnails generated at once " \
+    "(0 for the number of CPUs)" )
+
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
 static const char *const psz_recursive_list[] = {
@@ -1799,6 +1844,8 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "seek-index-cache", true,
+              SEEK_INDEX_CACHE_TEXT, SEEK_INDEX_CACHE_LONGTEXT, true )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1956,6 +2003,9 @@ vlc_module_begin ()
                   INPUT_TIMESHIFT_PATH_TEXT, INPUT_TIMESHIFT_PATH_LONGTEXT)
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 4096, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1968,6 +2018,10 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_bool( "packetizer-thread", false, PACKETIZER_THREAD_TEXT,
+              PACKETIZER_THREAD_LONGTEXT, true )
+    add_bool( "preroll-skip", true, PREROLL_SKIP_TEXT,
+              PREROLL_SKIP_LONGTEXT, true )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint(N_("Input"), INPUT_CAT_LONGTEXT)
@@ -2139,12 +2193,28 @@ vlc_module_begin ()
     add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
                  PREPARSE_TIMEOUT_LONGTEXT, false )
 
-    add_integer( "preparse-threads", 1, PREPARSE_THREADS_TEXT,
+    add_integer( "preparse-threads", 0, PREPARSE_THREADS_TEXT,
                  PREPARSE_THREADS_LONGTEXT, false )
+        change_integer_range( 0, 64 )
+
+    add_integer( "preparse-network-threads", 4, PREPARSE_NETWORK_THREADS_TEXT,
+                 PREPARSE_NETWORK_THREADS_LONGTEXT, false )
+        change_integer_range( 1, 64 )
+
+    add_integer( "preparse-host-threads", 2, PREPARSE_HOST_THREADS_TEXT,
+                 PREPARSE_HOST_THREADS_LONGTEXT, false )
+        change_integer_range( 0, 64 )
+
+    add_integer( "preparse-cache-size", 1024, PREPARSE_CACHE_SIZE_TEXT,
+                 PREPARSE_CACHE_SIZE_LONGTEXT, false )
 
     add_integer( "fetch-art-threads", 1, FETCH_ART_THREADS_TEXT,
                  FETCH_ART_THREADS_LONGTEXT, false )
 
+    add_integer( "thumbnail-threads", 0, THUMBNAIL_THREADS_TEXT,
+                 THUMBNAIL_THREADS_LONGTEXT, false )
+        change_integer_range( 0, 64 )
+
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
                  METADATA_NETWORK_TEXT, false )
@@ -33,6 +33,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include <vlc_fs.h>
 
 #ifndef NDEBUG
@@ -263,6 +264,108 @@ block_t *block_heap_Alloc (void *addr, size_t length)
     return block_Init(block, &block_heap_cbs, addr, length);
 }
 
+struct block_shared
+{
+    vlc_atomic_rc_t rc;
+    block_t *source;
+};
+
+typedef struct
+{
+    block_t self;
+    struct block_shared *shared;
+} block_slice_t;
+
+static void block_slice_Release (block_t *block)
+{
+    block_slice_t *slice = container_of(block, block_slice_t, self);
+
+    if (vlc_atomic_rc_dec(&slice->shared->rc))
+    {
+        block_Release(slice->shared->source);
+        free(slice->shared);
+    }
+    free(slice);
+}
+
+static const struct vlc_block_callbacks block_slice_cbs =
+{
+    block_slice_Release,
+};
+
+block_t *block_Share (block_t *block)
+{
+    if (block->cbs == &block_slice_cbs)
+        return block;
+
+    block_slice_t *slice = malloc(sizeof (*slice));
+    struct block_shared *shared = malloc(sizeof (*shared));
+    if (unlikely(slice == NULL || shared == NULL))
+    {
+        free(slice);
+        free(shared);
+        return block;
+    }
+
+    vlc_atomic_rc_init(&shared->rc);
+    shared->source = block;
+
+    block_Init(&slice->self, &block_slice_cbs, block->p_buffer, block->i_buffer);
+    block_CopyProperties(&slice->self, block);
+    slice->self.p_next = block->p_next;
+    block->p_next = NULL;
+    slice->shared = shared;
+    return &slice->self;
+}
+
+block_t *block_Slice (block_t *block, size_t offset, size_t length)
+{
+    if (block->cbs != &block_slice_cbs
+     || offset > block->i_buffer || length > block->i_buffer - offset)
+        return NULL;
+
+    block_slice_t *parent = container_of(block, block_slice_t, self);
+    block_slice_t *slice = malloc(sizeof (*slice));
+    if (unlikely(slice == NULL))
+        return NULL;
+
+    vlc_atomic_rc_inc(&parent->shared->rc);
+    block_Init(&slice->self, &block_slice_cbs, block->p_buffer + offset, length);
+    block_CopyProperties(&slice->self, block);
+    slice->shared = parent->shared;
+    return &slice->self;
+}
+
+block_t *block_ChainGatherShared (block_t *list)
+{
+    if (list->cbs != &block_slice_cbs)
+        return block_ChainGather(list);
+
+    const struct block_shared *shared =
+        container_of(list, block_slice_t, self)->shared;
+    size_t total = list->i_buffer;
+    vlc_tick_t length = list->i_length;
+
+    for (const block_t *b = list; b->p_next != NULL; b = b->p_next)
+    {
+        const block_t *next = b->p_next;
+        if (next->cbs != &block_slice_cbs
+         || container_of(next, block_slice_t, self)->shared != shared
+         || next->p_buffer != b->p_buffer + b->i_buffer)
+            return block_ChainGather(list);
+        total += next->i_buffer;
+        length += next->i_length;
+    }
+
+    block_ChainRelease(list->p_next);
+    list->p_next = NULL;
+    /* no spare room, which could overlap other slices */
+    list->p_start = list->p_buffer;
+    list->i_size = list->i_buffer = total;
+    list->i_length = length;
+    return list;
+}
+
 #ifdef HAVE_MMAP
 # include <sys/mman.h>
 
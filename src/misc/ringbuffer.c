@@ -0,0 +1,326 @@
+/*****************************************************************************
+ * ringbuffer.c: lock-free single producer single consumer ring buffer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_ringbuffer.h>
+
+/* Keep the indexes owned by each side in separate cache lines */
+#define CACHE_LINE 64
+
+/*
+ * The read and write indexes increase monotonically and are only reduced
+ * modulo the (power of two) size when accessing the data, so that a full
+ * buffer can be told apart from an empty one.
+ *
+ * The producer cannot move the read index. It requests a flush by storing
+ * the write index in flush_pos and bumping flush_seq. The consumer moves the
+ * read index there on its next read, and acknowledges the request by
+ * copying flush_seq into flush_ack.
+ */
+struct vlc_ringbuffer
+{
+    /* Written by the producer */
+    atomic_size_t write;
+    atomic_size_t flush_pos;
+    atomic_uint flush_seq;
+    char pad1[CACHE_LINE];
+
+    /* Written by the consumer */
+    atomic_size_t read;
+    atomic_uint flush_ack;
+    atomic_int_least64_t played;
+    char pad2[CACHE_LINE];
+
+    bool locked;
+    size_t mask;
+    unsigned char data[];
+};
+
+vlc_ringbuffer_t *vlc_ringbuffer_New(size_t size)
+{
+    size_t capacity = 1;
+
+    while (capacity < size)
+    {
+        if (unlikely(capacity > SIZE_MAX / 2))
+            return NULL;
+        capacity *= 2;
+    }
+
+    if (unlikely(capacity > SIZE_MAX - sizeof (vlc_ringbuffer_t)))
+        return NULL;
+
+    vlc_ringbuffer_t *rb = malloc(sizeof (*rb) + capacity);
+    if (unlikely(rb == NULL))
+        return NULL;
+
+    atomic_init(&rb->write, 0);
+    atomic_init(&rb->flush_pos, 0);
+    atomic_init(&rb->flush_seq, 0);
+    atomic_init(&rb->read, 0);
+    atomic_init(&rb->flush_ack, 0);
+    atomic_init(&rb->played, VLC_TICK_INVALID);
+    rb->mask = capacity - 1;
+    rb->locked = false;
+    return rb;
+}
+
+void vlc_ringbuffer_Delete(vlc_ringbuffer_t *rb)
+{
+#ifdef HAVE_MMAP
+    if (rb->locked)
+        munlock(rb, sizeof (*rb) + rb->mask + 1);
+#endif
+    free(rb);
+}
+
+int vlc_ringbuffer_Lock(vlc_ringbuffer_t *rb)
+{
+#ifdef HAVE_MMAP
+    if (!rb->locked && mlock(rb, sizeof (*rb) + rb->mask + 1) == 0)
+        rb->locked = true;
+    return rb->locked ? VLC_SUCCESS : VLC_EGENERIC;
+#else
+    VLC_UNUSED(rb);
+    return VLC_ENOTSUP;
+#endif
+}
+
+size_t vlc_ringbuffer_GetSize(const vlc_ringbuffer_t *rb)
+{
+    return rb->mask + 1;
+}
+
+/**
+ * Returns the later of two indexes.
+ *
+ * The consumer may have read past the flush position already, if the
+ * producer wrote more data after the flush, before the consumer saw it:
+ * the read index must never go back, or the data would be read again, and
+ * the producer would overwrite data still unread.
+ */
+static size_t vlc_ringbuffer_Max(size_t a, size_t b)
+{
+    /* The indexes wrap around */
+    return (ptrdiff_t)(a - b) > 0 ? a : b;
+}
+
+/** Returns the read index as seen after any pending flush. */
+static size_t vlc_ringbuffer_GetReadIndex(vlc_ringbuffer_t *rb)
+{
+    unsigned ack = atomic_load_explicit(&rb->flush_ack, memory_order_acquire);
+    unsigned seq = atomic_load_explicit(&rb->flush_seq, memory_order_acquire);
+    size_t read = atomic_load_explicit(&rb->read, memory_order_acquire);
+
+    if (ack != seq)
+        return vlc_ringbuffer_Max(read,
+                                  atomic_load_explicit(&rb->flush_pos,
+                                                       memory_order_relaxed));
+    return read;
+}
+
+size_t vlc_ringbuffer_WriteSpace(vlc_ringbuffer_t *rb)
+{
+    /* Flushed data is accounted for until the consumer actually drops it,
+     * as it may still be copying it out. */
+    size_t read = atomic_load_explicit(&rb->read, memory_order_acquire);
+    size_t write = atomic_load_explicit(&rb->write, memory_order_relaxed);
+
+    return rb->mask + 1 - (write - read);
+}
+
+size_t vlc_ringbuffer_Write(vlc_ringbuffer_t *rb, const void *buf, size_t len)
+{
+    size_t read = atomic_load_explicit(&rb->read, memory_order_acquire);
+    size_t write = atomic_load_explicit(&rb->write, memory_order_relaxed);
+    size_t space = rb->mask + 1 - (write - read);
+
+    if (len > space)
+        len = space;
+
+    size_t offset = write & rb->mask;
+    size_t first = rb->mask + 1 - offset;
+
+    if (first > len)
+        first = len;
+
+    memcpy(rb->data + offset, buf, first);
+    memcpy(rb->data, (const unsigned char *)buf + first, len - first);
+
+    atomic_store_explicit(&rb->write, write + len, memory_order_release);
+    return len;
+}
+
+void vlc_ringbuffer_Flush(vlc_ringbuffer_t *rb)
+{
+    size_t write = atomic_load_explicit(&rb->write, memory_order_relaxed);
+
+    atomic_store_explicit(&rb->flush_pos, write, memory_order_relaxed);
+    atomic_fetch_add_explicit(&rb->flush_seq, 1, memory_order_release);
+}
+
+size_t vlc_ringbuffer_ReadSpace(vlc_ringbuffer_t *rb)
+{
+    size_t read = vlc_ringbuffer_GetReadIndex(rb);
+    size_t write = atomic_load_explicit(&rb->write, memory_order_acquire);
+
+    return write - read;
+}
+
+/** Applies any pending flush request and returns the read index. */
+static size_t vlc_ringbuffer_Acquire(vlc_ringbuffer_t *rb)
+{
+    unsigned seq = atomic_load_explicit(&rb->flush_seq, memory_order_acquire);
+    unsigned ack = atomic_load_explicit(&rb->flush_ack, memory_order_relaxed);
+    size_t read = atomic_load_explicit(&rb->read, memory_order_relaxed);
+
+    if (seq != ack)
+    {
+        size_t pos = atomic_load_explicit(&rb->flush_pos,
+                                          memory_order_relaxed);
+
+        read = vlc_ringbuffer_Max(read, pos);
+        atomic_store_explicit(&rb->read, read, memory_order_release);
+        atomic_store_explicit(&rb->flush_ack, seq, memory_order_release);
+    }
+    return read;
+}
+
+size_t vlc_ringbuffer_Read(vlc_ringbuffer_t *rb, void *buf, size_t len)
+{
+    size_t read = vlc_ringbuffer_Acquire(rb);
+    size_t write = atomic_load_explicit(&rb->write, memory_order_acquire);
+
+    if (len > write - read)
+        len = write - read;
+
+    if (buf != NULL)
+    {
+        size_t offset = read & rb->mask;
+        size_t first = rb->mask + 1 - offset;
+
+        if (first > len)
+            first = len;
+
+        memcpy(buf, rb->data + offset, first);
+        memcpy((unsigned char *)buf + first, rb->data, len - first);
+    }
+
+    atomic_store_explicit(&rb->read, read + len, memory_order_release);
+    return len;
+}
+
+static void Deinterleave(float *const *planes, size_t done,
+                         const float *src, unsigned channels, size_t frames)
+{
+    for (unsigned c = 0; c < channels; c++)
+    {
+        float *dst = planes[c] + done;
+
+        for (size_t i = 0; i < frames; i++)
+            dst[i] = src[i * channels + c];
+    }
+}
+
+size_t vlc_ringbuffer_ReadDeinterleave(vlc_ringbuffer_t *rb,
+                                       float *const *planes,
+                                       unsigned channels, size_t frames)
+{
+    const size_t frame_size = channels * sizeof (float);
+    size_t read = vlc_ringbuffer_Acquire(rb);
+    size_t write = atomic_load_explicit(&rb->write, memory_order_acquire);
+    size_t avail = (write - read) / frame_size;
+
+    if (frames > avail)
+        frames = avail;
+
+    size_t done = 0;
+    size_t pos = read;
+
+    while (done < frames)
+    {
+        size_t offset = pos & rb->mask;
+        size_t count = (rb->mask + 1 - offset) / frame_size;
+
+        if (count == 0)
+        {   /* A frame straddles the end of the buffer */
+            float frame[channels];
+            size_t first = rb->mask + 1 - offset;
+
+            memcpy(frame, rb->data + offset, first);
+            memcpy((unsigned char *)frame + first, rb->data,
+                   frame_size - first);
+            Deinterleave(planes, done, frame, channels, 1);
+            count = 1;
+        }
+        else
+        {
+            if (count > frames - done)
+                count = frames - done;
+            /* The data is suitably aligned as long as the producer only
+             * writes whole samples. */
+            assert(offset % sizeof (float) == 0);
+            Deinterleave(planes, done, (const float *)(rb->data + offset),
+                         channels, count);
+        }
+        done += count;
+        pos += count * frame_size;
+    }
+
+    atomic_store_explicit(&rb->read, pos, memory_order_release);
+    return frames;
+}
+
+void vlc_ringbuffer_SetPlayedDate(vlc_ringbuffer_t *rb, vlc_tick_t date)
+{
+    atomic_store_explicit(&rb->played, date, memory_order_relaxed);
+}
+
+vlc_tick_t vlc_ringbuffer_GetDelay(vlc_ringbuffer_t *rb,
+                                   size_t bytes_per_frame, unsigned rate)
+{
+    assert(bytes_per_frame > 0 && rate > 0);
+
+    size_t frames = vlc_ringbuffer_ReadSpace(rb) / bytes_per_frame;
+    vlc_tick_t delay = vlc_tick_from_samples(frames, rate);
+    vlc_tick_t played = atomic_load_explicit(&rb->played,
+                                             memory_order_relaxed);
+
+    if (played != VLC_TICK_INVALID)
+    {
+        vlc_tick_t remaining = played - vlc_tick_now();
+
+        if (remaining > 0)
+            delay += remaining;
+    }
+    return delay;
+}
@@ -23,21 +23,78 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+#include <limits.h>
+#include <sys/stat.h>
+
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include <vlc_arrays.h>
+#include <vlc_cpu.h>
+#include <vlc_fs.h>
+#include <vlc_list.h>
+#include <vlc_meta.h>
+#include <vlc_url.h>
 
 #include "misc/background_worker.h"
+#include "input/info.h"
 #include "input/input_interface.h"
 #include "input/input_internal.h"
+#include "input/item.h"
 #include "preparser.h"
 #include "fetcher.h"
 
+/**
+ * Local items are preparsed by the local worker, mostly bound by the CPU
+ * (demuxers probing), network items by the network worker, mostly waiting
+ * for the I/O. The network requests for a same host are also limited, so
+ * that a slow or overloaded server does not take all the network threads,
+ * the requests over the limit wait in the queue of their host.
+ */
+struct preparser_host
+{
+    struct vlc_list node;
+    struct vlc_list queue; /**< requests waiting for a slot */
+    unsigned running; /**< requests pushed to the network worker */
+    char name[];
+};
+
+/**
+ * Results of the preparsing of a local file, reused as long as the file is
+ * not modified
+ */
+struct preparser_cache_entry
+{
+    struct vlc_list node; /**< in the LRU list, the most recent last */
+    char *uri;
+    int64_t mtime; /**< in nanoseconds if available, in seconds otherwise */
+    uint64_t size;
+
+    /* Only what the preparsing produced, not what the item creator set */
+    vlc_tick_t duration; /**< INPUT_DURATION_UNSET if not changed */
+    vlc_meta_t *meta; /**< the changed meta only */
+    int i_es;
+    es_format_t **es;
+    int i_categories;
+    info_category_t **categories;
+};
+
 struct input_preparser_t
 {
     vlc_object_t* owner;
     input_fetcher_t* fetcher;
-    struct background_worker* worker;
+    struct background_worker* local;
+    struct background_worker* network;
     atomic_bool deactivated;
+
+    vlc_mutex_t lock;
+    struct vlc_list hosts; /**< hosts with running or waiting requests */
+    unsigned host_threads; /**< maximum running requests per host */
+
+    vlc_dictionary_t cache; /**< cache entries by URI */
+    struct vlc_list cache_lru;
+    size_t cache_count;
+    size_t cache_max;
 };
 
 typedef struct input_preparser_req_t
@@ -46,6 +103,13 @@ typedef struct input_preparser_req_t
     const input_preparser_callbacks_t *cbs;
     void *userdata;
     vlc_atomic_rc_t rc;
+
+    input_preparser_t *preparser;
+    struct background_worker *worker;
+    struct preparser_host *host; /**< host slot held, if any */
+    struct vlc_list node; /**< in the queue of its host while waiting */
+    void *id;
+    int timeout;
 } input_preparser_req_t;
 
 typedef struct input_preparser_task_t
@@ -56,11 +120,19 @@ typedef struct input_preparser_task_t
     input_thread_t* input;
     atomic_int state;
     atomic_bool done;
+
+    char *uri; /**< URI of a local file whose results can be cached */
+    int64_t mtime;
+    uint64_t size;
+    bool subitems;
+    vlc_tick_t duration; /**< before the preparsing */
+    vlc_meta_t *meta; /**< before the preparsing */
 } input_preparser_task_t;
 
-static input_preparser_req_t *ReqCreate(input_item_t *item,
+static input_preparser_req_t *ReqCreate(input_preparser_t *preparser,
+                                        input_item_t *item,
                                         const input_preparser_callbacks_t *cbs,
-                                        void *userdata)
+                                        void *userdata, int timeout, void *id)
 {
     input_preparser_req_t *req = malloc(sizeof(*req));
     if (unlikely(!req))
@@ -71,6 +143,12 @@ static input_preparser_req_t *ReqCreate(input_item_t *item,
     req->userdata = userdata;
     vlc_atomic_rc_init(&req->rc);
 
+    req->preparser = preparser;
+    req->worker = NULL;
+    req->host = NULL;
+    req->id = id;
+    req->timeout = timeout;
+
     input_item_Hold(item);
 
     return req;
@@ -90,6 +168,407 @@ static void ReqRelease(input_preparser_req_t *req)
     }
 }
 
+static struct preparser_host *HostGet( input_preparser_t *preparser,
+                                       const char *name )
+{
+    vlc_mutex_assert( &preparser->lock );
+
+    struct preparser_host *host;
+    vlc_list_foreach( host, &preparser->hosts, node )
+        if( !strcmp( host->name, name ) )
+            return host;
+
+    size_t len = strlen( name ) + 1;
+    host = malloc( sizeof( *host ) + len );
+    if( unlikely( !host ) )
+        return NULL;
+
+    vlc_list_init( &host->queue );
+    host->running = 0;
+    memcpy( host->name, name, len );
+    vlc_list_append( &host->node, &preparser->hosts );
+    return host;
+}
+
+static void HostPut( struct preparser_host *host )
+{
+    if( host->running == 0 && vlc_list_is_empty( &host->queue ) )
+    {
+        vlc_list_remove( &host->node );
+        free( host );
+    }
+}
+
+/* Takes the next waiting request of a host, if a slot is free; the
+ * reference of the queue is transferred to the caller */
+static input_preparser_req_t *HostTakeLocked( input_preparser_t *preparser,
+                                              struct preparser_host *host )
+{
+    vlc_mutex_assert( &preparser->lock );
+
+    if( host->running >= preparser->host_threads )
+        return NULL;
+
+    input_preparser_req_t *req =
+        vlc_list_first_entry_or_null( &host->queue, input_preparser_req_t,
+                                      node );
+    if( req )
+    {
+        vlc_list_remove( &req->node );
+        req->host = host;
+        host->running++;
+    }
+    return req;
+}
+
+/* Releases the host slot of a request, and returns the next request allowed
+ * to run on this host, if any */
+static input_preparser_req_t *HostRelease( input_preparser_t *preparser,
+                                           input_preparser_req_t *req )
+{
+    input_preparser_req_t *next = NULL;
+
+    vlc_mutex_lock( &preparser->lock );
+    struct preparser_host *host = req->host;
+    if( host )
+    {
+        req->host = NULL;
+        host->running--;
+        next = HostTakeLocked( preparser, host );
+        HostPut( host );
+    }
+    vlc_mutex_unlock( &preparser->lock );
+
+    return next;
+}
+
+/* Pushes a request to its worker, and releases the reference of the caller */
+static void PreparserPush( input_preparser_t *preparser,
+                           input_preparser_req_t *req )
+{
+    while( req )
+    {
+        input_preparser_req_t *next = NULL;
+
+        if( background_worker_Push( req->worker, req, req->id, req->timeout ) )
+        {
+            if( req->cbs && req->cbs->on_preparse_ended )
+                req->cbs->on_preparse_ended( req->item, ITEM_PREPARSE_FAILED,
+                                             req->userdata );
+            next = HostRelease( preparser, req );
+        }
+        ReqRelease( req );
+        req = next;
+    }
+}
+
+/* Pushes the waiting requests whose host has a free slot */
+static void PreparserSchedule( input_preparser_t *preparser )
+{
+    for( ;; )
+    {
+        input_preparser_req_t *req = NULL;
+        struct preparser_host *host;
+
+        vlc_mutex_lock( &preparser->lock );
+        vlc_list_foreach( host, &preparser->hosts, node )
+            if( ( req = HostTakeLocked( preparser, host ) ) )
+                break;
+        vlc_mutex_unlock( &preparser->lock );
+
+        if( !req )
+            break;
+        PreparserPush( preparser, req );
+    }
+}
+
+/* Removes the requests waiting for a host slot, without callback, as the
+ * workers do with the requests of their queue */
+static void PreparserCancelWaiting( input_preparser_t *preparser, void *id )
+{
+    struct vlc_list canceled;
+    struct preparser_host *host;
+    input_preparser_req_t *req;
+
+    vlc_list_init( &canceled );
+
+    vlc_mutex_lock( &preparser->lock );
+    vlc_list_foreach( host, &preparser->hosts, node )
+    {
+        vlc_list_foreach( req, &host->queue, node )
+            if( !id || req->id == id )
+            {
+                vlc_list_remove( &req->node );
+                vlc_list_append( &req->node, &canceled );
+            }
+        HostPut( host );
+    }
+    vlc_mutex_unlock( &preparser->lock );
+
+    vlc_list_foreach( req, &canceled, node )
+        ReqRelease( req );
+}
+
+static void ReqHoldVoid(void *item) { ReqHold(item); }
+
+static void ReqReleaseVoid(void *item)
+{
+    input_preparser_req_t *req = item;
+    input_preparser_t *preparser = req->preparser;
+
+    /* A request removed from the queue of the network worker before it
+     * started still holds its host slot. The worker lock may be held here:
+     * the waiting requests are pushed by the canceller. */
+    vlc_mutex_lock( &preparser->lock );
+    if( req->host )
+    {
+        req->host->running--;
+        HostPut( req->host );
+        req->host = NULL;
+    }
+    vlc_mutex_unlock( &preparser->lock );
+
+    ReqRelease( req );
+}
+
+/* Gets the modification time and the size of a local file */
+static int GetFileStamp( const char *uri, int64_t *mtime, uint64_t *size )
+{
+    char *path = vlc_uri2path( uri );
+    if( !path )
+        return VLC_EGENERIC;
+
+    struct stat st;
+    int val = vlc_stat( path, &st );
+    free( path );
+    if( val != 0 || !S_ISREG( st.st_mode ) )
+        return VLC_EGENERIC;
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    *mtime = st.st_mtim.tv_sec * INT64_C(1000000000) + st.st_mtim.tv_nsec;
+#else
+    *mtime = st.st_mtime;
+#endif
+    *size = st.st_size;
+    return VLC_SUCCESS;
+}
+
+static void CacheEntryDelete( struct preparser_cache_entry *entry )
+{
+    free( entry->uri );
+    if( entry->meta )
+        vlc_meta_Delete( entry->meta );
+    for( int i = 0; i < entry->i_es; i++ )
+    {
+        es_format_Clean( entry->es[i] );
+        free( entry->es[i] );
+    }
+    free( entry->es );
+    for( int i = 0; i < entry->i_categories; i++ )
+        info_category_Delete( entry->categories[i] );
+    free( entry->categories );
+    free( entry );
+}
+
+/* Creates an entry with a copy of the results of the item or of another
+ * entry */
+static struct preparser_cache_entry *
+CacheEntryCopy( vlc_tick_t duration, const vlc_meta_t *meta,
+                int i_es, es_format_t *const *es,
+                int i_categories, info_category_t *const *categories )
+{
+    struct preparser_cache_entry *entry = calloc( 1, sizeof( *entry ) );
+    if( unlikely( !entry ) )
+        return NULL;
+
+    entry->duration = duration;
+
+    if( meta )
+    {
+        entry->meta = vlc_meta_New();
+        if( unlikely( !entry->meta ) )
+            goto error;
+        vlc_meta_Merge( entry->meta, meta );
+    }
+
+    if( i_es > 0 && !( entry->es = vlc_alloc( i_es, sizeof( *es ) ) ) )
+        goto error;
+    for( ; entry->i_es < i_es; entry->i_es++ )
+    {
+        es_format_t *fmt = malloc( sizeof( *fmt ) );
+        if( unlikely( !fmt ) )
+            goto error;
+        es_format_Copy( fmt, es[entry->i_es] );
+        entry->es[entry->i_es] = fmt;
+    }
+
+    if( i_categories > 0 && !( entry->categories =
+                vlc_alloc( i_categories, sizeof( *categories ) ) ) )
+        goto error;
+    for( ; entry->i_categories < i_categories; entry->i_categories++ )
+    {
+        const info_category_t *cat = categories[entry->i_categories];
+        info_category_t *copy = info_category_New( cat->psz_name );
+        if( unlikely( !copy ) )
+            goto error;
+
+        info_t *info;
+        info_foreach( info, &cat->infos )
+            info_category_AddInfo( copy, info->psz_name, "%s",
+                                   info->psz_value ? info->psz_value : "" );
+        entry->categories[entry->i_categories] = copy;
+    }
+
+    return entry;
+
+error:
+    CacheEntryDelete( entry );
+    return NULL;
+}
+
+static void CacheRemoveLocked( input_preparser_t *preparser,
+                               struct preparser_cache_entry *entry )
+{
+    vlc_mutex_assert( &preparser->lock );
+
+    vlc_dictionary_remove_value_for_key( &preparser->cache, entry->uri,
+                                         NULL, NULL );
+    vlc_list_remove( &entry->node );
+    preparser->cache_count--;
+    CacheEntryDelete( entry );
+}
+
+static bool MetaChanged( const char *before, const char *after )
+{
+    return after && ( !before || strcmp( before, after ) );
+}
+
+/* Gets the meta set or changed since the snapshot taken before the
+ * preparsing */
+static vlc_meta_t *MetaDiff( const vlc_meta_t *before, const vlc_meta_t *after )
+{
+    vlc_meta_t *diff = vlc_meta_New();
+    if( unlikely( !diff ) )
+        return NULL;
+
+    for( int i = 0; i < VLC_META_TYPE_COUNT; i++ )
+    {
+        const char *value = vlc_meta_Get( after, i );
+        if( MetaChanged( vlc_meta_Get( before, i ), value ) )
+            vlc_meta_Set( diff, i, value );
+    }
+
+    char **names = vlc_meta_CopyExtraNames( after );
+    if( names )
+    {
+        for( size_t i = 0; names[i]; i++ )
+        {
+            const char *value = vlc_meta_GetExtra( after, names[i] );
+            if( MetaChanged( vlc_meta_GetExtra( before, names[i] ), value ) )
+                vlc_meta_AddExtra( diff, names[i], value );
+            free( names[i] );
+        }
+        free( names );
+    }
+    return diff;
+}
+
+static void CacheStore( input_preparser_t *preparser,
+                        input_preparser_task_t *task, input_item_t *item )
+{
+    struct preparser_cache_entry *entry = NULL;
+
+    vlc_mutex_lock( &item->lock );
+    vlc_meta_t *meta = item->p_meta ? MetaDiff( task->meta, item->p_meta )
+                                    : NULL;
+    if( !item->p_meta || meta )
+        entry = CacheEntryCopy( item->i_duration != task->duration
+                                ? item->i_duration : INPUT_DURATION_UNSET,
+                                meta, item->i_es, item->es,
+                                item->i_categories, item->pp_categories );
+    vlc_mutex_unlock( &item->lock );
+
+    if( meta )
+        vlc_meta_Delete( meta );
+    if( unlikely( !entry ) )
+        return;
+
+    entry->uri = task->uri;
+    entry->mtime = task->mtime;
+    entry->size = task->size;
+    task->uri = NULL;
+
+    vlc_mutex_lock( &preparser->lock );
+    struct preparser_cache_entry *old =
+        vlc_dictionary_value_for_key( &preparser->cache, entry->uri );
+    if( old )
+        CacheRemoveLocked( preparser, old );
+
+    vlc_dictionary_insert( &preparser->cache, entry->uri, entry );
+    vlc_list_append( &entry->node, &preparser->cache_lru );
+    preparser->cache_count++;
+
+    while( preparser->cache_count > preparser->cache_max )
+        CacheRemoveLocked( preparser,
+            vlc_list_first_entry_or_null( &preparser->cache_lru,
+                                          struct preparser_cache_entry,
+                                          node ) );
+    vlc_mutex_unlock( &preparser->lock );
+}
+
+/* Restores the results of the last preparsing of an unmodified file */
+static bool CacheRestore( input_preparser_t *preparser,
+                          const input_preparser_task_t *task,
+                          input_item_t *item )
+{
+    struct preparser_cache_entry *copy = NULL;
+
+    vlc_mutex_lock( &preparser->lock );
+    struct preparser_cache_entry *entry =
+        vlc_dictionary_value_for_key( &preparser->cache, task->uri );
+    if( entry )
+    {
+        if( entry->mtime != task->mtime || entry->size != task->size )
+            CacheRemoveLocked( preparser, entry );
+        else
+        {
+            vlc_list_remove( &entry->node );
+            vlc_list_append( &entry->node, &preparser->cache_lru );
+            copy = CacheEntryCopy( entry->duration, entry->meta,
+                                   entry->i_es, entry->es,
+                                   entry->i_categories, entry->categories );
+        }
+    }
+    vlc_mutex_unlock( &preparser->lock );
+
+    if( !copy )
+        return false;
+
+    /* The item is updated out of the preparser lock, as it sends events */
+    if( copy->duration != INPUT_DURATION_UNSET )
+        input_item_SetDuration( item, copy->duration );
+
+    if( copy->meta )
+    {
+        vlc_mutex_lock( &item->lock );
+        if( !item->p_meta )
+            item->p_meta = vlc_meta_New();
+        vlc_meta_Merge( item->p_meta, copy->meta );
+        vlc_mutex_unlock( &item->lock );
+    }
+
+    for( int i = 0; i < copy->i_es; i++ )
+        input_item_UpdateTracksInfo( item, copy->es[i] );
+
+    /* The categories are owned by the item now */
+    for( int i = 0; i < copy->i_categories; i++ )
+        input_item_MergeInfos( item, copy->categories[i] );
+    copy->i_categories = 0;
+
+    CacheEntryDelete( copy );
+    return true;
+}
+
 static void InputEvent( input_thread_t *input,
                         const struct vlc_input_event *event, void *task_ )
 {
@@ -104,11 +583,13 @@ static void InputEvent( input_thread_t *input,
 
         case INPUT_EVENT_DEAD:
             atomic_store( &task->done, true );
-            background_worker_RequestProbe( task->preparser->worker );
+            background_worker_RequestProbe( task->req->worker );
             break;
         case INPUT_EVENT_SUBITEMS:
         {
             input_preparser_req_t *req = task->req;
+            /* The sub items are not cached, nor their parent */
+            task->subitems = true;
             if (req->cbs && req->cbs->on_subtree_added)
                 req->cbs->on_subtree_added(req->item, event->subitems, req->userdata);
             break;
@@ -130,14 +611,55 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
     atomic_init( &task->done, false );
 
     task->preparser = preparser_;
+    task->req = req;
+    task->preparse_status = -1;
+    task->uri = NULL;
+    task->subitems = false;
+    task->meta = NULL;
+
+    if( preparser->cache_max > 0 && req->worker == preparser->local )
+    {
+        task->uri = input_item_GetURI( req->item );
+        if( task->uri
+         && GetFileStamp( task->uri, &task->mtime, &task->size ) )
+            FREENULL( task->uri );
+    }
+
+    if( task->uri && CacheRestore( preparser, task, req->item ) )
+    {
+        /* Not modified since its last preparsing: no need to open it */
+        FREENULL( task->uri );
+        task->input = NULL;
+        atomic_store( &task->state, END_S );
+        atomic_store( &task->done, true );
+        background_worker_RequestProbe( req->worker );
+        *out = task;
+        return VLC_SUCCESS;
+    }
+
+    if( task->uri )
+    {
+        /* Snapshot of what the creator of the item set, to only cache what
+         * the preparsing adds */
+        input_item_t *item = req->item;
+        task->meta = vlc_meta_New();
+        if( unlikely( !task->meta ) )
+            FREENULL( task->uri );
+        else
+        {
+            vlc_mutex_lock( &item->lock );
+            if( item->p_meta )
+                vlc_meta_Merge( task->meta, item->p_meta );
+            task->duration = item->i_duration;
+            vlc_mutex_unlock( &item->lock );
+        }
+    }
+
     task->input = input_CreatePreparser( preparser->owner, InputEvent,
                                          task, req->item );
     if( !task->input )
         goto error;
 
-    task->req = req;
-    task->preparse_status = -1;
-
     if( input_Start( task->input ) )
     {
         input_Close( task->input );
@@ -149,9 +671,16 @@ static int PreparserOpenInput( void* preparser_, void* req_, void** out )
     return VLC_SUCCESS;
 
 error:
+    if( task )
+    {
+        free( task->uri );
+        if( task->meta )
+            vlc_meta_Delete( task->meta );
+    }
     free( task );
     if (req->cbs && req->cbs->on_preparse_ended)
         req->cbs->on_preparse_ended(req->item, ITEM_PREPARSE_FAILED, req->userdata);
+    PreparserPush( preparser, HostRelease( preparser, req ) );
     return VLC_EGENERIC;
 }
 
@@ -189,7 +718,7 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
 
     input_preparser_t* preparser = preparser_;
     input_thread_t* input = task->input;
-    input_item_t* item = input_priv(task->input)->p_item;
+    input_item_t* item = req->item;
 
     int status;
     switch( atomic_load( &task->state ) )
@@ -204,8 +733,22 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
             status = ITEM_PREPARSE_TIMEOUT;
     }
 
-    input_Stop( input );
-    input_Close( input );
+    if( input )
+    {
+        input_Stop( input );
+        input_Close( input );
+
+        if( status == ITEM_PREPARSE_DONE && task->uri && !task->subitems )
+            CacheStore( preparser, task, item );
+    }
+    FREENULL( task->uri );
+    if( task->meta )
+    {
+        vlc_meta_Delete( task->meta );
+        task->meta = NULL;
+    }
+
+    PreparserPush( preparser, HostRelease( preparser, req ) );
 
     if( preparser->fetcher )
     {
@@ -225,16 +768,20 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
         req->cbs->on_preparse_ended(req->item, status, req->userdata);
 }
 
-static void ReqHoldVoid(void *item) { ReqHold(item); }
-static void ReqReleaseVoid(void *item) { ReqRelease(item); }
-
 input_preparser_t* input_preparser_New( vlc_object_t *parent )
 {
     input_preparser_t* preparser = malloc( sizeof *preparser );
+    if( unlikely( !preparser ) )
+        return NULL;
+
+    /* Probing local files is mostly bound by the CPU */
+    int threads = var_InheritInteger( parent, "preparse-threads" );
+    if( threads <= 0 )
+        threads = vlc_GetCPUCount();
 
     struct background_worker_config conf = {
         .default_timeout = VLC_TICK_FROM_MS(var_InheritInteger( parent, "preparse-timeout" )),
-        .max_threads = var_InheritInteger( parent, "preparse-threads" ),
+        .max_threads = threads,
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
@@ -242,12 +789,19 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
         .pf_hold = ReqHoldVoid
     };
 
+    preparser->local = background_worker_New( preparser, &conf );
 
-    if( likely( preparser ) )
-        preparser->worker = background_worker_New( preparser, &conf );
+    /* Probing network items is mostly waiting for the I/O */
+    threads = var_InheritInteger( parent, "preparse-network-threads" );
+    conf.max_threads = threads > 0 ? threads : 1;
+    preparser->network = background_worker_New( preparser, &conf );
 
-    if( unlikely( !preparser || !preparser->worker ) )
+    if( unlikely( !preparser->local || !preparser->network ) )
     {
+        if( preparser->local )
+            background_worker_Delete( preparser->local );
+        if( preparser->network )
+            background_worker_Delete( preparser->network );
         free( preparser );
         return NULL;
     }
@@ -256,6 +810,17 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
     preparser->fetcher = input_fetcher_New( parent );
     atomic_init( &preparser->deactivated, false );
 
+    vlc_mutex_init( &preparser->lock );
+    vlc_list_init( &preparser->hosts );
+    threads = var_InheritInteger( parent, "preparse-host-threads" );
+    preparser->host_threads = threads > 0 ? (unsigned) threads : UINT_MAX;
+
+    vlc_dictionary_init( &preparser->cache, 0 );
+    vlc_list_init( &preparser->cache_lru );
+    preparser->cache_count = 0;
+    int64_t cache_max = var_InheritInteger( parent, "preparse-cache-size" );
+    preparser->cache_max = cache_max > 0 ? cache_max : 0;
+
     if( unlikely( !preparser->fetcher ) )
         msg_Warn( parent, "unable to create art fetcher" );
 
@@ -290,13 +855,52 @@ void input_preparser_Push( input_preparser_t *preparser,
             return;
     }
 
-    struct input_preparser_req_t *req = ReqCreate(item, cbs, cbs_userdata);
-
-    if (background_worker_Push(preparser->worker, req, id, timeout))
-        if (req->cbs && cbs->on_preparse_ended)
+    struct input_preparser_req_t *req = ReqCreate(preparser, item, cbs,
+                                                  cbs_userdata, timeout, id);
+    if( unlikely( !req ) )
+    {
+        if (cbs && cbs->on_preparse_ended)
             cbs->on_preparse_ended(item, ITEM_PREPARSE_FAILED, cbs_userdata);
+        return;
+    }
 
-    ReqRelease(req);
+    if( !b_net )
+    {
+        req->worker = preparser->local;
+        PreparserPush( preparser, req );
+        return;
+    }
+
+    req->worker = preparser->network;
+
+    char *uri = input_item_GetURI( item );
+    vlc_url_t url;
+    vlc_UrlParse( &url, uri );
+
+    vlc_mutex_lock( &preparser->lock );
+    struct preparser_host *host =
+        HostGet( preparser, url.psz_host ? url.psz_host : "" );
+    if( host )
+    {
+        if( host->running < preparser->host_threads )
+        {
+            req->host = host;
+            host->running++;
+        }
+        else
+        {
+            /* Pushed when a request of the same host is done */
+            vlc_list_append( &req->node, &host->queue );
+            req = NULL;
+        }
+    }
+    vlc_mutex_unlock( &preparser->lock );
+
+    vlc_UrlClean( &url );
+    free( uri );
+
+    if( req )
+        PreparserPush( preparser, req );
 }
 
 void input_preparser_fetcher_Push( input_preparser_t *preparser,
@@ -310,21 +914,38 @@ void input_preparser_fetcher_Push( input_preparser_t *preparser,
 
 void input_preparser_Cancel( input_preparser_t *preparser, void *id )
 {
-    background_worker_Cancel( preparser->worker, id );
+    PreparserCancelWaiting( preparser, id );
+    background_worker_Cancel( preparser->local, id );
+    background_worker_Cancel( preparser->network, id );
+
+    /* The canceled requests that were not started freed their host slot */
+    PreparserSchedule( preparser );
 }
 
 void input_preparser_Deactivate( input_preparser_t* preparser )
 {
     atomic_store( &preparser->deactivated, true );
-    background_worker_Cancel( preparser->worker, NULL );
+    PreparserCancelWaiting( preparser, NULL );
+    background_worker_Cancel( preparser->local, NULL );
+    background_worker_Cancel( preparser->network, NULL );
 }
 
 void input_preparser_Delete( input_preparser_t *preparser )
 {
-    background_worker_Delete( preparser->worker );
+    /* No waiting request can be pushed to the workers being deleted */
+    PreparserCancelWaiting( preparser, NULL );
+    background_worker_Delete( preparser->local );
+    background_worker_Delete( preparser->network );
+    assert( vlc_list_is_empty( &preparser->hosts ) );
 
     if( preparser->fetcher )
         input_fetcher_Delete( preparser->fetcher );
 
+    struct preparser_cache_entry *entry;
+    vlc_list_foreach( entry, &preparser->cache_lru, node )
+        CacheEntryDelete( entry );
+    vlc_dictionary_clear( &preparser->cache, NULL, NULL );
+    vlc_mutex_destroy( &preparser->lock );
+
     free( preparser );
 }
@@ -0,0 +1,324 @@
+/*****************************************************************************
+ * timeshift_storage.c: Test for the timeshift storage
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+# include <sys/resource.h>
+#endif
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "../input/timeshift_storage.h"
+
+/* Three hours of TS input, 2 TS packets every 40 ms, with a 16 MiB
+ * limit (about 25 minutes of timeshift) */
+#define PERIOD       VLC_TICK_FROM_MS(40)
+#define COUNT        (3 * 3600 * CLOCK_FREQ / PERIOD)
+#define PAUSE_COUNT  (3600 * CLOCK_FREQ / PERIOD)
+#define PACKET_SIZE  (2 * 188)
+#define SEGMENT_SIZE (1024 * 1024)
+#define MAX_SIZE     (16 * 1024 * 1024)
+
+struct test_record
+{
+    uint64_t i_seq;
+    bool     b_block;
+};
+
+static vlc_tick_t Date( uint64_t i_seq )
+{
+    return VLC_TICK_0 + i_seq * PERIOD;
+}
+
+static void Push( vlc_timeshift_storage_t *p_storage, uint64_t i_seq )
+{
+    /* Some records carry no data, like the es_out controls */
+    struct test_record rec = { .i_seq = i_seq, .b_block = i_seq % 64 != 0 };
+    block_t *p_block = NULL;
+
+    if( rec.b_block )
+    {
+        p_block = block_Alloc( PACKET_SIZE );
+        assert( p_block != NULL );
+        memset( p_block->p_buffer, i_seq & 0xff, PACKET_SIZE );
+        memcpy( p_block->p_buffer, &i_seq, sizeof(i_seq) );
+        p_block->i_dts = p_block->i_pts = Date( i_seq );
+        p_block->i_flags = i_seq % 25 == 0 ? BLOCK_FLAG_TYPE_I : 0;
+    }
+
+    int i_ret = vlc_timeshift_storage_Push( p_storage, Date( i_seq ), &rec,
+                                            p_block );
+    assert( i_ret == VLC_SUCCESS );
+    assert( vlc_timeshift_storage_GetSize( p_storage ) <= MAX_SIZE + 2 * SEGMENT_SIZE );
+}
+
+static uint64_t Pop( vlc_timeshift_storage_t *p_storage, int *pi_flags )
+{
+    struct test_record rec;
+    block_t *p_block;
+
+    int i_ret = vlc_timeshift_storage_Pop( p_storage, &rec, &p_block, true,
+                                           pi_flags );
+    assert( i_ret == VLC_SUCCESS );
+
+    if( *pi_flags & VLC_TIMESHIFT_SKIP )
+        assert( p_block == NULL );
+    else if( !rec.b_block )
+        assert( p_block == NULL );
+    else
+    {
+        /* The data is read back from the segment file */
+        uint64_t i_seq;
+        assert( p_block != NULL );
+        assert( p_block->i_buffer == PACKET_SIZE );
+        memcpy( &i_seq, p_block->p_buffer, sizeof(i_seq) );
+        assert( i_seq == rec.i_seq );
+        assert( p_block->p_buffer[PACKET_SIZE - 1] == (rec.i_seq & 0xff) );
+        assert( p_block->i_dts == Date( rec.i_seq ) );
+        assert( !!(p_block->i_flags & BLOCK_FLAG_TYPE_I) == (rec.i_seq % 25 == 0) );
+        block_Release( p_block );
+    }
+    return rec.i_seq;
+}
+
+static void test_Live( vlc_timeshift_storage_t *p_storage )
+{
+    uint64_t i_last = 0;
+    bool b_first = true;
+    uint64_t i_skipped = 0;
+
+    for( uint64_t i = 0; i < COUNT; i++ )
+    {
+        Push( p_storage, i );
+
+        /* The playback is paused for an hour: the oldest part of the
+         * timeshift buffer is skipped to stay under the limit */
+        while( vlc_timeshift_storage_IsSkipping( p_storage ) )
+        {
+            int i_flags;
+            uint64_t i_seq = Pop( p_storage, &i_flags );
+            assert( i_flags == VLC_TIMESHIFT_SKIP );
+            assert( b_first || i_seq == i_last + 1 );
+            i_last = i_seq;
+            b_first = false;
+            i_skipped++;
+        }
+
+        /* Then it is resumed at the same speed than the input */
+        if( i >= PAUSE_COUNT )
+        {
+            int i_flags;
+            uint64_t i_seq = Pop( p_storage, &i_flags );
+            assert( !(i_flags & (VLC_TIMESHIFT_SKIP | VLC_TIMESHIFT_REPLAY)) );
+            assert( !!(i_flags & VLC_TIMESHIFT_DISCONTINUITY) == (i == PAUSE_COUNT) );
+            assert( b_first || i_seq == i_last + 1 );
+            i_last = i_seq;
+            b_first = false;
+        }
+    }
+
+    /* About 35 minutes were skipped */
+    assert( i_skipped > 0 );
+    assert( i_skipped < PAUSE_COUNT );
+
+    /* Catch up with the input */
+    while( !vlc_timeshift_storage_IsEmpty( p_storage ) )
+    {
+        int i_flags;
+        uint64_t i_seq = Pop( p_storage, &i_flags );
+        assert( i_flags == 0 );
+        assert( i_seq == i_last + 1 );
+        i_last = i_seq;
+    }
+    assert( i_last == COUNT - 1 );
+}
+
+static void test_Seek( vlc_timeshift_storage_t *p_storage )
+{
+    vlc_tick_t i_first, i_read, i_last;
+    int i_flags;
+    int i_ret;
+
+    i_ret = vlc_timeshift_storage_GetDates( p_storage, &i_first, &i_read, &i_last );
+    assert( i_ret == VLC_SUCCESS );
+    assert( i_last == Date( COUNT - 1 ) );
+    assert( i_read == i_last );
+    /* The history fills the whole limit */
+    assert( i_last - i_first > VLC_TICK_FROM_SEC(20 * 60) );
+
+    /* Back by 10 minutes and a bit, between two records */
+    vlc_tick_t i_target = i_last - VLC_TICK_FROM_SEC(600) - PERIOD / 2;
+    i_ret = vlc_timeshift_storage_Seek( p_storage, i_target );
+    assert( i_ret == VLC_SUCCESS );
+    assert( !vlc_timeshift_storage_IsEmpty( p_storage ) );
+
+    uint64_t i_seq = Pop( p_storage, &i_flags );
+    assert( i_flags == (VLC_TIMESHIFT_REPLAY | VLC_TIMESHIFT_DISCONTINUITY) );
+    assert( Date( i_seq ) >= i_target && Date( i_seq - 1 ) < i_target );
+    for( int i = 0; i < 100; i++ )
+    {
+        assert( Pop( p_storage, &i_flags ) == ++i_seq );
+        assert( i_flags == VLC_TIMESHIFT_REPLAY );
+    }
+
+    /* Forward by 5 minutes: the records in between are skipped */
+    i_ret = vlc_timeshift_storage_GetDates( p_storage, &i_first, &i_read, &i_last );
+    assert( i_ret == VLC_SUCCESS );
+    assert( i_read == Date( i_seq + 1 ) );
+    i_target = i_read + VLC_TICK_FROM_SEC(300);
+    i_ret = vlc_timeshift_storage_Seek( p_storage, i_target );
+    assert( i_ret == VLC_SUCCESS );
+    while( vlc_timeshift_storage_IsSkipping( p_storage ) )
+    {
+        assert( Pop( p_storage, &i_flags ) == ++i_seq );
+        assert( i_flags == (VLC_TIMESHIFT_REPLAY | VLC_TIMESHIFT_SKIP) );
+    }
+    assert( Pop( p_storage, &i_flags ) == ++i_seq );
+    assert( i_flags == (VLC_TIMESHIFT_REPLAY | VLC_TIMESHIFT_DISCONTINUITY) );
+    assert( Date( i_seq ) == i_target );
+
+    /* Back to the oldest record, and before */
+    i_ret = vlc_timeshift_storage_Seek( p_storage, i_first );
+    assert( i_ret == VLC_SUCCESS );
+    assert( Date( Pop( p_storage, &i_flags ) ) == i_first );
+    i_ret = vlc_timeshift_storage_Seek( p_storage, i_first - 1 );
+    assert( i_ret != VLC_SUCCESS );
+
+    /* After the last record: back to live */
+    i_ret = vlc_timeshift_storage_Seek( p_storage, i_last + VLC_TICK_FROM_SEC(60) );
+    assert( i_ret == VLC_SUCCESS );
+    while( vlc_timeshift_storage_IsSkipping( p_storage ) )
+    {
+        Pop( p_storage, &i_flags );
+        assert( i_flags & VLC_TIMESHIFT_SKIP );
+    }
+    assert( vlc_timeshift_storage_IsEmpty( p_storage ) );
+
+    Push( p_storage, COUNT );
+    assert( Pop( p_storage, &i_flags ) == COUNT );
+    assert( i_flags == VLC_TIMESHIFT_DISCONTINUITY );
+
+    /* Without history, seeking back is not possible */
+    vlc_timeshift_storage_DropHistory( p_storage );
+    i_ret = vlc_timeshift_storage_Seek( p_storage, Date( COUNT ) - PERIOD );
+    assert( i_ret != VLC_SUCCESS );
+    assert( vlc_timeshift_storage_IsEmpty( p_storage ) );
+}
+
+#ifndef _WIN32
+/* A block too large for the files size limit: the write fails as when the
+ * disk is full, in a new segment */
+static void PushTooLarge( vlc_timeshift_storage_t *p_storage, uint64_t i_seq,
+                          size_t i_size )
+{
+    struct test_record rec = { .i_seq = i_seq, .b_block = true };
+    block_t *p_block = block_Alloc( i_size );
+    assert( p_block != NULL );
+    memset( p_block->p_buffer, 0, i_size );
+
+    int i_ret = vlc_timeshift_storage_Push( p_storage, Date( i_seq ), &rec,
+                                            p_block );
+    assert( i_ret != VLC_SUCCESS );
+    /* The block is left to the caller */
+    block_Release( p_block );
+}
+
+static void test_WriteError( void )
+{
+    const size_t i_segment_size = 16 * PACKET_SIZE;
+    const size_t i_limit = 2 * i_segment_size;
+    vlc_tick_t i_first, i_read, i_last;
+    struct rlimit old, lim;
+    int i_flags;
+
+    signal( SIGXFSZ, SIG_IGN );
+    assert( getrlimit( RLIMIT_FSIZE, &old ) == 0 );
+    lim = old;
+    lim.rlim_cur = i_limit;
+    assert( setrlimit( RLIMIT_FSIZE, &lim ) == 0 );
+
+    vlc_timeshift_storage_t *p_storage =
+        vlc_timeshift_storage_New( NULL, i_segment_size, 0,
+                                   sizeof(struct test_record) );
+    assert( p_storage != NULL );
+
+    /* Failing first write: nothing is stored */
+    PushTooLarge( p_storage, 0, 2 * i_limit );
+    assert( vlc_timeshift_storage_IsEmpty( p_storage ) );
+    assert( vlc_timeshift_storage_GetSize( p_storage ) == 0 );
+    assert( vlc_timeshift_storage_GetDates( p_storage, &i_first, &i_read,
+                                            &i_last ) != VLC_SUCCESS );
+    assert( vlc_timeshift_storage_Seek( p_storage, Date( 0 ) ) != VLC_SUCCESS );
+
+    /* Failing write after a full segment: the previous records are kept
+     * and can be sought and read */
+    for( uint64_t i = 1; i <= 40; i++ )
+        Push( p_storage, i );
+    const uint64_t i_size = vlc_timeshift_storage_GetSize( p_storage );
+    PushTooLarge( p_storage, 41, 2 * i_limit );
+    assert( vlc_timeshift_storage_GetSize( p_storage ) == i_size );
+    assert( vlc_timeshift_storage_GetDates( p_storage, &i_first, &i_read,
+                                            &i_last ) == VLC_SUCCESS );
+    assert( i_first == Date( 1 ) );
+    assert( i_read == Date( 1 ) );
+    assert( i_last == Date( 40 ) );
+
+    for( uint64_t i = 1; i <= 30; i++ )
+        assert( Pop( p_storage, &i_flags ) == i );
+    assert( vlc_timeshift_storage_Seek( p_storage, Date( 1 ) ) == VLC_SUCCESS );
+    for( uint64_t i = 1; i <= 40; i++ )
+        assert( Pop( p_storage, &i_flags ) == i );
+    assert( vlc_timeshift_storage_IsEmpty( p_storage ) );
+
+    /* Writing goes on once the disk has space again */
+    Push( p_storage, 42 );
+    assert( Pop( p_storage, &i_flags ) == 42 );
+    assert( vlc_timeshift_storage_IsEmpty( p_storage ) );
+
+    vlc_timeshift_storage_Delete( p_storage );
+    assert( setrlimit( RLIMIT_FSIZE, &old ) == 0 );
+}
+#endif
+
+int main( void )
+{
+    vlc_timeshift_storage_t *p_storage =
+        vlc_timeshift_storage_New( NULL, SEGMENT_SIZE, MAX_SIZE,
+                                   sizeof(struct test_record) );
+    assert( p_storage != NULL );
+
+    test_Live( p_storage );
+    test_Seek( p_storage );
+
+    vlc_timeshift_storage_Delete( p_storage );
+
+#ifndef _WIN32
+    test_WriteError();
+#endif
+    return 0;
+}
@@ -27,9 +27,22 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+# include <sys/inotify.h>
+#endif
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+# include <poll.h>
+#endif
 
+#include <vlc_atomic.h>
 #include <vlc_threads.h>
 #include <vlc_fs.h>
+#include <vlc_url.h>
 #include <vlc_input_item.h>
 #include <vlc_events.h>
 
@@ -127,6 +140,311 @@ static void test_media_preparsed(libvlc_instance_t *vlc, const char *path,
     libvlc_media_release (media);
 }
 
+static void media_parse(libvlc_media_t *media)
+{
+    vlc_sem_t sem;
+    vlc_sem_init (&sem, 0);
+
+    libvlc_event_manager_t *em = libvlc_media_event_manager (media);
+    libvlc_event_attach (em, libvlc_MediaParsedChanged, media_parse_ended, &sem);
+
+    int i_ret = libvlc_media_parse_with_options(media, libvlc_media_parse_local, -1);
+    assert(i_ret == 0);
+
+    vlc_sem_wait (&sem);
+    vlc_sem_destroy (&sem);
+    libvlc_event_detach (em, libvlc_MediaParsedChanged, media_parse_ended, &sem);
+
+    assert (libvlc_media_get_parsed_status(media) == libvlc_media_parsed_status_done);
+}
+
+static libvlc_media_t *media_parse_path(libvlc_instance_t *vlc,
+                                        const char *path)
+{
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+    media_parse (media);
+    return media;
+}
+
+/* Counts the openings of the watched file since the last call, or returns
+ * -1 if they cannot be watched */
+static int count_opens(int fd)
+{
+#ifdef __linux__
+    char buf[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    int count = 0;
+    ssize_t len;
+
+    while ((len = read(fd, buf, sizeof (buf))) > 0)
+        for (char *ptr = buf; ptr < buf + len;
+             ptr += sizeof (struct inotify_event)
+                  + ((struct inotify_event *)ptr)->len)
+            if (((struct inotify_event *)ptr)->mask & IN_OPEN)
+                count++;
+    return count;
+#else
+    (void) fd;
+    return -1;
+#endif
+}
+
+static void test_media_preparsed_cached(libvlc_instance_t *vlc, const char *sample)
+{
+    test_log ("test_media_preparsed_cached: %s\n", sample);
+
+    /* Copy of the sample, to modify it */
+    char path[] = "/tmp/vlc-test-media-XXXXXX.jpg";
+    int fd = mkstemps (path, 4);
+    assert (fd >= 0);
+    int in = vlc_open (sample, O_RDONLY);
+    assert (in >= 0);
+    char buf[4096];
+    ssize_t len;
+    while ((len = read (in, buf, sizeof (buf))) > 0)
+        assert (write (fd, buf, len) == len);
+    vlc_close (in);
+
+    int watch = -1;
+#ifdef __linux__
+    watch = inotify_init1 (IN_NONBLOCK);
+    assert (watch >= 0);
+    assert (inotify_add_watch (watch, path, IN_OPEN) >= 0);
+#endif
+
+    /* The meta set by the creator of the item is not part of the results
+     * of the preparsing */
+    libvlc_media_t *first = libvlc_media_new_path (vlc, path);
+    assert (first != NULL);
+    libvlc_media_set_meta (first, libvlc_meta_Description, "set by the creator");
+    media_parse (first);
+    assert (count_opens (watch) != 0);
+
+    /* The second preparsing of an unmodified file gets the same results
+     * from the preparser cache, without opening the file */
+    libvlc_media_t *second = media_parse_path (vlc, path);
+    assert (count_opens (watch) <= 0);
+
+    libvlc_media_track_t **first_tracks, **second_tracks;
+    unsigned first_count = libvlc_media_tracks_get(first, &first_tracks);
+    unsigned second_count = libvlc_media_tracks_get(second, &second_tracks);
+    assert (first_count > 0);
+    assert (first_count == second_count);
+    for (unsigned i = 0; i < first_count; ++i)
+    {
+        assert (first_tracks[i]->i_type == second_tracks[i]->i_type);
+        assert (first_tracks[i]->i_codec == second_tracks[i]->i_codec);
+    }
+    libvlc_media_tracks_release(first_tracks, first_count);
+    libvlc_media_tracks_release(second_tracks, second_count);
+
+    assert (libvlc_media_get_duration(first) == libvlc_media_get_duration(second));
+    char *desc = libvlc_media_get_meta (second, libvlc_meta_Description);
+    assert (desc == NULL);
+    libvlc_media_release (second);
+
+    libvlc_media_t *third;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    /* Modified within the same second: probed again */
+    struct stat st;
+    assert (fstat (fd, &st) == 0);
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    times[1].tv_nsec = (times[1].tv_nsec + 1) % 1000000000;
+    assert (futimens (fd, times) == 0);
+
+    third = media_parse_path (vlc, path);
+    assert (count_opens (watch) != 0);
+    libvlc_media_release (third);
+#endif
+
+    /* Rewritten: probed again */
+    assert (write (fd, "", 1) == 1);
+    third = media_parse_path (vlc, path);
+    assert (count_opens (watch) != 0);
+    libvlc_media_release (third);
+
+    if (watch >= 0)
+        close (watch);
+    close (fd);
+    unlink (path);
+    libvlc_media_release (first);
+}
+
+#ifndef _WIN32
+/* Loopback server holding every connection for a while before failing the
+ * request, recording the number of simultaneous connections */
+#define HOST_REQUESTS 6
+#define HOST_HOLD VLC_TICK_FROM_MS(400)
+
+static struct
+{
+    int fd;
+    unsigned port;
+    atomic_bool quit;
+    vlc_thread_t thread;
+    unsigned max_clients;
+} host_server;
+
+static void *host_server_thread(void *data)
+{
+    (void) data;
+    int clients[64];
+    vlc_tick_t deadlines[64];
+    unsigned count = 0;
+
+    while (!atomic_load(&host_server.quit) || count > 0)
+    {
+        struct pollfd ufd = { host_server.fd, POLLIN, 0 };
+        if (poll(&ufd, 1, 10) > 0 && count < ARRAY_SIZE(clients))
+        {
+            int fd = accept(host_server.fd, NULL, NULL);
+            if (fd >= 0)
+            {
+                clients[count] = fd;
+                deadlines[count] = vlc_tick_now() + HOST_HOLD;
+                count++;
+                if (count > host_server.max_clients)
+                    host_server.max_clients = count;
+            }
+        }
+
+        const vlc_tick_t now = vlc_tick_now();
+        for (unsigned i = 0; i < count;)
+        {
+            if (now < deadlines[i] && !atomic_load(&host_server.quit))
+            {
+                i++;
+                continue;
+            }
+            static const char reply[] =
+                "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+                "Connection: close\r\n\r\n";
+            ssize_t val = send(clients[i], reply, sizeof (reply) - 1,
+                               MSG_NOSIGNAL);
+            (void) val;
+            close(clients[i]);
+            clients[i] = clients[--count];
+            deadlines[i] = deadlines[count];
+        }
+    }
+    return NULL;
+}
+
+static struct
+{
+    vlc_sem_t sem;
+    atomic_uint done;
+} host_requests;
+
+static void host_preparse_ended(input_item_t *item,
+                                enum input_item_preparse_status status,
+                                void *user_data)
+{
+    (void) item; (void) status; (void) user_data;
+    atomic_fetch_add(&host_requests.done, 1);
+    vlc_sem_post(&host_requests.sem);
+}
+
+static void local_preparse_ended(input_item_t *item,
+                                 enum input_item_preparse_status status,
+                                 void *user_data)
+{
+    (void) item;
+    unsigned *network_done = user_data;
+    assert(status == ITEM_PREPARSE_DONE);
+    /* Not queued behind the network requests */
+    *network_done = atomic_load(&host_requests.done);
+    vlc_sem_post(&host_requests.sem);
+}
+
+static void test_media_preparse_hosts(const char *sample)
+{
+    test_log ("test_media_preparse_hosts\n");
+
+    const char *argv[test_defaults_nargs + 2];
+    for (int i = 0; i < test_defaults_nargs; i++)
+        argv[i] = test_defaults_args[i];
+    argv[test_defaults_nargs] = "--preparse-host-threads=2";
+    argv[test_defaults_nargs + 1] = "--preparse-network-threads=4";
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(argv), argv);
+    assert (vlc != NULL);
+
+    host_server.fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(host_server.fd >= 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(host_server.fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(listen(host_server.fd, HOST_REQUESTS) == 0);
+    socklen_t addrlen = sizeof (addr);
+    assert(getsockname(host_server.fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    host_server.port = ntohs(addr.sin_port);
+    host_server.max_clients = 0;
+    atomic_init(&host_server.quit, false);
+    assert(vlc_clone(&host_server.thread, host_server_thread, NULL,
+                     VLC_THREAD_PRIORITY_LOW) == 0);
+
+    vlc_sem_init(&host_requests.sem, 0);
+    atomic_init(&host_requests.done, 0);
+
+    /* All the requests of the host are pushed at once */
+    static const struct input_preparser_callbacks_t host_cbs = {
+        .on_preparse_ended = host_preparse_ended,
+    };
+    input_item_t *items[HOST_REQUESTS];
+    for (unsigned i = 0; i < HOST_REQUESTS; i++)
+    {
+        char uri[64];
+        snprintf(uri, sizeof (uri), "http://127.0.0.1:%u/%u",
+                 host_server.port, i);
+        items[i] = input_item_NewExt(uri, "host test", 0, ITEM_TYPE_FILE,
+                                     ITEM_NET);
+        assert(items[i] != NULL);
+        int ret = libvlc_MetadataRequest(vlc->p_libvlc_int, items[i],
+                                         META_REQUEST_OPTION_SCOPE_NETWORK,
+                                         &host_cbs, NULL, 0, NULL);
+        assert(ret == 0);
+    }
+
+    /* A local item is preparsed meanwhile */
+    static const struct input_preparser_callbacks_t local_cbs = {
+        .on_preparse_ended = local_preparse_ended,
+    };
+    char *sample_uri = vlc_path2uri(sample, NULL);
+    assert(sample_uri != NULL);
+    input_item_t *local = input_item_NewExt(sample_uri, "local test", 0,
+                                            ITEM_TYPE_FILE, ITEM_LOCAL);
+    free(sample_uri);
+    assert(local != NULL);
+    unsigned network_done = HOST_REQUESTS;
+    int ret = libvlc_MetadataRequest(vlc->p_libvlc_int, local,
+                                     META_REQUEST_OPTION_SCOPE_LOCAL,
+                                     &local_cbs, &network_done, 0, NULL);
+    assert(ret == 0);
+
+    for (unsigned i = 0; i < HOST_REQUESTS + 1; i++)
+        vlc_sem_wait(&host_requests.sem);
+    assert(network_done < HOST_REQUESTS);
+
+    atomic_store(&host_server.quit, true);
+    vlc_join(host_server.thread, NULL);
+    close(host_server.fd);
+
+    /* Never more than the limit, and the limit is used */
+    test_log ("at most %u simultaneous connections to the host\n",
+              host_server.max_clients);
+    assert(host_server.max_clients == 2);
+
+    for (unsigned i = 0; i < HOST_REQUESTS; i++)
+        input_item_Release(items[i]);
+    input_item_Release(local);
+    vlc_sem_destroy(&host_requests.sem);
+    libvlc_release (vlc);
+}
+#endif
+
 static void input_item_preparse_timeout( input_item_t *item,
                                          enum input_item_preparse_status status,
                                          void *user_data )
@@ -362,6 +680,10 @@ int main(int i_argc, char *ppsz_argv[])
     test_media_preparsed (vlc, SRCDIR"/samples/image.jpg", NULL,
                           libvlc_media_parse_local,
                           libvlc_media_parsed_status_done);
+    test_media_preparsed_cached (vlc, SRCDIR"/samples/image.jpg");
+#ifndef _WIN32
+    test_media_preparse_hosts (SRCDIR"/samples/image.jpg");
+#endif
     test_media_preparsed (vlc, NULL, "http://parsing_should_be_skipped.org/video.mp4",
                           libvlc_media_parse_local,
                           libvlc_media_parsed_status_skipped);
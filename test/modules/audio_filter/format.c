@@ -0,0 +1,211 @@
+/*****************************************************************************
+ * format.c: test the PCM format conversion kernels against the scalar ones
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <vlc_common.h>
+#include "../modules/audio_filter/converter/format.h"
+
+/* Values are converted in chunks so that every kernel goes through its
+ * vector loop, and with an odd remainder so that the scalar tail runs too */
+#define CHUNK 4099
+
+struct kernels
+{
+    const char *name;
+    pcm_s16_fl32_t s16_fl32;
+    pcm_fl32_s16_t fl32_s16;
+    pcm_fl32_s16_dither_t fl32_s16_dither;
+    pcm_s32_fl32_t s32_fl32;
+    pcm_fl32_s32_t fl32_s32;
+};
+
+#define KERNELS(isa) { #isa, pcm_s16_to_fl32_##isa, pcm_fl32_to_s16_##isa, \
+                       pcm_fl32_to_s16_dither_##isa, pcm_s32_to_fl32_##isa, \
+                       pcm_fl32_to_s32_##isa }
+
+static const struct kernels scalar = KERNELS(c);
+
+static float ref_f[CHUNK], out_f[CHUNK];
+static int16_t ref_s16[CHUNK], out_s16[CHUNK];
+static int32_t ref_s32[CHUNK];
+
+static void check_s16_fl32(const struct kernels *k)
+{
+    int16_t in[CHUNK];
+    size_t n = 0;
+
+    /* Exhaustive */
+    for (int32_t v = INT16_MIN; v <= INT16_MAX; v++)
+    {
+        in[n++] = v;
+        if (n == CHUNK || v == INT16_MAX)
+        {
+            scalar.s16_fl32(ref_f, in, n);
+            k->s16_fl32(out_f, in, n);
+            assert(memcmp(ref_f, out_f, n * sizeof(float)) == 0);
+            for (size_t i = 0; i < n; i++)
+                assert(ref_f[i] == in[i] / 32768.f);
+            n = 0;
+        }
+    }
+}
+
+static void check_s32_fl32(const struct kernels *k)
+{
+    int32_t in[CHUNK];
+    size_t n = 0;
+
+    /* Every 16-bits value of the most significant half, with varying low
+     * bits to cover the float rounding of all magnitudes */
+    for (uint32_t hi = 0; hi <= 0xffff; hi++)
+    {
+        in[n++] = (int32_t)((hi << 16) | ((hi * 0x9e37) & 0xffff));
+        if (n == CHUNK || hi == 0xffff)
+        {
+            scalar.s32_fl32(ref_f, in, n);
+            /* in place */
+            memcpy(out_f, in, n * sizeof(float));
+            k->s32_fl32(out_f, (const int32_t *)out_f, n);
+            assert(memcmp(ref_f, out_f, n * sizeof(float)) == 0);
+            n = 0;
+        }
+    }
+}
+
+static void check_float_chunk(const struct kernels *k, const float *in,
+                              size_t n)
+{
+    scalar.fl32_s16(ref_s16, in, n);
+    memcpy(out_f, in, n * sizeof(float));
+    k->fl32_s16((int16_t *)out_f, out_f, n);
+    if (memcmp(ref_s16, out_f, n * sizeof(int16_t)))
+    {
+        for (size_t i = 0; i < n; i++)
+            if (ref_s16[i] != ((int16_t *)out_f)[i])
+                printf("%s: fl32->s16 %a: %d != %d\n", k->name, in[i],
+                       ref_s16[i], ((int16_t *)out_f)[i]);
+        abort();
+    }
+
+    uint32_t ref_state[PCM_DITHER_LANES], state[PCM_DITHER_LANES];
+    for (unsigned i = 0; i < PCM_DITHER_LANES; i++)
+        ref_state[i] = state[i] = 0x9e3779b9 * (i + 1);
+    scalar.fl32_s16_dither(ref_s16, in, n, ref_state);
+    k->fl32_s16_dither(out_s16, in, n, state);
+    assert(memcmp(ref_s16, out_s16, n * sizeof(int16_t)) == 0);
+    assert(memcmp(ref_state, state, sizeof(state)) == 0);
+
+    scalar.fl32_s32(ref_s32, in, n);
+    memcpy(out_f, in, n * sizeof(float));
+    k->fl32_s32((int32_t *)out_f, out_f, n);
+    if (memcmp(ref_s32, out_f, n * sizeof(int32_t)))
+    {
+        for (size_t i = 0; i < n; i++)
+            if (ref_s32[i] != ((int32_t *)out_f)[i])
+                printf("%s: fl32->s32 %a: %d != %d\n", k->name, in[i],
+                       ref_s32[i], ((int32_t *)out_f)[i]);
+        abort();
+    }
+}
+
+static void check_fl32(const struct kernels *k)
+{
+    float in[CHUNK];
+    size_t n = 0;
+
+    /* All the rounding and clipping boundaries of the 16-bits output */
+    for (int32_t v = INT16_MIN - 2; v <= INT16_MAX + 2; v++)
+    {
+        float b = (v + .5f) / 32768.f;
+        in[n++] = nextafterf(b, -INFINITY);
+        in[n++] = b;
+        in[n++] = nextafterf(b, INFINITY);
+        in[n++] = v / 32768.f;
+        if (n > CHUNK - 4)
+        {
+            check_float_chunk(k, in, n);
+            n = 0;
+        }
+    }
+
+    /* All the non-NaN single precision values, sparsely */
+    for (uint64_t bits = 0; bits <= UINT32_MAX; bits += 509)
+    {
+        union { uint32_t u; float f; } u = { .u = bits };
+        if (isnan(u.f))
+            continue;
+        in[n++] = u.f;
+        if (n == CHUNK)
+        {
+            check_float_chunk(k, in, n);
+            n = 0;
+        }
+    }
+    in[n++] = INFINITY;
+    in[n++] = -INFINITY;
+    in[n++] = 1.f;
+    in[n++] = -1.f;
+    check_float_chunk(k, in, n);
+}
+
+static void check(const struct kernels *k)
+{
+    printf("checking %s kernels\n", k->name);
+    check_s16_fl32(k);
+    check_s32_fl32(k);
+    check_fl32(k);
+}
+
+int main(void)
+{
+    check(&scalar);
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (vlc_CPU_SSE2())
+    {
+        const struct kernels sse2 = KERNELS(sse2);
+        check(&sse2);
+    }
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2())
+    {
+        const struct kernels avx2 = KERNELS(avx2);
+        check(&avx2);
+    }
+#endif
+#ifdef PCM_CONVERT_NEON
+    if (vlc_CPU_ARM_NEON())
+    {
+        const struct kernels neon = KERNELS(neon);
+        check(&neon);
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,500 @@
+/*****************************************************************************
+ * adaptivelogic.cpp: adaptive streaming logics simulator
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include "../modules/demux/adaptive/ID.cpp"
+#include "../modules/demux/adaptive/StreamFormat.cpp"
+#include "../modules/demux/adaptive/SegmentTracker.cpp"
+#include "../modules/demux/adaptive/tools/Conversions.cpp"
+#include "../modules/demux/adaptive/tools/Helper.cpp"
+#include "../modules/demux/adaptive/tools/MemoryBudget.cpp"
+#include "../modules/demux/adaptive/http/AuthStorage.cpp"
+#include "../modules/demux/adaptive/http/BytesRange.cpp"
+#include "../modules/demux/adaptive/http/Chunk.cpp"
+#include "../modules/demux/adaptive/http/ConnectionParams.cpp"
+#include "../modules/demux/adaptive/http/Downloader.cpp"
+#include "../modules/demux/adaptive/http/HTTPConnection.cpp"
+#include "../modules/demux/adaptive/http/HTTPConnectionManager.cpp"
+#include "../modules/demux/adaptive/http/Transport.cpp"
+#include "../modules/demux/adaptive/playlist/AbstractPlaylist.cpp"
+#include "../modules/demux/adaptive/playlist/BaseAdaptationSet.cpp"
+#include "../modules/demux/adaptive/playlist/BasePeriod.cpp"
+#include "../modules/demux/adaptive/playlist/BaseRepresentation.cpp"
+#include "../modules/demux/adaptive/playlist/CommonAttributesElements.cpp"
+#include "../modules/demux/adaptive/playlist/Inheritables.cpp"
+#include "../modules/demux/adaptive/playlist/Segment.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentBase.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentChunk.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentInfoCommon.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentInformation.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentList.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentTemplate.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentTimeline.cpp"
+#include "../modules/demux/adaptive/playlist/Url.cpp"
+#include "../modules/demux/adaptive/logic/AbstractAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/AlwaysBestAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/AlwaysLowestAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/BufferBasedAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/NearOptimalAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/PredictiveAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/RateBasedAdaptationLogic.cpp"
+#include "../modules/demux/adaptive/logic/Representationselectors.cpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Bandwidth traces are replayed on a virtual clock: segments are downloaded
+ * one at a time, least buffered stream first, while the playback drains the
+ * buffers. Nothing depends on the wall clock or the network, so that the
+ * logics can be compared, and regressions spotted, from run to run.
+ *
+ * Usage: test_modules_demux_adaptivelogic [trace]
+ * with one "<duration in s> <bandwidth in kbps>" step per line.
+ */
+
+#define SEGMENT_DURATION    VLC_TICK_FROM_SEC(2)
+#define SEGMENTS            150
+#define REQUEST_LATENCY     VLC_TICK_FROM_MS(50)
+#define MIN_BUFFERING       VLC_TICK_FROM_SEC(6)
+#define MAX_BUFFERING       VLC_TICK_FROM_SEC(60)
+
+static const uint64_t video_rates[] = { 250000, 500000, 1000000, 2000000,
+                                        3000000, 4500000, 6000000 };
+static const uint64_t audio_rates[] = { 64000, 128000 };
+
+struct TraceStep
+{
+    unsigned duration; /* s */
+    unsigned kbps;
+};
+
+struct Trace
+{
+    const char *name;
+    std::vector<TraceStep> steps;
+};
+
+struct Result
+{
+    vlc_tick_t startup;
+    vlc_tick_t played;
+    vlc_tick_t stalled;
+    unsigned stalls;
+    unsigned switches;
+    uint64_t avg_bitrate; /* video */
+
+    double rebufferRatio() const
+    {
+        return (played + stalled) ? (double) stalled / (played + stalled) : 0.0;
+    }
+    bool operator==(const Result &o) const
+    {
+        return startup == o.startup && played == o.played && stalled == o.stalled &&
+               stalls == o.stalls && switches == o.switches &&
+               avg_bitrate == o.avg_bitrate;
+    }
+};
+
+class SimPlaylist : public AbstractPlaylist
+{
+    public:
+        SimPlaylist() : AbstractPlaylist(NULL) {}
+        virtual bool isLive() const { return false; }
+        virtual void debug() {}
+};
+
+/* Download time of a request, the last step of the trace lasting forever */
+static vlc_tick_t Download(const Trace &trace, vlc_tick_t now, uint64_t bytes)
+{
+    vlc_tick_t start = now + REQUEST_LATENCY;
+    vlc_tick_t t = start;
+    double bits = bytes * 8.0;
+
+    vlc_tick_t stepstart = 0;
+    for(size_t i = 0; bits > 0.0; i++)
+    {
+        const TraceStep &step = trace.steps[std::min(i, trace.steps.size() - 1)];
+        const vlc_tick_t stepend = (i + 1 < trace.steps.size())
+                                 ? stepstart + VLC_TICK_FROM_SEC(step.duration) : INT64_MAX;
+        if(stepend > t && step.kbps > 0)
+        {
+            const double bps = step.kbps * 1000.0;
+            const double available = (stepend == INT64_MAX) ? bits
+                                   : bps * secf_from_vlc_tick(stepend - t);
+            if(available >= bits)
+            {
+                t += vlc_tick_from_sec(bits / bps);
+                bits = 0.0;
+            }
+            else
+            {
+                t = stepend;
+                bits -= available;
+            }
+        }
+        else if(stepend > t)
+        {
+            t = stepend;
+        }
+        stepstart = stepend;
+    }
+    return t - now;
+}
+
+struct SimStream
+{
+    BaseAdaptationSet *set;
+    BaseRepresentation *rep;
+    vlc_tick_t buffered;
+    unsigned segment;
+};
+
+class Simulation
+{
+    public:
+        Simulation(AbstractAdaptationLogic *logic_, const Trace &trace_)
+            : logic(logic_), trace(trace_)
+        {
+            period = new BasePeriod(&playlist);
+            playlist.addPeriod(period);
+            AddStream("video", video_rates, ARRAY_SIZE(video_rates));
+            AddStream("audio", audio_rates, ARRAY_SIZE(audio_rates));
+            now = 0;
+            playing = false;
+            started = false;
+            result = Result();
+            bits = 0;
+            videosegments = 0;
+        }
+
+        Result run()
+        {
+            for(size_t i = 0; i < streams.size(); i++)
+                logic->trackerEvent(SegmentTrackerEvent(streams[i].set->getID(), true));
+
+            for(;;)
+            {
+                SimStream *next = NULL;
+                bool done = true;
+                for(size_t i = 0; i < streams.size(); i++)
+                {
+                    SimStream &s = streams[i];
+                    if(s.segment == SEGMENTS)
+                        continue;
+                    done = false;
+                    if(s.buffered + SEGMENT_DURATION > MAX_BUFFERING)
+                        continue;
+                    if(next == NULL || s.buffered < next->buffered)
+                        next = &s;
+                }
+                if(done)
+                    break;
+
+                if(next == NULL)
+                {
+                    /* all full, wait for the least buffered to have room */
+                    vlc_tick_t wait = INT64_MAX;
+                    for(size_t i = 0; i < streams.size(); i++)
+                        if(streams[i].segment < SEGMENTS)
+                            wait = std::min(wait, streams[i].buffered + SEGMENT_DURATION - MAX_BUFFERING);
+                    Advance(wait);
+                    continue;
+                }
+
+                DownloadSegment(*next);
+            }
+
+            /* play out what remains */
+            if(!playing)
+                Start();
+            vlc_tick_t remain = INT64_MAX;
+            for(size_t i = 0; i < streams.size(); i++)
+                remain = std::min(remain, streams[i].buffered);
+            Advance(remain);
+
+            for(size_t i = 0; i < streams.size(); i++)
+            {
+                logic->trackerEvent(SegmentTrackerEvent(streams[i].rep, NULL));
+                logic->trackerEvent(SegmentTrackerEvent(streams[i].set->getID(), false));
+            }
+
+            result.avg_bitrate = videosegments ? bits / videosegments : 0;
+            return result;
+        }
+
+    private:
+        void AddStream(const char *id, const uint64_t *rates, size_t count)
+        {
+            BaseAdaptationSet *set = new BaseAdaptationSet(period);
+            set->setID(ID(id));
+            for(size_t i = 0; i < count; i++)
+            {
+                BaseRepresentation *rep = new BaseRepresentation(set);
+                rep->setID(ID(i));
+                rep->setBandwidth(rates[i]);
+                set->addRepresentation(rep);
+            }
+            period->addAdaptationSet(set);
+
+            SimStream s;
+            s.set = set;
+            s.rep = NULL;
+            s.buffered = 0;
+            s.segment = 0;
+            streams.push_back(s);
+        }
+
+        void DownloadSegment(SimStream &s)
+        {
+            const ID &id = s.set->getID();
+            logic->trackerEvent(SegmentTrackerEvent(id, MIN_BUFFERING, s.buffered, MAX_BUFFERING));
+
+            BaseRepresentation *rep = logic->getNextRepresentation(s.set, s.rep);
+            assert(rep != NULL);
+            if(rep != s.rep)
+            {
+                if(s.rep)
+                    result.switches++;
+                logic->trackerEvent(SegmentTrackerEvent(s.rep, rep));
+                s.rep = rep;
+            }
+            logic->trackerEvent(SegmentTrackerEvent(id, SEGMENT_DURATION));
+
+            const uint64_t bytes = rep->getBandwidth() * SEGMENT_DURATION / CLOCK_FREQ / 8;
+            const vlc_tick_t duration = Download(trace, now, bytes);
+            Advance(duration);
+            logic->updateDownloadRate(id, bytes, duration);
+
+            s.buffered += SEGMENT_DURATION;
+            s.segment++;
+            if(&s == &streams[0])
+            {
+                bits += rep->getBandwidth();
+                videosegments++;
+            }
+
+            if(!playing)
+            {
+                bool ready = true;
+                for(size_t i = 0; i < streams.size(); i++)
+                    if(streams[i].buffered < MIN_BUFFERING && streams[i].segment < SEGMENTS)
+                        ready = false;
+                if(ready)
+                    Start();
+            }
+        }
+
+        void Start()
+        {
+            playing = true;
+            if(!started)
+            {
+                started = true;
+                result.startup = now;
+            }
+        }
+
+        void Advance(vlc_tick_t duration)
+        {
+            now += duration;
+            if(!playing)
+            {
+                if(started)
+                    result.stalled += duration;
+                return;
+            }
+
+            vlc_tick_t playable = duration;
+            for(size_t i = 0; i < streams.size(); i++)
+                playable = std::min(playable, streams[i].buffered);
+            for(size_t i = 0; i < streams.size(); i++)
+                streams[i].buffered -= playable;
+            result.played += playable;
+
+            if(playable < duration)
+            {
+                playing = false;
+                result.stalls++;
+                result.stalled += duration - playable;
+            }
+        }
+
+        AbstractAdaptationLogic *logic;
+        const Trace &trace;
+        SimPlaylist playlist;
+        BasePeriod *period;
+        std::vector<SimStream> streams;
+        vlc_tick_t now;
+        bool playing;
+        bool started;
+        Result result;
+        uint64_t bits;
+        unsigned videosegments;
+};
+
+enum
+{
+    LOGIC_RATE,
+    LOGIC_PREDICTIVE,
+    LOGIC_NEAROPTIMAL,
+    LOGIC_BOLA,
+    LOGIC_HYBRID,
+    LOGIC_LOWEST,
+    LOGIC_HIGHEST,
+    LOGIC_COUNT,
+};
+
+static const char *const logic_names[] = {
+    "rate", "predictive", "nearoptimal", "bola", "hybrid", "lowest", "highest",
+};
+
+static AbstractAdaptationLogic *CreateLogic(unsigned type)
+{
+    switch(type)
+    {
+        case LOGIC_RATE:        return new RateBasedAdaptationLogic(NULL);
+        case LOGIC_PREDICTIVE:  return new PredictiveAdaptationLogic(NULL);
+        case LOGIC_NEAROPTIMAL: return new NearOptimalAdaptationLogic();
+        case LOGIC_BOLA:        return new BufferBasedAdaptationLogic(NULL, false);
+        case LOGIC_HYBRID:      return new BufferBasedAdaptationLogic(NULL, true);
+        case LOGIC_LOWEST:      return new AlwaysLowestAdaptationLogic();
+        case LOGIC_HIGHEST:     return new AlwaysBestAdaptationLogic();
+        default:                return NULL;
+    }
+}
+
+static Result Simulate(unsigned type, const Trace &trace)
+{
+    AbstractAdaptationLogic *logic = CreateLogic(type);
+    assert(logic != NULL);
+    Result result;
+    {
+        Simulation sim(logic, trace);
+        result = sim.run();
+    }
+    delete logic;
+    return result;
+}
+
+static void Compare(const Trace &trace, Result *results)
+{
+    printf("trace %s\n", trace.name);
+    printf("  %-12s %8s %9s %7s %6s %9s\n",
+           "logic", "startup", "rebuffer", "stalls", "switch", "kbps");
+    for(unsigned i = 0; i < LOGIC_COUNT; i++)
+    {
+        results[i] = Simulate(i, trace);
+        printf("  %-12s %7.1fs %8.2f%% %7u %6u %9" PRIu64 "\n", logic_names[i],
+               secf_from_vlc_tick(results[i].startup),
+               100.0 * results[i].rebufferRatio(),
+               results[i].stalls, results[i].switches,
+               results[i].avg_bitrate / 1000);
+    }
+}
+
+static bool LoadTrace(const char *path, Trace *trace)
+{
+    FILE *f = fopen(path, "r");
+    if(f == NULL)
+        return false;
+
+    TraceStep step;
+    while(fscanf(f, "%u %u", &step.duration, &step.kbps) == 2)
+        trace->steps.push_back(step);
+    fclose(f);
+    trace->name = path;
+    /* the last step lasts forever */
+    return !trace->steps.empty() && trace->steps.back().kbps > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    Result results[LOGIC_COUNT];
+
+    if(argc > 1)
+    {
+        Trace trace;
+        if(!LoadTrace(argv[1], &trace))
+        {
+            fprintf(stderr, "cannot load trace %s\n", argv[1]);
+            return 1;
+        }
+        Compare(trace, results);
+        return 0;
+    }
+
+    /* Constant bandwidth, enough for the 4.5 Mbps quality */
+    Trace stable;
+    stable.name = "stable";
+    stable.steps.push_back({ 1, 5500 });
+    Compare(stable, results);
+    assert(results[LOGIC_LOWEST].avg_bitrate == video_rates[0]);
+    assert(results[LOGIC_HIGHEST].stalls > 0);
+    assert(results[LOGIC_BOLA].stalls == 0);
+    assert(results[LOGIC_BOLA].avg_bitrate >= 3000000);
+    assert(results[LOGIC_HYBRID].stalls == 0);
+    assert(results[LOGIC_HYBRID].avg_bitrate >= results[LOGIC_BOLA].avg_bitrate);
+
+    /* Sudden drop under the highest qualities */
+    Trace drop;
+    drop.name = "drop";
+    drop.steps.push_back({ 90, 8000 });
+    drop.steps.push_back({ 1, 900 });
+    Compare(drop, results);
+    assert(results[LOGIC_BOLA].stalls == 0);
+    assert(results[LOGIC_HYBRID].stalls == 0);
+
+    /* Alternating good and bad periods, with outages */
+    Trace steps;
+    steps.name = "steps";
+    for(unsigned i = 0; i < 8; i++)
+    {
+        steps.steps.push_back({ 20, 6000 });
+        steps.steps.push_back({ 15, 1200 });
+        steps.steps.push_back({ 3, 0 });
+    }
+    steps.steps.push_back({ 1, 3000 });
+    Compare(steps, results);
+    assert(results[LOGIC_BOLA].stalls == 0);
+
+    /* Mobile like, from a fixed seed */
+    Trace mobile;
+    mobile.name = "mobile";
+    uint32_t seed = 0x1234;
+    for(unsigned i = 0; i < 300; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        mobile.steps.push_back({ 1, 300 + (seed >> 16) % 5000 });
+    }
+    Compare(mobile, results);
+
+    /* Same trace, same decisions */
+    for(unsigned i = 0; i < LOGIC_COUNT; i++)
+        assert(Simulate(i, mobile) == results[i]);
+
+    return 0;
+}
@@ -0,0 +1,538 @@
+/*****************************************************************************
+ * downloader.cpp: adaptive segments downloader test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include "../modules/demux/adaptive/ID.cpp"
+#include "../modules/demux/adaptive/tools/Helper.cpp"
+#include "../modules/demux/adaptive/tools/MemoryBudget.cpp"
+#include "../modules/demux/adaptive/http/AuthStorage.cpp"
+#include "../modules/demux/adaptive/http/BytesRange.cpp"
+#include "../modules/demux/adaptive/http/Chunk.cpp"
+#include "../modules/demux/adaptive/http/ConnectionParams.cpp"
+#include "../modules/demux/adaptive/http/Downloader.cpp"
+#include "../modules/demux/adaptive/http/HTTPConnection.cpp"
+#include "../modules/demux/adaptive/http/HTTPConnectionManager.cpp"
+#include "../modules/demux/adaptive/http/Transport.cpp"
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+/* The loopback server delays each reply and throttles its body, so that
+ * requests are dominated by latency and bandwidth as on a real network. */
+#define SERVER_LATENCY  VLC_TICK_FROM_MS(20)
+#define SERVER_BLOCK    4096
+#define SERVER_PACING   VLC_TICK_FROM_MS(1) /* per block, ~4 MB/s */
+#define SEGMENT_SIZE    (80 * 1024)
+#define FIRST_CHUNK_SIZE 1000
+#define CHUNK_INTERVAL  VLC_TICK_FROM_MS(100)
+
+static const char *const streams[] = { "video", "audio", "text" };
+#define STREAMS ARRAY_SIZE(streams)
+
+static uint8_t SegmentByte(unsigned segment, size_t offset)
+{
+    return (segment * 7 + offset) & 0xff;
+}
+
+/*
+ * Loopback HTTP/1.1 server
+ */
+struct server
+{
+    int fd;
+    unsigned port;
+    bool quit;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    std::list<vlc_thread_t> clients;
+};
+
+struct client
+{
+    server *srv;
+    int fd;
+};
+
+static bool SendAll(int fd, const void *buf, size_t len)
+{
+    const char *p = static_cast<const char *>(buf);
+    while(len > 0)
+    {
+        ssize_t ret = send(fd, p, len, MSG_NOSIGNAL);
+        if(ret <= 0)
+            return false;
+        p += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+/* Live CMAF like reply: the first chunk is sent as soon as produced and
+ * the remaining of the segment a while later */
+static bool SendChunked(int fd, unsigned segment)
+{
+    static const char header[] =
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    if(!SendAll(fd, header, sizeof(header) - 1))
+        return false;
+
+    uint8_t data[SEGMENT_SIZE];
+    for(size_t i = 0; i < SEGMENT_SIZE; i++)
+        data[i] = SegmentByte(segment, i);
+
+    const size_t sizes[] = { FIRST_CHUNK_SIZE, SEGMENT_SIZE - FIRST_CHUNK_SIZE };
+    size_t offset = 0;
+    for(size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        if(i > 0)
+            vlc_tick_sleep(CHUNK_INTERVAL);
+
+        char line[32];
+        int len = snprintf(line, sizeof(line), "%zx\r\n", sizes[i]);
+        if(!SendAll(fd, line, len) ||
+           !SendAll(fd, &data[offset], sizes[i]) ||
+           !SendAll(fd, "\r\n", 2))
+            return false;
+        offset += sizes[i];
+    }
+    return SendAll(fd, "0\r\n\r\n", 5);
+}
+
+static void *ClientThread(void *data)
+{
+    client *cl = static_cast<client *>(data);
+    std::string request;
+    char buf[1024];
+
+    while(!cl->srv->quit)
+    {
+        size_t end = request.find("\r\n\r\n");
+        if(end == std::string::npos)
+        {
+            ssize_t ret = recv(cl->fd, buf, sizeof(buf), 0);
+            if(ret <= 0)
+                break;
+            request.append(buf, ret);
+            continue;
+        }
+
+        char name[16];
+        unsigned segment;
+        int ok = sscanf(request.c_str(), "GET /%15[a-z]/%u HTTP/1.1", name, &segment);
+        request.erase(0, end + 4);
+
+        if(ok != 2)
+        {
+            static const char notfound[] =
+                "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            if(!SendAll(cl->fd, notfound, sizeof(notfound) - 1))
+                break;
+            continue;
+        }
+
+        vlc_tick_sleep(SERVER_LATENCY);
+
+        if(!strcmp(name, "chunked"))
+        {
+            if(!SendChunked(cl->fd, segment))
+                break;
+            continue;
+        }
+
+        char header[128];
+        int len = snprintf(header, sizeof(header),
+                           "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n",
+                           SEGMENT_SIZE);
+        if(!SendAll(cl->fd, header, len))
+            break;
+
+        uint8_t block[SERVER_BLOCK];
+        bool error = false;
+        for(size_t offset = 0; offset < SEGMENT_SIZE && !error; offset += SERVER_BLOCK)
+        {
+            size_t size = __MIN(SERVER_BLOCK, SEGMENT_SIZE - offset);
+            for(size_t i = 0; i < size; i++)
+                block[i] = SegmentByte(segment, offset + i);
+            error = !SendAll(cl->fd, block, size);
+            vlc_tick_sleep(SERVER_PACING);
+        }
+        if(error)
+            break;
+    }
+
+    close(cl->fd);
+    delete cl;
+    return NULL;
+}
+
+static void *ServerThread(void *data)
+{
+    server *srv = static_cast<server *>(data);
+
+    while(!srv->quit)
+    {
+        struct pollfd ufd = { srv->fd, POLLIN, 0 };
+        if(poll(&ufd, 1, 50) <= 0)
+            continue;
+
+        int fd = accept(srv->fd, NULL, NULL);
+        if(fd < 0)
+            continue;
+
+        client *cl = new client;
+        cl->srv = srv;
+        cl->fd = fd;
+
+        vlc_thread_t th;
+        if(vlc_clone(&th, ClientThread, cl, VLC_THREAD_PRIORITY_LOW))
+        {
+            close(fd);
+            delete cl;
+            continue;
+        }
+        vlc_mutex_lock(&srv->lock);
+        srv->clients.push_back(th);
+        vlc_mutex_unlock(&srv->lock);
+    }
+    return NULL;
+}
+
+static void ServerStart(server *srv)
+{
+    srv->fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(srv->fd >= 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    assert(bind(srv->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(listen(srv->fd, 16) == 0);
+
+    socklen_t addrlen = sizeof(addr);
+    assert(getsockname(srv->fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    srv->port = ntohs(addr.sin_port);
+
+    srv->quit = false;
+    vlc_mutex_init(&srv->lock);
+    assert(vlc_clone(&srv->thread, ServerThread, srv, VLC_THREAD_PRIORITY_LOW) == 0);
+}
+
+static void ServerStop(server *srv)
+{
+    srv->quit = true;
+    vlc_join(srv->thread, NULL);
+    /* clients exit once their connection is closed */
+    for(std::list<vlc_thread_t>::iterator it = srv->clients.begin();
+        it != srv->clients.end(); ++it)
+        vlc_join(*it, NULL);
+    vlc_mutex_destroy(&srv->lock);
+    close(srv->fd);
+}
+
+/*
+ * Client
+ */
+class CompletionObserver : public IDownloadRateObserver
+{
+    public:
+        CompletionObserver()
+        {
+            vlc_mutex_init(&lock);
+            totalSize = 0;
+            totalTime = 0;
+        }
+        virtual ~CompletionObserver()
+        {
+            vlc_mutex_destroy(&lock);
+        }
+        virtual void updateDownloadRate(const ID &id, size_t size, vlc_tick_t time)
+        {
+            assert(size > 0 && time > 0);
+            vlc_mutex_lock(&lock);
+            completed.push_back(Completion(id, vlc_tick_now()));
+            totalSize += size;
+            totalTime += time;
+            vlc_mutex_unlock(&lock);
+        }
+
+        typedef std::pair<ID, vlc_tick_t> Completion;
+        std::vector<Completion> completed;
+        /* sum of the reported samples, which do not overlap */
+        size_t totalSize;
+        vlc_tick_t totalTime;
+
+    private:
+        vlc_mutex_t lock;
+};
+
+static void ReadSegment(HTTPChunkBufferedSource *source, unsigned segment)
+{
+    size_t offset = 0;
+    block_t *p_block;
+    while((p_block = source->readBlock()))
+    {
+        for(size_t i = 0; i < p_block->i_buffer; i++)
+            assert(p_block->p_buffer[i] == SegmentByte(segment, offset + i));
+        offset += p_block->i_buffer;
+        block_Release(p_block);
+    }
+    assert(offset == SEGMENT_SIZE);
+}
+
+static HTTPChunkBufferedSource *Schedule(HTTPConnectionManager *manager,
+                                         const server *srv,
+                                         const char *name, unsigned segment)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/%s/%u", srv->port, name, segment);
+
+    HTTPChunkBufferedSource *source =
+            new HTTPChunkBufferedSource(url, manager, ID(name));
+    manager->start(source);
+    return source;
+}
+
+static vlc_tick_t RunSession(vlc_object_t *obj, const server *srv,
+                             unsigned downloaders, unsigned segments,
+                             vlc_tick_t *startup, size_t *rate)
+{
+    var_SetInteger(obj, "adaptive-downloaders", downloaders);
+
+    AuthStorage *auth = new AuthStorage(obj);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(obj, auth);
+    CompletionObserver observer;
+    manager->setDownloadRateObserver(&observer);
+
+    const vlc_tick_t start = vlc_tick_now();
+
+    /* all the segments are queued upfront, as for a stream refilling its
+     * buffer from empty */
+    std::vector<HTTPChunkBufferedSource *> sources;
+    for(unsigned i = 0; i < segments; i++)
+        for(size_t j = 0; j < STREAMS; j++)
+            sources.push_back(Schedule(manager, srv, streams[j], i));
+
+    for(size_t i = 0; i < sources.size(); i++)
+    {
+        ReadSegment(sources[i], i / STREAMS);
+        delete sources[i];
+    }
+
+    const vlc_tick_t end = vlc_tick_now();
+
+    /* startup: every stream has got its first segment */
+    bool seen[STREAMS] = { false };
+    size_t left = STREAMS;
+    for(size_t i = 0; i < observer.completed.size() && left; i++)
+        for(size_t j = 0; j < STREAMS; j++)
+            if(!seen[j] && observer.completed[i].first == ID(streams[j]))
+            {
+                seen[j] = true;
+                if(--left == 0)
+                    *startup = observer.completed[i].second - start;
+            }
+    assert(left == 0);
+    assert(observer.completed.size() == segments * STREAMS);
+
+    /* The samples account for every byte once, over the time spent
+     * downloading, whatever the number of parallel transfers: the sum of
+     * their rates, or any of them, is the aggregate throughput */
+    assert(observer.totalSize == segments * STREAMS * SEGMENT_SIZE);
+    assert(observer.totalTime <= end - start);
+    *rate = observer.totalSize * CLOCK_FREQ / observer.totalTime;
+
+    delete manager;
+    delete auth;
+
+    return end - start;
+}
+
+static void TestPriority(vlc_object_t *obj, const server *srv)
+{
+    var_SetInteger(obj, "adaptive-downloaders", 1);
+
+    AuthStorage *auth = new AuthStorage(obj);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(obj, auth);
+    CompletionObserver observer;
+    manager->setDownloadRateObserver(&observer);
+
+    /* keeps the only downloader busy while the others are queued */
+    manager->updateBufferingLevel(ID("blocker"), -1);
+    manager->updateBufferingLevel(ID("video"), VLC_TICK_FROM_SEC(10));
+    manager->updateBufferingLevel(ID("text"), VLC_TICK_FROM_SEC(5));
+    manager->updateBufferingLevel(ID("audio"), VLC_TICK_FROM_SEC(1));
+
+    HTTPChunkBufferedSource *sources[] = {
+        Schedule(manager, srv, "blocker", 0),
+        Schedule(manager, srv, "video", 0),
+        Schedule(manager, srv, "text", 0),
+        Schedule(manager, srv, "audio", 0),
+    };
+    for(size_t i = 0; i < ARRAY_SIZE(sources); i++)
+    {
+        ReadSegment(sources[i], 0);
+        delete sources[i];
+    }
+
+    /* least buffered first */
+    assert(observer.completed.size() == 4);
+    assert(observer.completed[0].first == ID("blocker"));
+    assert(observer.completed[1].first == ID("audio"));
+    assert(observer.completed[2].first == ID("text"));
+    assert(observer.completed[3].first == ID("video"));
+
+    delete manager;
+    delete auth;
+}
+
+static void TestChunked(vlc_object_t *obj, const server *srv)
+{
+    var_SetInteger(obj, "adaptive-downloaders", 1);
+
+    AuthStorage *auth = new AuthStorage(obj);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(obj, auth);
+    CompletionObserver observer;
+    manager->setDownloadRateObserver(&observer);
+
+    const vlc_tick_t start = vlc_tick_now();
+    HTTPChunkBufferedSource *source = Schedule(manager, srv, "chunked", 3);
+
+    /* The first chunk is available before the segment is complete */
+    block_t *p_block = source->readBlock();
+    assert(p_block != NULL);
+    const vlc_tick_t first = vlc_tick_now() - start;
+    assert(p_block->i_buffer == FIRST_CHUNK_SIZE);
+    for(size_t i = 0; i < p_block->i_buffer; i++)
+        assert(p_block->p_buffer[i] == SegmentByte(3, i));
+    block_Release(p_block);
+
+    size_t offset = FIRST_CHUNK_SIZE;
+    while((p_block = source->readBlock()))
+    {
+        for(size_t i = 0; i < p_block->i_buffer; i++)
+            assert(p_block->p_buffer[i] == SegmentByte(3, offset + i));
+        offset += p_block->i_buffer;
+        block_Release(p_block);
+    }
+    assert(offset == SEGMENT_SIZE);
+    const vlc_tick_t total = vlc_tick_now() - start;
+    delete source;
+
+    printf("chunked transfer: first data after %" PRId64 " ms, complete after %" PRId64 " ms\n",
+           MS_FROM_VLC_TICK(first), MS_FROM_VLC_TICK(total));
+
+    assert(observer.completed.size() == 1);
+    assert(observer.totalSize == SEGMENT_SIZE);
+
+    delete manager;
+    delete auth;
+}
+
+static void TestMemoryBudget(vlc_object_t *obj, const server *srv)
+{
+    var_SetInteger(obj, "adaptive-downloaders", 1);
+
+    AuthStorage *auth = new AuthStorage(obj);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(obj, auth);
+    MemoryBudget *budget = manager->getMemoryBudget();
+    budget->setLimit(SEGMENT_SIZE / 4);
+
+    /* Over the budget, nothing is read ahead of the reader */
+    HTTPChunkBufferedSource *source = Schedule(manager, srv, "video", 1);
+    vlc_tick_sleep(SERVER_LATENCY * 10);
+    assert(budget->getUsed() > 0);
+    assert(budget->getUsed() <= budget->getLimit() + HTTPChunkSource::CHUNK_SIZE);
+
+    ReadSegment(source, 1);
+    delete source;
+
+    assert(budget->getUsed() == 0);
+    assert(budget->getPeak() < SEGMENT_SIZE);
+    printf("memory budget %zu KiB: peak %zu KiB for a %u KiB segment\n",
+           budget->getLimit() / 1024, budget->getPeak() / 1024, SEGMENT_SIZE / 1024);
+
+    delete manager;
+    delete auth;
+}
+
+int main(int argc, char *argv[])
+{
+    /* more segments for a longer run */
+    unsigned segments = (argc > 1) ? strtoul(argv[1], NULL, 10) : 4;
+    if(segments == 0)
+        segments = 1;
+
+    /* test.h is C only */
+    alarm(30);
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    var_Create(obj, "adaptive-downloaders", VLC_VAR_INTEGER);
+
+    server srv;
+    ServerStart(&srv);
+
+    TestPriority(obj, &srv);
+    TestChunked(obj, &srv);
+    TestMemoryBudget(obj, &srv);
+
+    const unsigned counts[] = { 1, 3 };
+    for(size_t i = 0; i < ARRAY_SIZE(counts); i++)
+    {
+        vlc_tick_t startup;
+        size_t rate;
+        vlc_tick_t total = RunSession(obj, &srv, counts[i], segments, &startup, &rate);
+        printf("%u downloader(s), %u segments x %zu streams: "
+               "startup %" PRId64 " ms, total %" PRId64 " ms, measured %zu KiB/s\n",
+               counts[i], segments, STREAMS,
+               MS_FROM_VLC_TICK(startup), MS_FROM_VLC_TICK(total), rate / 1024);
+    }
+
+    ServerStop(&srv);
+    libvlc_release(vlc);
+
+    return 0;
+}
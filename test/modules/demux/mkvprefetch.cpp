@@ -0,0 +1,517 @@
+/*****************************************************************************
+ * mkvprefetch.cpp: matroska stream I/O read-ahead test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include "../modules/demux/mkv/stream_io_callback.cpp"
+
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mkv;
+
+#define FILE_SIZE       (4 * 1024 * 1024)
+#define RANDOM_OPS      20000
+
+#define CLUSTERS        24
+#define CLUSTER_BLOCKS  64
+#define BLOCK_MAX       4000
+
+static uint8_t FileByte(size_t offset)
+{
+    return (offset * 2654435761u) >> 13;
+}
+
+/*
+ * Random reads and seeks: the read-ahead must be transparent
+ */
+static void CheckSame(vlc_stream_io_callback &direct,
+                      vlc_stream_io_callback &prefetched)
+{
+    assert(direct.getFilePointer() == prefetched.getFilePointer());
+    assert(direct.IsEOF() == prefetched.IsEOF());
+    assert(direct.toRead() == prefetched.toRead());
+}
+
+static void TestRandom(vlc_object_t *obj, uint8_t *data, size_t size)
+{
+    stream_t *s_direct = vlc_stream_MemoryNew(obj, data, size, true);
+    stream_t *s_prefetched = vlc_stream_MemoryNew(obj, data, size, true);
+    assert(s_direct != NULL && s_prefetched != NULL);
+
+    vlc_stream_io_callback direct(s_direct, true);
+    vlc_stream_io_callback prefetched(s_prefetched, true);
+    static uint8_t buf_direct[65536], buf_prefetched[65536];
+
+    srand(42);
+    for(unsigned i = 0; i < RANDOM_OPS; i++)
+    {
+        int64_t offset;
+        seek_mode mode;
+
+        switch(rand() % 8)
+        {
+            case 0: /* anywhere, including out of the file */
+                offset = rand() % (size + 2048) - 1024;
+                direct.setFilePointer(offset, seek_beginning);
+                prefetched.setFilePointer(offset, seek_beginning);
+                break;
+            case 1: /* nearby, as when skipping elements */
+                offset = rand() % 8192 - 2048;
+                mode = rand() % 8 ? seek_current : seek_end;
+                direct.setFilePointer(offset, mode);
+                prefetched.setFilePointer(offset, mode);
+                break;
+            case 2: /* only the second one reads ahead */
+                prefetched.prefetch(1 + rand() % 65536);
+                break;
+            case 3: /* EBML header bytes */
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+            {
+                size_t len = (rand() % 4) ? 1 + rand() % 8 : rand() % sizeof(buf_direct);
+                uint32 ret = direct.read(buf_direct, len);
+                assert(prefetched.read(buf_prefetched, len) == ret);
+                assert(memcmp(buf_direct, buf_prefetched, ret) == 0);
+                break;
+            }
+        }
+        CheckSame(direct, prefetched);
+    }
+
+    assert(direct.i_prefetches == 0);
+    assert(prefetched.i_prefetches > 0);
+    printf("random: %u ops, direct %u reads %u seeks, "
+           "read-ahead %u reads (%u read-ahead) %u seeks\n", RANDOM_OPS,
+           direct.i_stream_reads, direct.i_stream_seeks,
+           prefetched.i_stream_reads, prefetched.i_prefetches,
+           prefetched.i_stream_seeks);
+}
+
+/*
+ * Loopback file server: one request per read, as with SMB or NFS
+ */
+struct request
+{
+    uint64_t offset;
+    uint32_t length;
+};
+
+struct server
+{
+    int fd;
+    unsigned port;
+    vlc_thread_t thread;
+    const uint8_t *data;
+    size_t size;
+    /* only accessed by the server thread until it is joined */
+    unsigned requests;
+    unsigned syscalls;
+    size_t bytes;
+};
+
+/* Requests and replies are small, do not wait for the acknowledgments */
+static void NoDelay(int fd)
+{
+    int on = 1;
+    assert(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) == 0);
+}
+
+static bool SendAll(int fd, const void *buf, size_t len, unsigned *syscalls)
+{
+    const char *p = static_cast<const char *>(buf);
+    while(len > 0)
+    {
+        ssize_t ret = send(fd, p, len, MSG_NOSIGNAL);
+        (*syscalls)++;
+        if(ret <= 0)
+            return false;
+        p += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+static bool RecvAll(int fd, void *buf, size_t len, unsigned *syscalls)
+{
+    char *p = static_cast<char *>(buf);
+    while(len > 0)
+    {
+        ssize_t ret = recv(fd, p, len, 0);
+        (*syscalls)++;
+        if(ret <= 0)
+            return false;
+        p += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+/* Serves a single connection */
+static void *ServerThread(void *data)
+{
+    server *srv = static_cast<server *>(data);
+
+    int fd = accept(srv->fd, NULL, NULL);
+    assert(fd >= 0);
+    NoDelay(fd);
+
+    request req;
+    while(RecvAll(fd, &req, sizeof(req), &srv->syscalls))
+    {
+        uint32_t length = 0;
+        if(req.offset < srv->size)
+            length = __MIN(req.length, srv->size - req.offset);
+
+        srv->requests++;
+        srv->bytes += length;
+        if(!SendAll(fd, &length, sizeof(length), &srv->syscalls) ||
+           !SendAll(fd, &srv->data[req.offset], length, &srv->syscalls))
+            break;
+    }
+    close(fd);
+    return NULL;
+}
+
+static void ServerStart(server *srv, const uint8_t *data, size_t size)
+{
+    srv->fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(srv->fd >= 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    assert(bind(srv->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(listen(srv->fd, 1) == 0);
+
+    socklen_t addrlen = sizeof(addr);
+    assert(getsockname(srv->fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    srv->port = ntohs(addr.sin_port);
+
+    srv->data = data;
+    srv->size = size;
+    srv->requests = srv->syscalls = 0;
+    srv->bytes = 0;
+    assert(vlc_clone(&srv->thread, ServerThread, srv, VLC_THREAD_PRIORITY_LOW) == 0);
+}
+
+static void ServerStop(server *srv)
+{
+    vlc_join(srv->thread, NULL);
+    close(srv->fd);
+}
+
+/*
+ * Client stream
+ */
+struct remote
+{
+    int fd;
+    uint64_t offset;
+    uint64_t size;
+    unsigned syscalls;
+};
+
+static ssize_t RemoteRead(stream_t *s, void *buf, size_t len)
+{
+    remote *sys = static_cast<remote *>(s->p_sys);
+    request req = { sys->offset, static_cast<uint32_t>(len) };
+    uint32_t length;
+
+    if(!SendAll(sys->fd, &req, sizeof(req), &sys->syscalls) ||
+       !RecvAll(sys->fd, &length, sizeof(length), &sys->syscalls) ||
+       !RecvAll(sys->fd, buf, length, &sys->syscalls))
+        return -1;
+    sys->offset += length;
+    return length;
+}
+
+static int RemoteSeek(stream_t *s, uint64_t offset)
+{
+    remote *sys = static_cast<remote *>(s->p_sys);
+    sys->offset = offset;
+    return VLC_SUCCESS;
+}
+
+static int RemoteControl(stream_t *s, int query, va_list args)
+{
+    remote *sys = static_cast<remote *>(s->p_sys);
+    switch(query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case STREAM_GET_SIZE:
+            *va_arg(args, uint64_t *) = sys->size;
+            return VLC_SUCCESS;
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = DEFAULT_PTS_DELAY;
+            return VLC_SUCCESS;
+        case STREAM_SET_PAUSE_STATE:
+            return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+static void RemoteDestroy(stream_t *s)
+{
+    remote *sys = static_cast<remote *>(s->p_sys);
+    close(sys->fd);
+}
+
+static stream_t *RemoteNew(vlc_object_t *obj, remote *sys, const server *srv)
+{
+    sys->fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(sys->fd >= 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(srv->port);
+    assert(connect(sys->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    NoDelay(sys->fd);
+    sys->offset = 0;
+    sys->size = srv->size;
+    sys->syscalls = 0;
+
+    stream_t *s = vlc_stream_CommonNew(obj, RemoteDestroy);
+    assert(s != NULL);
+    s->pf_read = RemoteRead;
+    s->pf_seek = RemoteSeek;
+    s->pf_control = RemoteControl;
+    s->p_sys = sys;
+    return s;
+}
+
+/*
+ * Clusters of SimpleBlocks, parsed as libebml does: the element IDs and
+ * sizes are read byte per byte, the payloads in one read
+ */
+struct element
+{
+    uint64_t start;
+    uint64_t end;
+};
+
+static void PutVint(std::vector<uint8_t> &file, uint64_t value, unsigned len)
+{
+    value |= UINT64_C(1) << (7 * len);
+    for(unsigned i = len; i > 0; i--)
+        file.push_back(value >> (8 * (i - 1)));
+}
+
+static std::vector<uint8_t> MakeClusters(std::vector<element> &clusters)
+{
+    std::vector<uint8_t> file;
+
+    srand(7);
+    for(unsigned i = 0; i < CLUSTERS; i++)
+    {
+        static const uint8_t cluster_id[] = { 0x1F, 0x43, 0xB6, 0x75 };
+        element cluster;
+
+        cluster.start = file.size();
+        file.insert(file.end(), cluster_id, cluster_id + sizeof(cluster_id));
+        size_t size_pos = file.size();
+        PutVint(file, 0, 8);
+
+        for(unsigned j = 0; j < CLUSTER_BLOCKS; j++)
+        {
+            size_t len = 1 + rand() % BLOCK_MAX;
+            file.push_back(0xA3); /* SimpleBlock */
+            PutVint(file, len, 2);
+            for(size_t k = 0; k < len; k++)
+                file.push_back(FileByte(file.size()));
+        }
+        cluster.end = file.size();
+
+        std::vector<uint8_t> size;
+        PutVint(size, cluster.end - size_pos - 8, 8);
+        std::copy(size.begin(), size.end(), file.begin() + size_pos);
+        clusters.push_back(cluster);
+    }
+    return file;
+}
+
+static uint64_t ReadVint(vlc_stream_io_callback &io, bool id)
+{
+    uint8_t byte;
+    assert(io.read(&byte, 1) == 1);
+
+    unsigned len = 1;
+    while(len <= 8 && !(byte & (0x100 >> len)))
+        len++;
+    assert(len <= 8);
+
+    uint64_t value = id ? byte : byte & (0xFF >> len);
+    for(unsigned i = 1; i < len; i++)
+    {
+        assert(io.read(&byte, 1) == 1);
+        value = (value << 8) | byte;
+    }
+    return value;
+}
+
+/* Same policy as matroska_segment_c::PrefetchCluster() */
+static void Prefetch(vlc_stream_io_callback &io, uint64_t needed_end,
+                     uint64_t cluster_end, size_t limit)
+{
+    if(limit == 0 || io.isPrefetched(needed_end))
+        return;
+
+    uint64_t pos = io.getFilePointer();
+    if(pos >= needed_end || needed_end > cluster_end ||
+       needed_end - pos > limit)
+        return;
+    io.prefetch(std::min<uint64_t>(cluster_end - pos, limit));
+}
+
+static void ParseCluster(vlc_stream_io_callback &io, const element &cluster,
+                         size_t limit)
+{
+    static uint8_t payload[BLOCK_MAX];
+
+    io.setFilePointer(cluster.start);
+    assert(ReadVint(io, true) == 0x1F43B675);
+    uint64_t size = ReadVint(io, false);
+    uint64_t end = io.getFilePointer() + size;
+    assert(end == cluster.end);
+    Prefetch(io, io.getFilePointer() + 1, end, limit);
+
+    unsigned blocks = 0;
+    while(io.getFilePointer() < end)
+    {
+        assert(ReadVint(io, true) == 0xA3);
+        uint64_t len = ReadVint(io, false);
+        uint64_t start = io.getFilePointer();
+        assert(len <= BLOCK_MAX && start + len <= end);
+
+        Prefetch(io, start + len, end, limit);
+        assert(io.read(payload, len) == len);
+        for(size_t i = 0; i < len; i++)
+            assert(payload[i] == FileByte(start + i));
+        blocks++;
+    }
+    assert(blocks == CLUSTER_BLOCKS);
+}
+
+struct counts
+{
+    unsigned requests;
+    unsigned syscalls;
+    size_t bytes;
+};
+
+static counts RunLoopback(vlc_object_t *obj, const std::vector<uint8_t> &file,
+                          const std::vector<element> &clusters, size_t limit)
+{
+    server srv;
+    ServerStart(&srv, file.data(), file.size());
+
+    remote sys;
+    {
+        vlc_stream_io_callback io(RemoteNew(obj, &sys, &srv), true);
+
+        /* play through, then seek to a few clusters */
+        for(size_t i = 0; i < clusters.size(); i++)
+            ParseCluster(io, clusters[i], limit);
+        for(size_t i = 0; i < clusters.size(); i += 5)
+            ParseCluster(io, clusters[clusters.size() - 1 - i], limit);
+    }
+
+    ServerStop(&srv);
+
+    counts c = { srv.requests, sys.syscalls + srv.syscalls, srv.bytes };
+    return c;
+}
+
+static void TestLoopback(vlc_object_t *obj)
+{
+    std::vector<element> clusters;
+    std::vector<uint8_t> file = MakeClusters(clusters);
+    const unsigned parsed = CLUSTERS + (CLUSTERS + 4) / 5;
+
+    const size_t limits[] = { 0, 16 * 1024, 8 * 1024 * 1024 };
+    counts c[ARRAY_SIZE(limits)];
+    for(size_t i = 0; i < ARRAY_SIZE(limits); i++)
+    {
+        c[i] = RunLoopback(obj, file, clusters, limits[i]);
+        printf("loopback, %zu KiB read-ahead: %u requests, %u syscalls, "
+               "%zu KiB for %u clusters of %u blocks (%zu KiB)\n",
+               limits[i] / 1024, c[i].requests, c[i].syscalls,
+               c[i].bytes / 1024, parsed, CLUSTER_BLOCKS, file.size() / 1024);
+    }
+
+    /* 12 requests for the cluster ID and size, and 4 per block: the
+     * ID, the 2 bytes of the size and the payload */
+    assert(c[0].requests == parsed * (12 + 4 * CLUSTER_BLOCKS));
+    /* whole clusters: the cluster header, then a single request */
+    assert(c[2].requests == parsed * (12 + 1));
+    /* partial clusters: about one request per read-ahead size */
+    assert(c[1].requests > c[2].requests);
+    assert(c[1].requests < c[0].requests / 10);
+    /* the read-ahead stops at the end of the cluster */
+    assert(c[1].bytes == c[0].bytes && c[2].bytes == c[0].bytes);
+}
+
+int main(void)
+{
+    /* test.h is C only */
+    alarm(30);
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    std::vector<uint8_t> data(FILE_SIZE);
+    for(size_t i = 0; i < data.size(); i++)
+        data[i] = FileByte(i);
+    TestRandom(obj, data.data(), data.size());
+
+    TestLoopback(obj);
+
+    libvlc_release(vlc);
+    return 0;
+}
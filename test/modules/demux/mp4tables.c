@@ -0,0 +1,654 @@
+/*****************************************************************************
+ * mp4tables.c: MP4 demuxer sample tables test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks the run-length sample tables against expanded tables, then opens a
+ * synthetic interleaved audio/video file (one sample per chunk, one ctts
+ * entry per video sample, i.e. the worst case for the sample tables) and
+ * reports the open time and memory used by the demuxer. The file also has
+ * alternative audio tracks which are never selected, and whose sample
+ * tables should not be loaded.
+ *
+ * Usage: test_modules_demux_mp4tables [hours]
+ * The default duration is one hour; use ten hours or more to benchmark.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_block.h>
+
+#include "../modules/demux/mp4/sampletable.c"
+
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+/*****************************************************************************
+ * Sample tables
+ *****************************************************************************/
+#define RUNS 200
+
+static void test_runs(unsigned seed)
+{
+    uint32_t counts[RUNS];
+    int32_t values[RUNS];
+    uint64_t total = 0;
+
+    srand(seed);
+    for (unsigned i = 0; i < RUNS; i++)
+    {
+        /* include empty runs and zero deltas */
+        counts[i] = rand() % 6;
+        values[i] = rand() % 5;
+        total += counts[i];
+    }
+
+    /* truncated to fewer samples than the runs, or not */
+    uint32_t max = (seed & 1) ? total : total - total / 4;
+
+    /* expanded reference */
+    stime_t *dts = malloc((max + 1) * sizeof (*dts));
+    int32_t *offsets = malloc((max + 1) * sizeof (*offsets));
+    assert(dts != NULL && offsets != NULL);
+
+    uint32_t n = 0;
+    dts[0] = 0;
+    for (unsigned i = 0; i < RUNS && n < max; i++)
+        for (uint32_t j = 0; j < counts[i] && n < max; j++)
+        {
+            offsets[n] = values[i];
+            dts[n + 1] = dts[n] + values[i];
+            n++;
+        }
+    assert(n == max);
+
+    mp4_sample_runs_t stts, ctts;
+    assert(MP4_SampleRuns_Init(&stts, counts, values, RUNS, max, true)
+           == VLC_SUCCESS);
+    assert(MP4_SampleRuns_Init(&ctts, counts, values, RUNS, max, false)
+           == VLC_SUCCESS);
+    assert(stts.i_samples == max);
+    assert(stts.i_duration == dts[max]);
+
+    for (uint32_t s = 0; s < max + 2; s++)
+    {
+        int32_t value;
+
+        assert(MP4_SampleRuns_GetTime(&stts, s) == dts[__MIN(s, max)]);
+        if (s < max)
+        {
+            assert(MP4_SampleRuns_GetValue(&ctts, s, &value));
+            assert(value == offsets[s]);
+        }
+        else
+            assert(!MP4_SampleRuns_GetValue(&ctts, s, &value));
+    }
+
+    for (stime_t t = -1; t <= dts[max] + 1; t++)
+    {
+        /* first sample at the time, or else the one spanning it */
+        uint32_t expected = max;
+        if (t <= 0)
+            expected = 0;
+        else
+            for (uint32_t s = 0; s < max; s++)
+                if (dts[s] == t || (dts[s] < t && t < dts[s + 1]))
+                {
+                    expected = s;
+                    break;
+                }
+
+        assert(MP4_SampleRuns_GetSample(&stts, t) == expected);
+    }
+
+    MP4_SampleRuns_Clean(&stts);
+    MP4_SampleRuns_Clean(&ctts);
+    free(dts);
+    free(offsets);
+}
+
+/*****************************************************************************
+ * Synthetic file
+ *****************************************************************************/
+#define VIDEO_TIMESCALE 90000
+#define VIDEO_DELTA     3600 /* 25 fps */
+#define VIDEO_GOP       25
+#define VIDEO_SIZE      16
+#define AUDIO_TIMESCALE 48000
+#define AUDIO_DELTA     1536 /* A/52 */
+#define AUDIO_SIZE      8
+#define AUDIO_ALT       8 /* unselected audio tracks, sharing the samples */
+
+struct buffer
+{
+    uint8_t *p;
+    size_t len;
+    size_t size;
+};
+
+static void Put(struct buffer *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size)
+    {
+        b->size = (b->len + len) * 2;
+        b->p = realloc(b->p, b->size);
+        assert(b->p != NULL);
+    }
+    memcpy(b->p + b->len, data, len);
+    b->len += len;
+}
+
+static void Put8(struct buffer *b, uint8_t v)
+{
+    Put(b, &v, 1);
+}
+
+static void Put16(struct buffer *b, uint16_t v)
+{
+    uint8_t buf[2];
+    SetWBE(buf, v);
+    Put(b, buf, 2);
+}
+
+static void Put32(struct buffer *b, uint32_t v)
+{
+    uint8_t buf[4];
+    SetDWBE(buf, v);
+    Put(b, buf, 4);
+}
+
+static void Put64(struct buffer *b, uint64_t v)
+{
+    uint8_t buf[8];
+    SetQWBE(buf, v);
+    Put(b, buf, 8);
+}
+
+static void PutZero(struct buffer *b, size_t len)
+{
+    while (len-- > 0)
+        Put8(b, 0);
+}
+
+static size_t BoxStart(struct buffer *b, const char *type)
+{
+    size_t pos = b->len;
+    Put32(b, 0);
+    Put(b, type, 4);
+    return pos;
+}
+
+static size_t FullBoxStart(struct buffer *b, const char *type, uint32_t flags)
+{
+    size_t pos = BoxStart(b, type);
+    Put32(b, flags); /* version 0 */
+    return pos;
+}
+
+static void BoxEnd(struct buffer *b, size_t pos)
+{
+    SetDWBE(b->p + pos, b->len - pos);
+}
+
+static const uint8_t matrix[36] = {
+    0x00, 0x01, 0x00, 0x00, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0x00, 0x01, 0x00, 0x00, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0x40, 0x00, 0x00, 0x00,
+};
+
+struct track
+{
+    bool video;
+    uint32_t count;
+    uint64_t *offsets;
+};
+
+static uint32_t TrackTimescale(const struct track *tk)
+{
+    return tk->video ? VIDEO_TIMESCALE : AUDIO_TIMESCALE;
+}
+
+static uint32_t TrackDelta(const struct track *tk)
+{
+    return tk->video ? VIDEO_DELTA : AUDIO_DELTA;
+}
+
+static void WriteStbl(struct buffer *b, const struct track *tk)
+{
+    size_t stbl = BoxStart(b, "stbl");
+
+    size_t stsd = FullBoxStart(b, "stsd", 0);
+    Put32(b, 1);
+    if (tk->video)
+    {
+        size_t entry = BoxStart(b, "jpeg");
+        PutZero(b, 6);
+        Put16(b, 1); /* data reference index */
+        PutZero(b, 16);
+        Put16(b, 320);
+        Put16(b, 240);
+        Put32(b, 0x00480000);
+        Put32(b, 0x00480000);
+        Put32(b, 0);
+        Put16(b, 1); /* frame count */
+        PutZero(b, 32);
+        Put16(b, 24); /* depth */
+        Put16(b, 0xffff);
+        BoxEnd(b, entry);
+    }
+    else
+    {
+        size_t entry = BoxStart(b, "ac-3");
+        PutZero(b, 6);
+        Put16(b, 1); /* data reference index */
+        PutZero(b, 8);
+        Put16(b, 2); /* channels */
+        Put16(b, 16);
+        Put32(b, 0);
+        Put32(b, AUDIO_TIMESCALE << 16);
+        BoxEnd(b, entry);
+    }
+    BoxEnd(b, stsd);
+
+    size_t stts = FullBoxStart(b, "stts", 0);
+    Put32(b, 1);
+    Put32(b, tk->count);
+    Put32(b, TrackDelta(tk));
+    BoxEnd(b, stts);
+
+    if (tk->video)
+    {
+        /* I P B B ... reordering restarting at each GOP: one entry per
+         * sample */
+        size_t ctts = FullBoxStart(b, "ctts", 0);
+        Put32(b, tk->count);
+        for (uint32_t i = 0; i < tk->count; i++)
+        {
+            static const uint32_t pattern[] = { 1, 4, 2, 3 };
+            Put32(b, 1);
+            Put32(b, pattern[(i % VIDEO_GOP) % 4] * VIDEO_DELTA);
+        }
+        BoxEnd(b, ctts);
+
+        size_t stss = FullBoxStart(b, "stss", 0);
+        Put32(b, (tk->count + VIDEO_GOP - 1) / VIDEO_GOP);
+        for (uint32_t i = 0; i < tk->count; i += VIDEO_GOP)
+            Put32(b, i + 1);
+        BoxEnd(b, stss);
+    }
+
+    size_t stsc = FullBoxStart(b, "stsc", 0);
+    Put32(b, 1);
+    Put32(b, 1); /* first chunk */
+    Put32(b, 1); /* samples per chunk */
+    Put32(b, 1); /* sample description index */
+    BoxEnd(b, stsc);
+
+    size_t stsz = FullBoxStart(b, "stsz", 0);
+    Put32(b, 0);
+    Put32(b, tk->count);
+    for (uint32_t i = 0; i < tk->count; i++)
+        Put32(b, tk->video ? VIDEO_SIZE : AUDIO_SIZE);
+    BoxEnd(b, stsz);
+
+    size_t co64 = FullBoxStart(b, "co64", 0);
+    Put32(b, tk->count);
+    for (uint32_t i = 0; i < tk->count; i++)
+        Put64(b, tk->offsets[i]);
+    BoxEnd(b, co64);
+
+    BoxEnd(b, stbl);
+}
+
+static void WriteTrak(struct buffer *b, const struct track *tk, uint32_t id,
+                      uint32_t duration_s)
+{
+    size_t trak = BoxStart(b, "trak");
+
+    size_t tkhd = FullBoxStart(b, "tkhd", 3);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, id);
+    Put32(b, 0);
+    Put32(b, duration_s * 1000);
+    PutZero(b, 8);
+    Put16(b, 0);
+    Put16(b, 0);
+    Put16(b, tk->video ? 0 : 0x0100);
+    Put16(b, 0);
+    Put(b, matrix, sizeof (matrix));
+    Put32(b, tk->video ? 320 << 16 : 0);
+    Put32(b, tk->video ? 240 << 16 : 0);
+    BoxEnd(b, tkhd);
+
+    size_t mdia = BoxStart(b, "mdia");
+
+    size_t mdhd = FullBoxStart(b, "mdhd", 0);
+    Put32(b, 0);
+    Put32(b, 0);
+    Put32(b, TrackTimescale(tk));
+    Put32(b, tk->count * TrackDelta(tk));
+    Put16(b, 0x55c4); /* und */
+    Put16(b, 0);
+    BoxEnd(b, mdhd);
+
+    size_t hdlr = FullBoxStart(b, "hdlr", 0);
+    Put32(b, 0);
+    Put(b, tk->video ? "vide" : "soun", 4);
+    PutZero(b, 12);
+    Put8(b, 0);
+    BoxEnd(b, hdlr);
+
+    size_t minf = BoxStart(b, "minf");
+    if (tk->video)
+    {
+        size_t vmhd = FullBoxStart(b, "vmhd", 1);
+        PutZero(b, 8);
+        BoxEnd(b, vmhd);
+    }
+    else
+    {
+        size_t smhd = FullBoxStart(b, "smhd", 0);
+        PutZero(b, 4);
+        BoxEnd(b, smhd);
+    }
+
+    size_t dinf = BoxStart(b, "dinf");
+    size_t dref = FullBoxStart(b, "dref", 0);
+    Put32(b, 1);
+    size_t url = FullBoxStart(b, "url ", 1);
+    BoxEnd(b, url);
+    BoxEnd(b, dref);
+    BoxEnd(b, dinf);
+
+    WriteStbl(b, tk);
+
+    BoxEnd(b, minf);
+    BoxEnd(b, mdia);
+    BoxEnd(b, trak);
+}
+
+static struct buffer WriteFile(uint32_t duration_s, struct track *tracks)
+{
+    struct buffer b = { NULL, 0, 0 };
+
+    size_t ftyp = BoxStart(&b, "ftyp");
+    Put(&b, "isom", 4);
+    Put32(&b, 0);
+    Put(&b, "isom", 4);
+    BoxEnd(&b, ftyp);
+
+    /* mdat first, so that the offsets are known when writing the moov */
+    struct track *video = &tracks[0], *audio = &tracks[1];
+    video->count = (uint64_t)duration_s * VIDEO_TIMESCALE / VIDEO_DELTA;
+    audio->count = (uint64_t)duration_s * AUDIO_TIMESCALE / AUDIO_DELTA;
+    for (unsigned i = 0; i < 2; i++)
+    {
+        tracks[i].offsets = malloc(tracks[i].count * sizeof (uint64_t));
+        assert(tracks[i].offsets != NULL);
+    }
+
+    size_t mdat = BoxStart(&b, "mdat");
+    uint32_t v = 0, a = 0;
+    while (v < video->count || a < audio->count)
+    {
+        /* interleave by time, one sample per chunk */
+        bool take_video = a >= audio->count ||
+            (v < video->count && (uint64_t)v * VIDEO_DELTA * AUDIO_TIMESCALE <=
+                                 (uint64_t)a * AUDIO_DELTA * VIDEO_TIMESCALE);
+        uint8_t data[VIDEO_SIZE];
+
+        if (take_video)
+        {
+            memset(data, v, VIDEO_SIZE);
+            video->offsets[v++] = b.len;
+            Put(&b, data, VIDEO_SIZE);
+        }
+        else
+        {
+            memset(data, a, AUDIO_SIZE);
+            audio->offsets[a++] = b.len;
+            Put(&b, data, AUDIO_SIZE);
+        }
+    }
+    BoxEnd(&b, mdat);
+
+    size_t moov = BoxStart(&b, "moov");
+    size_t mvhd = FullBoxStart(&b, "mvhd", 0);
+    Put32(&b, 0);
+    Put32(&b, 0);
+    Put32(&b, 1000);
+    Put32(&b, duration_s * 1000);
+    Put32(&b, 0x00010000);
+    Put16(&b, 0x0100);
+    PutZero(&b, 10);
+    Put(&b, matrix, sizeof (matrix));
+    PutZero(&b, 24);
+    Put32(&b, 3 + AUDIO_ALT);
+    BoxEnd(&b, mvhd);
+
+    WriteTrak(&b, video, 1, duration_s);
+    WriteTrak(&b, audio, 2, duration_s);
+    for (unsigned i = 0; i < AUDIO_ALT; i++)
+        WriteTrak(&b, audio, 3 + i, duration_s);
+    BoxEnd(&b, moov);
+
+    return b;
+}
+
+/*****************************************************************************
+ * ES output
+ *****************************************************************************/
+struct es_out_id_t
+{
+    enum es_format_category_e cat;
+    bool selected;
+};
+
+struct test_es_out
+{
+    es_out_t out;
+    unsigned audio_count;
+    vlc_tick_t video_dts;
+    vlc_tick_t video_pts;
+    vlc_tick_t audio_dts;
+};
+
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    struct test_es_out *ctx = container_of(out, struct test_es_out, out);
+    es_out_id_t *id = malloc(sizeof (*id));
+    assert(id != NULL);
+    id->cat = fmt->i_cat;
+    /* Only select the video and the first audio track */
+    id->selected = fmt->i_cat == VIDEO_ES ||
+                   (fmt->i_cat == AUDIO_ES && ctx->audio_count++ == 0);
+    return id;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    struct test_es_out *ctx = container_of(out, struct test_es_out, out);
+
+    assert(id->selected);
+
+    /* Record the first block of each track after a reset */
+    if (id->cat == VIDEO_ES && ctx->video_dts == VLC_TICK_INVALID)
+    {
+        ctx->video_dts = block->i_dts;
+        ctx->video_pts = block->i_pts;
+    }
+    else if (id->cat == AUDIO_ES && ctx->audio_dts == VLC_TICK_INVALID)
+        ctx->audio_dts = block->i_dts;
+
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDelete(es_out_t *out, es_out_id_t *id)
+{
+    (void) out;
+    free(id);
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    (void) out;
+    switch (query)
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg(args, es_out_id_t *);
+            *va_arg(args, bool *) = id->selected;
+            return VLC_SUCCESS;
+        }
+        case ES_OUT_GET_EMPTY:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case ES_OUT_GET_PCR_SYSTEM:
+        case ES_OUT_MODIFY_PCR_SYSTEM:
+            return VLC_EGENERIC;
+        default:
+            return VLC_SUCCESS;
+    }
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static const struct es_out_callbacks es_out_cbs =
+{
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDelete,
+    .control = EsOutControl,
+    .destroy = EsOutDestroy,
+};
+
+static long GetMaxRSS(void)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru))
+        return 0;
+    return ru.ru_maxrss; /* kB */
+}
+
+static void test_file(vlc_object_t *obj, uint32_t duration_s)
+{
+    struct track tracks[2] = { { .video = true }, { .video = false } };
+    struct buffer b = WriteFile(duration_s, tracks);
+
+    printf("synthetic file: %u s, %"PRIu32" video and %"PRIu32" audio chunks,"
+           " %u unselected audio tracks, %zu bytes\n", duration_s,
+           tracks[0].count, tracks[1].count, AUDIO_ALT, b.len);
+
+    struct test_es_out ctx = {
+        .out = { .cbs = &es_out_cbs },
+        .video_dts = VLC_TICK_INVALID,
+        .audio_dts = VLC_TICK_INVALID,
+    };
+
+    stream_t *s = vlc_stream_MemoryNew(obj, b.p, b.len, true);
+    assert(s != NULL);
+
+    long rss = GetMaxRSS();
+    vlc_tick_t start = vlc_tick_now();
+    demux_t *demux = demux_New(obj, "mp4", s, &ctx.out);
+    vlc_tick_t open = vlc_tick_now() - start;
+    assert(demux != NULL);
+
+    printf("open: %"PRId64" ms, peak RSS increase: %ld kB\n",
+           MS_FROM_VLC_TICK(open), GetMaxRSS() - rss);
+
+    assert(ctx.audio_count == 1 + AUDIO_ALT);
+
+    vlc_tick_t length;
+    assert(demux_Control(demux, DEMUX_GET_LENGTH, &length) == VLC_SUCCESS);
+    assert(length == VLC_TICK_FROM_SEC(duration_s));
+
+    /* Seek to various positions; the video restarts from the previous
+     * keyframe. Samples are 40 ms long, with 1 s GOPs. */
+    static const unsigned positions[] = { 0, 1, 37, 50, 99 };
+    start = vlc_tick_now();
+    for (size_t i = 0; i < ARRAY_SIZE(positions); i++)
+    {
+        vlc_tick_t target = VLC_TICK_FROM_SEC(duration_s) / 100 * positions[i]
+                          + VLC_TICK_FROM_MS(520);
+        vlc_tick_t keyframe = target - target % VLC_TICK_FROM_SEC(1);
+
+        assert(demux_Control(demux, DEMUX_SET_TIME, target, false)
+               == VLC_SUCCESS);
+        ctx.video_dts = ctx.audio_dts = VLC_TICK_INVALID;
+        while (ctx.video_dts == VLC_TICK_INVALID ||
+               ctx.audio_dts == VLC_TICK_INVALID)
+            assert(demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+
+        assert(ctx.video_dts == VLC_TICK_0 + keyframe);
+        assert(ctx.video_pts == ctx.video_dts + VLC_TICK_FROM_MS(40));
+        assert(ctx.audio_dts >= VLC_TICK_0 + keyframe - VLC_TICK_FROM_MS(32));
+        assert(ctx.audio_dts <= VLC_TICK_0 + keyframe + VLC_TICK_FROM_MS(32));
+    }
+    printf("seeks: %"PRId64" us each\n",
+           US_FROM_VLC_TICK(vlc_tick_now() - start) / ARRAY_SIZE(positions));
+
+    demux_Delete(demux);
+    vlc_stream_Delete(s);
+    free(b.p);
+    free(tracks[0].offsets);
+    free(tracks[1].offsets);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned hours = 1;
+
+    if (argc > 1)
+        hours = strtoul(argv[1], NULL, 10);
+
+    test_init();
+
+    for (unsigned seed = 0; seed < 64; seed++)
+        test_runs(seed);
+
+    static const char *args[] = { "--no-auto-preparse", "--quiet" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    test_file(VLC_OBJECT(vlc->p_libvlc_int), hours * 3600);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,259 @@
+/*****************************************************************************
+ * oggpage.c: Ogg page reader test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks the sliced CRC against a bitwise one, then reads a synthetic
+ * multiplexed file (several logical streams with interleaved pages, some
+ * garbage and a corrupted page) and checks that every valid page is read
+ * back, in order, and that only the invalid data is skipped. Reports the
+ * CRC and page reading throughputs.
+ *
+ * Usage: test_modules_demux_oggpage [megabytes]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_block.h>
+
+#include "../modules/demux/ogg_page.c"
+
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+/*****************************************************************************
+ * CRC
+ *****************************************************************************/
+static uint32_t BitwiseCRC(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len--)
+    {
+        crc ^= (uint32_t)*p++ << 24;
+        for (unsigned i = 0; i < 8; i++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+    return crc;
+}
+
+/* one table lookup per byte, as libogg does */
+static uint32_t BytewiseCRC(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len--)
+        crc = (crc << 8) ^ crc_tables[0][(crc >> 24) ^ *p++];
+    return crc;
+}
+
+static void test_crc(void)
+{
+    uint8_t buf[1024];
+    for (size_t i = 0; i < sizeof (buf); i++)
+        buf[i] = rand();
+
+    /* all the lengths and alignments of the sliced and bytewise parts */
+    for (size_t offset = 0; offset < 8; offset++)
+        for (size_t len = 0; len + offset <= 64; len++)
+            assert(Ogg_PageCRC(0, &buf[offset], len)
+                   == BitwiseCRC(0, &buf[offset], len));
+
+    /* continued computation */
+    uint32_t crc = Ogg_PageCRC(0, buf, 13);
+    crc = Ogg_PageCRC(crc, &buf[13], sizeof (buf) - 13);
+    assert(crc == BitwiseCRC(0, buf, sizeof (buf)));
+}
+
+/*****************************************************************************
+ * Synthetic file
+ *****************************************************************************/
+#define STREAMS 8
+#define GARBAGE_SIZE 1000
+
+struct buffer
+{
+    uint8_t *p;
+    size_t len;
+    size_t size;
+};
+
+static void Put(struct buffer *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size)
+    {
+        b->size = (b->len + len) * 2;
+        b->p = realloc(b->p, b->size);
+        assert(b->p != NULL);
+    }
+    memcpy(&b->p[b->len], data, len);
+    b->len += len;
+}
+
+/* Writes a page, with its body bytes below 'O', so that the capture
+ * pattern can't be found inside. Returns its offset. */
+static size_t PutPage(struct buffer *b, uint32_t serial, uint32_t seqno)
+{
+    uint8_t header[OGG_PAGE_HEADER_SIZE + 255];
+    const unsigned segments = 1 + rand() % 255;
+    size_t body = 0;
+
+    memcpy(header, "OggS", 4);
+    header[4] = 0;
+    header[5] = seqno == 0 ? 0x02 : 0;
+    SetQWLE(&header[6], seqno * 1000);
+    SetDWLE(&header[14], serial);
+    SetDWLE(&header[18], seqno);
+    SetDWLE(&header[22], 0);
+    header[26] = segments;
+    for (unsigned i = 0; i < segments; i++)
+    {
+        header[OGG_PAGE_HEADER_SIZE + i] = rand() % 256;
+        body += header[OGG_PAGE_HEADER_SIZE + i];
+    }
+
+    const size_t offset = b->len;
+    Put(b, header, OGG_PAGE_HEADER_SIZE + segments);
+    for (size_t i = 0; i < body; i++)
+    {
+        uint8_t c = rand() % 'O';
+        Put(b, &c, 1);
+    }
+
+    uint32_t crc = BitwiseCRC(0, &b->p[offset], b->len - offset);
+    SetDWLE(&b->p[offset + 22], crc);
+    return offset;
+}
+
+static void PutGarbage(struct buffer *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = rand() % 'O';
+        Put(b, &c, 1);
+    }
+}
+
+static void test_file(vlc_object_t *obj, size_t size)
+{
+    struct buffer b = { NULL, 0, 0 };
+    uint32_t seqnos[STREAMS] = { 0 };
+    size_t pages = 0;
+
+    /* leading garbage, as when starting in the middle of a file */
+    PutGarbage(&b, GARBAGE_SIZE);
+    uint64_t garbage = GARBAGE_SIZE;
+
+    size_t corrupted = 0;
+    while (b.len < size)
+    {
+        const uint32_t serial = rand() % STREAMS;
+        size_t offset = PutPage(&b, 0x1000 + serial, seqnos[serial]);
+
+        if (corrupted == 0 && b.len >= size / 2)
+        {
+            /* flip a body bit: the page is skipped as garbage */
+            b.p[b.len - 1] ^= 0x01;
+            corrupted = b.len - offset;
+            garbage += corrupted;
+            continue;
+        }
+        seqnos[serial]++;
+        pages++;
+    }
+    assert(corrupted > 0);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, b.p, b.len, true);
+    assert(s != NULL);
+
+    uint32_t expected[STREAMS] = { 0 };
+    uint64_t skipped = 0;
+    size_t read = 0, header;
+    block_t *block;
+
+    vlc_tick_t start = vlc_tick_now();
+    while ((block = Ogg_PageRead(s, &header, &skipped)) != NULL)
+    {
+        assert(header == OGG_PAGE_HEADER_SIZE + block->p_buffer[26]);
+        assert(!memcmp(block->p_buffer, "OggS", 4));
+
+        const uint32_t serial = GetDWLE(&block->p_buffer[14]) - 0x1000;
+        assert(serial < STREAMS);
+        assert(GetDWLE(&block->p_buffer[18]) == expected[serial]);
+        expected[serial]++;
+        read++;
+        block_Release(block);
+    }
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    assert(read == pages);
+    assert(skipped == garbage);
+    assert(memcmp(expected, seqnos, sizeof (seqnos)) == 0);
+
+    printf("%zu pages, %zu bytes, %"PRIu64" skipped: %"PRId64" ms",
+           pages, b.len, skipped, MS_FROM_VLC_TICK(elapsed));
+    if (elapsed > 0)
+        printf(", %"PRIu64" MB/s",
+               (uint64_t) b.len / US_FROM_VLC_TICK(elapsed));
+    printf("\n");
+
+    /* CRC throughput */
+    start = vlc_tick_now();
+    uint32_t crc = BytewiseCRC(0, b.p, b.len);
+    vlc_tick_t bytewise = vlc_tick_now() - start;
+    start = vlc_tick_now();
+    assert(Ogg_PageCRC(0, b.p, b.len) == crc);
+    vlc_tick_t sliced = vlc_tick_now() - start;
+
+    printf("CRC: bytewise %"PRId64" us, sliced %"PRId64" us\n",
+           US_FROM_VLC_TICK(bytewise), US_FROM_VLC_TICK(sliced));
+
+    vlc_stream_Delete(s);
+    free(b.p);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned megabytes = 16;
+
+    if (argc > 1)
+        megabytes = strtoul(argv[1], NULL, 10);
+
+    test_init();
+
+    srand(0);
+    test_crc();
+
+    static const char *args[] = { "--no-auto-preparse", "--quiet" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    test_file(VLC_OBJECT(vlc->p_libvlc_int), megabytes << 20);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ * segmenttimeline.cpp: adaptive SegmentTimeline refresh test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include "../modules/demux/adaptive/ID.cpp"
+#include "../modules/demux/adaptive/playlist/Inheritables.cpp"
+#include "../modules/demux/adaptive/playlist/SegmentTimeline.cpp"
+
+#include <vlc_tick.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace adaptive::playlist;
+
+/* Live window refreshes: each updated MPD has the same window of entries
+ * shifted by a few new segments. The full refresh builds a new timeline
+ * and merges it, as the DOM parser path does, while the incremental one
+ * merges the entries as they are read, as the streaming updater does. */
+#define TIMESCALE  90000
+#define REFRESHES  32
+#define NEW_PER_REFRESH 2
+
+/* Varying durations, so that entries can't be folded into repeats */
+static stime_t Duration(uint64_t index)
+{
+    return TIMESCALE * 2 + (index * 2654435761U) % 3 * 3003;
+}
+
+static stime_t StartTime(uint64_t index)
+{
+    stime_t t = 0;
+    for(uint64_t i = 0; i < index; i++)
+        t += Duration(i);
+    return t;
+}
+
+static void FillWindow(SegmentTimeline *timeline, uint64_t first, stime_t t, size_t window)
+{
+    for(uint64_t i = first; i < first + window; i++)
+    {
+        timeline->addElement(i, Duration(i), 0, t);
+        t += Duration(i);
+    }
+}
+
+static vlc_tick_t RunFull(SegmentTimeline *timeline, size_t window)
+{
+    vlc_tick_t total = 0;
+    for(unsigned i = 1; i <= REFRESHES; i++)
+    {
+        const uint64_t first = (uint64_t) i * NEW_PER_REFRESH;
+        const stime_t firsttime = StartTime(first);
+        const vlc_tick_t start = vlc_tick_now();
+        SegmentTimeline updated(TIMESCALE);
+        FillWindow(&updated, first, firsttime, window);
+        timeline->mergeWith(updated);
+        timeline->pruneBySequenceNumber(first);
+        total += vlc_tick_now() - start;
+    }
+    return total;
+}
+
+static vlc_tick_t RunIncremental(SegmentTimeline *timeline, size_t window)
+{
+    vlc_tick_t total = 0;
+    for(unsigned i = 1; i <= REFRESHES; i++)
+    {
+        const uint64_t first = (uint64_t) i * NEW_PER_REFRESH;
+        stime_t t = StartTime(first);
+        const vlc_tick_t start = vlc_tick_now();
+        for(uint64_t j = first; j < first + window; j++)
+        {
+            bool b_merged = timeline->mergeElement(Duration(j), 0, t);
+            assert(b_merged);
+            t += Duration(j);
+        }
+        timeline->pruneBySequenceNumber(first);
+        total += vlc_tick_now() - start;
+    }
+    return total;
+}
+
+static void CheckEqual(const SegmentTimeline &a, const SegmentTimeline &b)
+{
+    assert(a.minElementNumber() == b.minElementNumber());
+    assert(a.maxElementNumber() == b.maxElementNumber());
+    stime_t t = StartTime(a.minElementNumber());
+    for(uint64_t n = a.minElementNumber(); n <= a.maxElementNumber(); n++)
+    {
+        stime_t at, ad, bt, bd;
+        assert(a.getScaledPlaybackTimeDurationBySegmentNumber(n, &at, &ad));
+        assert(b.getScaledPlaybackTimeDurationBySegmentNumber(n, &bt, &bd));
+        assert(at == bt && ad == bd);
+        assert(at == t && ad == Duration(n));
+        t += ad;
+    }
+}
+
+static void RunWindow(size_t window)
+{
+    SegmentTimeline full(TIMESCALE);
+    SegmentTimeline incremental(TIMESCALE);
+    FillWindow(&full, 0, 0, window);
+    FillWindow(&incremental, 0, 0, window);
+
+    /* empty timelines have nothing to merge with */
+    SegmentTimeline empty(TIMESCALE);
+    assert(!empty.mergeElement(TIMESCALE, 0, 0));
+
+    const vlc_tick_t fulltime = RunFull(&full, window);
+    const vlc_tick_t inctime = RunIncremental(&incremental, window);
+
+    CheckEqual(full, incremental);
+    assert(full.maxElementNumber() == REFRESHES * NEW_PER_REFRESH + window - 1);
+
+    fprintf(stderr, "window %6zu: full %8" PRId64 " us, incremental %8" PRId64 " us"
+                    " per refresh\n", window,
+            US_FROM_VLC_TICK(fulltime) / REFRESHES,
+            US_FROM_VLC_TICK(inctime) / REFRESHES);
+}
+
+static void CheckRepeats(void)
+{
+    /* an updated entry can extend the repeats of the last one,
+     * or start in the middle of them */
+    SegmentTimeline timeline(TIMESCALE);
+    timeline.addElement(10, TIMESCALE, 4, TIMESCALE * 100);
+    assert(timeline.mergeElement(TIMESCALE, 5, TIMESCALE * 102));
+    assert(timeline.maxElementNumber() == 17);
+    assert(timeline.mergeElement(TIMESCALE, 0, TIMESCALE * 101));
+    assert(timeline.maxElementNumber() == 17);
+    assert(timeline.mergeElement(TIMESCALE * 2, 1, TIMESCALE * 108));
+    assert(timeline.maxElementNumber() == 19);
+
+    stime_t t, d;
+    assert(timeline.getScaledPlaybackTimeDurationBySegmentNumber(19, &t, &d));
+    assert(t == TIMESCALE * 110 && d == TIMESCALE * 2);
+}
+
+int main(void)
+{
+    CheckRepeats();
+
+    static const size_t windows[] = { 1000, 4000, 16000 };
+    for(size_t i = 0; i < ARRAY_SIZE(windows); i++)
+        RunWindow(windows[i]);
+
+    return 0;
+}
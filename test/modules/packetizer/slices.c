@@ -0,0 +1,272 @@
+/*****************************************************************************
+ * slices.c: packetizer helper zero copy test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Splits an AnnexB stream of large intra access units, one per input block,
+ * into NAL units and gathers them back into access units, as the H.264 and
+ * HEVC packetizers do, with copies and with slices of the input blocks.
+ * Checks that both give the same access units, and reports the throughputs.
+ *
+ * Usage: test_modules_packetizer_slices [megabytes]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include <vlc_tick.h>
+
+#include "../modules/packetizer/startcode_helper.h"
+#include "../modules/packetizer/packetizer_helper.h"
+
+#define SLICES_PER_AU   8
+#define SLICE_SIZE      (64 * 1024)
+#define NAL_AUD         9
+
+static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+
+struct parser
+{
+    block_t *p_au;
+    block_t **pp_au_last;
+    bool b_zerocopy;
+};
+
+static void Reset(void *priv, bool b_broken)
+{
+    struct parser *p = priv;
+    VLC_UNUSED(b_broken);
+    block_ChainRelease(p->p_au);
+    p->p_au = NULL;
+    p->pp_au_last = &p->p_au;
+}
+
+static block_t *Gather(struct parser *p)
+{
+    block_t *p_au = p->p_au;
+    p->p_au = NULL;
+    p->pp_au_last = &p->p_au;
+    if (p_au == NULL)
+        return NULL;
+    return p->b_zerocopy ? block_ChainGatherShared(p_au)
+                         : block_ChainGather(p_au);
+}
+
+static block_t *Parse(void *priv, bool *pb_ts_used, block_t *p_frag)
+{
+    struct parser *p = priv;
+    block_t *p_out = NULL;
+
+    *pb_ts_used = false;
+    /* same trimming as the H.264/HEVC packetizers */
+    while (p_frag->i_buffer > 5 && p_frag->p_buffer[p_frag->i_buffer - 1] == 0x00)
+        p_frag->i_buffer--;
+
+    if ((p_frag->p_buffer[4] & 0x1f) == NAL_AUD)
+        p_out = Gather(p);
+
+    block_ChainLastAppend(&p->pp_au_last, p_frag);
+    return p_out;
+}
+
+static int Validate(void *priv, block_t *p_au)
+{
+    VLC_UNUSED(priv); VLC_UNUSED(p_au);
+    return VLC_SUCCESS;
+}
+
+/* Access unit with an AUD, a small parameter set and large slices, without
+ * emulated startcodes. One in 4 units has 3 bytes startcodes, so that some
+ * NALs need a copy to be prefixed, and trailing zeros. */
+static block_t *NewAU(unsigned i_au)
+{
+    const size_t i_max = 6 + 20 + SLICES_PER_AU * (5 + SLICE_SIZE + 1);
+    block_t *p_block = block_Alloc(i_max);
+    assert(p_block != NULL);
+
+    uint8_t *p = p_block->p_buffer;
+    static const uint8_t aud[] = { 0x00, 0x00, 0x00, 0x01, NAL_AUD, 0xf0 };
+    memcpy(p, aud, sizeof(aud));
+    p += sizeof(aud);
+
+    static const uint8_t sps[] = { 0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1e };
+    memcpy(p, sps, sizeof(sps));
+    p += sizeof(sps);
+
+    const bool b_mixed = i_au % 4 == 0;
+    for (unsigned i = 0; i < SLICES_PER_AU; i++)
+    {
+        if (!b_mixed || i % 2)
+            *p++ = 0x00;
+        memcpy(p, startcode, 3);
+        p += 3;
+        *p++ = 0x65;
+        for (size_t j = 0; j < SLICE_SIZE; j++)
+            *p++ = 1 + (i_au * 31 + i * 7 + j) % 255;
+        if (b_mixed && i % 3 == 0)
+            *p++ = 0x00; /* trailing zero */
+    }
+
+    p_block->i_buffer = p - p_block->p_buffer;
+    p_block->i_pts = p_block->i_dts = VLC_TICK_0 + i_au * VLC_TICK_FROM_MS(40);
+    return p_block;
+}
+
+static uint32_t Checksum(uint32_t sum, const block_t *p_au)
+{
+    for (size_t i = 0; i < p_au->i_buffer; i++)
+        sum = sum * 31 + p_au->p_buffer[i];
+    return sum;
+}
+
+static vlc_tick_t Run(block_t **pp_in, unsigned i_count, bool b_zerocopy,
+                      uint32_t *p_sum, unsigned *pi_aus)
+{
+    struct parser parser = { NULL, &parser.p_au, b_zerocopy };
+    packetizer_t pack;
+
+    packetizer_Init(&pack, startcode, sizeof(startcode), startcode_FindAnnexB,
+                    startcode, 1, 5, Reset, Parse, Validate, &parser);
+    pack.b_zerocopy = b_zerocopy;
+
+    *p_sum = 0;
+    *pi_aus = 0;
+
+    vlc_tick_t elapsed = 0;
+    for (unsigned i = 0; i <= i_count; i++)
+    {
+        block_t *p_in = i < i_count ? pp_in[i] : NULL;
+        for (;;)
+        {
+            /* only the packetizer is timed, not the checks */
+            vlc_tick_t start = vlc_tick_now();
+            block_t *p_au = packetizer_Packetize(&pack, p_in ? &p_in : NULL);
+            elapsed += vlc_tick_now() - start;
+            if (p_au == NULL)
+                break;
+
+            assert(p_au->p_next == NULL);
+            *p_sum = Checksum(*p_sum, p_au);
+            (*pi_aus)++;
+            block_Release(p_au);
+        }
+    }
+    block_t *p_au = Gather(&parser);
+    if (p_au)
+    {
+        *p_sum = Checksum(*p_sum, p_au);
+        (*pi_aus)++;
+        block_Release(p_au);
+    }
+
+    packetizer_Clean(&pack);
+    return elapsed;
+}
+
+static void TestSlices(void)
+{
+    static const uint8_t data[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0,
+                                    0x00, 0x00, 0x00, 0x01, 0x65, 0x80 };
+    block_t *p_block = block_Alloc(sizeof(data));
+    assert(p_block != NULL);
+    memcpy(p_block->p_buffer, data, sizeof(data));
+
+    block_t *p_shared = block_Share(p_block);
+    assert(block_Share(p_shared) == p_shared);
+    assert(block_Slice(p_shared, 6, 7) == NULL);
+
+    block_t *p_aud = block_Slice(p_shared, 0, 6);
+    block_t *p_slice = block_Slice(p_shared, 6, 6);
+    assert(p_aud != NULL && p_slice != NULL);
+    /* the slices keep the data alive */
+    block_Release(p_shared);
+
+    /* contiguous slices are gathered without copy */
+    const uint8_t *p_data = p_aud->p_buffer;
+    p_aud->p_next = p_slice;
+    block_t *p_au = block_ChainGatherShared(p_aud);
+    assert(p_au->p_buffer == p_data && p_au->i_buffer == sizeof(data));
+    assert(!memcmp(p_au->p_buffer, data, sizeof(data)));
+
+    /* and grow as copies */
+    p_au = block_Realloc(p_au, 0, p_au->i_buffer + 16);
+    assert(p_au != NULL && p_au->p_buffer != p_data);
+    assert(!memcmp(p_au->p_buffer, data, sizeof(data)));
+    block_Release(p_au);
+
+    /* anything else is copied */
+    p_block = block_Alloc(sizeof(data));
+    assert(p_block != NULL);
+    memcpy(p_block->p_buffer, data, sizeof(data));
+    p_shared = block_Share(p_block);
+    p_aud = block_Slice(p_shared, 0, 6);
+    p_slice = block_Slice(p_shared, 7, 5);
+    block_Release(p_shared);
+    p_aud->p_next = p_slice;
+    p_au = block_ChainGatherShared(p_aud);
+    assert(p_au->i_buffer == 11);
+    assert(!memcmp(p_au->p_buffer, data, 6));
+    assert(!memcmp(&p_au->p_buffer[6], &data[7], 5));
+    block_Release(p_au);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned megabytes = 64;
+    if (argc > 1)
+        megabytes = strtoul(argv[1], NULL, 10);
+
+    TestSlices();
+
+    const unsigned i_count = 1 + (megabytes << 20) / (SLICES_PER_AU * SLICE_SIZE);
+    block_t **pp_in = malloc(i_count * sizeof(*pp_in));
+    assert(pp_in != NULL);
+
+    uint32_t sums[2];
+    unsigned aus[2];
+    vlc_tick_t times[2];
+    for (int zerocopy = 0; zerocopy < 2; zerocopy++)
+    {
+        for (unsigned i = 0; i < i_count; i++)
+            pp_in[i] = NewAU(i);
+        times[zerocopy] = Run(pp_in, i_count, zerocopy, &sums[zerocopy],
+                              &aus[zerocopy]);
+    }
+
+    assert(aus[0] == i_count && aus[1] == i_count);
+    assert(sums[0] == sums[1]);
+
+    const uint64_t i_bytes = (uint64_t) i_count * SLICES_PER_AU * SLICE_SIZE;
+    printf("%u access units, %"PRIu64" bytes: copy %"PRId64" ms, "
+           "zero copy %"PRId64" ms\n", i_count, i_bytes,
+           MS_FROM_VLC_TICK(times[0]), MS_FROM_VLC_TICK(times[1]));
+
+    free(pp_in);
+    return 0;
+}
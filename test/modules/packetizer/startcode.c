@@ -0,0 +1,261 @@
+/*****************************************************************************
+ * startcode.c: startcode and emulation prevention helpers test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks every startcode lookup version available on this CPU against a
+ * bytewise search, for all the alignments and lengths, and the emulation
+ * prevention bytes stripping against a bytewise one. Reports the throughput
+ * of each version on slice-like data.
+ *
+ * Usage: test_modules_packetizer_startcode [megabytes]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include "../modules/packetizer/hxxx_ep3b.h"
+
+typedef const uint8_t *(*find_cb)(const uint8_t *, const uint8_t *);
+
+struct finder
+{
+    const char *name;
+    find_cb annexb;
+    find_cb zeropair;
+};
+
+static const struct finder finders[] = {
+    { "bits", startcode_FindAnnexB_Bits, startcode_FindZeroPair_Bits },
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    { "sse2", startcode_FindAnnexB_SSE2, startcode_FindZeroPair_Bits },
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    { "avx2", startcode_FindAnnexB_AVX2, startcode_FindZeroPair_AVX2 },
+#endif
+#ifdef STARTCODE_NEON
+    { "neon", startcode_FindAnnexB_NEON, startcode_FindZeroPair_NEON },
+#endif
+};
+
+static bool Available(const struct finder *f)
+{
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if (!strcmp(f->name, "sse2"))
+        return vlc_CPU_SSE2();
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (!strcmp(f->name, "avx2"))
+        return vlc_CPU_AVX2();
+#endif
+#ifdef STARTCODE_NEON
+    if (!strcmp(f->name, "neon"))
+        return vlc_CPU_ARM_NEON();
+#endif
+    return true;
+}
+
+static const uint8_t *RefAnnexB(const uint8_t *p, const uint8_t *end)
+{
+    for (; end - p >= 3; p++)
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+            return p;
+    return NULL;
+}
+
+static const uint8_t *RefZeroPair(const uint8_t *p, const uint8_t *end)
+{
+    for (; end - p >= 2; p++)
+        if (p[0] == 0 && p[1] == 0)
+            return p;
+    return NULL;
+}
+
+/* Mostly 0, 1 and 3, so that every pattern happens at every offset */
+static void FillDense(uint8_t *p, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        static const uint8_t values[] = { 0x00, 0x00, 0x01, 0x03, 0x42 };
+        p[i] = values[rand() % ARRAY_SIZE(values)];
+    }
+}
+
+/* Random slice data with a few zero bytes, escaped, and startcodes */
+static void FillSlices(uint8_t *p, size_t size)
+{
+    unsigned zeros = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (i % (256 * 1024) == 0 && size - i >= 4)
+        {
+            memcpy(&p[i], "\x00\x00\x01\x65", 4);
+            i += 3;
+            zeros = 0;
+            continue;
+        }
+        uint8_t c = rand();
+        if (zeros == 2 && c <= 0x03)
+        {
+            p[i++] = 0x03;
+            zeros = 0;
+            if (i == size)
+                break;
+        }
+        p[i] = c;
+        zeros = c == 0x00 ? zeros + 1 : 0;
+    }
+}
+
+static void CheckFinders(void)
+{
+    uint8_t buf[256];
+
+    for (int run = 0; run < 64; run++)
+    {
+        FillDense(buf, sizeof(buf));
+        for (size_t offset = 0; offset < 32; offset++)
+        for (size_t len = 0; offset + len <= sizeof(buf); len++)
+        {
+            const uint8_t *p = &buf[offset], *end = &buf[offset + len];
+            for (size_t i = 0; i < ARRAY_SIZE(finders); i++)
+            {
+                if (!Available(&finders[i]))
+                    continue;
+                assert(finders[i].annexb(p, end) == RefAnnexB(p, end));
+                assert(finders[i].zeropair(p, end) == RefZeroPair(p, end));
+            }
+            assert(startcode_FindAnnexB(p, end) == RefAnnexB(p, end));
+            assert(startcode_FindZeroPair(p, end) == RefZeroPair(p, end));
+        }
+    }
+}
+
+/* Previous bytewise size computation */
+static size_t RefTotalSize(const uint8_t *p, const uint8_t *p_end)
+{
+    unsigned i_prev = 0;
+    size_t i = 0;
+    while (p < p_end)
+    {
+        uint8_t *n = hxxx_ep3b_to_rbsp((uint8_t *)p, (uint8_t *)p_end, &i_prev, 1);
+        if (n > p)
+            ++i;
+        p = n;
+    }
+    return i;
+}
+
+static void CheckEP3B(uint8_t *buf, size_t size)
+{
+    for (size_t len = 0; len < 512 && len <= size; len++)
+        assert(hxxx_ep3b_total_size(buf, &buf[len]) == RefTotalSize(buf, &buf[len]));
+
+    /* reads with and without large skips give the same bits */
+    for (size_t skip = 1; skip < 300; skip += 7)
+    {
+        const size_t len = size < 4096 ? size : 4096;
+        struct hxxx_bsfw_ep3b_ctx_s ctx, refctx;
+        bs_t bs, ref;
+        hxxx_bsfw_ep3b_ctx_init(&ctx);
+        hxxx_bsfw_ep3b_ctx_init(&refctx);
+        bs_init_custom(&bs, buf, len, &hxxx_bsfw_ep3b_callbacks, &ctx);
+        bs_init_custom(&ref, buf, len, &hxxx_bsfw_ep3b_callbacks, &refctx);
+        assert(bs_remain(&bs) == 8 * RefTotalSize(buf, &buf[len]));
+
+        while (!bs_eof(&ref))
+        {
+            bs_skip(&bs, skip * 8);
+            for (size_t i = 0; i < skip; i++)
+                bs_skip(&ref, 8);
+            assert(bs_eof(&bs) == bs_eof(&ref));
+            if (bs_eof(&ref))
+                break;
+            assert(bs_read(&bs, 8) == bs_read(&ref, 8));
+            assert(bs_remain(&bs) == bs_remain(&ref));
+        }
+    }
+}
+
+static void Bench(const char *name, find_cb find, const uint8_t *buf, size_t size)
+{
+    size_t count = 0;
+    vlc_tick_t start = vlc_tick_now();
+    for (const uint8_t *p = buf; (p = find(p, &buf[size])) != NULL; p++)
+        count++;
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    printf("%s: %zu matches, %"PRId64" us", name, count, US_FROM_VLC_TICK(elapsed));
+    if (elapsed > 0)
+        printf(", %"PRIu64" MB/s", (uint64_t) size / US_FROM_VLC_TICK(elapsed));
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned megabytes = 64;
+    if (argc > 1)
+        megabytes = strtoul(argv[1], NULL, 10);
+
+    srand(0);
+    CheckFinders();
+
+    const size_t size = (size_t) megabytes << 20;
+    uint8_t *buf = malloc(size);
+    assert(buf != NULL);
+
+    FillDense(buf, 4096);
+    CheckEP3B(buf, 4096);
+    FillSlices(buf, size);
+    CheckEP3B(buf, size);
+
+    for (size_t i = 0; i < ARRAY_SIZE(finders); i++)
+    {
+        if (!Available(&finders[i]))
+            continue;
+        char name[32];
+        snprintf(name, sizeof(name), "annexb %s", finders[i].name);
+        Bench(name, finders[i].annexb, buf, size);
+        snprintf(name, sizeof(name), "zero pairs %s", finders[i].name);
+        Bench(name, finders[i].zeropair, buf, size);
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+    size_t ref = RefTotalSize(buf, &buf[size]);
+    vlc_tick_t bytewise = vlc_tick_now() - start;
+    start = vlc_tick_now();
+    assert(hxxx_ep3b_total_size(buf, &buf[size]) == ref);
+    vlc_tick_t skipping = vlc_tick_now() - start;
+
+    printf("ep3b size: %zu bytes, bytewise %"PRId64" us, skipping %"PRId64" us\n",
+           ref, US_FROM_VLC_TICK(bytewise), US_FROM_VLC_TICK(skipping));
+
+    free(buf);
+    return 0;
+}
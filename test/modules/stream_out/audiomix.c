@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * audiomix.c: audio mixer stream output test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_sout.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define RATE 48000
+#define FRAME 960 /* 20 ms, the mixer default */
+
+/* Last stage of the chain, recording the mixed output */
+struct capture
+{
+    int flushes;
+    unsigned blocks;
+    unsigned jumps;
+    vlc_tick_t first_pts;
+    vlc_tick_t next_pts;
+    vlc_tick_t jump_pts;
+};
+
+static struct capture capture;
+
+static void *CaptureAdd(sout_stream_t *stream, const es_format_t *fmt)
+{
+    (void) stream;
+    assert(fmt->i_cat == AUDIO_ES);
+    assert(fmt->i_codec == VLC_CODEC_FL32);
+    assert(fmt->audio.i_rate == RATE);
+    return &capture;
+}
+
+static void CaptureDel(sout_stream_t *stream, void *id)
+{
+    (void) stream;
+    assert(id == &capture);
+}
+
+static int CaptureSend(sout_stream_t *stream, void *id, block_t *block)
+{
+    (void) stream;
+    assert(id == &capture);
+    assert(block->i_nb_samples == FRAME);
+
+    if (capture.blocks == 0)
+        capture.first_pts = block->i_pts;
+    else if (block->i_pts != capture.next_pts)
+    {   /* The mix re-anchored on an input discontinuity */
+        capture.jumps++;
+        capture.jump_pts = block->i_pts;
+    }
+    capture.next_pts = block->i_pts + block->i_length;
+    capture.blocks++;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void CaptureFlush(sout_stream_t *stream, void *id)
+{
+    (void) stream;
+    assert(id == &capture);
+    capture.flushes++;
+    capture.blocks = 0;
+}
+
+/* Sends count frames of silence from the given date, flags go to the
+ * first frame */
+static void SendInput(sout_stream_t *mix, void *id, vlc_tick_t pts,
+                      unsigned count, uint32_t flags)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = block_Alloc(FRAME * 2 * sizeof (float));
+        assert(block != NULL);
+        memset(block->p_buffer, 0, block->i_buffer);
+        block->i_nb_samples = FRAME;
+        block->i_pts = block->i_dts =
+            pts + vlc_tick_from_samples(i * FRAME, RATE);
+        block->i_length = vlc_tick_from_samples(FRAME, RATE);
+        if (i == 0)
+            block->i_flags |= flags;
+        assert(sout_StreamIdSend(mix, id, block) == VLC_SUCCESS);
+    }
+}
+
+static sout_stream_t *MixNew(vlc_object_t *parent)
+{
+    sout_instance_t *sout = vlc_object_create(parent, sizeof (*sout));
+    assert(sout != NULL);
+    sout->i_out_pace_nocontrol = 0;
+
+    sout_stream_t *last = vlc_object_create(sout, sizeof (*last));
+    assert(last != NULL);
+    last->p_sout = sout;
+    last->pf_add = CaptureAdd;
+    last->pf_del = CaptureDel;
+    last->pf_send = CaptureSend;
+    last->pf_flush = CaptureFlush;
+    last->pf_control = NULL;
+
+    sout_stream_t *mix = sout_StreamChainNew(sout, "audiomix", last, NULL);
+    assert(mix != NULL);
+    memset(&capture, 0, sizeof (capture));
+    return mix;
+}
+
+static void MixDelete(sout_stream_t *mix)
+{
+    sout_instance_t *sout = mix->p_sout;
+    sout_stream_t *last = mix->p_next;
+
+    sout_StreamChainDelete(mix, mix);
+    vlc_object_release(last);
+    vlc_object_release(sout);
+}
+
+static void *MixInputAdd(sout_stream_t *mix)
+{
+    es_format_t fmt;
+    es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_FL32);
+    fmt.audio.i_rate = RATE;
+    fmt.audio.i_channels = 2;
+    fmt.audio.i_physical_channels = AOUT_CHANS_STEREO;
+    void *id = sout_StreamIdAdd(mix, &fmt);
+    assert(id != NULL);
+    return id;
+}
+
+static void test_flush(vlc_object_t *parent)
+{
+    sout_stream_t *mix = MixNew(parent);
+    void *id = MixInputAdd(mix);
+
+    /* One second from the start */
+    const vlc_tick_t start = VLC_TICK_0 + VLC_TICK_FROM_SEC(1);
+    SendInput(mix, id, start, 50, 0);
+    assert(capture.blocks > 0);
+    assert(capture.first_pts == start);
+
+    /* Seek forward: the mix restarts at the new dates instead of filling
+     * the gap with silence */
+    const vlc_tick_t forward = VLC_TICK_0 + VLC_TICK_FROM_SEC(60);
+    sout_StreamFlush(mix, id);
+    assert(capture.flushes == 1);
+    SendInput(mix, id, forward, 50, 0);
+    assert(capture.blocks > 0 && capture.blocks <= 50);
+    assert(capture.first_pts == forward);
+
+    /* Seek backward: the input is not dropped as already mixed */
+    sout_StreamFlush(mix, id);
+    assert(capture.flushes == 2);
+    SendInput(mix, id, VLC_TICK_0, 50, 0);
+    assert(capture.blocks > 0);
+    assert(capture.first_pts == VLC_TICK_0);
+
+    /* Flushing twice does not flush the output again */
+    sout_StreamFlush(mix, id);
+    sout_StreamFlush(mix, id);
+    assert(capture.flushes == 3);
+    assert(capture.jumps == 0);
+
+    sout_StreamIdDel(mix, id);
+    MixDelete(mix);
+}
+
+static void test_jump(vlc_object_t *parent)
+{
+    sout_stream_t *mix = MixNew(parent);
+    void *id = MixInputAdd(mix);
+    const vlc_tick_t frame = vlc_tick_from_samples(FRAME, RATE);
+
+    const vlc_tick_t start = VLC_TICK_0 + VLC_TICK_FROM_SEC(1);
+    SendInput(mix, id, start, 50, 0);
+    assert(capture.first_pts == start);
+
+    /* A gap within the latency is filled with silence */
+    SendInput(mix, id, start + 50 * frame + VLC_TICK_FROM_MS(100), 50, 0);
+    assert(capture.jumps == 0);
+    assert(capture.blocks > 50 && capture.blocks <= 105);
+
+    /* An hour later: the mix follows the input instead of filling the hour
+     * with silence, which would be some 180000 blocks */
+    const vlc_tick_t later = start + VLC_TICK_FROM_SEC(3600);
+    SendInput(mix, id, later, 50, 0);
+    assert(capture.jumps == 1);
+    assert(capture.jump_pts == later);
+    assert(capture.blocks <= 155);
+
+    /* Back in time with the input drained: the discontinuity flag keeps it
+     * from being dropped as already mixed */
+    SendInput(mix, id, VLC_TICK_0, 50, BLOCK_FLAG_DISCONTINUITY);
+    assert(capture.jumps == 2);
+    assert(capture.jump_pts == VLC_TICK_0);
+    assert(capture.blocks <= 205);
+    assert(capture.flushes == 0);
+
+    sout_StreamIdDel(mix, id);
+    MixDelete(mix);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+
+    test_flush(VLC_OBJECT(vlc->p_libvlc_int));
+    test_jump(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -26,6 +26,10 @@
 
 #include "common.h"
 
+#include <time.h>
+
+uint64_t (*vlc_run_allocations)(void) = NULL;
+
 static inline int getenv_atoi(const char *name)
 {
     char *env = getenv(name);
@@ -43,6 +47,35 @@ void vlc_run_args_init(struct vlc_run_args *args)
     args->test_demux_controls = getenv_atoi("VLC_DEMUX_CONTROLS");
 }
 
+uint64_t vlc_run_now_ns(void)
+{
+    struct timespec ts;
+
+    /* vlc_tick_now() is too coarse for a single packet */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void vlc_run_timer_start(const struct vlc_run_stats *stats,
+                         struct vlc_run_timer *timer)
+{
+    if (stats == NULL)
+        return;
+    timer->allocs = vlc_run_allocations ? vlc_run_allocations() : 0;
+    timer->ns = vlc_run_now_ns();
+}
+
+void vlc_run_timer_stop(struct vlc_run_stats *stats,
+                        const struct vlc_run_timer *timer,
+                        enum vlc_run_stage stage)
+{
+    if (stats == NULL)
+        return;
+    stats->stages[stage].ns += vlc_run_now_ns() - timer->ns;
+    if (vlc_run_allocations)
+        stats->stages[stage].allocs += vlc_run_allocations() - timer->allocs;
+}
+
 libvlc_instance_t *libvlc_create(const struct vlc_run_args *args)
 {
 #ifdef TOP_BUILDDIR
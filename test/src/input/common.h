@@ -37,8 +37,56 @@ struct vlc_run_args
 
     /* true to test demux controls */
     bool test_demux_controls;
+
+    /* only packetize the ES, without decoding them */
+    bool packetize_only;
+
+    /* statistics to fill, NULL to don't measure anything */
+    struct vlc_run_stats *stats;
+};
+
+enum vlc_run_stage
+{
+    VLC_RUN_DEMUX, /* excluding the ES output */
+    VLC_RUN_PACKETIZER,
+    VLC_RUN_DECODER,
+    VLC_RUN_STAGE_COUNT
 };
 
+struct vlc_run_stats
+{
+    struct
+    {
+        uint64_t packets; /* input packets */
+        uint64_t bytes;
+        uint64_t ns;
+        uint64_t allocs;
+    } stages[VLC_RUN_STAGE_COUNT];
+
+    /* from the demux creation to its deletion */
+    uint64_t total_ns;
+    uint64_t total_allocs;
+};
+
+struct vlc_run_timer
+{
+    uint64_t ns;
+    uint64_t allocs;
+};
+
+/* Allocations counter, set by the program if it can count them */
+extern uint64_t (*vlc_run_allocations)(void);
+
 void vlc_run_args_init(struct vlc_run_args *args);
 
+uint64_t vlc_run_now_ns(void);
+
+/* Measures the time and allocations between start and stop, and adds them
+ * to the stage, if there are statistics to fill */
+void vlc_run_timer_start(const struct vlc_run_stats *stats,
+                         struct vlc_run_timer *timer);
+void vlc_run_timer_stop(struct vlc_run_stats *stats,
+                        const struct vlc_run_timer *timer,
+                        enum vlc_run_stage stage);
+
 libvlc_instance_t *libvlc_create(const struct vlc_run_args *args);
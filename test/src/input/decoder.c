@@ -43,6 +43,8 @@ struct decoder_owner
 {
     decoder_t dec;
     decoder_t *packetizer;
+    bool packetize_only;
+    struct vlc_run_stats *stats;
 };
 
 static inline struct decoder_owner *dec_get_owner(decoder_t *dec)
@@ -146,7 +148,8 @@ void test_decoder_destroy(decoder_t *decoder)
     vlc_object_release(decoder);
 }
 
-decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
+decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt,
+                               const struct vlc_run_args *args)
 {
     assert(parent && fmt);
     decoder_t *packetizer = NULL;
@@ -163,6 +166,8 @@ decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
     }
     decoder = &owner->dec;
     owner->packetizer = packetizer;
+    owner->packetize_only = args->packetize_only;
+    owner->stats = args->stats;
 
     static const struct decoder_owner_callbacks dec_video_cbs =
     {
@@ -210,7 +215,8 @@ decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
         return NULL;
     }
 
-    if (decoder_load(decoder, false, &packetizer->fmt_out) != VLC_SUCCESS)
+    if (!owner->packetize_only
+     && decoder_load(decoder, false, &packetizer->fmt_out) != VLC_SUCCESS)
     {
         decoder_unload(packetizer);
         vlc_object_release(packetizer);
@@ -221,31 +227,69 @@ decoder_t *test_decoder_create(vlc_object_t *parent, const es_format_t *fmt)
     return decoder;
 }
 
+static block_t *packetize(struct decoder_owner *owner, block_t **pp_block)
+{
+    decoder_t *packetizer = owner->packetizer;
+    struct vlc_run_timer timer;
+
+    vlc_run_timer_start(owner->stats, &timer);
+    block_t *p_packetized_block = packetizer->pf_packetize(packetizer, pp_block);
+    vlc_run_timer_stop(owner->stats, &timer, VLC_RUN_PACKETIZER);
+    return p_packetized_block;
+}
+
+static int decode(struct decoder_owner *owner, block_t *p_block)
+{
+    decoder_t *decoder = &owner->dec;
+    struct vlc_run_timer timer;
+
+    if (owner->stats != NULL && p_block != NULL)
+    {
+        owner->stats->stages[VLC_RUN_DECODER].packets++;
+        owner->stats->stages[VLC_RUN_DECODER].bytes += p_block->i_buffer;
+    }
+
+    vlc_run_timer_start(owner->stats, &timer);
+    int ret = decoder->pf_decode(decoder, p_block);
+    vlc_run_timer_stop(owner->stats, &timer, VLC_RUN_DECODER);
+    return ret;
+}
+
 int test_decoder_process(decoder_t *decoder, block_t *p_block)
 {
     struct decoder_owner *owner = dec_get_owner(decoder);
     decoder_t *packetizer = owner->packetizer;
 
     /* This case can happen if a decoder reload failed */
-    if (decoder->p_module == NULL)
+    if (decoder->p_module == NULL && !owner->packetize_only)
     {
         if (p_block != NULL)
             block_Release(p_block);
         return VLC_EGENERIC;
     }
 
+    if (owner->stats != NULL && p_block != NULL)
+    {
+        owner->stats->stages[VLC_RUN_PACKETIZER].packets++;
+        owner->stats->stages[VLC_RUN_PACKETIZER].bytes += p_block->i_buffer;
+    }
+
     block_t **pp_block = p_block ? &p_block : NULL;
     block_t *p_packetized_block;
-    while ((p_packetized_block =
-                packetizer->pf_packetize(packetizer, pp_block)))
+    while ((p_packetized_block = packetize(owner, pp_block)))
     {
+        if (owner->packetize_only)
+        {
+            block_ChainRelease(p_packetized_block);
+            continue;
+        }
 
         if (!es_format_IsSimilar(&decoder->fmt_in, &packetizer->fmt_out))
         {
             debug("restarting module due to input format change\n");
 
             /* Drain the decoder module */
-            decoder->pf_decode(decoder, NULL);
+            decode(owner, NULL);
 
             /* Reload decoder */
             decoder_unload(decoder);
@@ -270,7 +314,7 @@ int test_decoder_process(decoder_t *decoder, block_t *p_block)
             block_t *p_next = p_packetized_block->p_next;
             p_packetized_block->p_next = NULL;
 
-            int ret = decoder->pf_decode(decoder, p_packetized_block);
+            int ret = decode(owner, p_packetized_block);
 
             if (ret == VLCDEC_ECRITICAL)
             {
@@ -281,7 +325,7 @@ int test_decoder_process(decoder_t *decoder, block_t *p_block)
             p_packetized_block = p_next;
         }
     }
-    if (p_block == NULL) /* Drain */
-        decoder->pf_decode(decoder, NULL);
+    if (p_block == NULL && !owner->packetize_only) /* Drain */
+        decode(owner, NULL);
     return VLC_SUCCESS;
 }
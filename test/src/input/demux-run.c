@@ -53,6 +53,9 @@ struct test_es_out_t
 {
     struct es_out_t out;
     struct es_out_id_t *ids;
+    const struct vlc_run_args *args;
+    /* time and allocations spent in the ES output, during the demux */
+    struct vlc_run_stats send;
 #ifdef HAVE_DECODERS
     vlc_object_t *parent;
 #endif
@@ -82,7 +85,7 @@ static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
     ctx->ids = id;
 #ifdef HAVE_DECODERS
     es_format_Copy(&id->fmt, fmt);
-    id->decoder = test_decoder_create(ctx->parent, &id->fmt);
+    id->decoder = test_decoder_create(ctx->parent, &id->fmt, ctx->args);
     if (id->decoder == NULL)
         es_format_Clean(&id->fmt);
 #endif
@@ -106,12 +109,22 @@ static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
 
     //debug("[%p] Sent    ES: %zu\n", (void *)idd, block->i_buffer);
     EsOutCheckId(ctx, id);
+
+    struct vlc_run_stats *stats = ctx->args->stats;
+    struct vlc_run_timer timer;
+    if (stats != NULL)
+    {
+        stats->stages[VLC_RUN_DEMUX].packets++;
+        stats->stages[VLC_RUN_DEMUX].bytes += block->i_buffer;
+    }
+    vlc_run_timer_start(stats, &timer);
 #ifdef HAVE_DECODERS
     if (id->decoder)
         test_decoder_process(id->decoder, block);
     else
 #endif
         block_Release(block);
+    vlc_run_timer_stop(stats ? &ctx->send : NULL, &timer, VLC_RUN_DEMUX);
     return VLC_SUCCESS;
 }
 
@@ -159,8 +172,9 @@ static int EsOutControl(es_out_t *out, int query, va_list args)
 #ifdef HAVE_DECODERS
             es_out_id_t* id = va_arg(args, es_out_id_t*);
             EsOutCheckId(ctx, id);
-            test_decoder_destroy(id->decoder);
-            test_decoder_create(ctx->parent, &id->fmt);
+            if (id->decoder)
+                test_decoder_destroy(id->decoder);
+            id->decoder = test_decoder_create(ctx->parent, &id->fmt, ctx->args);
 #endif
             break;
         }
@@ -220,7 +234,8 @@ static const struct es_out_callbacks es_out_cbs =
     .destroy = EsOutDestroy,
 };
 
-static es_out_t *test_es_out_create(vlc_object_t *parent)
+static es_out_t *test_es_out_create(vlc_object_t *parent,
+                                    const struct vlc_run_args *args)
 {
     struct test_es_out_t *ctx = malloc(sizeof (*ctx));
     if (ctx == NULL)
@@ -230,6 +245,8 @@ static es_out_t *test_es_out_create(vlc_object_t *parent)
     }
 
     ctx->ids = NULL;
+    ctx->args = args;
+    memset(&ctx->send, 0, sizeof (ctx->send));
 
     es_out_t *out = &ctx->out;
     out->cbs = &es_out_cbs;
@@ -286,11 +303,18 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
     if (s == NULL)
         return -1;
 
-    es_out_t *out = test_es_out_create(VLC_OBJECT(s));
+    es_out_t *out = test_es_out_create(VLC_OBJECT(s), args);
     if (out == NULL)
         return -1;
 
+    struct vlc_run_stats *stats = args->stats;
+    struct vlc_run_timer total, timer;
+    vlc_run_timer_start(stats, &total);
+
+    /* the demux stage includes the opening and closing of the demux */
+    vlc_run_timer_start(stats, &timer);
     demux_t *demux = demux_New(VLC_OBJECT(s), name, s, out);
+    vlc_run_timer_stop(stats, &timer, VLC_RUN_DEMUX);
     if (demux == NULL)
     {
         es_out_Delete(out);
@@ -302,8 +326,14 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
     uintmax_t i = 0;
     int val;
 
-    while ((val = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS)
+    for (;;)
     {
+        vlc_run_timer_start(stats, &timer);
+        val = demux_Demux(demux);
+        vlc_run_timer_stop(stats, &timer, VLC_RUN_DEMUX);
+        if (val != VLC_DEMUXER_SUCCESS)
+            break;
+
         if (args->test_demux_controls)
         {
             if (demux_test_and_clear_flags(demux, INPUT_UPDATE_TITLE_LIST))
@@ -326,9 +356,26 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
         i++;
     }
 
+    vlc_run_timer_start(stats, &timer);
     demux_Delete(demux);
+    vlc_run_timer_stop(stats, &timer, VLC_RUN_DEMUX);
+
+    if (stats != NULL)
+    {
+        /* the ES output time is accounted in the other stages */
+        const struct test_es_out_t *ctx = (const struct test_es_out_t *) out;
+        stats->stages[VLC_RUN_DEMUX].ns -= ctx->send.stages[VLC_RUN_DEMUX].ns;
+        stats->stages[VLC_RUN_DEMUX].allocs -= ctx->send.stages[VLC_RUN_DEMUX].allocs;
+    }
     es_out_Delete(out);
 
+    if (stats != NULL)
+    {
+        stats->total_ns = vlc_run_now_ns() - total.ns;
+        if (vlc_run_allocations)
+            stats->total_allocs = vlc_run_allocations() - total.allocs;
+    }
+
     debug("Completed with %" PRIuMAX " iteration(s).\n", i);
 
     return val == VLC_DEMUXER_EOF ? 0 : -1;
@@ -0,0 +1,323 @@
+/*****************************************************************************
+ * seekindex.c: seek index cache unit test
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+#include <vlc_seekindex.h>
+#include "../../../lib/libvlc_internal.h"
+#include "../../libvlc/test.h"
+
+#include <vlc/vlc.h>
+
+#define COUNT 10000
+
+static vlc_object_t *parent;
+static char *url;
+
+static vlc_seekindex_t *OpenIndex(const char *name, uint32_t version)
+{
+    stream_t *s = vlc_stream_NewURL(parent, url);
+    assert(s != NULL);
+
+    vlc_seekindex_t *idx = vlc_seekindex_New(parent, s, name, version);
+    vlc_stream_Delete(s);
+    return idx;
+}
+
+static void FillIndex(vlc_seekindex_t *idx)
+{
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        const vlc_seekindex_entry_t entry = {
+            .time = VLC_TICK_FROM_MS(40) * i,
+            .offset = UINT64_C(1) << 33 | (i * 1000 + (i % 17)),
+            .size = i % 5000,
+            .track = i % 2,
+            .flags = (i % 12) ? 0 : 0x10,
+        };
+        assert(vlc_seekindex_Append(idx, &entry) == VLC_SUCCESS);
+    }
+}
+
+static void CheckIndex(const vlc_seekindex_t *idx)
+{
+    size_t count;
+    const vlc_seekindex_entry_t *entries =
+        vlc_seekindex_GetEntries(idx, &count);
+
+    assert(count == COUNT);
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        assert(entries[i].time == VLC_TICK_FROM_MS(40) * i);
+        assert(entries[i].offset == (UINT64_C(1) << 33 | (i * 1000 + (i % 17))));
+        assert(entries[i].size == i % 5000);
+        assert(entries[i].track == i % 2);
+        assert(entries[i].flags == ((i % 12) ? 0 : 0x10));
+    }
+
+    const vlc_seekindex_entry_t *entry;
+
+    entry = vlc_seekindex_Find(idx, 0, VLC_TICK_FROM_MS(40) * 101 + 1);
+    assert(entry == &entries[100]);
+    entry = vlc_seekindex_Find(idx, 1, VLC_TICK_FROM_MS(40) * 101);
+    assert(entry == &entries[101]);
+    entry = vlc_seekindex_Find(idx, 1, 0);
+    assert(entry == NULL);
+    entry = vlc_seekindex_Find(idx, 0, -1);
+    assert(entry == NULL);
+    entry = vlc_seekindex_Find(idx, 0, INT64_MAX);
+    assert(entry == &entries[COUNT - 2]);
+    entry = vlc_seekindex_Find(idx, 2, INT64_MAX);
+    assert(entry == NULL);
+}
+
+/* Minimal ES output: the packetized frames are dropped */
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    (void) fmt;
+    return (es_out_id_t *) out;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    (void) out; (void) id;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    (void) out; (void) id;
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    (void) out; (void) args;
+    switch (query)
+    {
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_SET_ES_FMT:
+        case ES_OUT_SET_META:
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static const struct es_out_callbacks es_out_cbs = {
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDel,
+    .control = EsOutControl,
+    .destroy = EsOutDestroy,
+};
+
+/* Writes count frames of the given header, with a silent payload */
+static char *WriteFrames(const char *suffix, const uint8_t *header,
+                         size_t header_size, size_t frame_size,
+                         unsigned count)
+{
+    char *path;
+    assert(asprintf(&path, "/tmp/vlc-test-seekindex-es-XXXXXX%s", suffix) > 0);
+
+    int fd = mkstemps(path, strlen(suffix));
+    assert(fd >= 0);
+
+    uint8_t frame[1024] = { 0 };
+    assert(frame_size <= sizeof (frame));
+    memcpy(frame, header, header_size);
+    for (unsigned i = 0; i < count; i++)
+        assert(write(fd, frame, frame_size) == (ssize_t) frame_size);
+    close(fd);
+    return path;
+}
+
+/* Plays a file through the ES demuxer from the start to the end, and
+ * returns its cached seek index, if any */
+static vlc_seekindex_t *DemuxFile(const char *path)
+{
+    char *file_url = vlc_path2uri(path, NULL);
+    assert(file_url != NULL);
+
+    stream_t *s = vlc_stream_NewURL(parent, file_url);
+    assert(s != NULL);
+
+    es_out_t out = { .cbs = &es_out_cbs };
+    demux_t *demux = demux_New(parent, "es", s, &out);
+    assert(demux != NULL);
+    while (demux_Demux(demux) > 0)
+        ;
+    /* The index is stored on close */
+    demux_Delete(demux);
+    vlc_stream_Delete(s);
+
+    s = vlc_stream_NewURL(parent, file_url);
+    assert(s != NULL);
+    vlc_seekindex_t *idx = vlc_seekindex_New(parent, s, "es", 2);
+    vlc_stream_Delete(s);
+    free(file_url);
+
+    assert(idx != NULL);
+    if (vlc_seekindex_Load(idx) != VLC_SUCCESS)
+    {
+        vlc_seekindex_Delete(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+static void test_es(void)
+{
+    /* MPEG-1 layer III, 128 kb/s, 44.1 kHz, without padding: the frames are
+     * stored as is by the packetizer, the points are at their offsets */
+    static const uint8_t mpga[] = { 0xFF, 0xFB, 0x90, 0x00 };
+    const size_t mpga_size = 417;
+    char *path = WriteFrames(".mp3", mpga, sizeof (mpga), mpga_size, 400);
+    vlc_seekindex_t *idx = DemuxFile(path);
+
+    assert(idx != NULL);
+    size_t count;
+    const vlc_seekindex_entry_t *entries =
+        vlc_seekindex_GetEntries(idx, &count);
+    assert(count >= 9);
+    for (size_t i = 0; i < count; i++)
+    {
+        assert(entries[i].offset % mpga_size == 0);
+
+        vlc_tick_t time =
+            vlc_tick_from_samples(entries[i].offset / mpga_size * 1152, 44100);
+        assert(entries[i].time >= time - VLC_TICK_FROM_MS(1));
+        assert(entries[i].time <= time + VLC_TICK_FROM_MS(1));
+    }
+    vlc_seekindex_Delete(idx);
+    unlink(path);
+    free(path);
+
+    /* AAC LC in ADTS, 44.1 kHz stereo, 200 bytes frames: the packetizer
+     * strips the headers, the sizes of its frames are not the offsets */
+    static const uint8_t adts[] = { 0xFF, 0xF1, 0x50, 0x80, 0x19, 0x1F, 0xFC };
+    path = WriteFrames(".aac", adts, sizeof (adts), 200, 500);
+    assert(DemuxFile(path) == NULL);
+    unlink(path);
+    free(path);
+}
+
+static int RemoveCb(const char *path, const struct stat *st, int type,
+                    struct FTW *ftw)
+{
+    (void) st; (void) type; (void) ftw;
+    return remove(path);
+}
+
+int main(void)
+{
+    char cachedir[] = "/tmp/vlc-test-seekindex-XXXXXX";
+    char path[] = "/tmp/vlc-test-seekindex-file-XXXXXX";
+    vlc_seekindex_t *idx;
+
+    test_init();
+
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    assert(write(fd, "seek index test", 15) == 15);
+
+    url = vlc_path2uri(path, NULL);
+    assert(url != NULL);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    /* Nothing cached yet */
+    idx = OpenIndex("test", 1);
+    assert(idx != NULL);
+    assert(vlc_seekindex_Load(idx) != VLC_SUCCESS);
+    FillIndex(idx);
+    CheckIndex(idx);
+    assert(vlc_seekindex_Store(idx) == VLC_SUCCESS);
+    vlc_seekindex_Delete(idx);
+
+    /* Cached */
+    idx = OpenIndex("test", 1);
+    assert(idx != NULL);
+    assert(vlc_seekindex_Load(idx) == VLC_SUCCESS);
+    CheckIndex(idx);
+    vlc_seekindex_Delete(idx);
+
+    /* Other demuxer or other version */
+    idx = OpenIndex("other", 1);
+    assert(idx != NULL);
+    assert(vlc_seekindex_Load(idx) != VLC_SUCCESS);
+    vlc_seekindex_Delete(idx);
+    idx = OpenIndex("test", 2);
+    assert(idx != NULL);
+    assert(vlc_seekindex_Load(idx) != VLC_SUCCESS);
+    vlc_seekindex_Delete(idx);
+
+    /* Modified file */
+    assert(write(fd, "!", 1) == 1);
+    idx = OpenIndex("test", 1);
+    assert(idx != NULL);
+    assert(vlc_seekindex_Load(idx) != VLC_SUCCESS);
+    size_t count;
+    vlc_seekindex_GetEntries(idx, &count);
+    assert(count == 0);
+    vlc_seekindex_Delete(idx);
+
+    test_es();
+
+    /* Disabled cache */
+    var_Create(parent, "seek-index-cache", VLC_VAR_BOOL);
+    var_SetBool(parent, "seek-index-cache", false);
+    assert(OpenIndex("test", 1) == NULL);
+
+    libvlc_release(vlc);
+    close(fd);
+    unlink(path);
+    free(url);
+
+    /* Clean the cache up */
+    assert(nftw(cachedir, RemoveCb, 4, FTW_DEPTH | FTW_PHYS) == 0);
+    return 0;
+}
@@ -38,25 +38,34 @@ const struct
     vlc_tick_t i_time;
     float f_pos;
     bool b_use_pos;
-    bool b_fast_seek;
+    enum vlc_thumbnailer_seek_speed speed;
     vlc_tick_t i_timeout;
     bool b_expected_success;
 } test_params[] = {
     /* Simple test with a thumbnail at 60s, with a video track */
-    { 1, 0, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false, true,
-        VLC_TICK_FROM_SEC( 1 ), true },
+    { 1, 0, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false,
+        VLC_THUMBNAILER_SEEK_FAST, VLC_TICK_FROM_SEC( 1 ), true },
     /* Test without fast-seek */
-    { 1, 0, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false, false,
-        VLC_TICK_FROM_SEC( 1 ), true },
+    { 1, 0, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false,
+        VLC_THUMBNAILER_SEEK_PRECISE, VLC_TICK_FROM_SEC( 1 ), true },
+    /* Test with keyframes only */
+    { 1, 0, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false,
+        VLC_THUMBNAILER_SEEK_KEYFRAME, VLC_TICK_FROM_SEC( 1 ), true },
     /* Seek by position test */
-    { 1, 0, VLC_TICK_INVALID, 0, .3f, true, true, VLC_TICK_FROM_SEC( 1 ), true },
+    { 1, 0, VLC_TICK_INVALID, 0, .3f, true, VLC_THUMBNAILER_SEEK_FAST,
+        VLC_TICK_FROM_SEC( 1 ), true },
+    /* Seek by position with keyframes only */
+    { 1, 0, VLC_TICK_INVALID, 0, .3f, true, VLC_THUMBNAILER_SEEK_KEYFRAME,
+        VLC_TICK_FROM_SEC( 1 ), true },
     /* Seek at a negative position */
-    { 1, 0, VLC_TICK_INVALID, -12345, .0f, false, true, VLC_TICK_FROM_SEC( 1 ), true },
+    { 1, 0, VLC_TICK_INVALID, -12345, .0f, false, VLC_THUMBNAILER_SEEK_FAST,
+        VLC_TICK_FROM_SEC( 1 ), true },
     /* Take a thumbnail of a file without video, which should timeout. */
-    { 0, 1, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false, true, VLC_TICK_FROM_MS( 100 ), false },
+    { 0, 1, VLC_TICK_INVALID, VLC_TICK_FROM_SEC( 60 ), .0f, false,
+        VLC_THUMBNAILER_SEEK_FAST, VLC_TICK_FROM_MS( 100 ), false },
     /* Take a thumbnail of a file with a video track starting later */
-    { 0, 1, VLC_TICK_FROM_SEC( 120 ), VLC_TICK_FROM_SEC( 60 ), .0f, false, true,
-        VLC_TICK_FROM_SEC( 2 ), true },
+    { 0, 1, VLC_TICK_FROM_SEC( 120 ), VLC_TICK_FROM_SEC( 60 ), .0f, false,
+        VLC_THUMBNAILER_SEEK_FAST, VLC_TICK_FROM_SEC( 2 ), true },
 };
 
 struct test_ctx
@@ -137,16 +146,14 @@ static void test_thumbnails( libvlc_instance_t* p_vlc )
         if ( test_params[i].b_use_pos )
         {
             vlc_thumbnailer_RequestByPos( p_thumbnailer, test_params[i].f_pos,
-                test_params[i].b_fast_seek ?
-                    VLC_THUMBNAILER_SEEK_FAST : VLC_THUMBNAILER_SEEK_PRECISE,
-                p_item, test_params[i].i_timeout, thumbnailer_callback, &ctx );
+                test_params[i].speed, p_item, test_params[i].i_timeout,
+                thumbnailer_callback, &ctx );
         }
         else
         {
             vlc_thumbnailer_RequestByTime( p_thumbnailer, test_params[i].i_time,
-                test_params[i].b_fast_seek ?
-                    VLC_THUMBNAILER_SEEK_FAST : VLC_THUMBNAILER_SEEK_PRECISE,
-                p_item, test_params[i].i_timeout, thumbnailer_callback, &ctx );
+                test_params[i].speed, p_item, test_params[i].i_timeout,
+                thumbnailer_callback, &ctx );
         }
 
         while ( ctx.b_done == false )
@@ -163,6 +170,68 @@ static void test_thumbnails( libvlc_instance_t* p_vlc )
     vlc_thumbnailer_Release( p_thumbnailer );
 }
 
+#define PARALLEL_COUNT 16
+
+struct parallel_ctx
+{
+    vlc_cond_t cond;
+    vlc_mutex_t lock;
+    unsigned done;
+};
+
+static void thumbnailer_callback_parallel( void* data, picture_t* thumbnail )
+{
+    struct parallel_ctx* p_ctx = data;
+    assert( thumbnail != NULL );
+    vlc_mutex_lock( &p_ctx->lock );
+    p_ctx->done++;
+    vlc_cond_signal( &p_ctx->cond );
+    vlc_mutex_unlock( &p_ctx->lock );
+}
+
+/* More requests than threads at once: the pending ones wait in the queue */
+static void test_parallel_thumbnails( libvlc_instance_t* p_vlc )
+{
+    var_Create( p_vlc->p_libvlc_int, "thumbnail-threads", VLC_VAR_INTEGER );
+    var_SetInteger( p_vlc->p_libvlc_int, "thumbnail-threads", 4 );
+
+    vlc_thumbnailer_t* p_thumbnailer = vlc_thumbnailer_Create(
+                VLC_OBJECT( p_vlc->p_libvlc_int ) );
+    assert( p_thumbnailer != NULL );
+
+    struct parallel_ctx ctx;
+    vlc_cond_init( &ctx.cond );
+    vlc_mutex_init( &ctx.lock );
+    ctx.done = 0;
+
+    char psz_mrl[128];
+    snprintf( psz_mrl, sizeof( psz_mrl ), "mock://video_track_count=1"
+              ";length=%" PRId64 ";video_chroma=ARGB", MOCK_DURATION );
+    for ( unsigned i = 0; i < PARALLEL_COUNT; ++i )
+    {
+        input_item_t* p_item = input_item_New( psz_mrl, "mock item" );
+        assert( p_item != NULL );
+        vlc_thumbnailer_request_t* p_req = vlc_thumbnailer_RequestByPos(
+            p_thumbnailer, (float)i / PARALLEL_COUNT,
+            VLC_THUMBNAILER_SEEK_KEYFRAME, p_item, VLC_TICK_FROM_SEC( 5 ),
+            thumbnailer_callback_parallel, &ctx );
+        assert( p_req != NULL );
+        input_item_Release( p_item );
+    }
+
+    vlc_mutex_lock( &ctx.lock );
+    while ( ctx.done < PARALLEL_COUNT )
+    {
+        vlc_tick_t timeout = vlc_tick_now() + VLC_TICK_FROM_SEC( 5 );
+        int res = vlc_cond_timedwait( &ctx.cond, &ctx.lock, timeout );
+        assert( res != ETIMEDOUT );
+    }
+    vlc_mutex_unlock( &ctx.lock );
+
+    vlc_thumbnailer_Release( p_thumbnailer );
+    var_Destroy( p_vlc->p_libvlc_int, "thumbnail-threads" );
+}
+
 static void thumbnailer_callback_cancel( void* data, picture_t* p_thumbnail )
 {
     struct test_ctx* p_ctx = data;
@@ -219,6 +288,7 @@ int main()
     assert(vlc);
 
     test_thumbnails( vlc );
+    test_parallel_thumbnails( vlc );
     test_cancel_thumbnail( vlc );
 
     libvlc_release( vlc );
@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * ringbuffer.c: test the lock-free ring buffer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <vlc_common.h>
+#include <vlc_ringbuffer.h>
+
+#define CHANNELS 3
+#define TOTAL (1 << 16)
+
+static void test_basic(void)
+{
+    vlc_ringbuffer_t *rb = vlc_ringbuffer_New(100);
+    unsigned char in[200], out[200];
+
+    assert(rb != NULL);
+    assert(vlc_ringbuffer_GetSize(rb) == 128);
+    assert(vlc_ringbuffer_ReadSpace(rb) == 0);
+    assert(vlc_ringbuffer_WriteSpace(rb) == 128);
+
+    for (size_t i = 0; i < sizeof (in); i++)
+        in[i] = i;
+
+    /* Fill up and wrap around */
+    assert(vlc_ringbuffer_Write(rb, in, 100) == 100);
+    assert(vlc_ringbuffer_Read(rb, out, 60) == 60);
+    assert(memcmp(in, out, 60) == 0);
+    assert(vlc_ringbuffer_Write(rb, in + 100, 100) == 88);
+    assert(vlc_ringbuffer_WriteSpace(rb) == 0);
+    assert(vlc_ringbuffer_ReadSpace(rb) == 128);
+    assert(vlc_ringbuffer_Read(rb, out, sizeof (out)) == 128);
+    assert(memcmp(in + 60, out, 128) == 0);
+    assert(vlc_ringbuffer_Read(rb, out, sizeof (out)) == 0);
+
+    /* Flush is only applied by the consumer... */
+    assert(vlc_ringbuffer_Write(rb, in, 50) == 50);
+    vlc_ringbuffer_Flush(rb);
+    assert(vlc_ringbuffer_ReadSpace(rb) == 0);
+    assert(vlc_ringbuffer_WriteSpace(rb) == 78);
+    assert(vlc_ringbuffer_Write(rb, in + 50, 10) == 10);
+    assert(vlc_ringbuffer_ReadSpace(rb) == 10);
+    /* ...on its next read */
+    assert(vlc_ringbuffer_Read(rb, out, 4) == 4);
+    assert(memcmp(in + 50, out, 4) == 0);
+    assert(vlc_ringbuffer_WriteSpace(rb) == 122);
+    assert(vlc_ringbuffer_Read(rb, NULL, 100) == 6);
+
+    /* Delay */
+    float frame[2] = { 0.f, 0.f };
+    for (unsigned i = 0; i < 8; i++)
+        assert(vlc_ringbuffer_Write(rb, frame, sizeof (frame))
+               == sizeof (frame));
+    assert(vlc_ringbuffer_GetDelay(rb, sizeof (frame), 8000)
+           == VLC_TICK_FROM_MS(1));
+    vlc_ringbuffer_SetPlayedDate(rb, vlc_tick_now() + VLC_TICK_FROM_SEC(10));
+    assert(vlc_ringbuffer_GetDelay(rb, sizeof (frame), 8000)
+           > VLC_TICK_FROM_SEC(9));
+    vlc_ringbuffer_SetPlayedDate(rb, vlc_tick_now() - VLC_TICK_FROM_SEC(10));
+    assert(vlc_ringbuffer_GetDelay(rb, sizeof (frame), 8000)
+           == VLC_TICK_FROM_MS(1));
+
+    vlc_ringbuffer_Delete(rb);
+}
+
+/* The consumer thread checks that it gets a contiguous sequence of frames
+ * whose samples are the frame index plus the channel number, with the frame
+ * straddling the end of the (non-multiple of the frame size) buffer. */
+static void *Consumer(void *data)
+{
+    vlc_ringbuffer_t *rb = data;
+    float planes[CHANNELS][61];
+    float *p[CHANNELS];
+    size_t count = 0;
+
+    for (unsigned c = 0; c < CHANNELS; c++)
+        p[c] = planes[c];
+
+    while (count < TOTAL)
+    {
+        size_t frames = vlc_ringbuffer_ReadDeinterleave(rb, p, CHANNELS, 61);
+
+        for (size_t i = 0; i < frames; i++)
+            for (unsigned c = 0; c < CHANNELS; c++)
+                assert(planes[c][i] == (float)((count + i) % 4096 + c));
+        count += frames;
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    vlc_ringbuffer_t *rb = vlc_ringbuffer_New(4096);
+    vlc_thread_t th;
+    float buf[CHANNELS * 37];
+    size_t count = 0;
+
+    assert(rb != NULL);
+    if (vlc_clone(&th, Consumer, rb, VLC_THREAD_PRIORITY_LOW))
+        abort();
+
+    while (count < TOTAL)
+    {
+        size_t frames = 37;
+
+        if (frames > TOTAL - count)
+            frames = TOTAL - count;
+        for (size_t i = 0; i < frames; i++)
+            for (unsigned c = 0; c < CHANNELS; c++)
+                buf[i * CHANNELS + c] = (count + i) % 4096 + c;
+
+        size_t len = frames * sizeof (float) * CHANNELS;
+        const unsigned char *ptr = (const unsigned char *)buf;
+
+        while (len > 0)
+        {
+            /* Only write whole frames */
+            size_t space = vlc_ringbuffer_WriteSpace(rb);
+            size_t n = space - space % (sizeof (float) * CHANNELS);
+
+            if (n > len)
+                n = len;
+            /* Busy loop: the consumer never blocks either */
+            assert(vlc_ringbuffer_Write(rb, ptr, n) == n);
+            ptr += n;
+            len -= n;
+        }
+        count += frames;
+    }
+
+    vlc_join(th, NULL);
+    assert(vlc_ringbuffer_ReadSpace(rb) == 0);
+    vlc_ringbuffer_Delete(rb);
+}
+
+#define FLUSH_TOTAL (1 << 20)
+
+/* The consumer checks that the values it reads only increase: a flush may
+ * skip values, but never replay any. */
+static void *FlushConsumer(void *data)
+{
+    vlc_ringbuffer_t *rb = data;
+    uint32_t values[53];
+    uint32_t last = 0;
+
+    while (last != FLUSH_TOTAL)
+    {
+        assert(vlc_ringbuffer_ReadSpace(rb) <= vlc_ringbuffer_GetSize(rb));
+
+        size_t len = vlc_ringbuffer_Read(rb, values, sizeof (values));
+
+        assert(len % sizeof (uint32_t) == 0);
+        for (size_t i = 0; i < len / sizeof (uint32_t); i++)
+        {
+            assert(values[i] > last);
+            last = values[i];
+        }
+    }
+    return NULL;
+}
+
+static void test_flush_threads(void)
+{
+    vlc_ringbuffer_t *rb = vlc_ringbuffer_New(1024);
+    vlc_thread_t th;
+    uint32_t values[31];
+    uint32_t next = 1;
+
+    assert(rb != NULL);
+    if (vlc_clone(&th, FlushConsumer, rb, VLC_THREAD_PRIORITY_LOW))
+        abort();
+
+    for (unsigned n = 0; next <= FLUSH_TOTAL; n++)
+    {
+        size_t space = vlc_ringbuffer_WriteSpace(rb) / sizeof (uint32_t);
+        size_t count = ARRAY_SIZE(values);
+
+        /* The read index never goes past the write index */
+        assert(space <= vlc_ringbuffer_GetSize(rb) / sizeof (uint32_t));
+        if (count > space)
+            count = space;
+        if (count > FLUSH_TOTAL + 1 - next)
+            count = FLUSH_TOTAL + 1 - next;
+
+        for (size_t i = 0; i < count; i++)
+            values[i] = next++;
+        assert(vlc_ringbuffer_Write(rb, values, count * sizeof (uint32_t))
+               == count * sizeof (uint32_t));
+
+        /* Flush while the consumer reads, but keep the last value */
+        if (n % 7 == 0 && next <= FLUSH_TOTAL)
+            vlc_ringbuffer_Flush(rb);
+    }
+
+    vlc_join(th, NULL);
+    assert(vlc_ringbuffer_ReadSpace(rb) == 0);
+    vlc_ringbuffer_Delete(rb);
+}
+
+int main(void)
+{
+    test_basic();
+    test_threads();
+    test_flush_threads();
+    return 0;
+}
@@ -0,0 +1,443 @@
+/**
+ * @file vlc-demux-bench.c
+ */
+/*****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Runs a corpus of local files through the demuxers, packetizers and
+ * decoders, one process per file and several files at once, and prints one
+ * JSON object per file with the time and allocations of each stage and the
+ * peak RSS of the process, for regression tracking.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "src/input/demux-run.h"
+
+#ifdef __GLIBC__
+/* Counts the allocations of the whole process, by interposing the
+ * allocator entry points over the glibc ones */
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void *__libc_memalign(size_t, size_t);
+
+static atomic_uint_least64_t allocations;
+
+static inline void CountAllocation(void)
+{
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+}
+
+void *malloc(size_t size)
+{
+    CountAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    CountAllocation();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    CountAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t align, size_t size)
+{
+    CountAllocation();
+    return __libc_memalign(align, size);
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    CountAllocation();
+    return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **pp, size_t align, size_t size)
+{
+    if (align % sizeof (void *) || (align & (align - 1)))
+        return EINVAL;
+
+    CountAllocation();
+    void *ptr = __libc_memalign(align, size);
+    if (ptr == NULL)
+        return ENOMEM;
+    *pp = ptr;
+    return 0;
+}
+
+static uint64_t GetAllocations(void)
+{
+    return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+#endif
+
+struct result
+{
+    int status;
+    uint64_t wall_ns;
+    struct vlc_run_stats stats;
+};
+
+struct job
+{
+    char *path;
+    pid_t pid;
+    int fd;
+    bool crashed;
+    long peak_rss_kb;
+    struct result result;
+};
+
+struct corpus
+{
+    struct job *jobs;
+    size_t count;
+    size_t size;
+};
+
+static void corpus_Add(struct corpus *corpus, const char *path)
+{
+    if (corpus->count == corpus->size)
+    {
+        corpus->size = corpus->size ? corpus->size * 2 : 64;
+        corpus->jobs = realloc(corpus->jobs,
+                               corpus->size * sizeof (*corpus->jobs));
+        if (corpus->jobs == NULL)
+            abort();
+    }
+
+    struct job *job = &corpus->jobs[corpus->count++];
+    memset(job, 0, sizeof (*job));
+    job->path = strdup(path);
+    job->fd = -1;
+    if (job->path == NULL)
+        abort();
+}
+
+static void corpus_Scan(struct corpus *corpus, const char *path)
+{
+    struct stat st;
+    if (stat(path, &st))
+    {
+        fprintf(stderr, "Error: cannot stat %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    if (!S_ISDIR(st.st_mode))
+    {
+        corpus_Add(corpus, path);
+        return;
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (ent->d_name[0] == '.')
+            continue;
+
+        char *sub;
+        if (asprintf(&sub, "%s/%s", path, ent->d_name) < 0)
+            abort();
+        corpus_Scan(corpus, sub);
+        free(sub);
+    }
+    closedir(dir);
+}
+
+static int job_Compare(const void *a, const void *b)
+{
+    return strcmp(((const struct job *) a)->path,
+                  ((const struct job *) b)->path);
+}
+
+/* Keeps the fastest of the runs, the others being disturbed by something */
+static void RunChild(const struct vlc_run_args *base, const char *path,
+                     unsigned repeat, int fd)
+{
+    struct result best = { .status = -1 };
+
+    for (unsigned i = 0; i < repeat; i++)
+    {
+        struct vlc_run_args args = *base;
+        struct result res;
+
+        memset(&res, 0, sizeof (res));
+        args.stats = &res.stats;
+
+        uint64_t start = vlc_run_now_ns();
+        res.status = vlc_demux_process_path(&args, path);
+        res.wall_ns = vlc_run_now_ns() - start;
+
+        if (i == 0 || res.wall_ns < best.wall_ns)
+            best = res;
+        if (res.status != 0)
+            break;
+    }
+
+    if (write(fd, &best, sizeof (best)) != sizeof (best))
+        _exit(2);
+    _exit(0);
+}
+
+static int job_Start(struct job *job, const struct vlc_run_args *args,
+                     unsigned repeat)
+{
+    int fds[2];
+    if (pipe(fds))
+        return -1;
+
+    /* flush before the child inherits the buffers */
+    fflush(stdout);
+    fflush(stderr);
+
+    job->pid = fork();
+    if (job->pid == 0)
+    {
+        close(fds[0]);
+        RunChild(args, job->path, repeat, fds[1]);
+    }
+
+    close(fds[1]);
+    if (job->pid == -1)
+    {
+        close(fds[0]);
+        return -1;
+    }
+    job->fd = fds[0];
+    return 0;
+}
+
+static void job_Finish(struct job *job, int status, const struct rusage *ru)
+{
+    job->crashed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    if (job->crashed
+     || read(job->fd, &job->result, sizeof (job->result)) != sizeof (job->result))
+    {
+        job->crashed = true;
+        memset(&job->result, 0, sizeof (job->result));
+    }
+    close(job->fd);
+    job->fd = -1;
+
+    job->peak_rss_kb = ru->ru_maxrss;
+#ifdef __APPLE__
+    job->peak_rss_kb /= 1024; /* in bytes */
+#endif
+}
+
+static void PrintString(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *) str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            fprintf(out, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(out, "\\u%04x", *p);
+        else
+            fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+static void PrintJob(FILE *out, const struct job *job, bool allocs)
+{
+    static const char *const names[VLC_RUN_STAGE_COUNT] = {
+        [VLC_RUN_DEMUX] = "demux",
+        [VLC_RUN_PACKETIZER] = "packetizer",
+        [VLC_RUN_DECODER] = "decoder",
+    };
+    const struct result *res = &job->result;
+
+    fputs("{\"file\":", out);
+    PrintString(out, job->path);
+    fprintf(out, ",\"status\":\"%s\"",
+            job->crashed ? "crash" : res->status ? "error" : "ok");
+    fprintf(out, ",\"wall_ns\":%" PRIu64 ",\"total_ns\":%" PRIu64,
+            res->wall_ns, res->stats.total_ns);
+    if (allocs)
+        fprintf(out, ",\"allocs\":%" PRIu64, res->stats.total_allocs);
+    fprintf(out, ",\"peak_rss_kb\":%ld,\"stages\":{", job->peak_rss_kb);
+
+    for (int i = 0; i < VLC_RUN_STAGE_COUNT; i++)
+    {
+        const uint64_t packets = res->stats.stages[i].packets;
+        const uint64_t ns = res->stats.stages[i].ns;
+
+        fprintf(out, "%s\"%s\":{\"packets\":%" PRIu64 ",\"bytes\":%" PRIu64
+                ",\"ns\":%" PRIu64 ",\"ns_per_packet\":%" PRIu64,
+                i ? "," : "", names[i], packets, res->stats.stages[i].bytes,
+                ns, packets ? ns / packets : 0);
+        if (allocs)
+            fprintf(out, ",\"allocs\":%" PRIu64, res->stats.stages[i].allocs);
+        fputc('}', out);
+    }
+    fputs("}}\n", out);
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: [VLC_TARGET=demux] %s [-j jobs] [-r repeat] [-p] "
+            "[-o output] <file or directory>...\n"
+            "  -j  files processed at once (default: number of CPUs)\n"
+            "  -r  runs per file, the fastest is kept (default: 1)\n"
+            "  -p  packetize only, without decoding\n"
+            "  -o  output file (default: standard output)\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    struct vlc_run_args args;
+    vlc_run_args_init(&args);
+
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned repeat = 1;
+    FILE *out = stdout;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:r:po:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j':
+                jobs = strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                repeat = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                args.packetize_only = true;
+                break;
+            case 'o':
+                out = fopen(optarg, "w");
+                if (out == NULL)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (jobs < 1)
+        jobs = 1;
+    if (repeat < 1)
+        repeat = 1;
+
+#ifdef __GLIBC__
+    vlc_run_allocations = GetAllocations;
+#endif
+
+    struct corpus corpus = { NULL, 0, 0 };
+    for (int i = optind; i < argc; i++)
+        corpus_Scan(&corpus, argv[i]);
+    if (corpus.count == 0)
+    {
+        fprintf(stderr, "Error: no files to process\n");
+        return 1;
+    }
+    qsort(corpus.jobs, corpus.count, sizeof (*corpus.jobs), job_Compare);
+
+    size_t next = 0, running = 0, failed = 0;
+    while (next < corpus.count || running > 0)
+    {
+        while (running < (size_t) jobs && next < corpus.count)
+        {
+            struct job *job = &corpus.jobs[next++];
+            if (job_Start(job, &args, repeat))
+            {
+                fprintf(stderr, "Error: cannot start %s\n", job->path);
+                job->crashed = true;
+                continue;
+            }
+            running++;
+        }
+        if (running == 0)
+            continue;
+
+        struct rusage ru;
+        int status;
+        pid_t pid = wait4(-1, &status, 0, &ru);
+        if (pid == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("wait4");
+            return 1;
+        }
+
+        for (size_t i = 0; i < corpus.count; i++)
+            if (corpus.jobs[i].fd != -1 && corpus.jobs[i].pid == pid)
+            {
+                job_Finish(&corpus.jobs[i], status, &ru);
+                running--;
+                break;
+            }
+    }
+
+    for (size_t i = 0; i < corpus.count; i++)
+    {
+        struct job *job = &corpus.jobs[i];
+        if (job->crashed || job->result.status)
+            failed++;
+        PrintJob(out, job, vlc_run_allocations != NULL);
+        free(job->path);
+    }
+    free(corpus.jobs);
+
+    fprintf(stderr, "%zu file(s), %zu failure(s)\n", corpus.count, failed);
+    if (out != stdout)
+        fclose(out);
+    return failed ? 1 : 0;
+}
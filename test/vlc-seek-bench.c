@@ -0,0 +1,319 @@
+/**
+ * @file vlc-seek-bench.c
+ */
+/*****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Measures the latency of precise seeks: the time from the start of the
+ * playback at a given time to the display of its first frame, for times
+ * spread over the files. The playback of each time is started from scratch
+ * (with the start-time option) so that no frame from before the seek can be
+ * mistaken for the first one. The latency from the beginning of the file
+ * is measured too, as a reference for the opening cost.
+ *
+ * The options after "--" are passed to libvlc, to compare settings, like
+ * --no-preroll-skip.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vlc/vlc.h>
+
+#define WIDTH  160
+#define HEIGHT 90
+#define TIMEOUT_SEC 20
+
+struct run
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+    bool displayed;
+    bool failed;
+    uint32_t pixels[WIDTH * HEIGHT];
+};
+
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *Lock(void *opaque, void **planes)
+{
+    struct run *run = opaque;
+    planes[0] = run->pixels;
+    return NULL;
+}
+
+static void Display(void *opaque, void *picture)
+{
+    struct run *run = opaque;
+    (void) picture;
+
+    pthread_mutex_lock(&run->lock);
+    run->displayed = true;
+    pthread_cond_signal(&run->wait);
+    pthread_mutex_unlock(&run->lock);
+}
+
+static void OnEvent(const libvlc_event_t *event, void *opaque)
+{
+    struct run *run = opaque;
+    (void) event;
+
+    pthread_mutex_lock(&run->lock);
+    run->failed = true;
+    pthread_cond_signal(&run->wait);
+    pthread_mutex_unlock(&run->lock);
+}
+
+/**
+ * Plays a file from a time until its first frame is displayed
+ *
+ * \param time_ms the start time, 0 for the beginning
+ * \param length_ms filled with the length of the file, if not NULL
+ * \return the latency in ns, or 0 on error
+ */
+static uint64_t RunOnce(libvlc_instance_t *vlc, const char *path,
+                        libvlc_time_t time_ms, libvlc_time_t *length_ms)
+{
+    libvlc_media_t *media = libvlc_media_new_path(vlc, path);
+    if (media == NULL)
+        return 0;
+
+    if (time_ms > 0)
+    {
+        char option[64];
+        snprintf(option, sizeof (option), ":start-time=%.3f",
+                 time_ms / 1000.);
+        libvlc_media_add_option(media, option);
+    }
+
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    libvlc_media_release(media);
+    if (mp == NULL)
+        return 0;
+
+    struct run run = { .displayed = false, .failed = false };
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.wait, NULL);
+
+    libvlc_video_set_callbacks(mp, Lock, NULL, Display, &run);
+    libvlc_video_set_format(mp, "RV32", WIDTH, HEIGHT, WIDTH * 4);
+
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, OnEvent, &run);
+    libvlc_event_attach(em, libvlc_MediaPlayerEndReached, OnEvent, &run);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += TIMEOUT_SEC;
+
+    uint64_t start = NowNs();
+    uint64_t latency = 0;
+
+    if (libvlc_media_player_play(mp) == 0)
+    {
+        int ret = 0;
+
+        pthread_mutex_lock(&run.lock);
+        while (!run.displayed && !run.failed && ret != ETIMEDOUT)
+            ret = pthread_cond_timedwait(&run.wait, &run.lock, &deadline);
+        if (run.displayed)
+            latency = NowNs() - start;
+        pthread_mutex_unlock(&run.lock);
+    }
+
+    if (length_ms != NULL)
+        *length_ms = libvlc_media_player_get_length(mp);
+
+    libvlc_event_detach(em, libvlc_MediaPlayerEncounteredError, OnEvent, &run);
+    libvlc_event_detach(em, libvlc_MediaPlayerEndReached, OnEvent, &run);
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+
+    pthread_cond_destroy(&run.wait);
+    pthread_mutex_destroy(&run.lock);
+    return latency;
+}
+
+static int CompareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void PrintString(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *) str; *p; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            fprintf(out, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(out, "\\u%04x", *p);
+        else
+            fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+/* Seeks to count times spread over the file, after its first tenth so that
+ * the long GOPs of the beginning are not favoured, and prints the result */
+static int RunFile(libvlc_instance_t *vlc, const char *path, unsigned count,
+                   FILE *out)
+{
+    libvlc_time_t length_ms = 0;
+    uint64_t open_ns = RunOnce(vlc, path, 0, &length_ms);
+
+    fputs("{\"file\":", out);
+    PrintString(out, path);
+
+    if (open_ns == 0 || length_ms <= 0)
+    {
+        fputs(",\"status\":\"error\"}\n", out);
+        return -1;
+    }
+
+    uint64_t *seeks = calloc(count, sizeof (*seeks));
+    if (seeks == NULL)
+        abort();
+
+    unsigned failed = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        /* Odd offsets, to land between the keyframes */
+        libvlc_time_t time_ms = length_ms / 10
+                              + (length_ms * 8 / 10) * i / count + 333;
+
+        seeks[i] = RunOnce(vlc, path, time_ms, NULL);
+        if (seeks[i] == 0)
+            failed++;
+    }
+    qsort(seeks, count, sizeof (*seeks), CompareU64);
+
+    /* The failures are sorted first */
+    const uint64_t *ok = seeks + failed;
+    const unsigned ok_count = count - failed;
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < ok_count; i++)
+        sum += ok[i];
+
+    fprintf(out, ",\"status\":\"%s\",\"length_ms\":%" PRId64
+            ",\"open_ns\":%" PRIu64 ",\"seeks\":%u,\"failed\":%u",
+            failed ? "error" : "ok", (int64_t) length_ms, open_ns, count,
+            failed);
+    if (ok_count > 0)
+        fprintf(out, ",\"seek_ns\":{\"min\":%" PRIu64 ",\"median\":%" PRIu64
+                ",\"mean\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+                ok[0], ok[ok_count / 2], sum / ok_count, ok[ok_count - 1]);
+    fputs("}\n", out);
+
+    free(seeks);
+    return failed ? -1 : 0;
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-n seeks] [-o output] <file>... [-- vlc options]\n"
+            "  -n  seeks per file (default: 20)\n"
+            "  -o  output file (default: standard output)\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned count = 20;
+    FILE *out = stdout;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+n:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                count = strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                out = fopen(optarg, "w");
+                if (out == NULL)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    /* getopt() stopped at "--" or at the first file */
+    int files_end = optind;
+    while (files_end < argc && strcmp(argv[files_end], "--"))
+        files_end++;
+
+    if (optind >= files_end || count == 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    /* Run from the build tree by default */
+    setenv("VLC_PLUGIN_PATH", "../modules", 0);
+
+    const char *vlc_argv[64] = { "--no-audio", "--quiet" };
+    int vlc_argc = 2;
+    for (int i = files_end + 1; i < argc && vlc_argc < 64; i++)
+        vlc_argv[vlc_argc++] = argv[i];
+
+    libvlc_instance_t *vlc = libvlc_new(vlc_argc, vlc_argv);
+    if (vlc == NULL)
+    {
+        fprintf(stderr, "Error: cannot create the libvlc instance\n");
+        return 1;
+    }
+
+    unsigned failed = 0;
+    for (int i = optind; i < files_end; i++)
+        if (RunFile(vlc, argv[i], count, out))
+            failed++;
+
+    libvlc_release(vlc);
+
+    fprintf(stderr, "%d file(s), %u failure(s)\n", files_end - optind,
+            failed);
+    if (out != stdout)
+        fclose(out);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+/**
+ * @file vlc-thumbnail-bench.c
+ */
+/*****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Generates the thumbnails of a corpus of local files through the libvlc
+ * thumbnailer, as a media library would, and prints the throughput and the
+ * latency of the requests, including their wait in the queue, as a JSON
+ * object.
+ *
+ * Several requests are queued at once, the thumbnailer runs as many of them
+ * as set by --thumbnail-threads. The options after "--" are passed to
+ * libvlc.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vlc/vlc.h>
+
+#define MAX_QUEUED 256
+
+struct slot
+{
+    libvlc_media_t *md;
+    uint64_t start_ns;
+    uint64_t latency_ns;
+    bool done;
+    bool ok;
+};
+
+struct bench
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+    struct slot slots[MAX_QUEUED];
+    unsigned queued;
+
+    uint64_t *latencies;
+    size_t count;
+    size_t size;
+    size_t failed;
+};
+
+static uint64_t NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct bench bench = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wait = PTHREAD_COND_INITIALIZER,
+};
+
+static void OnThumbnail(const libvlc_event_t *event, void *opaque)
+{
+    struct slot *slot = opaque;
+
+    pthread_mutex_lock(&bench.lock);
+    slot->latency_ns = NowNs() - slot->start_ns;
+    slot->ok = event->u.media_thumbnail_generated.p_thumbnail != NULL;
+    slot->done = true;
+    pthread_cond_signal(&bench.wait);
+    pthread_mutex_unlock(&bench.lock);
+}
+
+/* Releases a finished request, with the lock held */
+static void slot_Finish(struct slot *slot)
+{
+    libvlc_event_detach(libvlc_media_event_manager(slot->md),
+                        libvlc_MediaThumbnailGenerated, OnThumbnail, slot);
+    libvlc_media_release(slot->md);
+    slot->md = NULL;
+    bench.queued--;
+
+    if (!slot->ok)
+    {
+        bench.failed++;
+        return;
+    }
+
+    if (bench.count == bench.size)
+    {
+        bench.size = bench.size ? bench.size * 2 : 1024;
+        bench.latencies = realloc(bench.latencies,
+                                  bench.size * sizeof (*bench.latencies));
+        if (bench.latencies == NULL)
+            abort();
+    }
+    bench.latencies[bench.count++] = slot->latency_ns;
+}
+
+/* Waits for a free slot, and returns it, with the lock held */
+static struct slot *bench_GetSlot(unsigned queue)
+{
+    for (;;)
+    {
+        for (unsigned i = 0; i < queue; i++)
+        {
+            struct slot *slot = &bench.slots[i];
+            if (slot->md != NULL && slot->done)
+                slot_Finish(slot);
+            if (slot->md == NULL)
+                return slot;
+        }
+        pthread_cond_wait(&bench.wait, &bench.lock);
+    }
+}
+
+static void Request(libvlc_instance_t *vlc, const char *path, unsigned queue,
+                    libvlc_thumbnailer_seek_speed_t speed, float pos)
+{
+    pthread_mutex_lock(&bench.lock);
+    struct slot *slot = bench_GetSlot(queue);
+
+    slot->md = libvlc_media_new_path(vlc, path);
+    if (slot->md == NULL)
+    {
+        bench.failed++;
+        pthread_mutex_unlock(&bench.lock);
+        return;
+    }
+    slot->done = slot->ok = false;
+    slot->start_ns = NowNs();
+    bench.queued++;
+    libvlc_event_attach(libvlc_media_event_manager(slot->md),
+                        libvlc_MediaThumbnailGenerated, OnThumbnail, slot);
+    pthread_mutex_unlock(&bench.lock);
+
+    /* The event is sent even in case of later failure */
+    if (libvlc_media_thumbnail_request_by_pos(slot->md, pos, speed, 512, 320,
+                                              libvlc_picture_Jpg, 0) == NULL)
+    {
+        pthread_mutex_lock(&bench.lock);
+        slot->done = true;
+        pthread_mutex_unlock(&bench.lock);
+    }
+}
+
+static void Scan(libvlc_instance_t *vlc, const char *path, unsigned queue,
+                 libvlc_thumbnailer_seek_speed_t speed, float pos)
+{
+    struct stat st;
+    if (stat(path, &st))
+    {
+        fprintf(stderr, "Error: cannot stat %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    if (!S_ISDIR(st.st_mode))
+    {
+        Request(vlc, path, queue, speed, pos);
+        return;
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (ent->d_name[0] == '.')
+            continue;
+
+        char *sub;
+        if (asprintf(&sub, "%s/%s", path, ent->d_name) < 0)
+            abort();
+        Scan(vlc, sub, queue, speed, pos);
+        free(sub);
+    }
+    closedir(dir);
+}
+
+static int CompareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-m mode] [-p position] [-q queue] "
+            "<file or directory>... [-- vlc options]\n"
+            "  -m  seek mode: precise, fast or keyframe (default: keyframe)\n"
+            "  -p  position of the thumbnails (default: 0.3)\n"
+            "  -q  requests queued at once (default: 64)\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    libvlc_thumbnailer_seek_speed_t speed =
+        libvlc_media_thumbnail_seek_keyframe;
+    const char *mode = "keyframe";
+    float pos = .3f;
+    unsigned queue = 64;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+m:p:q:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                mode = optarg;
+                if (!strcmp(mode, "precise"))
+                    speed = libvlc_media_thumbnail_seek_precise;
+                else if (!strcmp(mode, "fast"))
+                    speed = libvlc_media_thumbnail_seek_fast;
+                else if (!strcmp(mode, "keyframe"))
+                    speed = libvlc_media_thumbnail_seek_keyframe;
+                else
+                {
+                    Usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'p':
+                pos = strtof(optarg, NULL);
+                break;
+            case 'q':
+                queue = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    int files_end = optind;
+    while (files_end < argc && strcmp(argv[files_end], "--"))
+        files_end++;
+
+    if (optind >= files_end)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (queue < 1)
+        queue = 1;
+    if (queue > MAX_QUEUED)
+        queue = MAX_QUEUED;
+
+    /* Run from the build tree by default */
+    setenv("VLC_PLUGIN_PATH", "../modules", 0);
+
+    const char *vlc_argv[64] = { "--quiet" };
+    int vlc_argc = 1;
+    for (int i = files_end + 1; i < argc && vlc_argc < 64; i++)
+        vlc_argv[vlc_argc++] = argv[i];
+
+    libvlc_instance_t *vlc = libvlc_new(vlc_argc, vlc_argv);
+    if (vlc == NULL)
+    {
+        fprintf(stderr, "Error: cannot create the libvlc instance\n");
+        return 1;
+    }
+
+    uint64_t start = NowNs();
+    for (int i = optind; i < files_end; i++)
+        Scan(vlc, argv[i], queue, speed, pos);
+
+    pthread_mutex_lock(&bench.lock);
+    while (bench.queued > 0)
+    {
+        for (unsigned i = 0; i < queue; i++)
+            if (bench.slots[i].md != NULL && bench.slots[i].done)
+                slot_Finish(&bench.slots[i]);
+        if (bench.queued > 0)
+            pthread_cond_wait(&bench.wait, &bench.lock);
+    }
+    pthread_mutex_unlock(&bench.lock);
+    uint64_t wall_ns = NowNs() - start;
+
+    libvlc_release(vlc);
+
+    const size_t total = bench.count + bench.failed;
+    printf("{\"mode\":\"%s\",\"files\":%zu,\"failed\":%zu,\"wall_ns\":%" PRIu64
+           ",\"per_second\":%.2f", mode, total, bench.failed, wall_ns,
+           wall_ns ? bench.count * 1e9 / wall_ns : 0.);
+    if (bench.count > 0)
+    {
+        qsort(bench.latencies, bench.count, sizeof (*bench.latencies),
+              CompareU64);
+        printf(",\"latency_ns\":{\"min\":%" PRIu64 ",\"median\":%" PRIu64
+               ",\"p90\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+               bench.latencies[0], bench.latencies[bench.count / 2],
+               bench.latencies[bench.count * 9 / 10],
+               bench.latencies[bench.count - 1]);
+    }
+    puts("}");
+
+    free(bench.latencies);
+    return bench.failed ? 1 : 0;
+}